@@ -0,0 +1,373 @@
+// Copyright Twitch Interactive, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: MIT
+
+// Throughput and latency benchmarks. Each case prints one JSON object per line on stdout so that runs
+// can be diffed between releases; progress and failures go to stderr.
+
+#include "ConnectionFactory.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace Twitch::IPC;
+using namespace std::chrono_literals;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+enum class Transport { Pipe, Tcp, SharedMemory };
+enum class Mode { Send, Invoke, Blocking };
+
+constexpr size_t DefaultSizes[] = {16, 256, 4 * 1024, 64 * 1024, 1024 * 1024, 16 * 1024 * 1024, 64 * 1024 * 1024};
+// Send cases stamp the send time into the first bytes of each message
+constexpr size_t StampSize = sizeof(int64_t);
+constexpr auto ConnectTimeout = 10s;
+constexpr auto CaseTimeout = 120s;
+
+struct Options {
+    std::vector<Transport> transports{Transport::Pipe, Transport::Tcp, Transport::SharedMemory};
+    std::vector<Mode> modes{Mode::Send, Mode::Invoke, Mode::Blocking};
+    size_t maxSize = 64 * 1024 * 1024;
+    size_t maxClients = 4;
+    // Roughly how many bytes each case moves, within the message count limits below
+    size_t bytesPerCase = 256 * 1024 * 1024;
+    size_t minMessages = 4;
+    size_t maxMessages = 100000;
+};
+
+struct Case {
+    Transport transport;
+    Mode mode;
+    size_t messageSize;
+    size_t clients;
+    int index;
+};
+
+struct Result {
+    bool ok = true;
+    size_t messages = 0;
+    double seconds = 0;
+    // One-way for sends, round trip for invokes of either kind
+    std::vector<int64_t> latencies;
+};
+
+const char *toString(Transport transport)
+{
+    switch(transport) {
+    case Transport::Pipe:
+        return "pipe";
+    case Transport::Tcp:
+        return "tcp";
+    case Transport::SharedMemory:
+        return "shm";
+    }
+    return "unknown";
+}
+
+const char *toString(Mode mode)
+{
+    switch(mode) {
+    case Mode::Send:
+        return "send";
+    case Mode::Invoke:
+        return "invoke";
+    case Mode::Blocking:
+        return "blocking";
+    }
+    return "unknown";
+}
+
+int64_t nowNanoseconds()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+}
+
+std::string endpointFor(const Case &benchCase)
+{
+    // A fresh endpoint per case so a slow teardown can't get in the way of the next one
+    if(benchCase.transport == Transport::Tcp) {
+        return "127.0.0.1:" + std::to_string(10500 + benchCase.index % 1000);
+    }
+    return "twitch-native-ipc.bench." + std::to_string(benchCase.index) + ".sock";
+}
+
+std::unique_ptr<IServerConnection> makeServer(Transport transport, const std::string &endpoint)
+{
+    switch(transport) {
+    case Transport::Pipe:
+        return ConnectionFactory::newMulticonnectServerConnection(endpoint);
+    case Transport::Tcp:
+        return ConnectionFactory::newMulticonnectServerConnectionTCP(endpoint);
+    case Transport::SharedMemory:
+        return ConnectionFactory::newMulticonnectServerConnectionShm(endpoint);
+    }
+    return nullptr;
+}
+
+std::unique_ptr<IConnection> makeClient(Transport transport, const std::string &endpoint)
+{
+    switch(transport) {
+    case Transport::Pipe:
+        return ConnectionFactory::newClientConnection(endpoint);
+    case Transport::Tcp:
+        return ConnectionFactory::newClientConnectionTCP(endpoint);
+    case Transport::SharedMemory:
+        return ConnectionFactory::newClientConnectionShm(endpoint);
+    }
+    return nullptr;
+}
+
+size_t messageCount(const Options &options, const Case &benchCase)
+{
+    auto count = options.bytesPerCase / benchCase.messageSize;
+    if(benchCase.mode != Mode::Send) {
+        // Invokes wait for each other, so they get a tenth of the messages
+        count /= 10;
+    }
+    count = std::clamp(count, options.minMessages, options.maxMessages);
+    // Every client sends the same number
+    return std::max<size_t>(1, count / benchCase.clients) * benchCase.clients;
+}
+
+Result runCase(const Options &options, const Case &benchCase)
+{
+    Result result;
+    const auto endpoint = endpointFor(benchCase);
+    const auto total = messageCount(options, benchCase);
+    const auto perClient = total / benchCase.clients;
+
+    std::mutex mutex;
+    std::condition_variable condition;
+    size_t connected = 0;
+    size_t received = 0;
+
+    auto server = makeServer(benchCase.transport, endpoint);
+    server->onConnect([&](Handle) {
+        std::lock_guard guard(mutex);
+        ++connected;
+        condition.notify_all();
+    });
+    // Runs on the server's one dispatch thread, so the samples need no lock until the case is done
+    server->onReceived([&](Handle, Payload data) {
+        if(data.size() >= StampSize) {
+            int64_t sent{};
+            memcpy(&sent, data.data(), StampSize);
+            result.latencies.push_back(nowNanoseconds() - sent);
+        }
+        std::lock_guard guard(mutex);
+        if(++received == total) {
+            condition.notify_all();
+        }
+    });
+    server->onInvoked([](Handle, Payload) { return Payload(); });
+    server->connect();
+
+    std::vector<std::unique_ptr<IConnection>> clients;
+    for(size_t i = 0; i < benchCase.clients; ++i) {
+        clients.emplace_back(makeClient(benchCase.transport, endpoint));
+        clients.back()->connect();
+    }
+    {
+        std::unique_lock lock(mutex);
+        if(!condition.wait_for(lock, ConnectTimeout, [&] { return connected == benchCase.clients; })) {
+            fprintf(stderr, "  clients did not connect\n");
+            result.ok = false;
+            return result;
+        }
+    }
+
+    const Payload body(std::vector<uint8_t>(benchCase.messageSize, 0x5a));
+    std::vector<std::vector<int64_t>> clientLatencies(benchCase.clients);
+    std::atomic_bool failed{false};
+    const auto start = Clock::now();
+    std::vector<std::thread> threads;
+    for(size_t i = 0; i < benchCase.clients; ++i) {
+        threads.emplace_back([&, i] {
+            auto &client = *clients[i];
+            if(benchCase.mode == Mode::Send) {
+                for(size_t j = 0; j < perClient; ++j) {
+                    auto message = body;
+                    if(message.size() >= StampSize) {
+                        const auto sent = nowNanoseconds();
+                        memcpy(message.data(), &sent, StampSize);
+                    }
+                    client.send(std::move(message));
+                }
+                return;
+            }
+            auto &latencies = clientLatencies[i];
+            latencies.reserve(perClient);
+            if(benchCase.mode == Mode::Blocking) {
+                for(size_t j = 0; j < perClient && !failed; ++j) {
+                    const auto sent = Clock::now();
+                    if(client.invokeBlocking(body, CaseTimeout).resultCode != InvokeResultCode::Good) {
+                        failed = true;
+                        break;
+                    }
+                    latencies.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - sent).count());
+                }
+                return;
+            }
+            std::mutex invokeMutex;
+            std::condition_variable invokeCondition;
+            for(size_t j = 0; j < perClient && !failed; ++j) {
+                bool answered = false;
+                const auto sent = Clock::now();
+                client.invoke(body, [&](InvokeResultCode code, Payload) {
+                    std::lock_guard guard(invokeMutex);
+                    answered = true;
+                    if(code != InvokeResultCode::Good) {
+                        failed = true;
+                    }
+                    invokeCondition.notify_one();
+                });
+                std::unique_lock lock(invokeMutex);
+                if(!invokeCondition.wait_for(lock, CaseTimeout, [&] { return answered; })) {
+                    failed = true;
+                    break;
+                }
+                latencies.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - sent).count());
+            }
+        });
+    }
+    for(auto &thread : threads) {
+        thread.join();
+    }
+    if(benchCase.mode == Mode::Send) {
+        std::unique_lock lock(mutex);
+        if(!condition.wait_for(lock, CaseTimeout, [&] { return received == total; })) {
+            failed = true;
+        }
+    }
+    result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    result.messages = total;
+    result.ok = !failed;
+
+    clients.clear();
+    server.reset();
+    for(auto &latencies : clientLatencies) {
+        result.latencies.insert(result.latencies.end(), latencies.begin(), latencies.end());
+    }
+    return result;
+}
+
+double percentileMicroseconds(const std::vector<int64_t> &sorted, double fraction)
+{
+    if(sorted.empty()) {
+        return 0;
+    }
+    const auto rank = static_cast<size_t>(fraction * static_cast<double>(sorted.size()) + 0.5);
+    const auto index = std::min(sorted.size() - 1, rank ? rank - 1 : 0);
+    return static_cast<double>(sorted[index]) / 1000.0;
+}
+
+void printResult(const Case &benchCase, Result &result)
+{
+    std::sort(result.latencies.begin(), result.latencies.end());
+    const auto seconds = result.seconds > 0 ? result.seconds : 1e-9;
+    const auto bytes = static_cast<double>(result.messages) * static_cast<double>(benchCase.messageSize);
+    printf("{\"transport\":\"%s\",\"mode\":\"%s\",\"size\":%zu,\"clients\":%zu,\"ok\":%s,\"messages\":%zu,"
+           "\"seconds\":%.6f,\"messagesPerSecond\":%.1f,\"megabytesPerSecond\":%.2f,"
+           "\"p50us\":%.2f,\"p99us\":%.2f,\"p999us\":%.2f,\"maxus\":%.2f}\n",
+        toString(benchCase.transport),
+        toString(benchCase.mode),
+        benchCase.messageSize,
+        benchCase.clients,
+        result.ok ? "true" : "false",
+        result.messages,
+        result.seconds,
+        static_cast<double>(result.messages) / seconds,
+        bytes / seconds / (1024.0 * 1024.0),
+        percentileMicroseconds(result.latencies, 0.5),
+        percentileMicroseconds(result.latencies, 0.99),
+        percentileMicroseconds(result.latencies, 0.999),
+        percentileMicroseconds(result.latencies, 1.0));
+    fflush(stdout);
+}
+
+void printUsage()
+{
+    fprintf(stderr,
+        "Usage: nativeipc_bench [options]\n"
+        "  --quick               fewer messages, and sizes up to 1MB\n"
+        "  --transport=LIST      any of pipe,tcp,shm (default: all)\n"
+        "  --mode=LIST           any of send,invoke,blocking (default: all)\n"
+        "  --max-size=BYTES      largest message size in the sweep (default: 64MB)\n"
+        "  --clients=N           runs each case with 1, 2, 4... up to N clients (default: 4)\n");
+}
+
+bool parseOptions(int argc, char **argv, Options &options)
+{
+    for(int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const auto value = arg.substr(arg.find('=') + 1);
+        if(arg == "--quick") {
+            options.maxSize = std::min<size_t>(options.maxSize, 1024 * 1024);
+            options.bytesPerCase = 16 * 1024 * 1024;
+            options.maxMessages = 10000;
+        } else if(arg.rfind("--transport=", 0) == 0) {
+            options.transports.clear();
+            for(const auto *name : {"pipe", "tcp", "shm"}) {
+                if(value.find(name) != std::string::npos) {
+                    options.transports.push_back(
+                        name[0] == 'p' ? Transport::Pipe : name[0] == 't' ? Transport::Tcp : Transport::SharedMemory);
+                }
+            }
+        } else if(arg.rfind("--mode=", 0) == 0) {
+            options.modes.clear();
+            if(value.find("send") != std::string::npos) {
+                options.modes.push_back(Mode::Send);
+            }
+            if(value.find("invoke") != std::string::npos) {
+                options.modes.push_back(Mode::Invoke);
+            }
+            if(value.find("blocking") != std::string::npos) {
+                options.modes.push_back(Mode::Blocking);
+            }
+        } else if(arg.rfind("--max-size=", 0) == 0) {
+            options.maxSize = std::stoull(value);
+        } else if(arg.rfind("--clients=", 0) == 0) {
+            options.maxClients = std::max<size_t>(1, std::stoul(value));
+        } else {
+            return false;
+        }
+    }
+    return !options.transports.empty() && !options.modes.empty();
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    Options options;
+    if(!parseOptions(argc, argv, options)) {
+        printUsage();
+        return 2;
+    }
+
+    int index = 0;
+    bool allOk = true;
+    for(const auto transport : options.transports) {
+        for(const auto mode : options.modes) {
+            for(const auto size : DefaultSizes) {
+                if(size > options.maxSize) {
+                    continue;
+                }
+                for(size_t clients = 1; clients <= options.maxClients; clients *= 2) {
+                    const Case benchCase{transport, mode, size, clients, index++};
+                    fprintf(stderr, "%s %s %zu bytes, %zu clients\n", toString(transport), toString(mode), size, clients);
+                    auto result = runCase(options, benchCase);
+                    allOk = allOk && result.ok;
+                    printResult(benchCase, result);
+                }
+            }
+        }
+    }
+    return allOk ? 0 : 1;
+}
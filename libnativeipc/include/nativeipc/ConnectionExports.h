@@ -22,6 +22,52 @@
 extern "C" {
 #endif
 typedef void *Twitch_IPC_Connection;
+// A multi-connect server, which tells its clients apart by connection id
+typedef void *Twitch_IPC_ServerConnection;
+// A message in native memory that stays put until it is released or sent, so that the caller can
+// wrap or pin it where it is instead of copying it
+typedef void *Twitch_IPC_Buffer;
+
+typedef enum Twitch_IPC_MessageKind {
+    Twitch_IPC_MessageReceived = 0,
+    Twitch_IPC_MessageInvoked = 1,
+    Twitch_IPC_MessageResult = 2,
+} Twitch_IPC_MessageKind;
+
+// A message handed out by Poll. `buffer` holds the `length` bytes at `data` and is the caller's to
+// release or send on. Clients see connection id 0; promiseId is 0 for plain messages.
+typedef struct Twitch_IPC_Message {
+    int32_t kind;
+    uint32_t connectionId;
+    uint32_t promiseId;
+    int32_t length;
+    const void *data;
+    Twitch_IPC_Buffer buffer;
+} Twitch_IPC_Message;
+
+// Mirrors Twitch::IPC::ConnectionStats, with the invoke latency histogram summed up in microseconds
+typedef struct Twitch_IPC_ConnectionStats {
+    uint64_t messagesSent;
+    uint64_t bytesSent;
+    uint64_t messagesReceived;
+    uint64_t bytesReceived;
+    uint64_t writeQueueMessages;
+    uint64_t writeQueueBytes;
+    uint64_t writesInFlight;
+    uint64_t dispatchBacklog;
+    uint64_t pendingInvokes;
+    uint64_t peakPendingInvokes;
+    uint64_t invokesRejected;
+    uint64_t reorderedResults;
+    uint64_t reconnects;
+    uint64_t latestValuesReplaced;
+    uint64_t invokeCount;
+    uint64_t invokeLatencyP50;
+    uint64_t invokeLatencyP90;
+    uint64_t invokeLatencyP99;
+    uint64_t invokeLatencyP999;
+    uint64_t invokeLatencyMax;
+} Twitch_IPC_ConnectionStats;
 
 NATIVEIPC_LIBSPEC Twitch_IPC_Connection Twitch_IPC_ConnectionCreateServer(const char *endpoint);
 NATIVEIPC_LIBSPEC Twitch_IPC_Connection Twitch_IPC_ConnectionCreateClient(const char *endpoint);
@@ -29,6 +75,8 @@ NATIVEIPC_LIBSPEC Twitch_IPC_Connection Twitch_IPC_ConnectionCreateClient(const
 NATIVEIPC_LIBSPEC void Twitch_IPC_ConnectionDestroy(Twitch_IPC_Connection handle);
 
 NATIVEIPC_LIBSPEC void Twitch_IPC_ConnectionConnect(Twitch_IPC_Connection handle);
+// Returns without waiting for the connection to start; a failure to start calls the OnError callback
+NATIVEIPC_LIBSPEC void Twitch_IPC_ConnectionConnectAsync(Twitch_IPC_Connection handle);
 NATIVEIPC_LIBSPEC void Twitch_IPC_ConnectionDisconnect(Twitch_IPC_Connection handle);
 NATIVEIPC_LIBSPEC void Twitch_IPC_ConnectionSend(
     Twitch_IPC_Connection handle, const void *bytes, int length);
@@ -36,6 +84,18 @@ NATIVEIPC_LIBSPEC uint32_t Twitch_IPC_ConnectionInvoke(
     Twitch_IPC_Connection handle, const void *bytes, int length);
 NATIVEIPC_LIBSPEC void Twitch_IPC_ConnectionSendResult(
     Twitch_IPC_Connection handle, uint32_t connectionId, uint32_t promiseId, const void *bytes, int length);
+// Send or invoke `count` messages at once; message i is lengths[i] bytes at bytes[i]. InvokeMany
+// writes the promise id of each message to promiseIds, which must have room for `count` entries.
+NATIVEIPC_LIBSPEC void Twitch_IPC_ConnectionSendMany(
+    Twitch_IPC_Connection handle, const void *const *bytes, const int *lengths, int count);
+NATIVEIPC_LIBSPEC void Twitch_IPC_ConnectionInvokeMany(Twitch_IPC_Connection handle,
+    const void *const *bytes,
+    const int *lengths,
+    int count,
+    uint32_t *promiseIds);
+
+NATIVEIPC_LIBSPEC void Twitch_IPC_ConnectionGetStats(
+    Twitch_IPC_Connection handle, Twitch_IPC_ConnectionStats *stats);
 
 NATIVEIPC_LIBSPEC void Twitch_IPC_ConnectionOnConnect(Twitch_IPC_Connection handle, void (*fptr)());
 NATIVEIPC_LIBSPEC void Twitch_IPC_ConnectionOnDisconnect(
@@ -50,6 +110,109 @@ NATIVEIPC_LIBSPEC void Twitch_IPC_ConnectionOnResult(
 NATIVEIPC_LIBSPEC void Twitch_IPC_ConnectionOnLog(Twitch_IPC_Connection handle,
     int verbosity,
     void (*fptr)(uint32_t, const char *, const char *));
+
+// Buffers come from a pool that the buffers of received messages go back to once released, so
+// steady traffic reuses the same memory. A new buffer is `capacity` bytes long.
+NATIVEIPC_LIBSPEC Twitch_IPC_Buffer Twitch_IPC_BufferAllocate(int capacity);
+NATIVEIPC_LIBSPEC void *Twitch_IPC_BufferData(Twitch_IPC_Buffer buffer);
+NATIVEIPC_LIBSPEC int Twitch_IPC_BufferLength(Twitch_IPC_Buffer buffer);
+NATIVEIPC_LIBSPEC void Twitch_IPC_BufferRelease(Twitch_IPC_Buffer buffer);
+
+// Send the first `length` bytes of `buffer` without copying them. These take the buffer over, so it
+// must not be used or released afterwards.
+NATIVEIPC_LIBSPEC void Twitch_IPC_ConnectionSendBuffer(
+    Twitch_IPC_Connection handle, Twitch_IPC_Buffer buffer, int length);
+NATIVEIPC_LIBSPEC uint32_t Twitch_IPC_ConnectionInvokeBuffer(
+    Twitch_IPC_Connection handle, Twitch_IPC_Buffer buffer, int length);
+NATIVEIPC_LIBSPEC void Twitch_IPC_ConnectionSendResultBuffer(Twitch_IPC_Connection handle,
+    uint32_t connectionId,
+    uint32_t promiseId,
+    Twitch_IPC_Buffer buffer,
+    int length);
+// Like OnReceived, OnInvoked and OnResult, but lend the message's buffer to the callback instead of
+// only showing it the bytes for the duration of the call. The callback owns the buffer and must
+// release it, which it can do later on any thread.
+NATIVEIPC_LIBSPEC void Twitch_IPC_ConnectionOnReceivedBuffer(
+    Twitch_IPC_Connection handle, void (*fptr)(Twitch_IPC_Buffer, const void *, int));
+NATIVEIPC_LIBSPEC void Twitch_IPC_ConnectionOnInvokedBuffer(Twitch_IPC_Connection handle,
+    void (*fptr)(uint32_t, uint32_t, Twitch_IPC_Buffer, const void *, int));
+NATIVEIPC_LIBSPEC void Twitch_IPC_ConnectionOnResultBuffer(
+    Twitch_IPC_Connection handle, void (*fptr)(uint32_t, Twitch_IPC_Buffer, const void *, int));
+
+// Instead of a callback per message, collects received messages, invokes and results for the caller to
+// take many at a time with Poll. This replaces any OnReceived, OnInvoked and OnResult callbacks.
+// Up to `capacity` messages wait, or 4096 if it is 0. Until the caller polls, any more received messages
+// are dropped, and any more invokes are answered at once with an empty result. Results are never dropped.
+// `ready`, if given, is called with `context` each time a message arrives while none are waiting, so a
+// caller can sleep until then and poll until Poll returns 0.
+NATIVEIPC_LIBSPEC void Twitch_IPC_ConnectionEnablePolling(
+    Twitch_IPC_Connection handle, int capacity, void (*ready)(void *), void *context);
+// Moves up to `maxCount` waiting messages, oldest first, to `messages` and returns how many it moved
+NATIVEIPC_LIBSPEC int Twitch_IPC_ConnectionPoll(
+    Twitch_IPC_Connection handle, Twitch_IPC_Message *messages, int maxCount);
+// How many messages and invokes arrived to a full queue and were turned away since polling was enabled
+NATIVEIPC_LIBSPEC uint64_t Twitch_IPC_ConnectionPollDropped(Twitch_IPC_Connection handle);
+
+// Multi-connect servers. Callbacks get the connection id of the client first.
+NATIVEIPC_LIBSPEC Twitch_IPC_ServerConnection Twitch_IPC_ServerConnectionCreate(const char *endpoint);
+NATIVEIPC_LIBSPEC void Twitch_IPC_ServerConnectionDestroy(Twitch_IPC_ServerConnection handle);
+
+NATIVEIPC_LIBSPEC void Twitch_IPC_ServerConnectionConnect(Twitch_IPC_ServerConnection handle);
+NATIVEIPC_LIBSPEC void Twitch_IPC_ServerConnectionConnectAsync(Twitch_IPC_ServerConnection handle);
+NATIVEIPC_LIBSPEC void Twitch_IPC_ServerConnectionDisconnect(Twitch_IPC_ServerConnection handle);
+NATIVEIPC_LIBSPEC int Twitch_IPC_ServerConnectionActiveConnections(Twitch_IPC_ServerConnection handle);
+NATIVEIPC_LIBSPEC void Twitch_IPC_ServerConnectionSend(
+    Twitch_IPC_ServerConnection handle, uint32_t connectionId, const void *bytes, int length);
+NATIVEIPC_LIBSPEC void Twitch_IPC_ServerConnectionBroadcast(
+    Twitch_IPC_ServerConnection handle, const void *bytes, int length);
+NATIVEIPC_LIBSPEC uint32_t Twitch_IPC_ServerConnectionInvoke(
+    Twitch_IPC_ServerConnection handle, uint32_t connectionId, const void *bytes, int length);
+NATIVEIPC_LIBSPEC void Twitch_IPC_ServerConnectionSendResult(Twitch_IPC_ServerConnection handle,
+    uint32_t connectionId,
+    uint32_t promiseId,
+    const void *bytes,
+    int length);
+NATIVEIPC_LIBSPEC void Twitch_IPC_ServerConnectionSendBuffer(
+    Twitch_IPC_ServerConnection handle, uint32_t connectionId, Twitch_IPC_Buffer buffer, int length);
+NATIVEIPC_LIBSPEC void Twitch_IPC_ServerConnectionBroadcastBuffer(
+    Twitch_IPC_ServerConnection handle, Twitch_IPC_Buffer buffer, int length);
+NATIVEIPC_LIBSPEC uint32_t Twitch_IPC_ServerConnectionInvokeBuffer(
+    Twitch_IPC_ServerConnection handle, uint32_t connectionId, Twitch_IPC_Buffer buffer, int length);
+NATIVEIPC_LIBSPEC void Twitch_IPC_ServerConnectionSendResultBuffer(Twitch_IPC_ServerConnection handle,
+    uint32_t connectionId,
+    uint32_t promiseId,
+    Twitch_IPC_Buffer buffer,
+    int length);
+
+NATIVEIPC_LIBSPEC void Twitch_IPC_ServerConnectionGetStats(
+    Twitch_IPC_ServerConnection handle, Twitch_IPC_ConnectionStats *stats);
+
+NATIVEIPC_LIBSPEC void Twitch_IPC_ServerConnectionOnConnect(
+    Twitch_IPC_ServerConnection handle, void (*fptr)(uint32_t));
+NATIVEIPC_LIBSPEC void Twitch_IPC_ServerConnectionOnDisconnect(
+    Twitch_IPC_ServerConnection handle, void (*fptr)(uint32_t));
+NATIVEIPC_LIBSPEC void Twitch_IPC_ServerConnectionOnError(
+    Twitch_IPC_ServerConnection handle, void (*fptr)(uint32_t));
+NATIVEIPC_LIBSPEC void Twitch_IPC_ServerConnectionOnReceived(
+    Twitch_IPC_ServerConnection handle, void (*fptr)(uint32_t, const void *, int));
+NATIVEIPC_LIBSPEC void Twitch_IPC_ServerConnectionOnInvoked(
+    Twitch_IPC_ServerConnection handle, void (*fptr)(uint32_t, uint32_t, const void *, int));
+NATIVEIPC_LIBSPEC void Twitch_IPC_ServerConnectionOnResult(
+    Twitch_IPC_ServerConnection handle, void (*fptr)(uint32_t, uint32_t, const void *, int));
+NATIVEIPC_LIBSPEC void Twitch_IPC_ServerConnectionOnReceivedBuffer(
+    Twitch_IPC_ServerConnection handle, void (*fptr)(uint32_t, Twitch_IPC_Buffer, const void *, int));
+NATIVEIPC_LIBSPEC void Twitch_IPC_ServerConnectionOnInvokedBuffer(Twitch_IPC_ServerConnection handle,
+    void (*fptr)(uint32_t, uint32_t, Twitch_IPC_Buffer, const void *, int));
+NATIVEIPC_LIBSPEC void Twitch_IPC_ServerConnectionOnResultBuffer(Twitch_IPC_ServerConnection handle,
+    void (*fptr)(uint32_t, uint32_t, Twitch_IPC_Buffer, const void *, int));
+NATIVEIPC_LIBSPEC void Twitch_IPC_ServerConnectionOnLog(Twitch_IPC_ServerConnection handle,
+    int verbosity,
+    void (*fptr)(uint32_t, uint32_t, const char *, const char *));
+NATIVEIPC_LIBSPEC void Twitch_IPC_ServerConnectionEnablePolling(
+    Twitch_IPC_ServerConnection handle, int capacity, void (*ready)(void *), void *context);
+NATIVEIPC_LIBSPEC int Twitch_IPC_ServerConnectionPoll(
+    Twitch_IPC_ServerConnection handle, Twitch_IPC_Message *messages, int maxCount);
+NATIVEIPC_LIBSPEC uint64_t Twitch_IPC_ServerConnectionPollDropped(Twitch_IPC_ServerConnection handle);
 #ifdef __cplusplus
 }
 #endif
@@ -4,16 +4,55 @@
 #pragma once
 
 #include "ConnectionExports.h"
+#include "IEventLoop.h"
 #include "IServerConnection.h"
 #include <string>
 #include <memory>
 
+namespace Twitch::IPC {
+// Socket settings for TCP connections. Endpoints are "host:port", with IPv6 hosts in brackets like
+// "[::1]:10000", or ":port" for the loopback address on clients and every IPv4 address on servers.
+struct TCPOptions {
+    // Sends small messages and invokes right away instead of holding them back to coalesce with more
+    bool noDelay = true;
+    // Probes idle connections so that a peer that vanished without closing is noticed
+    bool keepAlive = false;
+    unsigned keepAliveDelaySeconds = 60;
+    // Kernel socket buffer sizes in bytes; 0 keeps the system default. Raise them for throughput over
+    // links with a high bandwidth-delay product.
+    int sendBufferSize = 0;
+    int receiveBufferSize = 0;
+    // Servers bound to an IPv6 address like "[::]:10000" also accept IPv4 clients unless this is set
+    bool ipv6Only = false;
+};
+} // namespace Twitch::IPC
+
 namespace Twitch::IPC::ConnectionFactory {
-NATIVEIPC_LIBSPEC std::unique_ptr<IConnection> newServerConnection(const std::string &endpoint, bool allowMultiuserAccess = false);
-NATIVEIPC_LIBSPEC std::unique_ptr<IConnection> newClientConnection(const std::string &endpoint);
+// Every connection runs a loop thread of its own unless it is given an event loop to share
+NATIVEIPC_LIBSPEC std::shared_ptr<IEventLoop> newEventLoop(size_t threadCount = 1);
+
+NATIVEIPC_LIBSPEC std::unique_ptr<IConnection> newServerConnection(const std::string &endpoint,
+    bool allowMultiuserAccess = false, const std::shared_ptr<IEventLoop> &eventLoop = {});
+NATIVEIPC_LIBSPEC std::unique_ptr<IConnection> newClientConnection(
+    const std::string &endpoint, const std::shared_ptr<IEventLoop> &eventLoop = {});
 NATIVEIPC_LIBSPEC std::unique_ptr<IServerConnection> newMulticonnectServerConnection(
-    const std::string &endpoint, bool allowMultiuserAccess = false);
-NATIVEIPC_LIBSPEC std::unique_ptr<IConnection> newServerConnectionTCP(const std::string &endpoint);
-NATIVEIPC_LIBSPEC std::unique_ptr<IConnection> newClientConnectionTCP(const std::string &endpoint);
-NATIVEIPC_LIBSPEC std::unique_ptr<IServerConnection> newMulticonnectServerConnectionTCP(const std::string &endpoint);
+    const std::string &endpoint, bool allowMultiuserAccess = false, const std::shared_ptr<IEventLoop> &eventLoop = {});
+// Same-machine connections that set up over a pipe and move messages through shared memory rings
+NATIVEIPC_LIBSPEC std::unique_ptr<IConnection> newServerConnectionShm(const std::string &endpoint,
+    bool allowMultiuserAccess = false, const std::shared_ptr<IEventLoop> &eventLoop = {});
+NATIVEIPC_LIBSPEC std::unique_ptr<IConnection> newClientConnectionShm(
+    const std::string &endpoint, const std::shared_ptr<IEventLoop> &eventLoop = {});
+NATIVEIPC_LIBSPEC std::unique_ptr<IServerConnection> newMulticonnectServerConnectionShm(
+    const std::string &endpoint, bool allowMultiuserAccess = false, const std::shared_ptr<IEventLoop> &eventLoop = {});
+NATIVEIPC_LIBSPEC std::unique_ptr<IConnection> newServerConnectionTCP(const std::string &endpoint,
+    const TCPOptions &options = {}, const std::shared_ptr<IEventLoop> &eventLoop = {});
+NATIVEIPC_LIBSPEC std::unique_ptr<IConnection> newClientConnectionTCP(const std::string &endpoint,
+    const TCPOptions &options = {}, const std::shared_ptr<IEventLoop> &eventLoop = {});
+NATIVEIPC_LIBSPEC std::unique_ptr<IServerConnection> newMulticonnectServerConnectionTCP(const std::string &endpoint,
+    const TCPOptions &options = {}, const std::shared_ptr<IEventLoop> &eventLoop = {});
+// Both ends in this process, which only meet clients and servers of these with the same endpoint.
+// Payloads are handed over without copying or serializing them, and nothing goes through the kernel.
+NATIVEIPC_LIBSPEC std::unique_ptr<IConnection> newServerConnectionInProc(const std::string &endpoint);
+NATIVEIPC_LIBSPEC std::unique_ptr<IConnection> newClientConnectionInProc(const std::string &endpoint);
+NATIVEIPC_LIBSPEC std::unique_ptr<IServerConnection> newMulticonnectServerConnectionInProc(const std::string &endpoint);
 } // namespace Twitch::IPC::ConnectionFactory
@@ -3,10 +3,19 @@
 
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <functional>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 #include <cstring>
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#include <coroutine>
+#define NATIVEIPC_COROUTINES 1
+#endif
 
 #include "ConnectionExports.h"
 
@@ -14,7 +23,11 @@ namespace Twitch::IPC {
 
 using Handle = uint32_t;
 enum class LogLevel { Debug, Info, Warning, Error, None };
-enum class InvokeResultCode { Good, RemoteDisconnect, LocalDisconnect };
+enum class InvokeResultCode { Good, RemoteDisconnect, LocalDisconnect, Timeout, WindowFull, FrameTooLarge };
+// The write lane a message waits in while the connection can't keep up with what is sent. Control goes
+// before anything else waiting, and bulk gets a turn for every few normal messages, so a small urgent
+// message doesn't queue behind megabytes sent earlier. Messages keep their order within a lane only.
+enum class Priority { Control, Normal, Bulk };
 
 NATIVEIPC_LIBSPEC LogLevel fromString(const char *value);
 NATIVEIPC_LIBSPEC const char *toString(LogLevel value);
@@ -56,12 +69,281 @@ struct Payload : std::vector<uint8_t> {
     }
 };
 
+#ifdef _WIN32
+// A file mapping HANDLE
+using NativeHandle = void *;
+#else
+// A file descriptor for shared memory, e.g. from memfd_create or shm_open
+using NativeHandle = int;
+#endif
+
+// Read-only view of shared memory the peer passed by handle instead of copying it into a Payload.
+// Copies share the mapping, which goes away with the last of them.
+class NATIVEIPC_LIBSPEC SharedPayload {
+public:
+    SharedPayload() = default;
+
+    // Maps the first `size` bytes of `handle`, taking ownership of the handle. Empty if that fails.
+    static SharedPayload map(NativeHandle handle, size_t size);
+
+    [[nodiscard]] const uint8_t *data() const;
+    [[nodiscard]] size_t size() const;
+    [[nodiscard]] bool empty() const
+    {
+        return !size();
+    }
+
+private:
+    struct Mapping;
+    std::shared_ptr<const Mapping> _mapping;
+};
+
+// Invoke round trip times in microseconds. Like an HDR histogram, every power of two is split into
+// SubBuckets equal buckets, so a bucket is never wider than 1/SubBuckets of the values in it.
+struct LatencyHistogram {
+    static constexpr unsigned SubBucketBits = 3;
+    static constexpr uint64_t SubBuckets = uint64_t{1} << SubBucketBits;
+    // Covers up to 2^40 microseconds, about 12 days; anything longer goes in the last bucket
+    static constexpr size_t BucketCount = (40 - SubBucketBits + 1) * SubBuckets;
+
+    uint64_t counts[BucketCount]{};
+    uint64_t count{};
+    uint64_t maxMicroseconds{};
+
+    static size_t bucketFor(uint64_t microseconds)
+    {
+        if(microseconds < SubBuckets) {
+            return static_cast<size_t>(microseconds);
+        }
+        unsigned topBit = SubBucketBits;
+        while(topBit < 63 && microseconds >> (topBit + 1)) {
+            ++topBit;
+        }
+        const auto shift = topBit - SubBucketBits;
+        const auto bucket = (shift + 1) * SubBuckets + (microseconds >> shift) - SubBuckets;
+        return bucket < BucketCount ? static_cast<size_t>(bucket) : BucketCount - 1;
+    }
+
+    // The largest value that lands in `bucket`
+    static uint64_t bucketLimit(size_t bucket)
+    {
+        if(bucket < SubBuckets) {
+            return bucket;
+        }
+        const auto shift = bucket / SubBuckets - 1;
+        return ((bucket % SubBuckets + SubBuckets) << shift) + (uint64_t{1} << shift) - 1;
+    }
+
+    // An upper bound for the given fraction of the samples, e.g. 0.99 for the 99th percentile
+    [[nodiscard]] uint64_t percentile(double fraction) const
+    {
+        if(!count) {
+            return 0;
+        }
+        auto rank = static_cast<uint64_t>(fraction * static_cast<double>(count) + 0.5);
+        rank = rank < 1 ? 1 : rank > count ? count : rank;
+        uint64_t seen = 0;
+        for(size_t i = 0; i < BucketCount; ++i) {
+            seen += counts[i];
+            if(seen >= rank) {
+                const auto limit = bucketLimit(i);
+                return limit < maxMicroseconds ? limit : maxMicroseconds;
+            }
+        }
+        return maxMicroseconds;
+    }
+};
+
+// A snapshot of what a connection has done since it was created. Multi-connect servers add up all
+// of their clients.
+struct ConnectionStats {
+    uint64_t messagesSent{};
+    uint64_t bytesSent{};
+    uint64_t messagesReceived{};
+    uint64_t bytesReceived{};
+    // Queued or being written, including what libuv still holds
+    uint64_t writeQueueMessages{};
+    uint64_t writeQueueBytes{};
+    // uv_write calls that haven't completed yet
+    uint64_t writesInFlight{};
+    // Handler calls waiting for a dispatch thread
+    uint64_t dispatchBacklog{};
+    // Invokes with a callback that is still waiting for its result
+    uint64_t pendingInvokes{};
+    // The most of them in flight on one connection at once, which setInvokeWindow caps
+    uint64_t peakPendingInvokes{};
+    // Invokes turned away with InvokeResultCode::WindowFull
+    uint64_t invokesRejected{};
+    // Results that arrived after the result of a later invoke on the same connection
+    uint64_t reorderedResults{};
+    // Times the connection came back on its own after losing the peer
+    uint64_t reconnects{};
+    // Latest values that were never handled because a newer one on the same channel took their place,
+    // whether before they were sent or before their handler ran
+    uint64_t latestValuesReplaced{};
+    // From invoke to its callback running, for invokes answered by the peer
+    LatencyHistogram invokeLatency;
+};
+
+// How a client retries while the server isn't there, whether on the first connect or after losing it.
+// Each failed attempt waits `multiplier` times longer than the last, up to `maxDelay`, and every wait
+// is moved by up to `jitter` of itself either way, so clients that lost the same server don't all
+// come back at the same moment.
+struct ReconnectPolicy {
+    std::chrono::milliseconds initialDelay{2};
+    std::chrono::milliseconds maxDelay{100};
+    double multiplier = 1.1;
+    double jitter = 0.1;
+    // For pipes, also watches for the server to create its endpoint and connects as soon as it does
+    // instead of waiting out the delay. Other transports only have the delay.
+    bool waitForServer = true;
+};
+
+// Where the handler of a method given to registerMethod runs
+enum class MethodExecutor {
+    // On the I/O thread as soon as the invoke is read, under the same rules as setInlineDispatch
+    Inline,
+    // On the dispatch threads, alongside the other handlers
+    Pool,
+    // On threads of the method's own: maxConcurrency of them, or one without a limit
+    Dedicated
+};
+
+struct MethodOptions {
+    MethodExecutor executor = MethodExecutor::Pool;
+    // How many calls of the method may run at once. Further invokes of it wait their turn without
+    // holding up any other method. 0 means no limit.
+    size_t maxConcurrency = 0;
+};
+
+struct InvokeResult {
+    InvokeResultCode resultCode{};
+    Payload payload;
+};
+
+// The result of invokeAsync. It is completed on the I/O thread the moment the result is read, without
+// a trip through the dispatch thread, and `then` continuations and coroutines awaiting it resume right
+// there. Like handlers under setInlineDispatch, they must return quickly and must not call disconnect
+// or destroy the connection; hand anything longer off to a thread of your own.
+class InvokeFuture {
+public:
+    // Shared by the future and the invoke it is waiting on
+    class State {
+    public:
+        // Only the first call counts
+        void complete(InvokeResultCode resultCode, Payload payload)
+        {
+            std::function<void()> continuation;
+            {
+                std::lock_guard guard(_mutex);
+                if(_done.load(std::memory_order_relaxed)) {
+                    return;
+                }
+                _result = {resultCode, std::move(payload)};
+                _done.store(true, std::memory_order_release);
+                continuation = std::move(_continuation);
+            }
+            _ready.notify_all();
+            if(continuation) {
+                continuation();
+            }
+        }
+
+    private:
+        friend class InvokeFuture;
+        std::mutex _mutex;
+        std::condition_variable _ready;
+        // Set under _mutex, but atomic so that ready can spin on it without taking the mutex
+        std::atomic<bool> _done{false};
+        InvokeResult _result;
+        std::function<void()> _continuation;
+    };
+
+    InvokeFuture() = default;
+    explicit InvokeFuture(std::shared_ptr<State> state)
+        : _state(std::move(state))
+    {
+    }
+
+    [[nodiscard]] bool valid() const
+    {
+        return _state != nullptr;
+    }
+    [[nodiscard]] bool ready() const
+    {
+        return _state->_done.load(std::memory_order_acquire);
+    }
+    void wait() const
+    {
+        std::unique_lock guard(_state->_mutex);
+        _state->_ready.wait(guard, [this] { return _state->_done.load(std::memory_order_relaxed); });
+    }
+    // Returns false if the result still hasn't arrived after `timeout`
+    bool waitFor(std::chrono::milliseconds timeout) const
+    {
+        std::unique_lock guard(_state->_mutex);
+        return _state->_ready.wait_for(
+            guard, timeout, [this] { return _state->_done.load(std::memory_order_relaxed); });
+    }
+    // Waits for the result and moves it out, so only call it once
+    InvokeResult get()
+    {
+        wait();
+        return std::move(_state->_result);
+    }
+    // Runs `continuation` with the result on the thread that completes the future, or right away if
+    // it already has. Use one of get, then or co_await per future.
+    void then(std::function<void(InvokeResult result)> continuation)
+    {
+        std::unique_lock guard(_state->_mutex);
+        if(!_state->_done.load(std::memory_order_relaxed)) {
+            // The state outlives its own continuation, so a plain pointer does
+            _state->_continuation = [state = _state.get(), continuation = std::move(continuation)] {
+                continuation(std::move(state->_result));
+            };
+            return;
+        }
+        guard.unlock();
+        continuation(std::move(_state->_result));
+    }
+
+#ifdef NATIVEIPC_COROUTINES
+    // InvokeResult result = co_await connection->invokeAsync(message);
+    [[nodiscard]] bool await_ready() const
+    {
+        return ready();
+    }
+    bool await_suspend(std::coroutine_handle<> handle)
+    {
+        std::lock_guard guard(_state->_mutex);
+        if(_state->_done.load(std::memory_order_relaxed)) {
+            return false;
+        }
+        _state->_continuation = [handle] { handle.resume(); };
+        return true;
+    }
+    InvokeResult await_resume()
+    {
+        return std::move(_state->_result);
+    }
+#endif
+
+private:
+    std::shared_ptr<State> _state;
+};
+
 class IConnection {
 public:
     using PromiseCallback = std::function<void(InvokeResultCode resultCode, Payload result)>;
+    // Like PromiseCallback, with the index of the message in the batch it answers
+    using BatchPromiseCallback =
+        std::function<void(size_t index, InvokeResultCode resultCode, Payload result)>;
     using ResultCallback = std::function<void(Payload result)>;
     using OnHandler = std::function<void()>;
     using OnDataHandler = std::function<void(Payload message)>;
+    using OnSharedDataHandler = std::function<void(SharedPayload message)>;
+    using OnChunkHandler = std::function<void(Handle streamId, Payload chunk, bool last)>;
+    using OnLatestHandler = std::function<void(uint32_t channel, Payload value)>;
     using OnInvokedPromiseIdHandler = std::function<void(Handle connectionHandle, Handle promiseId, Payload message)>;
     using OnInvokedImmediateHandler = std::function<Payload(Payload message)>;
     using OnInvokedCallbackHandler = std::function<void(Payload message, ResultCallback callback)>;
@@ -78,22 +360,109 @@ public:
     IConnection &operator=(IConnection &&) = delete;
 
     virtual void connect() = 0;
+    // Like connect, but returns straight away instead of waiting for the I/O thread to start, so that
+    // many connections can be started at once. If it can't start, onError is called, after which
+    // disconnect must be called before trying again.
+    virtual void connectAsync() = 0;
     virtual void disconnect() = 0;
 
     virtual void send(Payload message) = 0;
+    // Like send, in the write lane for `priority` rather than the normal one
+    virtual void send(Payload message, Priority priority) = 0;
+    // Like send, but returns false without queuing the message while over the write queue limits, or if it
+    // is larger than the peer's setMaxFrameSize
+    virtual bool trySend(Payload message) = 0;
+    // Passes `size` bytes of shared memory to the peer by handle; the caller keeps its own handle.
+    // Only pipe connections can do this, so it returns false on others or when not connected.
+    virtual bool sendShared(NativeHandle handle, size_t size) = 0;
+    // Streams a payload too large to send, or to hold, all at once. Each chunk is its own frame and
+    // reaches the peer's onChunk as soon as it is read, in order, so neither side needs the whole
+    // payload in memory. Take an id from openStream per stream and mark the final chunk `last`.
+    // sendChunk returns false if not connected, the peer is on a version without streams, or the chunk is
+    // larger than the peer's setMaxFrameSize.
+    virtual Handle openStream() = 0;
+    virtual bool sendChunk(Handle streamId, Payload chunk, bool last) = 0;
+    // Sends a value that only matters until the next one on `channel`, like a position or a progress
+    // update. A newer value takes the place of one that is still queued to go out, or still waiting for
+    // the peer's onLatest handler, so a slow reader skips to the newest value instead of falling behind.
+    // Values of one channel stay in order, but have no order with other messages. Returns false if not
+    // connected, the peer is on a version without them, or the value is larger than its setMaxFrameSize.
+    virtual bool sendLatest(uint32_t channel, Payload value) = 0;
     virtual void invoke(Payload message, PromiseCallback onResult) = 0;
+    // Like invoke, but gives up with InvokeResultCode::Timeout if there's no result within `timeout`.
+    // A result that turns up later goes to the onResult handler, if there is one.
+    virtual void invoke(Payload message, PromiseCallback onResult, std::chrono::milliseconds timeout) = 0;
     virtual Handle invoke(Payload message) = 0;
+    // Like invoke, in the write lane for `priority`. Its result comes back in the peer's normal lane.
+    virtual void invoke(Payload message, PromiseCallback onResult, Priority priority) = 0;
+    // Like invoke, but returns a future for the result instead of taking a callback. A zero timeout
+    // waits for as long as the connection lasts; the future is failed if the connection is destroyed.
+    virtual InvokeFuture invokeAsync(Payload message, std::chrono::milliseconds timeout = std::chrono::milliseconds::zero()) = 0;
+    // Invokes and waits for the result on the calling thread, which the I/O thread wakes directly. It
+    // spins briefly before going to sleep, for about as long as recent results have taken to arrive.
+    // A zero timeout waits for as long as the connection lasts. Don't call it from the I/O thread,
+    // which includes invokeAsync continuations and handlers under setInlineDispatch.
+    virtual InvokeResult invokeBlocking(Payload message, std::chrono::milliseconds timeout) = 0;
     virtual void sendResult(Handle connectionHandle, Handle promiseId, Payload message) = 0;
+    // Batched forms of send and invoke, which queue every message together and wake the I/O thread once
+    virtual void send(std::vector<Payload> messages) = 0;
+    virtual void invokeMany(std::vector<Payload> messages, BatchPromiseCallback onResult) = 0;
+    // Returns the promise id of each message, in order
+    virtual std::vector<Handle> invokeMany(std::vector<Payload> messages) = 0;
+    // Asks the server for the messages it publishes to `topic`, which then arrive through onReceived.
+    // Subscriptions carry over when connect is called again. Only client connections can subscribe.
+    virtual void subscribe(const std::string &topic) = 0;
+    virtual void unsubscribe(const std::string &topic) = 0;
 
     virtual void onReceived(OnDataHandler dataHandler) = 0;
+    virtual void onReceivedShared(OnSharedDataHandler dataHandler) = 0;
+    virtual void onChunk(OnChunkHandler chunkHandler) = 0;
+    virtual void onLatest(OnLatestHandler latestHandler) = 0;
     virtual void onInvoked(OnInvokedPromiseIdHandler dataHandler) = 0;
     virtual void onInvoked(OnInvokedImmediateHandler dataHandler) = 0;
     virtual void onInvoked(OnInvokedCallbackHandler dataHandler) = 0;
     virtual void onResult(OnResultHandler dataHandler) = 0;
+    // Hands invokes of one method to a handler of its own instead of the onInvoked handler, going by
+    // the method id a typed message starts with (see TypedMessage.h). Calls of a method don't keep to
+    // the order they arrived in, between themselves or with other handlers. Invokes of methods that
+    // aren't registered still go to onInvoked. Call before connect.
+    virtual void registerMethod(uint32_t methodId, OnInvokedCallbackHandler handler, MethodOptions options = {}) = 0;
     virtual void onConnect(OnHandler connectHandler) = 0;
     virtual void onDisconnect(OnHandler disconnectHandler) = 0;
     virtual void onError(OnHandler errorHandler) = 0;
+    // Called when more than the write queue limits is waiting to be written, then again once it has
+    // drained to half of them
+    virtual void onBackpressure(OnHandler backpressureHandler) = 0;
+    virtual void onWritable(OnHandler writableHandler) = 0;
     virtual void onLog(OnLogHandler logHandler, LogLevel level = LogLevel::None) = 0;
     virtual void setLogLevel(LogLevel level) = 0;
+    // Limits for coalescing queued messages into a single write. A maxMessages of 1 disables batching.
+    virtual void setWriteBatchLimits(size_t maxBytes, size_t maxMessages) = 0;
+    // Limits for what is queued or being written before backpressure kicks in. 0 means no limit.
+    virtual void setWriteQueueLimits(size_t maxBytes, size_t maxMessages) = 0;
+    // Compresses messages and invokes of at least minBytes before they go out, for peers on a version
+    // that can read them; older peers keep getting everything raw. Worth it where bandwidth rather than
+    // CPU is short, like TCP between machines. 0, the default, sends everything raw.
+    virtual void setCompressionThreshold(size_t minBytes) = 0;
+    // The largest message the peer may send, compressed or not. The peer is told it when it connects,
+    // and dropped if it sends a larger frame anyway, before anything is allocated for it. 0, the default,
+    // means no limit. Set it before connecting so the peer hears the new limit. Sending the peer more than
+    // its own limit fails at this end: invokes with InvokeResultCode::FrameTooLarge, trySend, sendChunk
+    // and sendLatest by returning false, and anything else is dropped with a warning.
+    virtual void setMaxFrameSize(size_t maxBytes) = 0;
+    // Caps how many invokes with a callback or future can wait on their results at once. Past that,
+    // they fail straight away with InvokeResultCode::WindowFull instead of being sent. 0, the default,
+    // means no limit. Safe to call at any time.
+    virtual void setInvokeWindow(size_t maxInFlight) = 0;
+    // Runs handlers directly on the I/O thread instead of handing them to the dispatch thread. This
+    // saves a thread hop per message, but handlers must return quickly and must not call disconnect
+    // or destroy the connection. Call before connect.
+    virtual void setInlineDispatch(bool runInline) = 0;
+    // How to retry while the server isn't there. Only clients reconnect, so servers ignore it. Call
+    // before connect.
+    virtual void setReconnectPolicy(const ReconnectPolicy &policy) = 0;
+    // Safe to call from any thread at any time. The counters are atomics, so reading them doesn't hold
+    // up sending or receiving.
+    virtual ConnectionStats stats() = 0;
 };
 } // namespace Twitch::IPC
@@ -0,0 +1,24 @@
+// Copyright Twitch Interactive, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <cstddef>
+
+namespace Twitch::IPC {
+// Loop threads that connections share instead of each running one of their own. Every connection made
+// with the same event loop goes on the next of its threads in turn. Connections hold on to their thread,
+// so the event loop may be released before them.
+class IEventLoop {
+public:
+    IEventLoop() = default;
+    virtual ~IEventLoop() = default;
+
+    IEventLoop(const IEventLoop &) = delete;
+    IEventLoop(IEventLoop &&) = delete;
+    IEventLoop &operator=(const IEventLoop &) = delete;
+    IEventLoop &operator=(IEventLoop &&) = delete;
+
+    [[nodiscard]] virtual size_t threadCount() const = 0;
+};
+} // namespace Twitch::IPC
@@ -9,9 +9,13 @@ namespace Twitch::IPC {
 class IServerConnection {
 public:
     using PromiseCallback = IConnection::PromiseCallback;
+    using BatchPromiseCallback = IConnection::BatchPromiseCallback;
     using ResultCallback = IConnection::ResultCallback;
     using OnHandler = std::function<void(Handle connectionHandle)>;
     using OnDataHandler = std::function<void(Handle connectionHandle, Payload data)>;
+    using OnSharedDataHandler = std::function<void(Handle connectionHandle, SharedPayload data)>;
+    using OnChunkHandler = std::function<void(Handle connectionHandle, Handle streamId, Payload chunk, bool last)>;
+    using OnLatestHandler = std::function<void(Handle connectionHandle, uint32_t channel, Payload value)>;
     using OnInvokedPromiseIdHandler =
         std::function<void(Handle connectionHandle, Handle promiseId, Payload message)>;
     using OnInvokedImmediateHandler =
@@ -32,24 +36,97 @@ public:
     IServerConnection &operator=(IServerConnection &&) = delete;
 
     virtual void connect() = 0;
+    // Starts listening without waiting for it, see IConnection::connectAsync
+    virtual void connectAsync() = 0;
     virtual void disconnect() = 0;
     virtual int activeConnections() = 0;
 
     virtual void broadcast(Payload message) = 0;
+    // Sends to the clients subscribed to `topic`, sharing one copy of the payload between them
+    virtual void publish(const std::string &topic, Payload message) = 0;
     virtual void send(Handle connectionHandle, Payload message) = 0;
+    // Like send, in the write lane for `priority`, see Priority
+    virtual void send(Handle connectionHandle, Payload message, Priority priority) = 0;
+    // Like send, but returns false without queuing the message while that client is over the write
+    // queue limits, or isn't connected
+    virtual bool trySend(Handle connectionHandle, Payload message) = 0;
+    // Passes `size` bytes of shared memory to the client by handle; the caller keeps its own handle.
+    // Only pipe connections can do this, so it returns false on others or when not connected.
+    virtual bool sendShared(Handle connectionHandle, NativeHandle handle, size_t size) = 0;
+    // Streams a payload to the client in chunks, see IConnection::sendChunk
+    virtual Handle openStream() = 0;
+    virtual bool sendChunk(Handle connectionHandle, Handle streamId, Payload chunk, bool last) = 0;
+    // Sends the newest value of `channel` to the client, see IConnection::sendLatest. Each client has
+    // channels of its own.
+    virtual bool sendLatest(Handle connectionHandle, uint32_t channel, Payload value) = 0;
     virtual void invoke(Handle connectionHandle, Payload message, PromiseCallback onResult) = 0;
+    // Like invoke, but gives up with InvokeResultCode::Timeout if there's no result within `timeout`.
+    // A result that turns up later goes to the onResult handler, if there is one.
+    virtual void invoke(Handle connectionHandle,
+        Payload message,
+        PromiseCallback onResult,
+        std::chrono::milliseconds timeout) = 0;
     virtual Handle invoke(Handle connectionHandle, Payload message) = 0;
+    // Like invoke, in the write lane for `priority`. Its result comes back in the client's normal lane.
+    virtual void invoke(Handle connectionHandle, Payload message, PromiseCallback onResult, Priority priority) = 0;
+    // Like invoke, but returns a future for the result instead of taking a callback. A zero timeout
+    // waits for as long as the client stays connected.
+    virtual InvokeFuture invokeAsync(Handle connectionHandle,
+        Payload message,
+        std::chrono::milliseconds timeout = std::chrono::milliseconds::zero()) = 0;
+    // Invokes and waits for the result on the calling thread, see IConnection::invokeBlocking
+    virtual InvokeResult invokeBlocking(Handle connectionHandle, Payload message, std::chrono::milliseconds timeout) = 0;
     virtual void sendResult(Handle connectionHandle, Handle promiseId, Payload message) = 0;
+    // Batched forms of send and invoke, which queue every message together and wake the I/O thread once
+    virtual void send(Handle connectionHandle, std::vector<Payload> messages) = 0;
+    virtual void invokeMany(Handle connectionHandle, std::vector<Payload> messages, BatchPromiseCallback onResult) = 0;
+    // Returns the promise id of each message, in order
+    virtual std::vector<Handle> invokeMany(Handle connectionHandle, std::vector<Payload> messages) = 0;
 
     virtual void onReceived(OnDataHandler dataHandler) = 0;
+    virtual void onReceivedShared(OnSharedDataHandler dataHandler) = 0;
+    virtual void onChunk(OnChunkHandler chunkHandler) = 0;
+    virtual void onLatest(OnLatestHandler latestHandler) = 0;
     virtual void onInvoked(OnInvokedPromiseIdHandler dataHandler) = 0;
     virtual void onInvoked(OnInvokedImmediateHandler dataHandler) = 0;
     virtual void onInvoked(OnInvokedCallbackHandler dataHandler) = 0;
     virtual void onResult(OnResultHandler dataHandler) = 0;
+    // Routes invokes from every client by method id, see IConnection::registerMethod. With
+    // setDispatchThreads, calls of a method may run at once for the same client too.
+    virtual void registerMethod(uint32_t methodId, OnInvokedCallbackHandler handler, MethodOptions options = {}) = 0;
     virtual void onConnect(OnHandler connectHandler) = 0;
     virtual void onDisconnect(OnHandler disconnectHandler) = 0;
     virtual void onError(OnHandler errorHandler) = 0;
+    // Called when more than the write queue limits is waiting to be written to a client, then again
+    // once it has drained to half of them
+    virtual void onBackpressure(OnHandler backpressureHandler) = 0;
+    virtual void onWritable(OnHandler writableHandler) = 0;
     virtual void onLog(OnLogHandler logHandler, LogLevel level = LogLevel::None) = 0;
     virtual void setLogLevel(LogLevel level) = 0;
+    // Limits for coalescing queued messages into a single write. A maxMessages of 1 disables batching.
+    virtual void setWriteBatchLimits(size_t maxBytes, size_t maxMessages) = 0;
+    // Per-client limits for what is queued or being written before backpressure kicks in. 0 means no limit.
+    virtual void setWriteQueueLimits(size_t maxBytes, size_t maxMessages) = 0;
+    // Compresses what goes to clients that can read it, see IConnection::setCompressionThreshold
+    virtual void setCompressionThreshold(size_t minBytes) = 0;
+    // The largest message a client may send, see IConnection::setMaxFrameSize
+    virtual void setMaxFrameSize(size_t maxBytes) = 0;
+    // Caps how many invokes with a callback or future can wait on results from each client, see
+    // IConnection::setInvokeWindow
+    virtual void setInvokeWindow(size_t maxInFlight) = 0;
+    // Runs handlers on a pool of this many threads so that a slow handler only holds up its own
+    // connection. Each connection's handlers still run one at a time and in order. Call before connect.
+    virtual void setDispatchThreads(size_t threadCount) = 0;
+    // Runs handlers directly on the I/O thread instead of handing them to the dispatch threads.
+    // This saves a thread hop per message, but handlers must return quickly and must not call disconnect
+    // or destroy the connection. Call before connect.
+    virtual void setInlineDispatch(bool runInline) = 0;
+    // Serves clients on this many I/O threads instead of one, so that reading and writing for many
+    // clients isn't held to a single core. Each client stays on the thread it was handed to when it
+    // connected. Handlers for different clients may then run at the same time, as with dispatch
+    // threads. Has no effect on Windows. Call before connect.
+    virtual void setIOThreads(size_t threadCount) = 0;
+    // Totals over every client. Safe to call from any thread at any time.
+    virtual ConnectionStats stats() = 0;
 };
 } // namespace Twitch::IPC
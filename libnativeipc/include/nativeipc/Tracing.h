@@ -0,0 +1,21 @@
+// Copyright Twitch Interactive, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "ConnectionExports.h"
+#include <string>
+
+// Records how long messages spend at each stage between send and handler, for every connection in the
+// process: waiting to be written, in uv_write, being read and reassembled, waiting for a dispatch
+// thread, and in the handler itself. Off until started, when each stage costs a single branch. Builds
+// with NATIVEIPC_TRACING off leave the hooks out altogether.
+namespace Twitch::IPC::Tracing {
+// Whether this build has the hooks at all
+NATIVEIPC_LIBSPEC bool available();
+NATIVEIPC_LIBSPEC void start();
+NATIVEIPC_LIBSPEC void stop();
+// Everything recorded since the last dump, as Chrome trace JSON for Perfetto or chrome://tracing.
+// Each thread keeps only its most recent events, so dump at least every few thousand messages.
+NATIVEIPC_LIBSPEC std::string dump();
+} // namespace Twitch::IPC::Tracing
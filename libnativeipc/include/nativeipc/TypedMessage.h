@@ -0,0 +1,234 @@
+// Copyright Twitch Interactive, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+
+#include "IConnection.h"
+
+namespace Twitch::IPC {
+
+// Names a typed message at compile time, so that nothing compares method names at run time
+constexpr uint32_t methodId(std::string_view name)
+{
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for(const char c : name) {
+        hash = (hash ^ static_cast<uint8_t>(c)) * 16777619u;
+    }
+    // 0 is left for payloads that aren't typed messages
+    return hash ? hash : 1;
+}
+
+// Every typed payload starts with this, then the message struct itself, then any trailing bytes.
+// Aligned so that the struct behind it is too, as vector storage is aligned for anything.
+struct alignas(8) TypedHeader {
+    uint32_t methodId;
+    // sizeof the sender's struct, so that peers with fields appended or missing can still read it
+    uint32_t size;
+};
+
+// A struct that can be read in place out of a received payload:
+//
+//     struct SetVolume {
+//         static constexpr auto MethodId = Twitch::IPC::methodId("setVolume");
+//         uint32_t source;
+//         float level;
+//     };
+//
+// Fields are in host byte order and both ends must agree on the layout, so keep to fixed-width types
+// and only ever append fields. Fields appended since the sender's version read as zero.
+template<typename T, typename = void>
+struct IsTypedMessage : std::false_type {
+};
+template<typename T>
+struct IsTypedMessage<T, std::void_t<decltype(T::MethodId)>>
+    : std::bool_constant<std::is_trivially_copyable_v<T> && std::is_standard_layout_v<T> &&
+                         alignof(T) <= alignof(TypedHeader)> {
+};
+
+// Returns the method id a typed payload starts with, or 0 for any other payload
+inline uint32_t methodOf(const Payload &payload)
+{
+    if(payload.size() < sizeof(TypedHeader)) {
+        return 0;
+    }
+    TypedHeader header;
+    memcpy(&header, payload.data(), sizeof(header));
+    return header.methodId;
+}
+
+// Lays `message` out as a payload, followed by `tailSize` bytes from `tail`, for variable-length data
+// such as strings that doesn't fit in a fixed-layout struct
+template<typename T>
+Payload encode(const T &message, const void *tail = nullptr, size_t tailSize = 0)
+{
+    static_assert(IsTypedMessage<T>::value, "typed messages are fixed-layout structs with a MethodId");
+    const TypedHeader header{T::MethodId, static_cast<uint32_t>(sizeof(T))};
+    // Appended rather than copied into a presized vector, whose data() the compiler can't prove non-null
+    std::vector<uint8_t> bytes;
+    bytes.reserve(sizeof(TypedHeader) + sizeof(T) + tailSize);
+    const auto append = [&bytes](const void *data, size_t size) {
+        const auto begin = static_cast<const uint8_t *>(data);
+        bytes.insert(bytes.end(), begin, begin + size);
+    };
+    append(&header, sizeof(header));
+    append(&message, sizeof(T));
+    if(tailSize) {
+        append(tail, tailSize);
+    }
+    return Payload(std::move(bytes));
+}
+
+// Reads a typed message straight out of the payload it arrived in, without copying or parsing it.
+// Check valid before anything else: it is false if the payload holds some other message, or less of
+// this one than its header says. A sender on an older, shorter layout is copied into a T of the view's
+// own instead, with the fields it didn't have zeroed.
+template<typename T>
+class MessageView {
+    static_assert(IsTypedMessage<T>::value, "typed messages are fixed-layout structs with a MethodId");
+
+public:
+    MessageView() = default;
+    explicit MessageView(Payload payload)
+        : _payload(std::move(payload))
+    {
+        if(_payload.size() < sizeof(TypedHeader) ||
+            reinterpret_cast<uintptr_t>(_payload.data()) % alignof(TypedHeader)) {
+            return;
+        }
+        TypedHeader header;
+        memcpy(&header, _payload.data(), sizeof(header));
+        if(header.methodId != T::MethodId || _payload.size() - sizeof(TypedHeader) < header.size) {
+            return;
+        }
+        _tailOffset = sizeof(TypedHeader) + header.size;
+        if(header.size < sizeof(T)) {
+            memcpy(&_filled, _payload.data() + sizeof(TypedHeader), header.size);
+            _padded = true;
+        }
+    }
+
+    [[nodiscard]] bool valid() const
+    {
+        return _tailOffset != 0;
+    }
+    explicit operator bool() const
+    {
+        return valid();
+    }
+    const T &operator*() const
+    {
+        return *get();
+    }
+    const T *operator->() const
+    {
+        return get();
+    }
+    [[nodiscard]] const T *get() const
+    {
+        return _padded ? &_filled : reinterpret_cast<const T *>(_payload.data() + sizeof(TypedHeader));
+    }
+
+    // Whatever was passed as the tail to encode
+    [[nodiscard]] const uint8_t *tail() const
+    {
+        return _payload.data() + _tailOffset;
+    }
+    [[nodiscard]] size_t tailSize() const
+    {
+        return _payload.size() - _tailOffset;
+    }
+    [[nodiscard]] std::string_view tailString() const
+    {
+        return {reinterpret_cast<const char *>(tail()), tailSize()};
+    }
+
+    // Gives the payload back, e.g. to send it on as it is
+    Payload release()
+    {
+        _tailOffset = 0;
+        return std::move(_payload);
+    }
+
+private:
+    Payload _payload;
+    size_t _tailOffset{};
+    // Only used for a sender whose T is shorter than ours
+    T _filled{};
+    bool _padded{};
+};
+
+// Routes typed messages to a handler per message type by method id, in place of one handler that
+// has to tell every message apart itself. Register every handler before passing invokedHandler or
+// receivedHandler to a connection, which take a snapshot of the table.
+//
+//     MethodTable methods;
+//     methods.on<SetVolume>([](MessageView<SetVolume> message) { return encode(VolumeSet{message->level}); });
+//     connection->onInvoked(methods.invokedHandler());
+class MethodTable {
+public:
+    using Handler = std::function<Payload(Payload message)>;
+
+    // `handler` takes a MessageView<T> and returns a Payload, which is the result when invoked, or
+    // returns nothing. Payloads that start with T's method id but hold less than their header says
+    // get an empty result without reaching it.
+    template<typename T, typename F>
+    void on(F handler)
+    {
+        static_assert(IsTypedMessage<T>::value, "typed messages are fixed-layout structs with a MethodId");
+        _handlers[T::MethodId] = [handler = std::move(handler)](Payload message) -> Payload {
+            MessageView<T> view(std::move(message));
+            if(!view) {
+                return {};
+            }
+            if constexpr(std::is_void_v<std::invoke_result_t<F &, MessageView<T>>>) {
+                handler(std::move(view));
+                return {};
+            } else {
+                return handler(std::move(view));
+            }
+        };
+    }
+
+    // For payloads with no handler of their own, including ones that aren't typed messages at all,
+    // so that typed and untyped traffic can share a connection
+    void otherwise(Handler handler)
+    {
+        _otherwise = std::move(handler);
+    }
+
+    [[nodiscard]] IConnection::OnInvokedImmediateHandler invokedHandler() const
+    {
+        return [table = snapshot()](Payload message) { return table->dispatch(std::move(message)); };
+    }
+    [[nodiscard]] IConnection::OnDataHandler receivedHandler() const
+    {
+        return [table = snapshot()](Payload message) { table->dispatch(std::move(message)); };
+    }
+
+    Payload dispatch(Payload message) const
+    {
+        const auto found = _handlers.find(methodOf(message));
+        if(found != _handlers.end()) {
+            return found->second(std::move(message));
+        }
+        return _otherwise ? _otherwise(std::move(message)) : Payload{};
+    }
+
+private:
+    [[nodiscard]] std::shared_ptr<const MethodTable> snapshot() const
+    {
+        return std::make_shared<const MethodTable>(*this);
+    }
+
+    std::unordered_map<uint32_t, Handler> _handlers;
+    Handler _otherwise;
+};
+} // namespace Twitch::IPC
@@ -0,0 +1,91 @@
+// Copyright Twitch Interactive, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: MIT
+
+#include "BufferPool.h"
+#include <algorithm>
+
+using namespace Twitch::IPC;
+
+namespace {
+size_t floorShift(size_t value)
+{
+    size_t shift = 0;
+    while(value >>= 1) {
+        ++shift;
+    }
+    return shift;
+}
+
+} // namespace
+
+BufferPool::BufferPool(size_t maxRetainedBytes)
+    : _maxRetainedBytes(maxRetainedBytes)
+{
+}
+
+size_t BufferPool::classSize(size_t index)
+{
+    const auto base = size_t{1} << (MinClassShift + index / StepsPerShift);
+    return base + base / StepsPerShift * (index % StepsPerShift);
+}
+
+size_t BufferPool::classAbove(size_t size)
+{
+    const auto shift = floorShift(size);
+    if(shift < MinClassShift) {
+        return 0;
+    }
+    const auto base = size_t{1} << shift;
+    const auto step = base / StepsPerShift;
+    return (shift - MinClassShift) * StepsPerShift + (size - base + step - 1) / step;
+}
+
+size_t BufferPool::classBelow(size_t capacity)
+{
+    const auto shift = floorShift(capacity);
+    const auto base = size_t{1} << shift;
+    return (shift - MinClassShift) * StepsPerShift + (capacity - base) / (base / StepsPerShift);
+}
+
+std::vector<uint8_t> BufferPool::acquire(size_t size)
+{
+    std::vector<uint8_t> buffer;
+    if(!size) {
+        return buffer;
+    }
+
+    const auto index = classAbove(size);
+    if(index >= ClassCount) {
+        buffer.reserve(size);
+        return buffer;
+    }
+
+    auto &buffers = _classes[index];
+    if(buffers.empty()) {
+        // round up so the buffer lands back in this class once it is released
+        buffer.reserve(classSize(index));
+        return buffer;
+    }
+    buffer.swap(buffers.back());
+    buffers.pop_back();
+    _retainedBytes -= buffer.capacity();
+    return buffer;
+}
+
+void BufferPool::release(std::vector<uint8_t> buffer)
+{
+    const auto capacity = buffer.capacity();
+    const auto shift = floorShift(capacity);
+    if(shift < MinClassShift || shift > MaxClassShift ||
+        _retainedBytes + capacity > _maxRetainedBytes) {
+        return;
+    }
+
+    auto &buffers = _classes[std::min(classBelow(capacity), ClassCount - 1)];
+    if(buffers.size() >= MaxBuffersPerClass) {
+        return;
+    }
+    buffer.clear();
+    buffers.emplace_back(std::move(buffer));
+    _retainedBytes += capacity;
+}
@@ -0,0 +1,50 @@
+// Copyright Twitch Interactive, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "DeleteConstructors.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Twitch::IPC {
+// Recycles byte buffers by size class so that steady traffic stops going through the allocator for
+// every message. Classes are a quarter of a power of two apart, so a buffer is at most a quarter
+// bigger than asked for: received bodies are handed to handlers as they are and can be held for long,
+// so whole powers of two would pin up to twice the memory of what they carry. Not thread safe: a
+// transport only touches its pool on its loop thread.
+class BufferPool {
+public:
+    static constexpr size_t DefaultMaxRetainedBytes = 32 * 1024 * 1024;
+
+    explicit BufferPool(size_t maxRetainedBytes = DefaultMaxRetainedBytes);
+    DELETE_COPY_AND_MOVE_CONSTRUCTORS(BufferPool);
+
+    // Returns an empty buffer with at least `size` bytes of capacity
+    std::vector<uint8_t> acquire(size_t size);
+    void release(std::vector<uint8_t> buffer);
+
+    [[nodiscard]] size_t retainedBytes() const
+    {
+        return _retainedBytes;
+    }
+
+private:
+    static constexpr size_t MinClassShift = 6; // 64 bytes
+    static constexpr size_t MaxClassShift = 24; // 16 MB
+    static constexpr size_t StepsPerShift = 4;
+    static constexpr size_t ClassCount = (MaxClassShift - MinClassShift) * StepsPerShift + 1;
+    static constexpr size_t MaxBuffersPerClass = 16;
+
+    static size_t classSize(size_t index);
+    // The smallest class that holds `size` bytes, and the largest that `capacity` bytes can stand in for
+    static size_t classAbove(size_t size);
+    static size_t classBelow(size_t capacity);
+
+    std::array<std::vector<std::vector<uint8_t>>, ClassCount> _classes;
+    size_t _retainedBytes = 0;
+    size_t _maxRetainedBytes;
+};
+} // namespace Twitch::IPC
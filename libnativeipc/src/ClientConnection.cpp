@@ -12,6 +12,8 @@ ClientConnection::ClientConnection(
     std::shared_ptr<ConnectionFactory::Factory> factory, std::string endpoint)
     : ConnectionBase(std::move(factory), std::move(endpoint))
 {
+    // The one connection a client has, whether or not it is up: invokes fail on the transport instead
+    _window = _promises.openConnection(0);
 }
 
 ClientConnection::~ClientConnection()
@@ -20,15 +22,30 @@ ClientConnection::~ClientConnection()
     {
         std::lock_guard guard(_transportMutex);
         _shuttingDown = true;
+        _sendTransport.retract();
     }
     _outputQueue.stop();
+    _methods.stop();
     _transport.reset();
+    // Nothing else is left to complete the futures still waiting
+    auto invokes = _promises.takeAll();
+    failDirectInvokes(invokes, InvokeResultCode::LocalDisconnect);
 }
 
 void ClientConnection::connect()
 {
     LOG_INFO("`connect`");
+    start(true);
+}
+
+void ClientConnection::connectAsync()
+{
+    LOG_INFO("`connectAsync`");
+    start(false);
+}
 
+void ClientConnection::start(bool wait)
+{
     if (_endpoint.empty()) {
         LOG_ERROR("No endpoint specified.");
         return;
@@ -46,9 +63,19 @@ void ClientConnection::connect()
     }
 
     _transport = _factory->makeClientProtocol();
+    _transport->setLoopThread(_factory->nextLoopThread());
     _transport->onData([this](Handle connectionHandle, Handle promiseId, Payload data) {
         handleData(connectionHandle, promiseId, std::move(data));
     });
+    _transport->onSharedData([this](Handle, SharedPayload data) {
+        handleSharedData(std::move(data));
+    });
+    _transport->onChunk([this](Handle, Handle streamId, Payload chunk, bool last) {
+        handleChunk(streamId, std::move(chunk), last);
+    });
+    _transport->onLatest([this](Handle, uint32_t channel, Payload value) {
+        handleLatest(channel, std::move(value));
+    });
 
     _transport->onDisconnect([this](Handle) {
         LOG_INFO("`onDisconnect` called");
@@ -68,7 +95,26 @@ void ClientConnection::connect()
             handleLog(connectionHandle, level, std::move(message), "transport");
         },
         _logLevel);
+    _transport->onBackpressure([this](Handle) { handleBackpressure(true); });
+    _transport->onWritable([this](Handle) { handleBackpressure(false); });
+    _transport->onInvokeTimeout([this](Handle, Handle promiseId) { handleInvokeTimeout(promiseId); });
+    _transport->setWriteBatchLimits(_writeBatchMaxBytes, _writeBatchMaxMessages);
+    _transport->setWriteQueueLimits(_writeQueueMaxBytes, _writeQueueMaxMessages);
+    _transport->setCompressionThreshold(_compressionThreshold);
+    _transport->setMaxFrameSize(_maxFrameSize);
+    _transport->setCounters(_counters);
+    _transport->setReconnectPolicy(_reconnectPolicy);
+    // Queued ahead of anything else, so the server knows the topics before the first message goes out
+    for(const auto &topic : _topics) {
+        _transport->send(0, ControlHandle::Subscribe, topic);
+    }
 
+    // Published first so that handlers running as soon as it connects can already send
+    _sendTransport.publish(_transport.get());
+    if(!wait) {
+        _transport->connectAsync(_endpoint);
+        return;
+    }
     const auto status = _transport->connect(_endpoint);
     switch(status) {
     case ConnectResult::Connected:
@@ -85,6 +131,7 @@ void ClientConnection::connect()
         break;
     }
     if (status != ConnectResult::Connected && status != ConnectResult::Connecting) {
+        _sendTransport.retract();
         _transport.reset();
     }
 }
@@ -96,62 +143,250 @@ void ClientConnection::disconnect()
     if (_shuttingDown) {
         return;
     }
-    _transport.reset();
-    decltype(_callbacks) callbacks;
-    {
-        std::lock_guard callbackGuard(_callbacksMutex);
-        callbacks.swap(_callbacks);
-    }
+    // Once no sender has it, destroyed outside the lock: with inline dispatch the loop thread may be
+    // waiting for it to send
+    _sendTransport.retract();
+    auto transport = std::move(_transport);
+    auto invokes = _promises.takeAll();
     guard.unlock();
-    for (auto &cb: callbacks) {
-        cb.second(InvokeResultCode::LocalDisconnect, {});
+    transport.reset();
+    for (auto &invoke: invokes) {
+        invoke.callback(InvokeResultCode::LocalDisconnect, {});
     }
 }
 
 void ClientConnection::send(Payload message)
 {
     LOG_DEBUG("Sending message of length " + std::to_string(message.size()));
-    std::lock_guard guard(_transportMutex);
-    if(_transport && !_shuttingDown) {
-        _transport->send(0, 0, std::move(message));
+    if(auto transport = _sendTransport.acquire()) {
+        transport->send(0, 0, std::move(message));
     }
 }
 
+void ClientConnection::send(Payload message, Priority priority)
+{
+    LOG_DEBUG("Sending message of length " + std::to_string(message.size()));
+    if(auto transport = _sendTransport.acquire()) {
+        transport->sendWithPriority(0, 0, std::move(message), priority, {});
+    }
+}
+
+bool ClientConnection::trySend(Payload message)
+{
+    auto transport = _sendTransport.acquire();
+    return transport && transport->trySend(0, 0, std::move(message));
+}
+
+bool ClientConnection::sendShared(NativeHandle handle, size_t size)
+{
+    LOG_DEBUG("Sending shared payload of length " + std::to_string(size));
+    auto transport = _sendTransport.acquire();
+    return transport && transport->sendShared(0, handle, size);
+}
+
+Handle ClientConnection::openStream()
+{
+    return getNextHandle();
+}
+
+bool ClientConnection::sendChunk(Handle streamId, Payload chunk, bool last)
+{
+    LOG_DEBUG("Sending chunk of stream " + std::to_string(streamId) + " of length " + std::to_string(chunk.size()));
+    auto transport = _sendTransport.acquire();
+    return transport && transport->sendChunk(0, streamId, std::move(chunk), last);
+}
+
+bool ClientConnection::sendLatest(uint32_t channel, Payload value)
+{
+    LOG_DEBUG("Sending latest value of channel " + std::to_string(channel) + " of length " + std::to_string(value.size()));
+    auto transport = _sendTransport.acquire();
+    return transport && transport->sendLatest(0, channel, std::move(value));
+}
+
 Handle ClientConnection::invoke(Payload message)
 {
     const auto handle = getNextHandle();
     LOG_DEBUG("Sending invoke of length " + std::to_string(message.size()));
-    std::lock_guard guard(_transportMutex);
-    if(_transport && !_shuttingDown) {
-        _transport->send(0, handle, std::move(message));
+    if(auto transport = _sendTransport.acquire()) {
+        transport->send(0, handle, std::move(message));
     }
     return handle;
 }
 
 void ClientConnection::invoke(Payload message, PromiseCallback onResult)
+{
+    invoke(std::move(message), std::move(onResult), std::chrono::milliseconds::zero());
+}
+
+void ClientConnection::invoke(Payload message, PromiseCallback onResult, std::chrono::milliseconds timeout)
 {
     LOG_DEBUG("Sending invoke of length " + std::to_string(message.size()));
-    const auto handle = getNextHandle();
-    std::unique_lock guard(_transportMutex);
-    if(_transport && !_shuttingDown) {
-        {
-            std::lock_guard callbackGuard(_callbacksMutex);
-            _callbacks[handle] = std::move(onResult);
-        }
-        _transport->send(0, handle, std::move(message));
-    } else if (!_shuttingDown) {
-        guard.unlock();
-        onResult(InvokeResultCode::LocalDisconnect, {});
+    PendingInvoke invoke;
+    invoke.callback = std::move(onResult);
+    const auto resultCode = queueInvoke(getNextHandle(), std::move(message), invoke, timeout);
+    if(resultCode == InvokeResultCode::Good || (resultCode == InvokeResultCode::LocalDisconnect && _shuttingDown)) {
+        return;
+    }
+    // Outside queueInvoke, which holds the transport, in case the callback disconnects
+    invoke.callback(resultCode, {});
+}
+
+void ClientConnection::invoke(Payload message, PromiseCallback onResult, Priority priority)
+{
+    LOG_DEBUG("Sending invoke of length " + std::to_string(message.size()));
+    PendingInvoke invoke;
+    invoke.callback = std::move(onResult);
+    const auto resultCode =
+        queueInvoke(getNextHandle(), std::move(message), invoke, std::chrono::milliseconds::zero(), priority);
+    if(resultCode == InvokeResultCode::Good || (resultCode == InvokeResultCode::LocalDisconnect && _shuttingDown)) {
+        return;
+    }
+    invoke.callback(resultCode, {});
+}
+
+InvokeFuture ClientConnection::invokeAsync(Payload message, std::chrono::milliseconds timeout)
+{
+    LOG_DEBUG("Sending invoke of length " + std::to_string(message.size()));
+    auto state = std::make_shared<InvokeFuture::State>();
+    auto invoke = asyncInvoke(state);
+    const auto resultCode = queueInvoke(getNextHandle(), std::move(message), invoke, timeout);
+    if(resultCode != InvokeResultCode::Good) {
+        state->complete(resultCode, {});
+    }
+    return InvokeFuture(std::move(state));
+}
+
+InvokeResult ClientConnection::invokeBlocking(Payload message, std::chrono::milliseconds timeout)
+{
+    return waitBlocking(invokeAsync(std::move(message), timeout));
+}
+
+InvokeResultCode ClientConnection::queueInvoke(Handle promiseId,
+    Payload message,
+    PendingInvoke &invoke,
+    std::chrono::milliseconds timeout,
+    Priority priority)
+{
+    auto transport = _sendTransport.acquire();
+    if(!transport) {
+        return InvokeResultCode::LocalDisconnect;
+    }
+    if(!transport->fitsPeer(0, message.size())) {
+        return InvokeResultCode::FrameTooLarge;
+    }
+    invoke.sent = std::chrono::steady_clock::now();
+    const auto deadline = invoke.sent + timeout;
+    const auto filed = _promises.insert(promiseId, 0, _window, std::move(invoke));
+    if(filed != InvokeResultCode::Good) {
+        return filed;
+    }
+    if(priority != Priority::Normal) {
+        const auto timesOut = timeout > std::chrono::milliseconds::zero();
+        transport->sendWithPriority(0, promiseId, std::move(message), priority, timesOut ? deadline : std::chrono::steady_clock::time_point{});
+    } else if(timeout > std::chrono::milliseconds::zero()) {
+        transport->sendInvoke(0, promiseId, std::move(message), deadline);
+    } else {
+        transport->send(0, promiseId, std::move(message));
     }
+    return InvokeResultCode::Good;
 }
 
 void ClientConnection::sendResult(Handle connectionHandle, Handle promiseId, Payload message)
 {
     LOG_DEBUG("Sending invoke result " + std::to_string(promiseId) + " of length " +
               std::to_string(message.size()));
+    if(auto transport = _sendTransport.acquire()) {
+        transport->send(connectionHandle, promiseId | ResponseFlag, std::move(message));
+    }
+}
+
+void ClientConnection::send(std::vector<Payload> messages)
+{
+    LOG_DEBUG("Sending " + std::to_string(messages.size()) + " messages");
+    if(auto transport = _sendTransport.acquire()) {
+        transport->sendMany(0, {}, std::move(messages));
+    }
+}
+
+std::vector<Handle> ClientConnection::invokeMany(std::vector<Payload> messages)
+{
+    LOG_DEBUG("Sending " + std::to_string(messages.size()) + " invokes");
+    std::vector<Handle> promiseIds(messages.size());
+    for(auto &promiseId : promiseIds) {
+        promiseId = getNextHandle();
+    }
+    if(auto transport = _sendTransport.acquire()) {
+        transport->sendMany(0, promiseIds, std::move(messages));
+    }
+    return promiseIds;
+}
+
+void ClientConnection::invokeMany(std::vector<Payload> messages, BatchPromiseCallback onResult)
+{
+    LOG_DEBUG("Sending " + std::to_string(messages.size()) + " invokes");
+    std::vector<Handle> promiseIds(messages.size());
+    for(auto &promiseId : promiseIds) {
+        promiseId = getNextHandle();
+    }
+    // Every promise of the batch shares the one callback
+    const auto shared = std::make_shared<BatchPromiseCallback>(std::move(onResult));
+    std::vector<size_t> rejected;
+    std::vector<InvokeResultCode> failures;
+    {
+        auto transport = _sendTransport.acquire();
+        if(transport) {
+            const auto sent = std::chrono::steady_clock::now();
+            for(size_t i = 0; i < promiseIds.size(); ++i) {
+                PendingInvoke invoke;
+                invoke.callback = [shared, i](InvokeResultCode resultCode, Payload result) {
+                    (*shared)(i, resultCode, std::move(result));
+                };
+                invoke.sent = sent;
+                const auto filed = transport->fitsPeer(0, messages[i].size())
+                    ? _promises.insert(promiseIds[i], 0, _window, std::move(invoke))
+                    : InvokeResultCode::FrameTooLarge;
+                if(filed != InvokeResultCode::Good) {
+                    rejected.push_back(i);
+                    failures.push_back(filed);
+                }
+            }
+            dropRejected(rejected, promiseIds, messages);
+            if(!promiseIds.empty()) {
+                transport->sendMany(0, promiseIds, std::move(messages));
+            }
+        } else if(_shuttingDown) {
+            return;
+        } else {
+            rejected.resize(messages.size());
+            failures.assign(messages.size(), InvokeResultCode::LocalDisconnect);
+            for(size_t i = 0; i < rejected.size(); ++i) {
+                rejected[i] = i;
+            }
+        }
+    }
+    // Let go of the transport first, in case the callback disconnects
+    for(size_t i = 0; i < rejected.size(); ++i) {
+        (*shared)(rejected[i], failures[i], {});
+    }
+}
+
+void ClientConnection::subscribe(const std::string &topic)
+{
+    if(topic.empty()) {
+        LOG_WARNING("Topics must not be empty");
+        return;
+    }
+    std::lock_guard guard(_transportMutex);
+    if(_topics.insert(topic).second && _transport && !_shuttingDown) {
+        _transport->send(0, ControlHandle::Subscribe, topic);
+    }
+}
+
+void ClientConnection::unsubscribe(const std::string &topic)
+{
     std::lock_guard guard(_transportMutex);
-    if(_transport && !_shuttingDown) {
-        _transport->send(connectionHandle, promiseId | ResponseFlag, std::move(message));
+    if(_topics.erase(topic) && _transport && !_shuttingDown) {
+        _transport->send(0, ControlHandle::Unsubscribe, topic);
     }
 }
 
@@ -167,14 +402,11 @@ void ClientConnection::handleRemoteConnected()
 void ClientConnection::handleRemoteDisconnected()
 {
     // Remove any lingering invoke callbacks for this connection
-    std::unordered_map<Handle, PromiseCallback> expiredInvokeCallbacks;
-    {
-        std::unique_lock guard(_callbacksMutex);
-        expiredInvokeCallbacks.swap(_callbacks);
-    }
-    _outputQueue.enqueue([this, expiredInvokeCallbacks = std::move(expiredInvokeCallbacks)] {
-        for (auto &cb: expiredInvokeCallbacks) {
-            cb.second(InvokeResultCode::RemoteDisconnect, {});
+    auto expiredInvokes = _promises.takeAll();
+    failDirectInvokes(expiredInvokes, InvokeResultCode::RemoteDisconnect);
+    _outputQueue.enqueue([this, expiredInvokes = std::move(expiredInvokes)]() mutable {
+        for (auto &invoke: expiredInvokes) {
+            invoke.callback(InvokeResultCode::RemoteDisconnect, {});
         }
         if(_disconnectHandler) {
             _disconnectHandler();
@@ -184,33 +416,18 @@ void ClientConnection::handleRemoteDisconnected()
 
 void ClientConnection::handleData(Handle connectionHandle, Handle handle, Payload message)
 {
+    if(handle & ResponseFlag) {
+        handleResult(handle & ~ResponseFlag, std::move(message));
+        return;
+    }
+    if(handle && _methods.route(connectionHandle, handle, message, _outputQueue)) {
+        return;
+    }
     _outputQueue.enqueue([this, connectionHandle, handle, message = std::move(message)]() mutable {
         if(!handle) {
             if(_receivedHandler) {
                 _receivedHandler(std::move(message));
             }
-        } else if(handle & ResponseFlag) {
-            const auto promiseId = handle & ~ResponseFlag;
-            {
-                std::unique_lock guard(_callbacksMutex);
-                auto i = _callbacks.find(promiseId);
-                if(i != _callbacks.end()) {
-                    const auto cb = std::move(i->second);
-                    _callbacks.erase(i);
-                    guard.unlock();
-                    LOG_DEBUG("Processing invoke result " + std::to_string(promiseId) +
-                              " of length " + std::to_string(message.size()));
-                    cb(InvokeResultCode::Good, std::move(message));
-                    return;
-                }
-            }
-            if(_resultHandler) {
-                LOG_DEBUG("Processing invoke result " + std::to_string(promiseId) + " of length " +
-                          std::to_string(message.size()) + "with global handler");
-                _resultHandler(promiseId, std::move(message));
-            } else {
-                LOG_DEBUG("Could not process invoke result " + std::to_string(promiseId));
-            }
             // handle invoke
         } else if(_transport) {
             auto promiseId = handle;
@@ -222,27 +439,87 @@ void ClientConnection::handleData(Handle connectionHandle, Handle handle, Payloa
                 auto result = _invokedImmediateHandler(std::move(message));
                 LOG_DEBUG("Sending invoke result " + std::to_string(promiseId) + " of length " +
                           std::to_string(result.size()));
-                std::lock_guard guard(_transportMutex);
-                if(_transport && !_shuttingDown) {
-                    _transport->send(connectionHandle, promiseId | ResponseFlag, std::move(result));
+                if(auto transport = _sendTransport.acquire()) {
+                    transport->send(connectionHandle, promiseId | ResponseFlag, std::move(result));
                 }
             } else if(_invokedCallbackHandler) {
-                _invokedCallbackHandler(std::move(message), [this, connectionHandle, promiseId, shieldLocker = std::weak_ptr<int>(_lambdaShield)](Payload result) {
-                    auto lock = shieldLocker.lock();
-                    if (lock) {
-                        LOG_DEBUG("Sending invoke result " + std::to_string(promiseId) + " of length " +
-                                  std::to_string(result.size()));
-                        std::lock_guard guard(_transportMutex);
-                        if (_transport && !_shuttingDown) {
-                            _transport->send(connectionHandle, promiseId | ResponseFlag, std::move(result));
-                        }
-                    }
-                });
+                _invokedCallbackHandler(std::move(message), resultCallback(connectionHandle, promiseId));
             }
         }
     });
 }
 
+IConnection::ResultCallback ClientConnection::resultCallback(Handle connectionHandle, Handle promiseId)
+{
+    return [this, connectionHandle, promiseId, shieldLocker = std::weak_ptr<int>(_lambdaShield)](Payload result) {
+        auto lock = shieldLocker.lock();
+        if (lock) {
+            LOG_DEBUG("Sending invoke result " + std::to_string(promiseId) + " of length " +
+                      std::to_string(result.size()));
+            if(auto transport = _sendTransport.acquire()) {
+                transport->send(connectionHandle, promiseId | ResponseFlag, std::move(result));
+            }
+        }
+    };
+}
+
+void ClientConnection::handleResult(Handle promiseId, Payload message)
+{
+    // Taken here on the I/O thread so that the futures of invokeAsync don't wait on the dispatch thread
+    PendingInvoke invoke;
+    if(_promises.takeAnswered(promiseId, 0, invoke)) {
+        LOG_DEBUG("Processing invoke result " + std::to_string(promiseId) + " of length " +
+                  std::to_string(message.size()));
+        if(invoke.direct) {
+            completeInvoke(invoke, std::move(message));
+        } else {
+            _outputQueue.enqueue([this, invoke = std::move(invoke), message = std::move(message)]() mutable {
+                completeInvoke(invoke, std::move(message));
+            });
+        }
+        return;
+    }
+    _outputQueue.enqueue([this, promiseId, message = std::move(message)]() mutable {
+        if(_resultHandler) {
+            LOG_DEBUG("Processing invoke result " + std::to_string(promiseId) + " of length " +
+                      std::to_string(message.size()) + "with global handler");
+            _resultHandler(promiseId, std::move(message));
+        } else {
+            LOG_DEBUG("Could not process invoke result " + std::to_string(promiseId));
+        }
+    });
+}
+
+void ClientConnection::handleSharedData(SharedPayload message)
+{
+    _outputQueue.enqueue([this, message = std::move(message)]() mutable {
+        if(_receivedSharedHandler) {
+            _receivedSharedHandler(std::move(message));
+        }
+    });
+}
+
+void ClientConnection::handleChunk(Handle streamId, Payload chunk, bool last)
+{
+    _outputQueue.enqueue([this, streamId, chunk = std::move(chunk), last]() mutable {
+        if(_chunkHandler) {
+            _chunkHandler(streamId, std::move(chunk), last);
+        }
+    });
+}
+
+void ClientConnection::handleLatest(uint32_t channel, Payload value)
+{
+    const bool replaced = _outputQueue.enqueueLatest(0, channel, [this, channel, value = std::move(value)]() mutable {
+        if(_latestHandler) {
+            _latestHandler(channel, std::move(value));
+        }
+    });
+    if(replaced) {
+        ++_counters->latestValuesReplaced;
+    }
+}
+
 void ClientConnection::handleError()
 {
     _outputQueue.enqueue([this] {
@@ -252,13 +529,40 @@ void ClientConnection::handleError()
     });
 }
 
+void ClientConnection::handleBackpressure(bool blocked)
+{
+    _outputQueue.enqueue([this, blocked] {
+        const auto &handler = blocked ? _backpressureHandler : _writableHandler;
+        if(handler) {
+            handler();
+        }
+    });
+}
+
+void ClientConnection::handleInvokeTimeout(Handle promiseId)
+{
+    PendingInvoke invoke;
+    // Already answered, or failed by a disconnect
+    if(!_promises.take(promiseId, 0, invoke)) {
+        return;
+    }
+    LOG_DEBUG("Invoke " + std::to_string(promiseId) + " timed out");
+    if(invoke.direct) {
+        invoke.callback(InvokeResultCode::Timeout, {});
+        return;
+    }
+    _outputQueue.enqueue([invoke = std::move(invoke)]() mutable {
+        invoke.callback(InvokeResultCode::Timeout, {});
+    });
+}
+
 void ClientConnection::handleLog(Handle, LogLevel level, std::string message, std::string category)
 {
-    if(_logHandler && level >= _logLevel) {
+    if(level >= _logLevel.load(std::memory_order_relaxed) && _logHandler) {
         _outputQueue.enqueue(
             [this, level, message = std::move(message), category = std::move(category)]() {
                 // check again just in case this changed since we were enqueued
-                if(_logHandler && static_cast<int>(level) >= static_cast<int>(_logLevel)) {
+                if(level >= _logLevel.load(std::memory_order_relaxed) && _logHandler) {
                     _logHandler(level, message, category);
                 }
             });
@@ -270,6 +574,21 @@ void ClientConnection::onReceived(OnDataHandler dataHandler)
     _receivedHandler = dataHandler;
 }
 
+void ClientConnection::onReceivedShared(OnSharedDataHandler dataHandler)
+{
+    _receivedSharedHandler = dataHandler;
+}
+
+void ClientConnection::onChunk(OnChunkHandler chunkHandler)
+{
+    _chunkHandler = chunkHandler;
+}
+
+void ClientConnection::onLatest(OnLatestHandler latestHandler)
+{
+    _latestHandler = latestHandler;
+}
+
 void ClientConnection::onInvoked(OnInvokedPromiseIdHandler dataHandler)
 {
     _invokedPromiseIdHandler = dataHandler;
@@ -296,6 +615,16 @@ void ClientConnection::onResult(OnResultHandler dataHandler)
     _resultHandler = dataHandler;
 }
 
+void ClientConnection::registerMethod(uint32_t methodId, OnInvokedCallbackHandler handler, MethodOptions options)
+{
+    _methods.add(
+        methodId,
+        [this, handler = std::move(handler)](Handle connectionHandle, Handle promiseId, Payload message) {
+            handler(std::move(message), resultCallback(connectionHandle, promiseId));
+        },
+        options);
+}
+
 void ClientConnection::onConnect(OnHandler connectHandler)
 {
     _connectHandler = connectHandler;
@@ -311,6 +640,16 @@ void ClientConnection::onError(OnHandler errorHandler)
     _errorHandler = errorHandler;
 }
 
+void ClientConnection::onBackpressure(OnHandler backpressureHandler)
+{
+    _backpressureHandler = backpressureHandler;
+}
+
+void ClientConnection::onWritable(OnHandler writableHandler)
+{
+    _writableHandler = writableHandler;
+}
+
 void ClientConnection::onLog(OnLogHandler logHandler, LogLevel level)
 {
     // Set _logLevel if level is anything but None
@@ -330,3 +669,71 @@ void ClientConnection::setLogLevel(LogLevel level)
         _transport->setLogLevel(level);
     }
 }
+
+void ClientConnection::setWriteBatchLimits(size_t maxBytes, size_t maxMessages)
+{
+    std::lock_guard guard(_transportMutex);
+    _writeBatchMaxBytes = maxBytes;
+    _writeBatchMaxMessages = maxMessages;
+    if(_transport) {
+        _transport->setWriteBatchLimits(maxBytes, maxMessages);
+    }
+}
+
+void ClientConnection::setWriteQueueLimits(size_t maxBytes, size_t maxMessages)
+{
+    std::lock_guard guard(_transportMutex);
+    _writeQueueMaxBytes = maxBytes;
+    _writeQueueMaxMessages = maxMessages;
+    if(_transport) {
+        _transport->setWriteQueueLimits(maxBytes, maxMessages);
+    }
+}
+
+void ClientConnection::setCompressionThreshold(size_t minBytes)
+{
+    std::lock_guard guard(_transportMutex);
+    _compressionThreshold = minBytes;
+    if(_transport) {
+        _transport->setCompressionThreshold(minBytes);
+    }
+}
+
+void ClientConnection::setMaxFrameSize(size_t maxBytes)
+{
+    std::lock_guard guard(_transportMutex);
+    _maxFrameSize = maxBytes;
+    if(_transport) {
+        _transport->setMaxFrameSize(maxBytes);
+    }
+}
+
+void ClientConnection::setInvokeWindow(size_t maxInFlight)
+{
+    _promises.setWindow(maxInFlight);
+}
+
+void ClientConnection::setInlineDispatch(bool runInline)
+{
+    std::lock_guard guard(_transportMutex);
+    if(_transport) {
+        LOG_WARNING("`setInlineDispatch` called after `connect`; ignoring");
+        return;
+    }
+    _outputQueue.setInline(runInline);
+}
+
+void ClientConnection::setReconnectPolicy(const ReconnectPolicy &policy)
+{
+    std::lock_guard guard(_transportMutex);
+    if(_transport) {
+        LOG_WARNING("`setReconnectPolicy` called after `connect`; ignoring");
+        return;
+    }
+    _reconnectPolicy = policy;
+}
+
+ConnectionStats ClientConnection::stats()
+{
+    return collectStats(_outputQueue.backlog());
+}
@@ -5,8 +5,10 @@
 
 #include "ConnectionBase.h"
 #include "IConnection.h"
+#include "MethodRouter.h"
 #include "OperationQueue.h"
-#include <unordered_map>
+#include "PublishedTransport.h"
+#include <unordered_set>
 
 namespace Twitch::IPC {
 class ClientConnection final
@@ -18,33 +20,72 @@ public:
     DELETE_COPY_AND_MOVE_CONSTRUCTORS(ClientConnection);
 
     void connect() override;
+    void connectAsync() override;
     void disconnect() override;
 
     void send(Payload message) override;
+    void send(Payload message, Priority priority) override;
+    bool trySend(Payload message) override;
+    bool sendShared(NativeHandle handle, size_t size) override;
+    Handle openStream() override;
+    bool sendChunk(Handle streamId, Payload chunk, bool last) override;
+    bool sendLatest(uint32_t channel, Payload value) override;
     void invoke(Payload message, PromiseCallback onResult) override;
+    void invoke(Payload message, PromiseCallback onResult, std::chrono::milliseconds timeout) override;
     Handle invoke(Payload message) override;
+    void invoke(Payload message, PromiseCallback onResult, Priority priority) override;
+    InvokeFuture invokeAsync(Payload message, std::chrono::milliseconds timeout) override;
+    InvokeResult invokeBlocking(Payload message, std::chrono::milliseconds timeout) override;
     void sendResult(Handle connectionHandle, Handle promiseId, Payload message) override;
+    void send(std::vector<Payload> messages) override;
+    void invokeMany(std::vector<Payload> messages, BatchPromiseCallback onResult) override;
+    std::vector<Handle> invokeMany(std::vector<Payload> messages) override;
+    void subscribe(const std::string &topic) override;
+    void unsubscribe(const std::string &topic) override;
 
     void onReceived(OnDataHandler dataHandler) override;
+    void onReceivedShared(OnSharedDataHandler dataHandler) override;
+    void onChunk(OnChunkHandler chunkHandler) override;
+    void onLatest(OnLatestHandler latestHandler) override;
     void onInvoked(OnInvokedPromiseIdHandler dataHandler) override;
     void onInvoked(OnInvokedImmediateHandler dataHandler) override;
     void onInvoked(OnInvokedCallbackHandler dataHandler) override;
     void onResult(OnResultHandler dataHandler) override;
+    void registerMethod(uint32_t methodId, OnInvokedCallbackHandler handler, MethodOptions options) override;
     void onConnect(OnHandler connectHandler) override;
     void onDisconnect(OnHandler disconnectHandler) override;
     void onError(OnHandler errorHandler) override;
+    void onBackpressure(OnHandler backpressureHandler) override;
+    void onWritable(OnHandler writableHandler) override;
     void onLog(OnLogHandler logHandler, LogLevel level) override;
     void setLogLevel(LogLevel level) override;
+    void setWriteBatchLimits(size_t maxBytes, size_t maxMessages) override;
+    void setWriteQueueLimits(size_t maxBytes, size_t maxMessages) override;
+    void setCompressionThreshold(size_t minBytes) override;
+    void setMaxFrameSize(size_t maxBytes) override;
+    void setInvokeWindow(size_t maxInFlight) override;
+    void setInlineDispatch(bool runInline) override;
+    void setReconnectPolicy(const ReconnectPolicy &policy) override;
+    ConnectionStats stats() override;
 
 protected:
-    LogLevel _logLevel = LogLevel::None;
+    std::atomic<LogLevel> _logLevel{LogLevel::None};
     OperationQueue _outputQueue;
+    MethodRouter _methods;
+    // The window of the one connection a client has, so invokes are filed without looking it up
+    std::shared_ptr<PromiseTable::Window> _window;
 
+    // Owned under _transportMutex; the send paths reach it through _sendTransport instead
     std::unique_ptr<IClientTransport> _transport;
-    std::unordered_map<Handle, PromiseCallback> _callbacks;
-    std::mutex _callbacksMutex;
+    PublishedTransport<IClientTransport> _sendTransport;
+    // Guarded by _transportMutex and replayed to each new transport
+    std::unordered_set<std::string> _topics;
+    ReconnectPolicy _reconnectPolicy;
 
     OnDataHandler _receivedHandler;
+    OnSharedDataHandler _receivedSharedHandler;
+    OnChunkHandler _chunkHandler;
+    OnLatestHandler _latestHandler;
     OnInvokedPromiseIdHandler _invokedPromiseIdHandler;
     OnInvokedImmediateHandler _invokedImmediateHandler;
     OnInvokedCallbackHandler _invokedCallbackHandler;
@@ -52,12 +93,31 @@ protected:
     OnHandler _connectHandler;
     OnHandler _disconnectHandler;
     OnHandler _errorHandler;
+    OnHandler _backpressureHandler;
+    OnHandler _writableHandler;
     OnLogHandler _logHandler;
 
+    // Files `invoke` and sends the message, unless there is no transport to send it with or its window
+    // is full. Returns Good if it went out.
+    InvokeResultCode queueInvoke(Handle promiseId,
+        Payload message,
+        PendingInvoke &invoke,
+        std::chrono::milliseconds timeout,
+        Priority priority = Priority::Normal);
+
+    void start(bool wait);
+    // Sends the result of an invoke, for as long as the connection is around to send it
+    ResultCallback resultCallback(Handle connectionHandle, Handle promiseId);
     void handleError();
     void handleRemoteDisconnected();
     void handleRemoteConnected();
     void handleData(Handle connectionHandle, Handle promiseId, Payload message);
+    void handleResult(Handle promiseId, Payload message);
+    void handleSharedData(SharedPayload message);
+    void handleChunk(Handle streamId, Payload chunk, bool last);
+    void handleLatest(uint32_t channel, Payload value);
+    void handleBackpressure(bool blocked);
+    void handleInvokeTimeout(Handle promiseId);
     void handleLog(Handle connectionHandle, LogLevel level, std::string message, std::string category = DefaultCategory);
 };
 } // namespace Twitch::IPC
@@ -0,0 +1,190 @@
+// Copyright Twitch Interactive, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: MIT
+
+#define NOMINMAX
+
+#include "Compression.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+// The LZ4 block format: each sequence is a token, literals and a match to copy from up to 64KB back.
+// The last sequence is literals only, and the format wants the last few bytes to be literals too.
+constexpr size_t MinMatch = 4;
+constexpr size_t LastLiterals = 5;
+constexpr size_t MatchFindLimit = 12;
+constexpr size_t MaxOffset = 65535;
+constexpr int HashBits = 12;
+
+uint32_t read32(const uint8_t *p)
+{
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+uint32_t hashSequence(uint32_t sequence)
+{
+    return (sequence * 2654435761u) >> (32 - HashBits);
+}
+
+// Lengths of 15 or more spill out of the token into bytes of 255 and a remainder
+void writeLength(uint8_t *&op, size_t length)
+{
+    length -= 15;
+    for(; length >= 255; length -= 255) {
+        *op++ = 255;
+    }
+    *op++ = static_cast<uint8_t>(length);
+}
+
+bool readLength(const uint8_t *&ip, const uint8_t *end, size_t &length)
+{
+    uint8_t byte;
+    do {
+        if(ip == end) {
+            return false;
+        }
+        byte = *ip++;
+        length += byte;
+    } while(byte == 255);
+    return true;
+}
+} // namespace
+
+namespace Twitch::IPC::Compression {
+bool compressFrame(const uint8_t *data, size_t size, std::vector<uint8_t> &out)
+{
+    if(size <= sizeof(uint32_t) || size > UINT32_MAX) {
+        return false;
+    }
+    // Nothing the block can hold expands it beyond this
+    out.resize(sizeof(uint32_t) + size + size / 255 + 16);
+    const auto rawSize = static_cast<uint32_t>(size);
+    memcpy(out.data(), &rawSize, sizeof(rawSize));
+    uint8_t *op = out.data() + sizeof(rawSize);
+    size_t anchor = 0;
+
+    const auto emit = [&](size_t literalEnd, size_t matchLength, size_t offset) {
+        const size_t literals = literalEnd - anchor;
+        uint8_t *token = op++;
+        *token = static_cast<uint8_t>(std::min<size_t>(literals, 15) << 4);
+        if(literals >= 15) {
+            writeLength(op, literals);
+        }
+        memcpy(op, data + anchor, literals);
+        op += literals;
+        if(matchLength) {
+            *op++ = static_cast<uint8_t>(offset);
+            *op++ = static_cast<uint8_t>(offset >> 8);
+            const size_t extra = matchLength - MinMatch;
+            *token |= static_cast<uint8_t>(std::min<size_t>(extra, 15));
+            if(extra >= 15) {
+                writeLength(op, extra);
+            }
+        }
+    };
+
+    if(size > MatchFindLimit) {
+        // Positions plus one, so that 0 means nothing seen yet
+        uint32_t table[1 << HashBits] = {};
+        const size_t matchLimit = size - LastLiterals;
+        const size_t searchLimit = size - MatchFindLimit;
+        size_t ip = 0;
+        while(ip < searchLimit) {
+            const uint32_t sequence = read32(data + ip);
+            auto &entry = table[hashSequence(sequence)];
+            const size_t candidate = entry;
+            entry = static_cast<uint32_t>(ip + 1);
+            if(!candidate || ip + 1 - candidate > MaxOffset || read32(data + candidate - 1) != sequence) {
+                // Looks further ahead the longer nothing matches, so incompressible data goes through quickly
+                ip += 1 + ((ip - anchor) >> 6);
+                continue;
+            }
+            const size_t ref = candidate - 1;
+            size_t length = MinMatch;
+            while(ip + length < matchLimit && data[ref + length] == data[ip + length]) {
+                ++length;
+            }
+            emit(ip, length, ip - ref);
+            ip += length;
+            anchor = ip;
+        }
+    }
+    emit(size, 0, 0);
+
+    const auto compressedSize = static_cast<size_t>(op - out.data());
+    if(compressedSize >= size) {
+        return false;
+    }
+    out.resize(compressedSize);
+    return true;
+}
+
+bool decompressFrame(const uint8_t *data, size_t size, std::vector<uint8_t> &out, size_t maxSize)
+{
+    uint32_t rawSize{};
+    if(size <= sizeof(rawSize)) {
+        return false;
+    }
+    memcpy(&rawSize, data, sizeof(rawSize));
+    // No LZ4 block inflates by more than this, so a larger claim is a lie and nothing is allocated for it
+    const size_t maxInflated = (size - sizeof(rawSize)) * 255 + 16;
+    if(!rawSize || rawSize > maxSize || rawSize > maxInflated) {
+        return false;
+    }
+    out.resize(rawSize);
+    const uint8_t *ip = data + sizeof(rawSize);
+    const uint8_t *const end = data + size;
+    uint8_t *const begin = out.data();
+    uint8_t *op = begin;
+    uint8_t *const opEnd = begin + rawSize;
+
+    for(;;) {
+        if(ip == end) {
+            return false;
+        }
+        const uint8_t token = *ip++;
+        size_t literals = token >> 4;
+        if(literals == 15 && !readLength(ip, end, literals)) {
+            return false;
+        }
+        if(literals > static_cast<size_t>(end - ip) || literals > static_cast<size_t>(opEnd - op)) {
+            return false;
+        }
+        memcpy(op, ip, literals);
+        ip += literals;
+        op += literals;
+        if(ip == end) {
+            return op == opEnd;
+        }
+
+        if(end - ip < 2) {
+            return false;
+        }
+        const size_t offset = ip[0] | (static_cast<size_t>(ip[1]) << 8);
+        ip += 2;
+        if(!offset || offset > static_cast<size_t>(op - begin)) {
+            return false;
+        }
+        size_t length = token & 15;
+        if(length == 15 && !readLength(ip, end, length)) {
+            return false;
+        }
+        length += MinMatch;
+        if(length > static_cast<size_t>(opEnd - op)) {
+            return false;
+        }
+        // A match can overlap what it produces, which is how runs are encoded
+        const uint8_t *match = op - offset;
+        if(offset >= length) {
+            memcpy(op, match, length);
+            op += length;
+        } else {
+            for(size_t i = 0; i < length; ++i) {
+                *op++ = *match++;
+            }
+        }
+    }
+}
+} // namespace Twitch::IPC::Compression
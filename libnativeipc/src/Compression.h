@@ -0,0 +1,19 @@
+// Copyright Twitch Interactive, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Twitch::IPC::Compression {
+// Bits of the mask a peer announces with ControlHandle::Compression, one per codec it can read
+constexpr uint32_t Lz4Block = 1;
+
+// Compressed frame bodies are the uint32_t size of the original body followed by an LZ4 block.
+// Returns false, leaving `out` unspecified, when that wouldn't be smaller than the body itself.
+bool compressFrame(const uint8_t *data, size_t size, std::vector<uint8_t> &out);
+// Returns false on a malformed frame, including one that would inflate past `maxSize`
+bool decompressFrame(const uint8_t *data, size_t size, std::vector<uint8_t> &out, size_t maxSize = UINT32_MAX);
+} // namespace Twitch::IPC::Compression
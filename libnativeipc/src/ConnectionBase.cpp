@@ -43,7 +43,13 @@ NATIVEIPC_LIBSPEC const char *Twitch::IPC::toString(LogLevel value)
 ConnectionBase::ConnectionBase(
     std::shared_ptr<ConnectionFactory::Factory> factory, std::string endpoint)
     : _factory(std::move(factory))
-    , _lambdaShield(std::make_shared<int>(1))
+    , _lambdaShield(new int(1),
+          [this](int *shield) {
+              delete shield;
+              std::lock_guard guard(_shieldMutex);
+              _shieldReleased = true;
+              _shieldCondVar.notify_all();
+          })
     , _endpoint(std::move(endpoint))
 {
 }
@@ -51,9 +57,9 @@ ConnectionBase::ConnectionBase(
 Handle ConnectionBase::getNextHandle()
 {
     auto result = ++_lastHandle;
-    if(_lastHandle >= ResponseFlag) {
+    if(_lastHandle >= PromiseIdLimit) {
         std::lock_guard guard(_rolloverMutex);
-        if(_lastHandle >= ResponseFlag) {
+        if(_lastHandle >= PromiseIdLimit) {
             _lastHandle = 0;
         }
         result = ++_lastHandle;
@@ -64,16 +70,107 @@ Handle ConnectionBase::getNextHandle()
 void ConnectionBase::clearLambdaShield()
 {
     if (_lambdaShield) {
-        std::weak_ptr<int> weakMarker(_lambdaShield);
         _lambdaShield.reset();
-        while(true) {
-            {
-                auto locked = weakMarker.lock();
-                if (!locked) {
-                    return;
-                }
+        // Wakes as soon as the last callback still using the connection returns
+        std::unique_lock lock(_shieldMutex);
+        _shieldCondVar.wait(lock, [this] { return _shieldReleased; });
+    }
+}
+
+void ConnectionBase::completeInvoke(PendingInvoke &invoke, Payload result)
+{
+    _invokeLatency.record(std::chrono::steady_clock::now() - invoke.sent);
+    invoke.callback(InvokeResultCode::Good, std::move(result));
+}
+
+PendingInvoke ConnectionBase::asyncInvoke(std::shared_ptr<InvokeFuture::State> state)
+{
+    PendingInvoke invoke;
+    invoke.callback = [state = std::move(state)](InvokeResultCode resultCode, Payload result) {
+        state->complete(resultCode, std::move(result));
+    };
+    invoke.direct = true;
+    return invoke;
+}
+
+void ConnectionBase::failDirectInvokes(std::vector<PendingInvoke> &invokes, InvokeResultCode resultCode)
+{
+    auto keep = invokes.begin();
+    for(auto &invoke : invokes) {
+        if(invoke.direct) {
+            invoke.callback(resultCode, {});
+        } else {
+            if(&*keep != &invoke) {
+                *keep = std::move(invoke);
             }
-            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            ++keep;
+        }
+    }
+    invokes.erase(keep, invokes.end());
+}
+
+void ConnectionBase::dropRejected(const std::vector<size_t> &rejected, std::vector<Handle> &promiseIds, std::vector<Payload> &messages)
+{
+    if(rejected.empty()) {
+        return;
+    }
+    size_t kept = 0;
+    auto next = rejected.begin();
+    for(size_t i = 0; i < promiseIds.size(); ++i) {
+        if(next != rejected.end() && *next == i) {
+            ++next;
+            continue;
+        }
+        if(kept != i) {
+            promiseIds[kept] = promiseIds[i];
+            messages[kept] = std::move(messages[i]);
         }
+        ++kept;
     }
+    promiseIds.resize(kept);
+    messages.resize(kept);
+}
+
+InvokeResult ConnectionBase::waitBlocking(InvokeFuture future)
+{
+    // With a single core, spinning only keeps the I/O thread from running
+    static const bool canSpin = std::thread::hardware_concurrency() > 1;
+    if(!canSpin) {
+        return future.get();
+    }
+    const auto start = std::chrono::steady_clock::now();
+    const auto spin = std::chrono::nanoseconds(_blockingSpinNanoseconds.load(std::memory_order_relaxed));
+    while(!future.ready() && std::chrono::steady_clock::now() - start < spin) {
+        std::this_thread::yield();
+    }
+    future.wait();
+
+    // Twice the wait just seen, when it was short enough to be worth spinning for, otherwise half the
+    // spin; averaged with the previous value so one odd result doesn't swing it
+    const auto waited = std::chrono::steady_clock::now() - start;
+    const auto target = waited < MaxBlockingSpin / 2 ? waited * 2 : waited < MaxBlockingSpin ? MaxBlockingSpin : spin / 2;
+    _blockingSpinNanoseconds.store(
+        ((spin + std::chrono::duration_cast<std::chrono::nanoseconds>(target)) / 2).count(), std::memory_order_relaxed);
+    return future.get();
+}
+
+ConnectionStats ConnectionBase::collectStats(size_t dispatchBacklog) const
+{
+    ConnectionStats stats;
+    stats.messagesSent = _counters->messagesSent;
+    stats.bytesSent = _counters->bytesSent;
+    stats.messagesReceived = _counters->messagesReceived;
+    stats.bytesReceived = _counters->bytesReceived;
+    stats.writeQueueMessages = _counters->writeQueueMessages;
+    stats.writeQueueBytes = _counters->writeQueueBytes;
+    stats.writesInFlight = _counters->writesInFlight;
+    stats.dispatchBacklog = dispatchBacklog;
+    stats.pendingInvokes = _promises.size();
+    stats.peakPendingInvokes = _promises.peakInFlight();
+    stats.invokesRejected = _promises.rejected();
+    stats.reorderedResults = _promises.reordered();
+    stats.reconnects = _counters->reconnects;
+    stats.latestValuesReplaced = _counters->latestValuesReplaced;
+    _invokeLatency.snapshot(stats.invokeLatency);
+    return stats;
 }
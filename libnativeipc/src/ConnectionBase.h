@@ -5,7 +5,12 @@
 
 #include "ConnectionFactoryPrivate.h"
 #include "IConnection.h"
+#include "LatencyRecorder.h"
+#include "Message.h"
+#include "PromiseTable.h"
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <mutex>
 
 namespace Twitch::IPC {
@@ -13,6 +18,9 @@ class IClientTransport;
 class IServerTransport;
 class ServerConnection;
 constexpr Handle ResponseFlag = 0x80000000;
+// Promise ids roll over here so that responses stay clear of the transport control handles, and of
+// the transport's own flag for compressed frames
+constexpr Handle PromiseIdLimit = ControlHandleBase & ~ResponseFlag & ~CompressedFlag;
 
 class ConnectionBase {
 public:
@@ -24,14 +32,47 @@ public:
 
 protected:
     std::shared_ptr<ConnectionFactory::Factory> _factory;
+    // Set by the shield's deleter, on whichever thread lets go of it last. Declared first so that they
+    // outlive it.
+    std::mutex _shieldMutex;
+    std::condition_variable _shieldCondVar;
+    bool _shieldReleased = false;
+    // Held weakly by result callbacks handed to handlers, which only use the connection while they
+    // can lock it
     std::shared_ptr<int> _lambdaShield;
     std::string _endpoint;
     std::mutex _transportMutex;
     std::atomic<bool> _shuttingDown{false};
+    size_t _writeBatchMaxBytes = DefaultWriteBatchMaxBytes;
+    size_t _writeBatchMaxMessages = DefaultWriteBatchMaxMessages;
+    size_t _writeQueueMaxBytes = DefaultWriteQueueMaxBytes;
+    size_t _writeQueueMaxMessages = DefaultWriteQueueMaxMessages;
+    size_t _compressionThreshold = 0;
+    size_t _maxFrameSize = DefaultMaxFrameSize;
+    // Handed to every transport the connection creates, so the totals outlive each of them
+    std::shared_ptr<TransportCounters> _counters{std::make_shared<TransportCounters>()};
+    LatencyRecorder _invokeLatency;
+    // Client connections file every invoke under connection handle 0
+    PromiseTable _promises;
     Handle getNextHandle();
     void clearLambdaShield();
+    // Runs the callback of an invoke the peer answered, once taken from _promises, and records how long that took
+    void completeInvoke(PendingInvoke &invoke, Payload result);
+    // The pending invoke behind an invokeAsync future
+    static PendingInvoke asyncInvoke(std::shared_ptr<InvokeFuture::State> state);
+    // Fails the direct invokes among `invokes` and removes them, leaving the rest for the dispatch thread
+    static void failDirectInvokes(std::vector<PendingInvoke> &invokes, InvokeResultCode resultCode);
+    // Takes the messages at the `rejected` indices, in ascending order, out of a batch
+    static void dropRejected(const std::vector<size_t> &rejected, std::vector<Handle> &promiseIds, std::vector<Payload> &messages);
+    // Spins on the future of an invokeBlocking call for a while before sleeping on it
+    InvokeResult waitBlocking(InvokeFuture future);
+    [[nodiscard]] ConnectionStats collectStats(size_t dispatchBacklog) const;
 
 private:
+    // Spinning any longer than this costs more than the wakeup it saves
+    static constexpr std::chrono::nanoseconds MaxBlockingSpin = std::chrono::microseconds(200);
+    // Follows how long recent invokeBlocking results took, so it spins just past that
+    std::atomic<int64_t> _blockingSpinNanoseconds{std::chrono::nanoseconds(std::chrono::microseconds(20)).count()};
     std::mutex _rolloverMutex;
     std::atomic<Handle> _lastHandle{0};
 };
@@ -3,12 +3,192 @@
 
 // ReSharper disable CppInconsistentNaming
 #include "ConnectionExports.h"
+#include "BufferPool.h"
 #include "ConnectionFactory.h"
+#include <algorithm>
+#include <mutex>
+#include <unordered_map>
 
 // This file contains C externs for use by C#
 
 using namespace Twitch::IPC;
 
+namespace {
+std::vector<Payload> toPayloads(const void *const *bytes, const int *lengths, int count)
+{
+    std::vector<Payload> messages;
+    messages.reserve(count > 0 ? count : 0);
+    for(int i = 0; i < count; ++i) {
+        messages.emplace_back(reinterpret_cast<const uint8_t *>(bytes[i]), lengths[i]);
+    }
+    return messages;
+}
+
+std::mutex s_bufferPoolMutex;
+BufferPool s_bufferPool;
+
+Twitch_IPC_Buffer lend(Payload &&message)
+{
+    return new Payload(std::move(message));
+}
+
+// Takes a buffer over from the caller, keeping the first `length` bytes
+Payload takeBuffer(Twitch_IPC_Buffer buffer, int length)
+{
+    std::unique_ptr<Payload> owned(reinterpret_cast<Payload *>(buffer));
+    owned->resize(std::min(owned->size(), static_cast<size_t>(std::max(length, 0))));
+    return std::move(*owned);
+}
+
+// Holds received messages for a caller that polls for them, so that it crosses into native code once
+// per batch rather than once per message. A ring of fixed capacity: messages and invokes that arrive
+// while it is full are turned away and counted, rather than queued without bound behind a caller that
+// stopped polling. Results are the answers to the caller's own invokes, so they are let in regardless.
+class Inbox {
+public:
+    static constexpr int DefaultCapacity = 4096;
+
+    Inbox(int capacity, void (*ready)(void *), void *context)
+        : _ready(ready)
+        , _context(context)
+        , _ring(static_cast<size_t>(capacity > 0 ? capacity : DefaultCapacity))
+    {
+    }
+    ~Inbox()
+    {
+        for(size_t i = 0; i < _count; ++i) {
+            Twitch_IPC_BufferRelease(_ring[(_head + i) % _ring.size()].buffer);
+        }
+    }
+    DELETE_COPY_AND_MOVE_CONSTRUCTORS(Inbox);
+
+    // Returns false if the ring was full and `message` was dropped
+    bool push(Twitch_IPC_MessageKind kind, Handle connectionHandle, Handle promiseId, Payload &&message)
+    {
+        bool wasEmpty;
+        {
+            std::lock_guard guard(_mutex);
+            if(_count == _ring.size()) {
+                if(kind != Twitch_IPC_MessageResult) {
+                    ++_dropped;
+                    return false;
+                }
+                grow();
+            }
+            const auto buffer = reinterpret_cast<Payload *>(lend(std::move(message)));
+            wasEmpty = !_count;
+            _ring[(_head + _count++) % _ring.size()] = {
+                kind, connectionHandle, promiseId, static_cast<int32_t>(buffer->size()), buffer->data(), buffer};
+        }
+        if(wasEmpty && _ready) {
+            _ready(_context);
+        }
+        return true;
+    }
+
+    int poll(Twitch_IPC_Message *messages, int maxCount)
+    {
+        std::lock_guard guard(_mutex);
+        const auto count = std::min(static_cast<size_t>(std::max(maxCount, 0)), _count);
+        // In at most two runs, as the waiting messages may wrap around the end of the ring
+        const auto first = std::min(count, _ring.size() - _head);
+        std::copy_n(_ring.begin() + static_cast<ptrdiff_t>(_head), first, messages);
+        std::copy_n(_ring.begin(), count - first, messages + first);
+        _head = (_head + count) % _ring.size();
+        _count -= count;
+        return static_cast<int>(count);
+    }
+
+    uint64_t dropped()
+    {
+        std::lock_guard guard(_mutex);
+        return _dropped;
+    }
+
+private:
+    // Doubles the ring, with what is waiting moved to the front of it
+    void grow()
+    {
+        std::vector<Twitch_IPC_Message> ring(_ring.size() * 2);
+        for(size_t i = 0; i < _count; ++i) {
+            ring[i] = _ring[(_head + i) % _ring.size()];
+        }
+        _ring = std::move(ring);
+        _head = 0;
+    }
+
+    void (*const _ready)(void *);
+    void *const _context;
+    std::mutex _mutex;
+    std::vector<Twitch_IPC_Message> _ring;
+    size_t _head = 0;
+    size_t _count = 0;
+    uint64_t _dropped = 0;
+};
+
+// Keyed by connection handle, and dropped when the connection is destroyed
+std::mutex s_inboxesMutex;
+std::unordered_map<void *, std::shared_ptr<Inbox>> s_inboxes;
+
+std::shared_ptr<Inbox> openInbox(void *handle, int capacity, void (*ready)(void *), void *context)
+{
+    auto inbox = std::make_shared<Inbox>(capacity, ready, context);
+    std::lock_guard guard(s_inboxesMutex);
+    s_inboxes[handle] = inbox;
+    return inbox;
+}
+
+std::shared_ptr<Inbox> findInbox(void *handle)
+{
+    std::lock_guard guard(s_inboxesMutex);
+    const auto found = s_inboxes.find(handle);
+    return found != s_inboxes.end() ? found->second : nullptr;
+}
+
+int pollInbox(void *handle, Twitch_IPC_Message *messages, int maxCount)
+{
+    const auto inbox = findInbox(handle);
+    return inbox ? inbox->poll(messages, maxCount) : 0;
+}
+
+uint64_t droppedFromInbox(void *handle)
+{
+    const auto inbox = findInbox(handle);
+    return inbox ? inbox->dropped() : 0;
+}
+
+void closeInbox(void *handle)
+{
+    std::lock_guard guard(s_inboxesMutex);
+    s_inboxes.erase(handle);
+}
+
+void copyStats(const ConnectionStats &current, Twitch_IPC_ConnectionStats *stats)
+{
+    stats->messagesSent = current.messagesSent;
+    stats->bytesSent = current.bytesSent;
+    stats->messagesReceived = current.messagesReceived;
+    stats->bytesReceived = current.bytesReceived;
+    stats->writeQueueMessages = current.writeQueueMessages;
+    stats->writeQueueBytes = current.writeQueueBytes;
+    stats->writesInFlight = current.writesInFlight;
+    stats->dispatchBacklog = current.dispatchBacklog;
+    stats->pendingInvokes = current.pendingInvokes;
+    stats->peakPendingInvokes = current.peakPendingInvokes;
+    stats->invokesRejected = current.invokesRejected;
+    stats->reorderedResults = current.reorderedResults;
+    stats->reconnects = current.reconnects;
+    stats->latestValuesReplaced = current.latestValuesReplaced;
+    const auto &latency = current.invokeLatency;
+    stats->invokeCount = latency.count;
+    stats->invokeLatencyP50 = latency.percentile(0.5);
+    stats->invokeLatencyP90 = latency.percentile(0.9);
+    stats->invokeLatencyP99 = latency.percentile(0.99);
+    stats->invokeLatencyP999 = latency.percentile(0.999);
+    stats->invokeLatencyMax = latency.maxMicroseconds;
+}
+} // namespace
+
 NATIVEIPC_LIBSPEC Twitch_IPC_Connection Twitch_IPC_ConnectionCreateServer(const char *endpoint)
 {
     return ConnectionFactory::newServerConnection(endpoint).release();
@@ -22,6 +202,7 @@ NATIVEIPC_LIBSPEC Twitch_IPC_Connection Twitch_IPC_ConnectionCreateClient(const
 NATIVEIPC_LIBSPEC void Twitch_IPC_ConnectionDestroy(Twitch_IPC_Connection handle)
 {
     delete reinterpret_cast<IConnection *>(handle);
+    closeInbox(handle);
 }
 
 NATIVEIPC_LIBSPEC void Twitch_IPC_ConnectionConnect(Twitch_IPC_Connection handle)
@@ -30,6 +211,12 @@ NATIVEIPC_LIBSPEC void Twitch_IPC_ConnectionConnect(Twitch_IPC_Connection handle
     connection->connect();
 }
 
+NATIVEIPC_LIBSPEC void Twitch_IPC_ConnectionConnectAsync(Twitch_IPC_Connection handle)
+{
+    auto connection = reinterpret_cast<IConnection *>(handle);
+    connection->connectAsync();
+}
+
 NATIVEIPC_LIBSPEC void Twitch_IPC_ConnectionSend(
     Twitch_IPC_Connection handle, const void *bytes, int length)
 {
@@ -51,12 +238,37 @@ NATIVEIPC_LIBSPEC void Twitch_IPC_ConnectionSendResult(
     return connection->sendResult(connectionId, promiseId, {reinterpret_cast<const uint8_t *>(bytes), length});
 }
 
+NATIVEIPC_LIBSPEC void Twitch_IPC_ConnectionSendMany(
+    Twitch_IPC_Connection handle, const void *const *bytes, const int *lengths, int count)
+{
+    auto connection = reinterpret_cast<IConnection *>(handle);
+    connection->send(toPayloads(bytes, lengths, count));
+}
+
+NATIVEIPC_LIBSPEC void Twitch_IPC_ConnectionInvokeMany(Twitch_IPC_Connection handle,
+    const void *const *bytes,
+    const int *lengths,
+    int count,
+    uint32_t *promiseIds)
+{
+    auto connection = reinterpret_cast<IConnection *>(handle);
+    const auto ids = connection->invokeMany(toPayloads(bytes, lengths, count));
+    std::copy(ids.begin(), ids.end(), promiseIds);
+}
+
 NATIVEIPC_LIBSPEC void Twitch_IPC_ConnectionDisconnect(Twitch_IPC_Connection handle)
 {
     auto connection = reinterpret_cast<IConnection *>(handle);
     connection->disconnect();
 }
 
+NATIVEIPC_LIBSPEC void Twitch_IPC_ConnectionGetStats(
+    Twitch_IPC_Connection handle, Twitch_IPC_ConnectionStats *stats)
+{
+    auto connection = reinterpret_cast<IConnection *>(handle);
+    copyStats(connection->stats(), stats);
+}
+
 NATIVEIPC_LIBSPEC void Twitch_IPC_ConnectionOnConnect(Twitch_IPC_Connection handle, void (*fptr)())
 {
     auto connection = reinterpret_cast<IConnection *>(handle);
@@ -128,3 +340,380 @@ NATIVEIPC_LIBSPEC void Twitch_IPC_ConnectionOnLog(
         connection->onLog(nullptr, static_cast<LogLevel>(verbosity));
     }
 }
+
+NATIVEIPC_LIBSPEC Twitch_IPC_Buffer Twitch_IPC_BufferAllocate(int capacity)
+{
+    const auto size = static_cast<size_t>(std::max(capacity, 0));
+    std::vector<uint8_t> buffer;
+    {
+        std::lock_guard guard(s_bufferPoolMutex);
+        buffer = s_bufferPool.acquire(size);
+    }
+    buffer.resize(size);
+    return lend(std::move(buffer));
+}
+
+NATIVEIPC_LIBSPEC void *Twitch_IPC_BufferData(Twitch_IPC_Buffer buffer)
+{
+    return reinterpret_cast<Payload *>(buffer)->data();
+}
+
+NATIVEIPC_LIBSPEC int Twitch_IPC_BufferLength(Twitch_IPC_Buffer buffer)
+{
+    return static_cast<int>(reinterpret_cast<Payload *>(buffer)->size());
+}
+
+NATIVEIPC_LIBSPEC void Twitch_IPC_BufferRelease(Twitch_IPC_Buffer buffer)
+{
+    std::unique_ptr<Payload> owned(reinterpret_cast<Payload *>(buffer));
+    std::lock_guard guard(s_bufferPoolMutex);
+    s_bufferPool.release(std::move(*owned));
+}
+
+NATIVEIPC_LIBSPEC void Twitch_IPC_ConnectionSendBuffer(
+    Twitch_IPC_Connection handle, Twitch_IPC_Buffer buffer, int length)
+{
+    auto connection = reinterpret_cast<IConnection *>(handle);
+    connection->send(takeBuffer(buffer, length));
+}
+
+NATIVEIPC_LIBSPEC uint32_t Twitch_IPC_ConnectionInvokeBuffer(
+    Twitch_IPC_Connection handle, Twitch_IPC_Buffer buffer, int length)
+{
+    auto connection = reinterpret_cast<IConnection *>(handle);
+    return connection->invoke(takeBuffer(buffer, length));
+}
+
+NATIVEIPC_LIBSPEC void Twitch_IPC_ConnectionSendResultBuffer(Twitch_IPC_Connection handle,
+    uint32_t connectionId,
+    uint32_t promiseId,
+    Twitch_IPC_Buffer buffer,
+    int length)
+{
+    auto connection = reinterpret_cast<IConnection *>(handle);
+    connection->sendResult(connectionId, promiseId, takeBuffer(buffer, length));
+}
+
+NATIVEIPC_LIBSPEC void Twitch_IPC_ConnectionOnReceivedBuffer(
+    Twitch_IPC_Connection handle, void (*fptr)(Twitch_IPC_Buffer, const void *, int))
+{
+    auto connection = reinterpret_cast<IConnection *>(handle);
+    if(fptr) {
+        connection->onReceived([fptr](Payload message) {
+            const auto buffer = lend(std::move(message));
+            fptr(buffer, Twitch_IPC_BufferData(buffer), Twitch_IPC_BufferLength(buffer));
+        });
+    } else {
+        connection->onReceived(nullptr);
+    }
+}
+
+NATIVEIPC_LIBSPEC void Twitch_IPC_ConnectionOnInvokedBuffer(Twitch_IPC_Connection handle,
+    void (*fptr)(uint32_t, uint32_t, Twitch_IPC_Buffer, const void *, int))
+{
+    auto connection = reinterpret_cast<IConnection *>(handle);
+    if(fptr) {
+        connection->onInvoked([fptr](Handle connectionHandle, Handle promiseId, Payload message) {
+            const auto buffer = lend(std::move(message));
+            fptr(connectionHandle, promiseId, buffer, Twitch_IPC_BufferData(buffer), Twitch_IPC_BufferLength(buffer));
+        });
+    } else {
+        connection->onInvoked(IConnection::OnInvokedPromiseIdHandler(nullptr));
+    }
+}
+
+NATIVEIPC_LIBSPEC void Twitch_IPC_ConnectionOnResultBuffer(
+    Twitch_IPC_Connection handle, void (*fptr)(uint32_t, Twitch_IPC_Buffer, const void *, int))
+{
+    auto connection = reinterpret_cast<IConnection *>(handle);
+    if(fptr) {
+        connection->onResult([fptr](Handle promiseId, Payload message) {
+            const auto buffer = lend(std::move(message));
+            fptr(promiseId, buffer, Twitch_IPC_BufferData(buffer), Twitch_IPC_BufferLength(buffer));
+        });
+    } else {
+        connection->onResult(nullptr);
+    }
+}
+
+NATIVEIPC_LIBSPEC void Twitch_IPC_ConnectionEnablePolling(
+    Twitch_IPC_Connection handle, int capacity, void (*ready)(void *), void *context)
+{
+    auto connection = reinterpret_cast<IConnection *>(handle);
+    auto inbox = openInbox(handle, capacity, ready, context);
+    connection->onReceived([inbox](Payload message) {
+        inbox->push(Twitch_IPC_MessageReceived, 0, 0, std::move(message));
+    });
+    // An invoke with no room is answered straight away, so the invoker isn't left waiting for a result
+    connection->onInvoked([inbox, connection](Handle connectionHandle, Handle promiseId, Payload message) {
+        if(!inbox->push(Twitch_IPC_MessageInvoked, connectionHandle, promiseId, std::move(message))) {
+            connection->sendResult(connectionHandle, promiseId, {});
+        }
+    });
+    connection->onResult([inbox](Handle promiseId, Payload message) {
+        inbox->push(Twitch_IPC_MessageResult, 0, promiseId, std::move(message));
+    });
+}
+
+NATIVEIPC_LIBSPEC int Twitch_IPC_ConnectionPoll(
+    Twitch_IPC_Connection handle, Twitch_IPC_Message *messages, int maxCount)
+{
+    return pollInbox(handle, messages, maxCount);
+}
+
+NATIVEIPC_LIBSPEC uint64_t Twitch_IPC_ConnectionPollDropped(Twitch_IPC_Connection handle)
+{
+    return droppedFromInbox(handle);
+}
+
+NATIVEIPC_LIBSPEC Twitch_IPC_ServerConnection Twitch_IPC_ServerConnectionCreate(const char *endpoint)
+{
+    return ConnectionFactory::newMulticonnectServerConnection(endpoint).release();
+}
+
+NATIVEIPC_LIBSPEC void Twitch_IPC_ServerConnectionDestroy(Twitch_IPC_ServerConnection handle)
+{
+    delete reinterpret_cast<IServerConnection *>(handle);
+    closeInbox(handle);
+}
+
+NATIVEIPC_LIBSPEC void Twitch_IPC_ServerConnectionConnect(Twitch_IPC_ServerConnection handle)
+{
+    auto connection = reinterpret_cast<IServerConnection *>(handle);
+    connection->connect();
+}
+
+NATIVEIPC_LIBSPEC void Twitch_IPC_ServerConnectionConnectAsync(Twitch_IPC_ServerConnection handle)
+{
+    auto connection = reinterpret_cast<IServerConnection *>(handle);
+    connection->connectAsync();
+}
+
+NATIVEIPC_LIBSPEC void Twitch_IPC_ServerConnectionDisconnect(Twitch_IPC_ServerConnection handle)
+{
+    auto connection = reinterpret_cast<IServerConnection *>(handle);
+    connection->disconnect();
+}
+
+NATIVEIPC_LIBSPEC int Twitch_IPC_ServerConnectionActiveConnections(Twitch_IPC_ServerConnection handle)
+{
+    auto connection = reinterpret_cast<IServerConnection *>(handle);
+    return connection->activeConnections();
+}
+
+NATIVEIPC_LIBSPEC void Twitch_IPC_ServerConnectionSend(
+    Twitch_IPC_ServerConnection handle, uint32_t connectionId, const void *bytes, int length)
+{
+    auto connection = reinterpret_cast<IServerConnection *>(handle);
+    connection->send(connectionId, {reinterpret_cast<const uint8_t *>(bytes), length});
+}
+
+NATIVEIPC_LIBSPEC void Twitch_IPC_ServerConnectionBroadcast(
+    Twitch_IPC_ServerConnection handle, const void *bytes, int length)
+{
+    auto connection = reinterpret_cast<IServerConnection *>(handle);
+    connection->broadcast({reinterpret_cast<const uint8_t *>(bytes), length});
+}
+
+NATIVEIPC_LIBSPEC uint32_t Twitch_IPC_ServerConnectionInvoke(
+    Twitch_IPC_ServerConnection handle, uint32_t connectionId, const void *bytes, int length)
+{
+    auto connection = reinterpret_cast<IServerConnection *>(handle);
+    return connection->invoke(connectionId, {reinterpret_cast<const uint8_t *>(bytes), length});
+}
+
+NATIVEIPC_LIBSPEC void Twitch_IPC_ServerConnectionSendResult(Twitch_IPC_ServerConnection handle,
+    uint32_t connectionId,
+    uint32_t promiseId,
+    const void *bytes,
+    int length)
+{
+    auto connection = reinterpret_cast<IServerConnection *>(handle);
+    connection->sendResult(connectionId, promiseId, {reinterpret_cast<const uint8_t *>(bytes), length});
+}
+
+NATIVEIPC_LIBSPEC void Twitch_IPC_ServerConnectionSendBuffer(
+    Twitch_IPC_ServerConnection handle, uint32_t connectionId, Twitch_IPC_Buffer buffer, int length)
+{
+    auto connection = reinterpret_cast<IServerConnection *>(handle);
+    connection->send(connectionId, takeBuffer(buffer, length));
+}
+
+NATIVEIPC_LIBSPEC void Twitch_IPC_ServerConnectionBroadcastBuffer(
+    Twitch_IPC_ServerConnection handle, Twitch_IPC_Buffer buffer, int length)
+{
+    auto connection = reinterpret_cast<IServerConnection *>(handle);
+    connection->broadcast(takeBuffer(buffer, length));
+}
+
+NATIVEIPC_LIBSPEC uint32_t Twitch_IPC_ServerConnectionInvokeBuffer(
+    Twitch_IPC_ServerConnection handle, uint32_t connectionId, Twitch_IPC_Buffer buffer, int length)
+{
+    auto connection = reinterpret_cast<IServerConnection *>(handle);
+    return connection->invoke(connectionId, takeBuffer(buffer, length));
+}
+
+NATIVEIPC_LIBSPEC void Twitch_IPC_ServerConnectionSendResultBuffer(Twitch_IPC_ServerConnection handle,
+    uint32_t connectionId,
+    uint32_t promiseId,
+    Twitch_IPC_Buffer buffer,
+    int length)
+{
+    auto connection = reinterpret_cast<IServerConnection *>(handle);
+    connection->sendResult(connectionId, promiseId, takeBuffer(buffer, length));
+}
+
+NATIVEIPC_LIBSPEC void Twitch_IPC_ServerConnectionGetStats(
+    Twitch_IPC_ServerConnection handle, Twitch_IPC_ConnectionStats *stats)
+{
+    auto connection = reinterpret_cast<IServerConnection *>(handle);
+    copyStats(connection->stats(), stats);
+}
+
+NATIVEIPC_LIBSPEC void Twitch_IPC_ServerConnectionOnConnect(
+    Twitch_IPC_ServerConnection handle, void (*fptr)(uint32_t))
+{
+    auto connection = reinterpret_cast<IServerConnection *>(handle);
+    connection->onConnect(fptr);
+}
+
+NATIVEIPC_LIBSPEC void Twitch_IPC_ServerConnectionOnDisconnect(
+    Twitch_IPC_ServerConnection handle, void (*fptr)(uint32_t))
+{
+    auto connection = reinterpret_cast<IServerConnection *>(handle);
+    connection->onDisconnect(fptr);
+}
+
+NATIVEIPC_LIBSPEC void Twitch_IPC_ServerConnectionOnError(
+    Twitch_IPC_ServerConnection handle, void (*fptr)(uint32_t))
+{
+    auto connection = reinterpret_cast<IServerConnection *>(handle);
+    connection->onError(fptr);
+}
+
+NATIVEIPC_LIBSPEC void Twitch_IPC_ServerConnectionOnReceived(
+    Twitch_IPC_ServerConnection handle, void (*fptr)(uint32_t, const void *, int))
+{
+    auto connection = reinterpret_cast<IServerConnection *>(handle);
+    if(fptr) {
+        connection->onReceived([fptr](Handle connectionHandle, Payload message) {
+            fptr(connectionHandle, message.data(), static_cast<int>(message.size()));
+        });
+    } else {
+        connection->onReceived(nullptr);
+    }
+}
+
+NATIVEIPC_LIBSPEC void Twitch_IPC_ServerConnectionOnInvoked(
+    Twitch_IPC_ServerConnection handle, void (*fptr)(uint32_t, uint32_t, const void *, int))
+{
+    auto connection = reinterpret_cast<IServerConnection *>(handle);
+    if(fptr) {
+        connection->onInvoked([fptr](Handle connectionHandle, Handle promiseId, Payload message) {
+            fptr(connectionHandle, promiseId, message.data(), static_cast<int>(message.size()));
+        });
+    } else {
+        connection->onInvoked(IServerConnection::OnInvokedPromiseIdHandler(nullptr));
+    }
+}
+
+NATIVEIPC_LIBSPEC void Twitch_IPC_ServerConnectionOnResult(
+    Twitch_IPC_ServerConnection handle, void (*fptr)(uint32_t, uint32_t, const void *, int))
+{
+    auto connection = reinterpret_cast<IServerConnection *>(handle);
+    if(fptr) {
+        connection->onResult([fptr](Handle connectionHandle, Handle promiseId, Payload message) {
+            fptr(connectionHandle, promiseId, message.data(), static_cast<int>(message.size()));
+        });
+    } else {
+        connection->onResult(nullptr);
+    }
+}
+
+NATIVEIPC_LIBSPEC void Twitch_IPC_ServerConnectionOnReceivedBuffer(
+    Twitch_IPC_ServerConnection handle, void (*fptr)(uint32_t, Twitch_IPC_Buffer, const void *, int))
+{
+    auto connection = reinterpret_cast<IServerConnection *>(handle);
+    if(fptr) {
+        connection->onReceived([fptr](Handle connectionHandle, Payload message) {
+            const auto buffer = lend(std::move(message));
+            fptr(connectionHandle, buffer, Twitch_IPC_BufferData(buffer), Twitch_IPC_BufferLength(buffer));
+        });
+    } else {
+        connection->onReceived(nullptr);
+    }
+}
+
+NATIVEIPC_LIBSPEC void Twitch_IPC_ServerConnectionOnInvokedBuffer(Twitch_IPC_ServerConnection handle,
+    void (*fptr)(uint32_t, uint32_t, Twitch_IPC_Buffer, const void *, int))
+{
+    auto connection = reinterpret_cast<IServerConnection *>(handle);
+    if(fptr) {
+        connection->onInvoked([fptr](Handle connectionHandle, Handle promiseId, Payload message) {
+            const auto buffer = lend(std::move(message));
+            fptr(connectionHandle, promiseId, buffer, Twitch_IPC_BufferData(buffer), Twitch_IPC_BufferLength(buffer));
+        });
+    } else {
+        connection->onInvoked(IServerConnection::OnInvokedPromiseIdHandler(nullptr));
+    }
+}
+
+NATIVEIPC_LIBSPEC void Twitch_IPC_ServerConnectionOnResultBuffer(Twitch_IPC_ServerConnection handle,
+    void (*fptr)(uint32_t, uint32_t, Twitch_IPC_Buffer, const void *, int))
+{
+    auto connection = reinterpret_cast<IServerConnection *>(handle);
+    if(fptr) {
+        connection->onResult([fptr](Handle connectionHandle, Handle promiseId, Payload message) {
+            const auto buffer = lend(std::move(message));
+            fptr(connectionHandle, promiseId, buffer, Twitch_IPC_BufferData(buffer), Twitch_IPC_BufferLength(buffer));
+        });
+    } else {
+        connection->onResult(nullptr);
+    }
+}
+
+NATIVEIPC_LIBSPEC void Twitch_IPC_ServerConnectionOnLog(Twitch_IPC_ServerConnection handle,
+    int verbosity,
+    void (*fptr)(uint32_t, uint32_t, const char *, const char *))
+{
+    auto connection = reinterpret_cast<IServerConnection *>(handle);
+    if(fptr) {
+        connection->onLog(
+            [fptr](Handle connectionHandle, LogLevel level, const std::string &message, const std::string &category) {
+                fptr(connectionHandle, static_cast<uint32_t>(level), message.c_str(), category.c_str());
+            },
+            static_cast<LogLevel>(verbosity));
+    } else {
+        connection->onLog(nullptr, static_cast<LogLevel>(verbosity));
+    }
+}
+
+NATIVEIPC_LIBSPEC void Twitch_IPC_ServerConnectionEnablePolling(
+    Twitch_IPC_ServerConnection handle, int capacity, void (*ready)(void *), void *context)
+{
+    auto connection = reinterpret_cast<IServerConnection *>(handle);
+    auto inbox = openInbox(handle, capacity, ready, context);
+    connection->onReceived([inbox](Handle connectionHandle, Payload message) {
+        inbox->push(Twitch_IPC_MessageReceived, connectionHandle, 0, std::move(message));
+    });
+    // An invoke with no room is answered straight away, so the invoker isn't left waiting for a result
+    connection->onInvoked([inbox, connection](Handle connectionHandle, Handle promiseId, Payload message) {
+        if(!inbox->push(Twitch_IPC_MessageInvoked, connectionHandle, promiseId, std::move(message))) {
+            connection->sendResult(connectionHandle, promiseId, {});
+        }
+    });
+    connection->onResult([inbox](Handle connectionHandle, Handle promiseId, Payload message) {
+        inbox->push(Twitch_IPC_MessageResult, connectionHandle, promiseId, std::move(message));
+    });
+}
+
+NATIVEIPC_LIBSPEC int Twitch_IPC_ServerConnectionPoll(
+    Twitch_IPC_ServerConnection handle, Twitch_IPC_Message *messages, int maxCount)
+{
+    return pollInbox(handle, messages, maxCount);
+}
+
+NATIVEIPC_LIBSPEC uint64_t Twitch_IPC_ServerConnectionPollDropped(Twitch_IPC_ServerConnection handle)
+{
+    return droppedFromInbox(handle);
+}
@@ -3,8 +3,12 @@
 
 #include "ClientConnection.h"
 #include "ConnectionFactoryPrivate.h"
+#include "InProc-ClientTransport.h"
+#include "InProc-ServerTransport.h"
 #include "Pipe-ClientTransport.h"
 #include "Pipe-ServerTransport.h"
+#include "SharedMemory-ClientTransport.h"
+#include "SharedMemory-ServerTransport.h"
 #include "TCP-ClientTransport.h"
 #include "TCP-ServerTransport.h"
 #include "ServerConnection.h"
@@ -26,23 +30,68 @@ std::string pipeNameForEndpoint(const std::string &endpoint)
 } // namespace
 
 namespace Twitch::IPC::ConnectionFactory {
+NATIVEIPC_LIBSPEC std::shared_ptr<IEventLoop> newEventLoop(size_t threadCount)
+{
+    return std::shared_ptr<IEventLoop>(std::make_shared<EventLoop>(threadCount));
+}
+
 
-NATIVEIPC_LIBSPEC std::unique_ptr<IConnection> newServerConnection(const std::string &endpoint, bool allowMultiuserAccess)
+NATIVEIPC_LIBSPEC std::unique_ptr<IConnection> newServerConnection(
+    const std::string &endpoint, bool allowMultiuserAccess, const std::shared_ptr<IEventLoop> &eventLoop)
 {
     return std::unique_ptr<IConnection>(std::make_unique<ServerConnectionSingle>(
-        MakeFactory<Transport::Pipe>(), pipeNameForEndpoint(endpoint), allowMultiuserAccess));
+        MakeFactory<Transport::Pipe>(eventLoop), pipeNameForEndpoint(endpoint), allowMultiuserAccess));
 }
 
 NATIVEIPC_LIBSPEC std::unique_ptr<IConnection> newClientConnection(
-    const std::string &endpoint)
+    const std::string &endpoint, const std::shared_ptr<IEventLoop> &eventLoop)
+{
+    return std::unique_ptr<IConnection>(std::make_unique<ClientConnection>(
+        MakeFactory<Transport::Pipe>(eventLoop), pipeNameForEndpoint(endpoint)));
+}
+
+NATIVEIPC_LIBSPEC std::unique_ptr<IServerConnection> newMulticonnectServerConnection(
+    const std::string &endpoint, bool allowMultiuserAccess, const std::shared_ptr<IEventLoop> &eventLoop)
+{
+    return std::unique_ptr<IServerConnection>(std::make_unique<ServerConnection>(
+        MakeFactory<Transport::Pipe>(eventLoop), pipeNameForEndpoint(endpoint), false, allowMultiuserAccess));
+}
+
+NATIVEIPC_LIBSPEC std::unique_ptr<IConnection> newServerConnectionShm(
+    const std::string &endpoint, bool allowMultiuserAccess, const std::shared_ptr<IEventLoop> &eventLoop)
+{
+    return std::unique_ptr<IConnection>(std::make_unique<ServerConnectionSingle>(
+        MakeFactory<Transport::SharedMemory>(eventLoop), pipeNameForEndpoint(endpoint), allowMultiuserAccess));
+}
+
+NATIVEIPC_LIBSPEC std::unique_ptr<IConnection> newClientConnectionShm(
+    const std::string &endpoint, const std::shared_ptr<IEventLoop> &eventLoop)
 {
     return std::unique_ptr<IConnection>(std::make_unique<ClientConnection>(
-        MakeFactory<Transport::Pipe>(), pipeNameForEndpoint(endpoint)));
+        MakeFactory<Transport::SharedMemory>(eventLoop), pipeNameForEndpoint(endpoint)));
 }
 
-NATIVEIPC_LIBSPEC std::unique_ptr<IServerConnection> newMulticonnectServerConnection(const std::string &endpoint, bool allowMultiuserAccess)
+NATIVEIPC_LIBSPEC std::unique_ptr<IServerConnection> newMulticonnectServerConnectionShm(
+    const std::string &endpoint, bool allowMultiuserAccess, const std::shared_ptr<IEventLoop> &eventLoop)
 {
     return std::unique_ptr<IServerConnection>(std::make_unique<ServerConnection>(
-        MakeFactory<Transport::Pipe>(), pipeNameForEndpoint(endpoint), false, allowMultiuserAccess));
+        MakeFactory<Transport::SharedMemory>(eventLoop), pipeNameForEndpoint(endpoint), false, allowMultiuserAccess));
+}
+
+NATIVEIPC_LIBSPEC std::unique_ptr<IConnection> newServerConnectionInProc(const std::string &endpoint)
+{
+    return std::unique_ptr<IConnection>(
+        std::make_unique<ServerConnectionSingle>(MakeFactory<Transport::InProc>(), endpoint, false));
+}
+
+NATIVEIPC_LIBSPEC std::unique_ptr<IConnection> newClientConnectionInProc(const std::string &endpoint)
+{
+    return std::unique_ptr<IConnection>(std::make_unique<ClientConnection>(MakeFactory<Transport::InProc>(), endpoint));
+}
+
+NATIVEIPC_LIBSPEC std::unique_ptr<IServerConnection> newMulticonnectServerConnectionInProc(const std::string &endpoint)
+{
+    return std::unique_ptr<IServerConnection>(
+        std::make_unique<ServerConnection>(MakeFactory<Transport::InProc>(), endpoint, false, false));
 }
 } // namespace Twitch::IPC::ConnectionFactory
@@ -3,6 +3,7 @@
 
 #pragma once
 
+#include "EventLoop.h"
 #include "IClientTransport.h"
 #include "IServerTransport.h"
 #include <memory>
@@ -18,6 +19,20 @@ public:
 
     virtual std::unique_ptr<IClientTransport> makeClientProtocol() const = 0;
     virtual std::unique_ptr<IServerTransport> makeServerProtocol(bool latestConnectionOnly, bool allowMultiuserAccess) const = 0;
+
+    // Shares the loop threads of `eventLoop` among the transports this makes
+    void setEventLoop(const std::shared_ptr<IEventLoop> &eventLoop)
+    {
+        _eventLoop = std::static_pointer_cast<EventLoop>(eventLoop);
+    }
+    // The loop thread for the next transport, or null for it to run one of its own
+    [[nodiscard]] std::shared_ptr<LoopThread> nextLoopThread() const
+    {
+        return _eventLoop ? _eventLoop->next() : nullptr;
+    }
+
+private:
+    std::shared_ptr<EventLoop> _eventLoop;
 };
 
 // ReSharper disable once CppPolymorphicClassWithNonVirtualPublicDestructor
@@ -38,9 +53,11 @@ public:
 };
 
 template<typename Transport>
-std::shared_ptr<Factory> MakeFactory()
+std::shared_ptr<Factory> MakeFactory(const std::shared_ptr<IEventLoop> &eventLoop = {})
 {
-    return std::shared_ptr<Factory>(std::make_shared<TransportFactory<Transport>>());
+    auto factory = std::shared_ptr<Factory>(std::make_shared<TransportFactory<Transport>>());
+    factory->setEventLoop(eventLoop);
+    return factory;
 }
 
 } // namespace Twitch::IPC::ConnectionFactory
@@ -12,22 +12,59 @@
 
 using namespace Twitch::IPC;
 
+namespace {
+// Hands every transport it makes the same socket options
+// ReSharper disable once CppPolymorphicClassWithNonVirtualPublicDestructor
+class TCPTransportFactory final : public ConnectionFactory::Factory {
+public:
+    explicit TCPTransportFactory(const TCPOptions &options)
+        : _options(options)
+    {
+    }
+
+    std::unique_ptr<IClientTransport> makeClientProtocol() const override
+    {
+        return std::unique_ptr<IClientTransport>(std::make_unique<ClientTransport<Transport::TCP>>(_options));
+    }
+
+    std::unique_ptr<IServerTransport> makeServerProtocol(
+        bool latestConnectionOnly, bool allowMultiuserAccess) const override
+    {
+        return std::make_unique<ServerTransport<Transport::TCP>>(latestConnectionOnly, allowMultiuserAccess, _options);
+    }
+
+private:
+    TCPOptions _options;
+};
+
+std::shared_ptr<ConnectionFactory::Factory> makeTCPFactory(
+    const TCPOptions &options, const std::shared_ptr<IEventLoop> &eventLoop)
+{
+    auto factory = std::shared_ptr<ConnectionFactory::Factory>(std::make_shared<TCPTransportFactory>(options));
+    factory->setEventLoop(eventLoop);
+    return factory;
+}
+} // namespace
+
 namespace Twitch::IPC::ConnectionFactory {
-NATIVEIPC_LIBSPEC std::unique_ptr<IConnection> newServerConnectionTCP(const std::string &endpoint)
+NATIVEIPC_LIBSPEC std::unique_ptr<IConnection> newServerConnectionTCP(
+    const std::string &endpoint, const TCPOptions &options, const std::shared_ptr<IEventLoop> &eventLoop)
 {
     return std::unique_ptr<IConnection>(std::make_unique<ServerConnectionSingle>(
-            MakeFactory<Transport::TCP>(), endpoint));
+            makeTCPFactory(options, eventLoop), endpoint));
 }
 
-NATIVEIPC_LIBSPEC std::unique_ptr<IConnection> newClientConnectionTCP(const std::string &endpoint)
+NATIVEIPC_LIBSPEC std::unique_ptr<IConnection> newClientConnectionTCP(
+    const std::string &endpoint, const TCPOptions &options, const std::shared_ptr<IEventLoop> &eventLoop)
 {
     return std::unique_ptr<IConnection>(std::make_unique<ClientConnection>(
-            MakeFactory<Transport::TCP>(), endpoint));
+            makeTCPFactory(options, eventLoop), endpoint));
 }
 
-NATIVEIPC_LIBSPEC std::unique_ptr<IServerConnection> newMulticonnectServerConnectionTCP(const std::string &endpoint)
+NATIVEIPC_LIBSPEC std::unique_ptr<IServerConnection> newMulticonnectServerConnectionTCP(
+    const std::string &endpoint, const TCPOptions &options, const std::shared_ptr<IEventLoop> &eventLoop)
 {
     return std::unique_ptr<IServerConnection>(std::make_unique<ServerConnection>(
-            MakeFactory<Transport::TCP>(), endpoint));
+            makeTCPFactory(options, eventLoop), endpoint));
 }
 } // namespace Twitch::IPC::ConnectionFactory
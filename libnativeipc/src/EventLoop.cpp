@@ -0,0 +1,89 @@
+// Copyright Twitch Interactive, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: MIT
+
+#include "EventLoop.h"
+#include <algorithm>
+#include <cassert>
+
+using namespace Twitch::IPC;
+
+LoopThread::LoopThread()
+{
+    uv_loop_init(&_loop);
+    _tasksReady.data = this;
+    // Keeps the loop running between transports
+    uv_async_init(&_loop, &_tasksReady, tasks_cb);
+    _thread = std::thread([this] { uv_run(&_loop, UV_RUN_DEFAULT); });
+}
+
+LoopThread::~LoopThread()
+{
+    {
+        std::lock_guard guard(_mutex);
+        _stopping = true;
+    }
+    uv_async_send(&_tasksReady);
+    _thread.join();
+
+    if (uv_loop_close(&_loop)) {
+        uv_run(&_loop, UV_RUN_DEFAULT); /* Run pending callbacks */
+        auto result = uv_loop_close(&_loop);
+        if (result) {
+            uv_walk(&_loop,
+                [](uv_handle_t *handle, void *) {
+                if (!uv_is_closing(handle)) {
+                    uv_close(handle, nullptr);
+                }
+            }, nullptr); /* Close all handles */
+            uv_run(&_loop, UV_RUN_DEFAULT); /* Run pending callbacks */
+            result = uv_loop_close(&_loop);
+        }
+        assert(result == 0);
+    }
+}
+
+void LoopThread::post(std::function<void()> task)
+{
+    {
+        std::lock_guard guard(_mutex);
+        _tasks.emplace_back(std::move(task));
+    }
+    uv_async_send(&_tasksReady);
+}
+
+void LoopThread::tasks_cb(uv_async_t *handle)
+{
+    reinterpret_cast<LoopThread *>(handle->data)->runTasks();
+}
+
+void LoopThread::runTasks()
+{
+    std::vector<std::function<void()>> tasks;
+    bool stopping;
+    {
+        std::lock_guard guard(_mutex);
+        tasks.swap(_tasks);
+        stopping = _stopping;
+    }
+    for(auto &task : tasks) {
+        task();
+    }
+    // Nobody is left to post anything, and every transport has closed its handles, so the loop runs out
+    if(stopping) {
+        uv_close(reinterpret_cast<uv_handle_t *>(&_tasksReady), nullptr);
+    }
+}
+
+EventLoop::EventLoop(size_t threadCount)
+{
+    threadCount = std::max<size_t>(threadCount, 1);
+    _threads.reserve(threadCount);
+    while(_threads.size() < threadCount) {
+        _threads.emplace_back(std::make_shared<LoopThread>());
+    }
+}
+
+std::shared_ptr<LoopThread> EventLoop::next()
+{
+    return _threads[_next.fetch_add(1, std::memory_order_relaxed) % _threads.size()];
+}
@@ -0,0 +1,62 @@
+// Copyright Twitch Interactive, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "DeleteConstructors.h"
+#include "IEventLoop.h"
+
+#include <uv.h>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Twitch::IPC {
+// A libuv loop and the thread that runs it. Transports start themselves on it with post and then
+// live on it until the last handle they opened has closed. The thread runs until the last owner lets
+// go of it.
+class LoopThread {
+public:
+    LoopThread();
+    ~LoopThread();
+    DELETE_COPY_AND_MOVE_CONSTRUCTORS(LoopThread);
+
+    [[nodiscard]] uv_loop_t *loop()
+    {
+        return &_loop;
+    }
+    // Runs `task` on the loop thread
+    void post(std::function<void()> task);
+
+private:
+    static void tasks_cb(uv_async_t *handle);
+    void runTasks();
+
+    uv_loop_t _loop{};
+    uv_async_t _tasksReady{};
+    std::mutex _mutex;
+    std::vector<std::function<void()>> _tasks;
+    bool _stopping{};
+    std::thread _thread;
+};
+
+class EventLoop final : public IEventLoop {
+public:
+    explicit EventLoop(size_t threadCount);
+    DELETE_COPY_AND_MOVE_CONSTRUCTORS(EventLoop);
+
+    [[nodiscard]] size_t threadCount() const override
+    {
+        return _threads.size();
+    }
+    // The thread for the next transport, round-robin
+    std::shared_ptr<LoopThread> next();
+
+private:
+    std::vector<std::shared_ptr<LoopThread>> _threads;
+    std::atomic<size_t> _next{0};
+};
+} // namespace Twitch::IPC
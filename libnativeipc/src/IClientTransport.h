@@ -20,7 +20,13 @@ public:
     DELETE_COPY_AND_MOVE_CONSTRUCTORS(IClientTransport);
 
     virtual ConnectResult connect(std::string endpoint) = 0;
+    // Returns without waiting for the loop thread to start connecting. If it can't, onError is called.
+    virtual void connectAsync(std::string endpoint) = 0;
     virtual void send(Handle connectionHandle, Handle promiseId, Payload message) = 0;
+    // Queues all of `messages` at once, each with the matching entry of `promiseIds` or 0 if it's empty
+    virtual void sendMany(Handle connectionHandle, const std::vector<Handle> &promiseIds, std::vector<Payload> messages) = 0;
+    // Call before connect
+    virtual void setReconnectPolicy(const ReconnectPolicy &policy) = 0;
 };
 
 template<typename T>
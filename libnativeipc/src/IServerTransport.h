@@ -13,9 +13,26 @@ public:
     DELETE_COPY_AND_MOVE_CONSTRUCTORS(IServerTransport);
 
     virtual bool listen(std::string endpoint) = 0;
+    // Returns without waiting for the loop thread to start listening. If it can't, onError is called.
+    virtual void listenAsync(std::string endpoint) = 0;
     virtual void send(Handle connectionHandle, Handle promiseId, Payload message) = 0;
+    // Queues all of `messages` at once, each with the matching entry of `promiseIds` or 0 if it's empty
+    virtual void sendMany(Handle connectionHandle, const std::vector<Handle> &promiseIds, std::vector<Payload> messages) = 0;
     virtual void broadcast(Payload message) = 0;
+    virtual void publish(std::string topic, Payload message) = 0;
     virtual int activeConnections() = 0;
+
+    // For transports that serve the clients of one listener between them, each on its own loop.
+    // Connections are numbered `first`, `first + step`, ... so that they never collide with the others'.
+    // Must be called before listen or serve.
+    virtual void setConnectionHandles(Handle first, Handle step) = 0;
+    // Hands each client it accepts to the next of `workers` in turn, which may include itself, instead
+    // of serving them all. Must be called before listen.
+    virtual void shareClients(std::vector<IServerTransport *> workers) = 0;
+    // Starts without listening, to serve only the clients handed to it through adoptClient
+    virtual bool serve() = 0;
+    // Takes over a connected socket that another transport accepted. Safe to call from any thread.
+    virtual void adoptClient(NativeHandle socket) = 0;
 };
 
 template<typename T>
@@ -5,9 +5,35 @@
 
 #include "DeleteConstructors.h"
 #include "IConnection.h"
+#include <atomic>
+#include <chrono>
 #include <functional>
+#include <memory>
 
 namespace Twitch::IPC {
+class LoopThread;
+constexpr size_t DefaultWriteBatchMaxBytes = 1024 * 1024;
+constexpr size_t DefaultWriteBatchMaxMessages = 64;
+// How much may be queued or in flight for one connection before it reports backpressure; 0 is unlimited
+constexpr size_t DefaultWriteQueueMaxBytes = 64 * 1024 * 1024;
+constexpr size_t DefaultWriteQueueMaxMessages = 0;
+// The largest frame body a connection reads from its peer before dropping it; 0 is unlimited
+constexpr size_t DefaultMaxFrameSize = 0;
+
+// What a transport counts for ConnectionStats. The connection owns these so they carry on across
+// the transports it goes through when connect is called again.
+struct TransportCounters {
+    std::atomic<uint64_t> messagesSent{0};
+    std::atomic<uint64_t> bytesSent{0};
+    std::atomic<uint64_t> messagesReceived{0};
+    std::atomic<uint64_t> bytesReceived{0};
+    std::atomic<uint64_t> writeQueueMessages{0};
+    std::atomic<uint64_t> writeQueueBytes{0};
+    std::atomic<uint64_t> writesInFlight{0};
+    std::atomic<uint64_t> reconnects{0};
+    std::atomic<uint64_t> latestValuesReplaced{0};
+};
+
 class ITransportBase {
 public:
     ITransportBase() = default;
@@ -15,19 +41,69 @@ public:
     DELETE_COPY_AND_MOVE_CONSTRUCTORS(ITransportBase);
 
     virtual void setLogLevel(LogLevel level) = 0;
+    virtual void setWriteBatchLimits(size_t maxBytes, size_t maxMessages) = 0;
+    virtual void setWriteQueueLimits(size_t maxBytes, size_t maxMessages) = 0;
+    // Compresses bodies of at least minBytes for peers that can read them. 0 turns it off.
+    virtual void setCompressionThreshold(size_t minBytes) = 0;
+    // Drops a peer that sends a frame with a body larger than maxBytes, before anything is allocated for it.
+    // 0 takes frames of any size.
+    virtual void setMaxFrameSize(size_t maxBytes) = 0;
+    // Whether a body of `size` bytes is within what the peer's hello says it reads. True until the
+    // hello arrives, as older peers have no limit.
+    virtual bool fitsPeer(Handle connectionHandle, size_t size) = 0;
+    // Must be called before connect or listen
+    virtual void setCounters(std::shared_ptr<TransportCounters> counters) = 0;
+    // Must be called before connect or listen. Without a loop thread, or with a null one, the
+    // transport runs one of its own.
+    virtual void setLoopThread(std::shared_ptr<LoopThread> loopThread) = 0;
+    // Queues the message unless the connection is over its write queue limits or the message is larger
+    // than the peer reads. The other sends drop a message that is too large with a warning.
+    virtual bool trySend(Handle connectionHandle, Handle promiseId, Payload message) = 0;
+    // Sends an invoke and reports it through onInvokeTimeout once `deadline` has passed. Whether it
+    // was answered in the meantime is up to the connection to check.
+    virtual void sendInvoke(Handle connectionHandle,
+        Handle promiseId,
+        Payload message,
+        std::chrono::steady_clock::time_point deadline) = 0;
+    // Queues the message in the write lane for `priority`. With a deadline, it times out like sendInvoke.
+    virtual void sendWithPriority(Handle connectionHandle,
+        Handle promiseId,
+        Payload message,
+        Priority priority,
+        std::chrono::steady_clock::time_point deadline) = 0;
+    // Returns false if the transport can't pass handles or the handle couldn't be duplicated
+    virtual bool sendShared(Handle connectionHandle, NativeHandle handle, size_t size) = 0;
+    // Queues one piece of stream `streamId`. Returns false if the peer's hello says it can't take them,
+    // or one this large.
+    virtual bool sendChunk(Handle connectionHandle, Handle streamId, Payload chunk, bool last) = 0;
+    // Queues the newest value of `channel`, which replaces a value of it that is still queued. Returns
+    // false if the peer's hello says it can't take them, or one this large.
+    virtual bool sendLatest(Handle connectionHandle, uint32_t channel, Payload value) = 0;
 
     using OnHandler = std::function<void(Handle connectionHandle)>;
     using OnDataHandler =
         std::function<void(Handle connectionHandle, Handle requestHandle, Payload data)>;
+    using OnSharedDataHandler = std::function<void(Handle connectionHandle, SharedPayload data)>;
+    using OnChunkHandler = std::function<void(Handle connectionHandle, Handle streamId, Payload chunk, bool last)>;
+    using OnLatestHandler = std::function<void(Handle connectionHandle, uint32_t channel, Payload value)>;
     using OnLogHandler =
         std::function<void(Handle connectionHandle, LogLevel level, std::string message)>;
     using OnNoInvokeClientHandler = std::function<void(Handle connectionHandle, Handle promiseId)>;
+    using OnInvokeTimeoutHandler = std::function<void(Handle connectionHandle, Handle promiseId)>;
 
     virtual void onConnect(OnHandler) = 0;
     virtual void onDisconnect(OnHandler) = 0;
     virtual void onData(OnDataHandler) = 0;
+    virtual void onSharedData(OnSharedDataHandler) = 0;
+    virtual void onChunk(OnChunkHandler) = 0;
+    virtual void onLatest(OnLatestHandler) = 0;
     virtual void onNoInvokeClientHandler(OnNoInvokeClientHandler) {}
     virtual void onError(OnHandler) {}
+    // Called on the loop thread
+    virtual void onInvokeTimeout(OnInvokeTimeoutHandler) = 0;
+    // Called once when a connection goes over its write queue limits, then once it has drained to half
+    virtual void onBackpressure(OnHandler) = 0;
+    virtual void onWritable(OnHandler) = 0;
     virtual void onLog(OnLogHandler, LogLevel) = 0;
 };
 } // namespace Twitch::IPC
@@ -0,0 +1,255 @@
+// Copyright Twitch Interactive, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: MIT
+
+#include "InProc-ClientTransport.h"
+#include "InProc-ServerTransport.h"
+#include "LogMacrosNoHandle.h"
+#include "Message.h"
+
+using namespace Twitch::IPC;
+
+ClientTransport<Transport::InProc>::~ClientTransport()
+{
+    ServerTransport<Transport::InProc>::leave(this);
+    stopDelivery();
+}
+
+ConnectResult ClientTransport<Transport::InProc>::connect(std::string endpoint)
+{
+    LOG_INFO("Connecting to " + endpoint + " in this process");
+    _endpoint = std::move(endpoint);
+    startDelivery();
+    return ServerTransport<Transport::InProc>::join(this) ? ConnectResult::Connected : ConnectResult::Connecting;
+}
+
+void ClientTransport<Transport::InProc>::connectAsync(std::string endpoint)
+{
+    // Joining never waits on anything but the lock on the endpoints
+    connect(std::move(endpoint));
+}
+
+void ClientTransport<Transport::InProc>::send(Handle, Handle promiseId, Payload message)
+{
+    auto frame = newFrame(InProcFrame::Kind::Message, 0, promiseId);
+    frame->payload = std::move(message);
+    sendFrame(std::move(frame), false);
+}
+
+void ClientTransport<Transport::InProc>::sendMany(
+    Handle connectionHandle, const std::vector<Handle> &promiseIds, std::vector<Payload> messages)
+{
+    for(size_t i = 0; i < messages.size(); ++i) {
+        send(connectionHandle, promiseIds.empty() ? 0 : promiseIds[i], std::move(messages[i]));
+    }
+}
+
+bool ClientTransport<Transport::InProc>::trySend(Handle, Handle promiseId, Payload message)
+{
+    auto frame = newFrame(InProcFrame::Kind::Message, 0, promiseId);
+    frame->payload = std::move(message);
+    return sendFrame(std::move(frame), true);
+}
+
+void ClientTransport<Transport::InProc>::sendInvoke(
+    Handle connectionHandle, Handle promiseId, Payload message, std::chrono::steady_clock::time_point deadline)
+{
+    trackInvokeTimeout(connectionHandle, promiseId, deadline);
+    send(connectionHandle, promiseId, std::move(message));
+}
+
+void ClientTransport<Transport::InProc>::sendWithPriority(Handle connectionHandle,
+    Handle promiseId,
+    Payload message,
+    Priority,
+    std::chrono::steady_clock::time_point deadline)
+{
+    // With nothing queued in front of it, there is nothing for an urgent message to overtake
+    if(deadline != std::chrono::steady_clock::time_point{}) {
+        trackInvokeTimeout(connectionHandle, promiseId, deadline);
+    }
+    send(connectionHandle, promiseId, std::move(message));
+}
+
+void ClientTransport<Transport::InProc>::setLogLevel(LogLevel level)
+{
+    _logLevel = level;
+}
+
+void ClientTransport<Transport::InProc>::setWriteBatchLimits(size_t, size_t)
+{
+    // Nothing is written, so there is nothing to batch
+}
+
+void ClientTransport<Transport::InProc>::setWriteQueueLimits(size_t maxBytes, size_t maxMessages)
+{
+    _writeQueueMaxBytes = maxBytes;
+    _writeQueueMaxMessages = maxMessages;
+}
+
+void ClientTransport<Transport::InProc>::setCompressionThreshold(size_t)
+{
+    // Payloads are handed over as they are
+}
+
+void ClientTransport<Transport::InProc>::setMaxFrameSize(size_t)
+{
+    // Nothing is read from a peer's header, so there is nothing to limit
+}
+
+bool ClientTransport<Transport::InProc>::fitsPeer(Handle, size_t)
+{
+    return true;
+}
+
+void ClientTransport<Transport::InProc>::setCounters(std::shared_ptr<TransportCounters> counters)
+{
+    _counters = std::move(counters);
+}
+
+void ClientTransport<Transport::InProc>::setLoopThread(std::shared_ptr<LoopThread>)
+{
+    // Each end delivers on a thread of its own
+}
+
+void ClientTransport<Transport::InProc>::setReconnectPolicy(const ReconnectPolicy &)
+{
+    // Clients are connected as soon as a server listens, so there is nothing to retry
+}
+
+bool ClientTransport<Transport::InProc>::sendShared(Handle, NativeHandle, size_t)
+{
+    return false;
+}
+
+bool ClientTransport<Transport::InProc>::sendChunk(Handle, Handle streamId, Payload chunk, bool last)
+{
+    auto frame = newFrame(InProcFrame::Kind::Chunk, 0, streamId);
+    frame->payload = std::move(chunk);
+    frame->last = last;
+    sendFrame(std::move(frame), false);
+    return true;
+}
+
+bool ClientTransport<Transport::InProc>::sendLatest(Handle, uint32_t channel, Payload value)
+{
+    auto frame = newFrame(InProcFrame::Kind::Latest, 0, channel);
+    frame->payload = std::move(value);
+    sendFrame(std::move(frame), false);
+    return true;
+}
+
+void ClientTransport<Transport::InProc>::onConnect(OnHandler handler)
+{
+    _connectHandler = std::move(handler);
+}
+
+void ClientTransport<Transport::InProc>::onDisconnect(OnHandler handler)
+{
+    _disconnectHandler = std::move(handler);
+}
+
+void ClientTransport<Transport::InProc>::onData(OnDataHandler handler)
+{
+    _dataHandler = std::move(handler);
+}
+
+void ClientTransport<Transport::InProc>::onSharedData(OnSharedDataHandler)
+{
+    // Handles are never passed
+}
+
+void ClientTransport<Transport::InProc>::onChunk(OnChunkHandler handler)
+{
+    _chunkHandler = std::move(handler);
+}
+
+void ClientTransport<Transport::InProc>::onLatest(OnLatestHandler handler)
+{
+    _latestHandler = std::move(handler);
+}
+
+void ClientTransport<Transport::InProc>::onError(OnHandler errorHandler)
+{
+    _errorHandler = std::move(errorHandler);
+}
+
+void ClientTransport<Transport::InProc>::onBackpressure(OnHandler handler)
+{
+    _backpressureHandler = std::move(handler);
+}
+
+void ClientTransport<Transport::InProc>::onWritable(OnHandler handler)
+{
+    _writableHandler = std::move(handler);
+}
+
+void ClientTransport<Transport::InProc>::onInvokeTimeout(OnInvokeTimeoutHandler handler)
+{
+    _invokeTimeoutHandler = std::move(handler);
+}
+
+void ClientTransport<Transport::InProc>::onLog(OnLogHandler logHandler, LogLevel level)
+{
+    _logHandler = std::move(logHandler);
+    _logLevel = level;
+}
+
+void ClientTransport<Transport::InProc>::handleFrame(InProcFrame &frame)
+{
+    switch(frame.kind) {
+    case InProcFrame::Kind::Connect:
+        LOG_DEBUG("Connected");
+        if(_connectHandler) {
+            _connectHandler(0);
+        }
+        break;
+    case InProcFrame::Kind::Disconnect:
+        LOG_DEBUG("Disconnected");
+        if(_disconnectHandler) {
+            _disconnectHandler(0);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+bool ClientTransport<Transport::InProc>::sendFrame(std::unique_ptr<InProcFrame> frame, bool mustFit)
+{
+    std::shared_ptr<InProcLink> link;
+    {
+        std::lock_guard lock(_linkMutex);
+        if(!_link) {
+            _held.push_back(std::move(frame));
+            return true;
+        }
+        link = _link;
+    }
+    return sendThrough(*link, std::move(frame), mustFit);
+}
+
+void ClientTransport<Transport::InProc>::attach(ServerTransport<Transport::InProc> *server, std::shared_ptr<InProcLink> link)
+{
+    std::lock_guard lock(_linkMutex);
+    _server = server;
+    // Sent before anything that is sent from now on
+    for(auto &frame : _held) {
+        sendThrough(*link, std::move(frame), false);
+    }
+    _held.clear();
+    _link = std::move(link);
+    if(_wasConnected) {
+        ++_counters->reconnects;
+    }
+    _wasConnected = true;
+}
+
+void ClientTransport<Transport::InProc>::detach()
+{
+    {
+        std::lock_guard lock(_linkMutex);
+        _server = nullptr;
+        _link.reset();
+    }
+    _mailbox->post(newFrame(InProcFrame::Kind::Disconnect, 0));
+}
@@ -0,0 +1,83 @@
+// Copyright Twitch Interactive, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "IClientTransport.h"
+#include "IServerTransport.h"
+#include "InProcTransportBase.h"
+#include "Transport.h"
+
+namespace Twitch::IPC {
+template<>
+class ServerTransport<Transport::InProc>;
+
+template<>
+class ClientTransport<Transport::InProc> final
+    : public IClientTransport
+    , public InProcTransportBase {
+public:
+    ClientTransport() = default;
+    ~ClientTransport();
+    DELETE_COPY_AND_MOVE_CONSTRUCTORS(ClientTransport);
+
+    ConnectResult connect(std::string endpoint) override;
+    void connectAsync(std::string endpoint) override;
+    void send(Handle connectionHandle, Handle promiseId, Payload message) override;
+    void sendMany(Handle connectionHandle, const std::vector<Handle> &promiseIds, std::vector<Payload> messages) override;
+    bool trySend(Handle connectionHandle, Handle promiseId, Payload message) override;
+    void sendInvoke(Handle connectionHandle,
+        Handle promiseId,
+        Payload message,
+        std::chrono::steady_clock::time_point deadline) override;
+    void sendWithPriority(Handle connectionHandle,
+        Handle promiseId,
+        Payload message,
+        Priority priority,
+        std::chrono::steady_clock::time_point deadline) override;
+    void setLogLevel(LogLevel level) override;
+    void setWriteBatchLimits(size_t maxBytes, size_t maxMessages) override;
+    void setWriteQueueLimits(size_t maxBytes, size_t maxMessages) override;
+    void setCompressionThreshold(size_t minBytes) override;
+    void setMaxFrameSize(size_t maxBytes) override;
+    bool fitsPeer(Handle connectionHandle, size_t size) override;
+    void setCounters(std::shared_ptr<TransportCounters> counters) override;
+    void setLoopThread(std::shared_ptr<LoopThread> loopThread) override;
+    void setReconnectPolicy(const ReconnectPolicy &policy) override;
+    bool sendShared(Handle connectionHandle, NativeHandle handle, size_t size) override;
+    bool sendChunk(Handle connectionHandle, Handle streamId, Payload chunk, bool last) override;
+    bool sendLatest(Handle connectionHandle, uint32_t channel, Payload value) override;
+
+    void onConnect(OnHandler handler) override;
+    void onDisconnect(OnHandler handler) override;
+    void onData(OnDataHandler handler) override;
+    void onSharedData(OnSharedDataHandler handler) override;
+    void onChunk(OnChunkHandler handler) override;
+    void onLatest(OnLatestHandler handler) override;
+    void onError(OnHandler errorHandler) override;
+    void onBackpressure(OnHandler handler) override;
+    void onWritable(OnHandler handler) override;
+    void onInvokeTimeout(OnInvokeTimeoutHandler handler) override;
+    void onLog(OnLogHandler logHandler, LogLevel level) override;
+
+protected:
+    friend class ServerTransport<Transport::InProc>;
+
+    void handleFrame(InProcFrame &frame) override;
+    // Sends to the server, or holds on to the frame until there is one
+    bool sendFrame(std::unique_ptr<InProcFrame> frame, bool mustFit);
+
+    // The server calls these with the endpoints locked
+    void attach(ServerTransport<Transport::InProc> *server, std::shared_ptr<InProcLink> link);
+    void detach();
+
+    // Guards the link and what is held back until there is one. Like the write queue of the other
+    // transports, what is sent while there is no server goes out once there is.
+    std::mutex _linkMutex;
+    std::shared_ptr<InProcLink> _link;
+    std::vector<std::unique_ptr<InProcFrame>> _held;
+    bool _wasConnected{};
+    // Endpoints locked
+    ServerTransport<Transport::InProc> *_server{};
+};
+} // namespace Twitch::IPC
@@ -0,0 +1,466 @@
+// Copyright Twitch Interactive, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: MIT
+
+#include "InProc-ServerTransport.h"
+#include "LogMacrosWithHandle.h"
+#include "Message.h"
+#include <algorithm>
+
+using namespace Twitch::IPC;
+
+std::mutex ServerTransport<Transport::InProc>::s_endpointsMutex;
+std::unordered_map<std::string, ServerTransport<Transport::InProc>::Endpoint> ServerTransport<Transport::InProc>::s_endpoints;
+
+ServerTransport<Transport::InProc>::ServerTransport(bool latestConnectionOnly, bool)
+    : _latestConnectionOnly(latestConnectionOnly)
+{
+}
+
+ServerTransport<Transport::InProc>::~ServerTransport()
+{
+    {
+        std::lock_guard lock(s_endpointsMutex);
+        if(_listening) {
+            // Clients wait for the next server to listen, as they would keep retrying on the other transports
+            auto &endpoint = s_endpoints[_endpoint];
+            endpoint.server = nullptr;
+            for(const auto &[handle, client] : _clients) {
+                client->detach();
+                endpoint.waiting.push_back(client);
+            }
+            _clients.clear();
+            if(endpoint.waiting.empty()) {
+                s_endpoints.erase(_endpoint);
+            }
+        }
+    }
+    stopDelivery();
+}
+
+bool ServerTransport<Transport::InProc>::listen(std::string endpoint)
+{
+    LOG_INFO(0, "Listening on " + endpoint + " in this process");
+    startDelivery();
+    std::lock_guard lock(s_endpointsMutex);
+    auto &listening = s_endpoints[endpoint];
+    if(listening.server) {
+        LOG_ERROR(0, "Another server is already listening on " + endpoint);
+        return false;
+    }
+    listening.server = this;
+    _endpoint = std::move(endpoint);
+    _listening = true;
+    for(auto *client : listening.waiting) {
+        link(client);
+    }
+    listening.waiting.clear();
+    return true;
+}
+
+void ServerTransport<Transport::InProc>::listenAsync(std::string endpoint)
+{
+    // Reported from the delivery thread, as the other transports report it from the loop thread
+    if(!listen(std::move(endpoint))) {
+        _mailbox->post(newFrame(InProcFrame::Kind::ListenFailed, 0));
+    }
+}
+
+void ServerTransport<Transport::InProc>::send(Handle connectionHandle, Handle promiseId, Payload message)
+{
+    auto frame = newFrame(InProcFrame::Kind::Message, connectionHandle, promiseId);
+    frame->payload = std::move(message);
+    sendFrame(connectionHandle, std::move(frame), false);
+}
+
+void ServerTransport<Transport::InProc>::sendMany(
+    Handle connectionHandle, const std::vector<Handle> &promiseIds, std::vector<Payload> messages)
+{
+    for(size_t i = 0; i < messages.size(); ++i) {
+        send(connectionHandle, promiseIds.empty() ? 0 : promiseIds[i], std::move(messages[i]));
+    }
+}
+
+bool ServerTransport<Transport::InProc>::trySend(Handle connectionHandle, Handle promiseId, Payload message)
+{
+    auto frame = newFrame(InProcFrame::Kind::Message, connectionHandle, promiseId);
+    frame->payload = std::move(message);
+    return sendFrame(connectionHandle, std::move(frame), true);
+}
+
+void ServerTransport<Transport::InProc>::sendInvoke(
+    Handle connectionHandle, Handle promiseId, Payload message, std::chrono::steady_clock::time_point deadline)
+{
+    trackInvokeTimeout(connectionHandle, promiseId, deadline);
+    send(connectionHandle, promiseId, std::move(message));
+}
+
+void ServerTransport<Transport::InProc>::sendWithPriority(Handle connectionHandle,
+    Handle promiseId,
+    Payload message,
+    Priority,
+    std::chrono::steady_clock::time_point deadline)
+{
+    // With nothing queued in front of it, there is nothing for an urgent message to overtake
+    if(deadline != std::chrono::steady_clock::time_point{}) {
+        trackInvokeTimeout(connectionHandle, promiseId, deadline);
+    }
+    send(connectionHandle, promiseId, std::move(message));
+}
+
+void ServerTransport<Transport::InProc>::broadcast(Payload message)
+{
+    std::vector<std::shared_ptr<InProcLink>> links;
+    {
+        std::lock_guard lock(_linksMutex);
+        for(const auto &i : _links) {
+            links.push_back(i.second);
+        }
+    }
+    for(size_t i = 0; i < links.size(); ++i) {
+        auto frame = newFrame(InProcFrame::Kind::Message, 0);
+        // The last one takes the original instead of a copy
+        frame->payload = i + 1 < links.size() ? message : std::move(message);
+        sendThrough(*links[i], std::move(frame), false);
+    }
+}
+
+void ServerTransport<Transport::InProc>::publish(std::string topic, Payload message)
+{
+    std::vector<std::shared_ptr<InProcLink>> links;
+    {
+        std::lock_guard lock(_linksMutex);
+        const auto subscribers = _subscribers.find(topic);
+        if(subscribers == _subscribers.end()) {
+            return;
+        }
+        for(const auto handle : subscribers->second) {
+            const auto link = _links.find(handle);
+            if(link != _links.end()) {
+                links.push_back(link->second);
+            }
+        }
+    }
+    for(size_t i = 0; i < links.size(); ++i) {
+        auto frame = newFrame(InProcFrame::Kind::Message, 0);
+        frame->payload = i + 1 < links.size() ? message : std::move(message);
+        sendThrough(*links[i], std::move(frame), false);
+    }
+}
+
+void ServerTransport<Transport::InProc>::setLogLevel(LogLevel level)
+{
+    _logLevel = level;
+}
+
+void ServerTransport<Transport::InProc>::setWriteBatchLimits(size_t, size_t)
+{
+    // Nothing is written, so there is nothing to batch
+}
+
+void ServerTransport<Transport::InProc>::setWriteQueueLimits(size_t maxBytes, size_t maxMessages)
+{
+    _writeQueueMaxBytes = maxBytes;
+    _writeQueueMaxMessages = maxMessages;
+}
+
+void ServerTransport<Transport::InProc>::setCompressionThreshold(size_t)
+{
+    // Payloads are handed over as they are
+}
+
+void ServerTransport<Transport::InProc>::setMaxFrameSize(size_t)
+{
+    // Nothing is read from a peer's header, so there is nothing to limit
+}
+
+bool ServerTransport<Transport::InProc>::fitsPeer(Handle, size_t)
+{
+    return true;
+}
+
+void ServerTransport<Transport::InProc>::setCounters(std::shared_ptr<TransportCounters> counters)
+{
+    _counters = std::move(counters);
+}
+
+void ServerTransport<Transport::InProc>::setLoopThread(std::shared_ptr<LoopThread>)
+{
+    // Each end delivers on a thread of its own
+}
+
+bool ServerTransport<Transport::InProc>::sendShared(Handle, NativeHandle, size_t)
+{
+    return false;
+}
+
+bool ServerTransport<Transport::InProc>::sendChunk(Handle connectionHandle, Handle streamId, Payload chunk, bool last)
+{
+    auto frame = newFrame(InProcFrame::Kind::Chunk, connectionHandle, streamId);
+    frame->payload = std::move(chunk);
+    frame->last = last;
+    sendFrame(connectionHandle, std::move(frame), false);
+    return true;
+}
+
+bool ServerTransport<Transport::InProc>::sendLatest(Handle connectionHandle, uint32_t channel, Payload value)
+{
+    auto frame = newFrame(InProcFrame::Kind::Latest, connectionHandle, channel);
+    frame->payload = std::move(value);
+    sendFrame(connectionHandle, std::move(frame), false);
+    return true;
+}
+
+int ServerTransport<Transport::InProc>::activeConnections()
+{
+    std::lock_guard lock(_linksMutex);
+    return static_cast<int>(_links.size());
+}
+
+void ServerTransport<Transport::InProc>::setConnectionHandles(Handle first, Handle step)
+{
+    _lastConnectionHandle = first - step;
+    _connectionHandleStep = step;
+}
+
+void ServerTransport<Transport::InProc>::shareClients(std::vector<IServerTransport *>)
+{
+    // Connecting costs the listener next to nothing, so it keeps every client
+}
+
+bool ServerTransport<Transport::InProc>::serve()
+{
+    startDelivery();
+    return true;
+}
+
+void ServerTransport<Transport::InProc>::adoptClient(NativeHandle)
+{
+    LOG_WARNING(0, "In-process servers have no sockets to adopt");
+}
+
+void ServerTransport<Transport::InProc>::onConnect(OnHandler handler)
+{
+    _connectHandler = std::move(handler);
+}
+
+void ServerTransport<Transport::InProc>::onDisconnect(OnHandler handler)
+{
+    _disconnectHandler = std::move(handler);
+}
+
+void ServerTransport<Transport::InProc>::onData(OnDataHandler handler)
+{
+    _dataHandler = std::move(handler);
+}
+
+void ServerTransport<Transport::InProc>::onSharedData(OnSharedDataHandler)
+{
+    // Handles are never passed
+}
+
+void ServerTransport<Transport::InProc>::onChunk(OnChunkHandler handler)
+{
+    _chunkHandler = std::move(handler);
+}
+
+void ServerTransport<Transport::InProc>::onLatest(OnLatestHandler handler)
+{
+    _latestHandler = std::move(handler);
+}
+
+void ServerTransport<Transport::InProc>::onBackpressure(OnHandler handler)
+{
+    _backpressureHandler = std::move(handler);
+}
+
+void ServerTransport<Transport::InProc>::onWritable(OnHandler handler)
+{
+    _writableHandler = std::move(handler);
+}
+
+void ServerTransport<Transport::InProc>::onError(OnHandler handler)
+{
+    _errorHandler = std::move(handler);
+}
+
+void ServerTransport<Transport::InProc>::onInvokeTimeout(OnInvokeTimeoutHandler handler)
+{
+    _invokeTimeoutHandler = std::move(handler);
+}
+
+void ServerTransport<Transport::InProc>::onNoInvokeClientHandler(OnNoInvokeClientHandler handler)
+{
+    _noInvokeClientHandler = std::move(handler);
+}
+
+void ServerTransport<Transport::InProc>::onLog(OnLogHandler handler, LogLevel level)
+{
+    _logHandler = std::move(handler);
+    _logLevel = level;
+}
+
+bool ServerTransport<Transport::InProc>::join(Client *client)
+{
+    std::lock_guard lock(s_endpointsMutex);
+    auto &endpoint = s_endpoints[client->_endpoint];
+    if(!endpoint.server) {
+        endpoint.waiting.push_back(client);
+        return false;
+    }
+    endpoint.server->link(client);
+    return true;
+}
+
+void ServerTransport<Transport::InProc>::leave(Client *client)
+{
+    std::lock_guard lock(s_endpointsMutex);
+    const auto endpoint = s_endpoints.find(client->_endpoint);
+    if(endpoint == s_endpoints.end()) {
+        return;
+    }
+    auto &waiting = endpoint->second.waiting;
+    waiting.erase(std::remove(waiting.begin(), waiting.end(), client), waiting.end());
+    if(auto *server = client->_server) {
+        for(const auto &[handle, connected] : server->_clients) {
+            if(connected == client) {
+                server->unlink(handle);
+                break;
+            }
+        }
+    }
+    if(!endpoint->second.server && waiting.empty()) {
+        s_endpoints.erase(endpoint);
+    }
+}
+
+void ServerTransport<Transport::InProc>::link(Client *client)
+{
+    const auto handle = getNextConnectionHandle();
+    if(_latestConnectionOnly) {
+        // Kicked clients wait for the next server rather than take the connection back
+        auto &waiting = s_endpoints[_endpoint].waiting;
+        while(!_clients.empty()) {
+            auto *kicked = _clients.begin()->second;
+            unlink(_clients.begin()->first);
+            kicked->detach();
+            waiting.push_back(kicked);
+        }
+    }
+    auto toClient = makeLink(client->_mailbox, 0, _mailbox, handle, _counters);
+    auto toServer = makeLink(_mailbox, handle, client->_mailbox, 0, client->_counters);
+    // Each end hears about the connection before anything sent over it
+    client->_mailbox->post(newFrame(InProcFrame::Kind::Connect, 0));
+    _mailbox->post(newFrame(InProcFrame::Kind::Connect, handle));
+    {
+        std::lock_guard lock(_linksMutex);
+        _links[handle] = std::move(toClient);
+    }
+    _clients[handle] = client;
+    client->attach(this, std::move(toServer));
+}
+
+void ServerTransport<Transport::InProc>::unlink(Handle connectionHandle)
+{
+    _clients.erase(connectionHandle);
+    {
+        std::lock_guard lock(_linksMutex);
+        _links.erase(connectionHandle);
+    }
+    // Behind whatever the client sent before it went
+    _mailbox->post(newFrame(InProcFrame::Kind::Disconnect, connectionHandle));
+}
+
+void ServerTransport<Transport::InProc>::handleFrame(InProcFrame &frame)
+{
+    const auto handle = frame.connectionHandle;
+    switch(frame.kind) {
+    case InProcFrame::Kind::Connect:
+        LOG_DEBUG(handle, "Client connected");
+        if(_connectHandler) {
+            _connectHandler(handle);
+        }
+        break;
+    case InProcFrame::Kind::Disconnect:
+        LOG_DEBUG(handle, "Client disconnected");
+        removeSubscriptions(handle);
+        if(_disconnectHandler) {
+            _disconnectHandler(handle);
+        }
+        break;
+    case InProcFrame::Kind::NoClient:
+        if(_noInvokeClientHandler) {
+            _noInvokeClientHandler(handle, frame.promiseId);
+        }
+        break;
+    case InProcFrame::Kind::ListenFailed:
+        if(_errorHandler) {
+            _errorHandler(0);
+        }
+        break;
+    case InProcFrame::Kind::Message: {
+        if(frame.promiseId != ControlHandle::Subscribe && frame.promiseId != ControlHandle::Unsubscribe) {
+            break;
+        }
+        std::string topic(frame.payload.begin(), frame.payload.end());
+        std::lock_guard lock(_linksMutex);
+        if(frame.promiseId == ControlHandle::Subscribe) {
+            LOG_DEBUG(handle, "Subscribed to " + topic);
+            _subscribers[topic].insert(handle);
+            _topicsByClient[handle].insert(std::move(topic));
+            break;
+        }
+        const auto subscribers = _subscribers.find(topic);
+        if(subscribers == _subscribers.end() || !subscribers->second.erase(handle)) {
+            break;
+        }
+        LOG_DEBUG(handle, "Unsubscribed from " + topic);
+        if(subscribers->second.empty()) {
+            _subscribers.erase(subscribers);
+        }
+        _topicsByClient[handle].erase(topic);
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+bool ServerTransport<Transport::InProc>::sendFrame(Handle connectionHandle, std::unique_ptr<InProcFrame> frame, bool mustFit)
+{
+    std::shared_ptr<InProcLink> link;
+    {
+        std::lock_guard lock(_linksMutex);
+        const auto i = _links.find(connectionHandle);
+        if(i != _links.end()) {
+            link = i->second;
+        }
+    }
+    if(!link) {
+        const auto promiseId = frame->promiseId;
+        if(promiseId && promiseId < ControlHandleBase) {
+            // Failed from the delivery thread, like an answer would have been
+            _mailbox->post(newFrame(InProcFrame::Kind::NoClient, connectionHandle, promiseId));
+        }
+        return false;
+    }
+    return sendThrough(*link, std::move(frame), mustFit);
+}
+
+void ServerTransport<Transport::InProc>::removeSubscriptions(Handle connectionHandle)
+{
+    std::lock_guard lock(_linksMutex);
+    const auto topics = _topicsByClient.find(connectionHandle);
+    if(topics == _topicsByClient.end()) {
+        return;
+    }
+    for(const auto &topic : topics->second) {
+        const auto subscribers = _subscribers.find(topic);
+        if(subscribers != _subscribers.end()) {
+            subscribers->second.erase(connectionHandle);
+            if(subscribers->second.empty()) {
+                _subscribers.erase(subscribers);
+            }
+        }
+    }
+    _topicsByClient.erase(topics);
+}
@@ -0,0 +1,106 @@
+// Copyright Twitch Interactive, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "IServerTransport.h"
+#include "InProc-ClientTransport.h"
+#include "InProcTransportBase.h"
+#include "Transport.h"
+
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace Twitch::IPC {
+template<>
+class ServerTransport<Transport::InProc> final
+    : public IServerTransport
+    , public InProcTransportBase {
+public:
+    ServerTransport(bool latestConnectionOnly, bool allowMultiuserAccess);
+    ~ServerTransport();
+    DELETE_COPY_AND_MOVE_CONSTRUCTORS(ServerTransport);
+
+    bool listen(std::string endpoint) override;
+    void listenAsync(std::string endpoint) override;
+    void send(Handle connectionHandle, Handle promiseId, Payload message) override;
+    void sendMany(Handle connectionHandle, const std::vector<Handle> &promiseIds, std::vector<Payload> messages) override;
+    bool trySend(Handle connectionHandle, Handle promiseId, Payload message) override;
+    void sendInvoke(Handle connectionHandle,
+        Handle promiseId,
+        Payload message,
+        std::chrono::steady_clock::time_point deadline) override;
+    void sendWithPriority(Handle connectionHandle,
+        Handle promiseId,
+        Payload message,
+        Priority priority,
+        std::chrono::steady_clock::time_point deadline) override;
+    void broadcast(Payload message) override;
+    void publish(std::string topic, Payload message) override;
+    void setLogLevel(LogLevel level) override;
+    void setWriteBatchLimits(size_t maxBytes, size_t maxMessages) override;
+    void setWriteQueueLimits(size_t maxBytes, size_t maxMessages) override;
+    void setCompressionThreshold(size_t minBytes) override;
+    void setMaxFrameSize(size_t maxBytes) override;
+    bool fitsPeer(Handle connectionHandle, size_t size) override;
+    void setCounters(std::shared_ptr<TransportCounters> counters) override;
+    void setLoopThread(std::shared_ptr<LoopThread> loopThread) override;
+    bool sendShared(Handle connectionHandle, NativeHandle handle, size_t size) override;
+    bool sendChunk(Handle connectionHandle, Handle streamId, Payload chunk, bool last) override;
+    bool sendLatest(Handle connectionHandle, uint32_t channel, Payload value) override;
+    int activeConnections() override;
+    void setConnectionHandles(Handle first, Handle step) override;
+    void shareClients(std::vector<IServerTransport *> workers) override;
+    bool serve() override;
+    void adoptClient(NativeHandle socket) override;
+
+    void onConnect(OnHandler handler) override;
+    void onDisconnect(OnHandler handler) override;
+    void onData(OnDataHandler handler) override;
+    void onSharedData(OnSharedDataHandler handler) override;
+    void onChunk(OnChunkHandler handler) override;
+    void onLatest(OnLatestHandler handler) override;
+    void onBackpressure(OnHandler handler) override;
+    void onWritable(OnHandler handler) override;
+    void onError(OnHandler handler) override;
+    void onInvokeTimeout(OnInvokeTimeoutHandler handler) override;
+    void onNoInvokeClientHandler(OnNoInvokeClientHandler) override;
+    void onLog(OnLogHandler handler, LogLevel level) override;
+
+protected:
+    using Client = ClientTransport<Transport::InProc>;
+    friend Client;
+
+    // Who is at, or waiting for, each endpoint in the process. Clients and servers only reach each
+    // other with it locked, and leave it before they go.
+    struct Endpoint {
+        ServerTransport *server{};
+        std::vector<Client *> waiting;
+    };
+    static std::mutex s_endpointsMutex;
+    static std::unordered_map<std::string, Endpoint> s_endpoints;
+
+    // Starts waiting for a server at the client's endpoint, or connects it if there is one
+    static bool join(Client *client);
+    static void leave(Client *client);
+
+    void handleFrame(InProcFrame &frame) override;
+    bool sendFrame(Handle connectionHandle, std::unique_ptr<InProcFrame> frame, bool mustFit);
+    void removeSubscriptions(Handle connectionHandle);
+    // Endpoints locked
+    void link(Client *client);
+    void unlink(Handle connectionHandle);
+
+    bool _latestConnectionOnly;
+    bool _listening{};
+    // Endpoints locked
+    std::unordered_map<Handle, Client *> _clients;
+    // Guards the links and subscriptions. Any thread sends through the links, but only the delivery
+    // thread changes the subscriptions.
+    std::mutex _linksMutex;
+    std::unordered_map<Handle, std::shared_ptr<InProcLink>> _links;
+    std::unordered_map<std::string, std::unordered_set<Handle>> _subscribers;
+    std::unordered_map<Handle, std::unordered_set<std::string>> _topicsByClient;
+};
+} // namespace Twitch::IPC
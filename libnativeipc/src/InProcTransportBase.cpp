@@ -0,0 +1,302 @@
+// Copyright Twitch Interactive, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: MIT
+
+#include "InProcTransportBase.h"
+#include "Message.h"
+
+using namespace Twitch::IPC;
+
+namespace {
+// How long the delivery thread keeps looking for more frames before it parks, so that a busy
+// exchange like a run of invokes doesn't pay for a wakeup per message
+constexpr auto SpinBeforeParking = std::chrono::microseconds(50);
+} // namespace
+
+void InProcMailbox::post(std::unique_ptr<InProcFrame> frame)
+{
+    if(_frames.push(std::move(frame))) {
+        notify();
+    }
+}
+
+void InProcMailbox::postList(InProcFrame *newest, InProcFrame *oldest)
+{
+    if(_frames.pushList(newest, oldest)) {
+        notify();
+    }
+}
+
+void InProcMailbox::wake()
+{
+    std::lock_guard lock(_mutex);
+    _woken = true;
+    _wake.notify_one();
+}
+
+void InProcMailbox::notify()
+{
+    // Taking the lock orders this against a receiver that has just found the queue empty and is
+    // about to wait
+    std::lock_guard lock(_mutex);
+    _wake.notify_one();
+}
+
+InProcFrame *InProcMailbox::take(bool tick)
+{
+    const auto spinUntil = std::chrono::steady_clock::now() + SpinBeforeParking;
+    while(_frames.empty() && !_stopping && std::chrono::steady_clock::now() < spinUntil) {
+        std::this_thread::yield();
+    }
+    std::unique_lock lock(_mutex);
+    const auto ready = [this] { return !_frames.empty() || _woken || _stopping; };
+    if(tick) {
+        _wake.wait_for(lock, TimerWheel<int>::Resolution, ready);
+    } else {
+        _wake.wait(lock, ready);
+    }
+    _woken = false;
+    lock.unlock();
+    return _frames.popAll();
+}
+
+void InProcMailbox::stop()
+{
+    std::lock_guard lock(_mutex);
+    _stopping = true;
+    _wake.notify_one();
+}
+
+std::shared_ptr<InProcLink> InProcTransportBase::makeLink(std::shared_ptr<InProcMailbox> to,
+    Handle toHandle,
+    const std::shared_ptr<InProcMailbox> &from,
+    Handle fromHandle,
+    std::shared_ptr<TransportCounters> counters)
+{
+    auto link = std::make_shared<InProcLink>();
+    link->to = std::move(to);
+    link->toHandle = toHandle;
+    link->budget = std::make_shared<InProcBudget>();
+    link->budget->counters = std::move(counters);
+    link->budget->sender = from;
+    link->budget->senderHandle = fromHandle;
+    return link;
+}
+
+std::unique_ptr<InProcFrame> InProcTransportBase::newFrame(InProcFrame::Kind kind, Handle connectionHandle, Handle promiseId)
+{
+    auto frame = std::make_unique<InProcFrame>();
+    frame->kind = kind;
+    frame->connectionHandle = connectionHandle;
+    frame->promiseId = promiseId;
+    return frame;
+}
+
+void InProcTransportBase::startDelivery()
+{
+    if(!_deliveryThread.joinable()) {
+        _deliveryThread = std::thread([this] { runDelivery(); });
+    }
+}
+
+void InProcTransportBase::stopDelivery()
+{
+    _mailbox->stop();
+    if(_deliveryThread.joinable()) {
+        _deliveryThread.join();
+    }
+    _mailbox->clear();
+}
+
+void InProcTransportBase::runDelivery()
+{
+    while(!_mailbox->stopping()) {
+        bool tick;
+        {
+            std::lock_guard lock(_timeoutsMutex);
+            tick = !_invokeTimeouts.empty();
+        }
+        auto *frame = _mailbox->take(tick);
+        while(frame && !_mailbox->stopping()) {
+            auto *next = frame->next;
+            frame->next = nullptr;
+            deliver(std::unique_ptr<InProcFrame>(frame));
+            frame = next;
+        }
+        // Whatever is left once stopping is dropped with the mailbox
+        while(frame) {
+            auto *next = frame->next;
+            delete frame;
+            frame = next;
+        }
+        if(tick) {
+            expireInvokes();
+        }
+    }
+}
+
+void InProcTransportBase::deliver(std::unique_ptr<InProcFrame> frame)
+{
+    switch(frame->kind) {
+    case InProcFrame::Kind::Message:
+        if(frame->promiseId >= ControlHandleBase) {
+            handleFrame(*frame);
+            break;
+        }
+        ++_counters->messagesReceived;
+        _counters->bytesReceived += frame->payload.size();
+        if(_dataHandler) {
+            _dataHandler(frame->connectionHandle, frame->promiseId, std::move(frame->payload));
+        }
+        break;
+    case InProcFrame::Kind::Chunk:
+        ++_counters->messagesReceived;
+        _counters->bytesReceived += frame->payload.size();
+        if(_chunkHandler) {
+            _chunkHandler(frame->connectionHandle, frame->promiseId, std::move(frame->payload), frame->last);
+        }
+        break;
+    case InProcFrame::Kind::Latest:
+        ++_counters->messagesReceived;
+        _counters->bytesReceived += frame->payload.size();
+        if(_latestHandler) {
+            _latestHandler(frame->connectionHandle, static_cast<uint32_t>(frame->promiseId), std::move(frame->payload));
+        }
+        break;
+    case InProcFrame::Kind::Blocked: {
+        auto &budget = *frame->budget;
+        budget.blocked = true;
+        if(_backpressureHandler) {
+            _backpressureHandler(budget.senderHandle);
+        }
+        budget.backpressurePosted = false;
+        // The receiver may have caught up before it could see the budget blocked
+        reportWritableIfDrained(budget);
+        return;
+    }
+    case InProcFrame::Kind::Drained:
+        // Cleared before looking, so a credit that lands after the look asks again
+        frame->budget->drainPosted = false;
+        reportWritableIfDrained(*frame->budget);
+        return;
+    default:
+        handleFrame(*frame);
+        return;
+    }
+
+    // Delivered, so no longer queued for the sender
+    auto &budget = *frame->budget;
+    budget.bytes -= frame->charged;
+    --budget.messages;
+    budget.counters->writeQueueBytes -= frame->charged;
+    --budget.counters->writeQueueMessages;
+    if(budget.blocked && !budget.drainPosted.exchange(true)) {
+        if(auto sender = budget.sender.lock()) {
+            auto drained = newFrame(InProcFrame::Kind::Drained, budget.senderHandle);
+            drained->budget = std::move(frame->budget);
+            sender->post(std::move(drained));
+        }
+    }
+}
+
+bool InProcTransportBase::sendThrough(InProcLink &link, std::unique_ptr<InProcFrame> frame, bool mustFit)
+{
+    auto &budget = *link.budget;
+    // Nothing is serialized, but charging the frame header keeps the limits comparable with the
+    // other transports
+    const auto size = sizeof(MessageHeader) + frame->payload.size();
+    if(mustFit && budget.messages && overWriteLimits(budget, size, 1)) {
+        postBlocked(link.budget);
+        return false;
+    }
+    if(frame->promiseId < ControlHandleBase || frame->kind != InProcFrame::Kind::Message) {
+        ++_counters->messagesSent;
+        _counters->bytesSent += frame->payload.size();
+    }
+    budget.bytes += size;
+    ++budget.messages;
+    budget.counters->writeQueueBytes += size;
+    ++budget.counters->writeQueueMessages;
+    if(overWriteLimits(budget, 0, 0)) {
+        postBlocked(link.budget);
+    }
+    frame->connectionHandle = link.toHandle;
+    frame->budget = link.budget;
+    frame->charged = size;
+    link.to->post(std::move(frame));
+    return true;
+}
+
+void InProcTransportBase::postBlocked(const std::shared_ptr<InProcBudget> &budget)
+{
+    if(budget->blocked || budget->backpressurePosted.exchange(true)) {
+        return;
+    }
+    auto blocked = newFrame(InProcFrame::Kind::Blocked, budget->senderHandle);
+    blocked->budget = budget;
+    _mailbox->post(std::move(blocked));
+}
+
+void InProcTransportBase::trackInvokeTimeout(
+    Handle connectionHandle, Handle promiseId, std::chrono::steady_clock::time_point deadline)
+{
+    bool first;
+    {
+        std::lock_guard lock(_timeoutsMutex);
+        first = _invokeTimeouts.empty();
+        _invokeTimeouts.add({connectionHandle, promiseId}, deadline);
+    }
+    // The delivery thread only ticks while there are timeouts to look at
+    if(first) {
+        _mailbox->wake();
+    }
+}
+
+void InProcTransportBase::expireInvokes()
+{
+    {
+        std::lock_guard lock(_timeoutsMutex);
+        _invokeTimeouts.advance(std::chrono::steady_clock::now(), [this](const std::pair<Handle, Handle> &key) {
+            _expired.push_back(key);
+        });
+    }
+    for(const auto &[connectionHandle, promiseId] : _expired) {
+        if(_invokeTimeoutHandler) {
+            _invokeTimeoutHandler(connectionHandle, promiseId);
+        }
+    }
+    _expired.clear();
+}
+
+bool InProcTransportBase::overWriteLimits(const InProcBudget &budget, size_t extraBytes, size_t extraMessages) const
+{
+    const size_t maxBytes = _writeQueueMaxBytes;
+    const size_t maxMessages = _writeQueueMaxMessages;
+    return (maxBytes && budget.bytes + extraBytes > maxBytes) ||
+           (maxMessages && budget.messages + extraMessages > maxMessages);
+}
+
+void InProcTransportBase::reportWritableIfDrained(InProcBudget &budget)
+{
+    // Writable again once at half the limits, like the other transports
+    const size_t maxBytes = _writeQueueMaxBytes;
+    const size_t maxMessages = _writeQueueMaxMessages;
+    if(budget.blocked && (!maxBytes || budget.bytes <= maxBytes / 2) &&
+        (!maxMessages || budget.messages <= maxMessages / 2) && budget.blocked.exchange(false)) {
+        if(_writableHandler) {
+            _writableHandler(budget.senderHandle);
+        }
+    }
+}
+
+void InProcTransportBase::handleLog(Handle handle, LogLevel level, std::string message)
+{
+    if(level >= _logLevel.load(std::memory_order_relaxed) && _logHandler) {
+        _logHandler(handle, level, message);
+    }
+}
+
+Handle InProcTransportBase::getNextConnectionHandle()
+{
+    auto h = _lastConnectionHandle += _connectionHandleStep;
+    return h ? h : _lastConnectionHandle += _connectionHandleStep;
+}
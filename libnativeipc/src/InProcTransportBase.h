@@ -0,0 +1,173 @@
+// Copyright Twitch Interactive, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "ITransportBase.h"
+#include "IntrusiveMPSCQueue.h"
+#include "TimerWheel.h"
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Twitch::IPC {
+class InProcMailbox;
+
+// What one direction of an in-process connection has handed to the receiver and it hasn't delivered
+// yet. The sender charges it and the receiver credits it back, like a WriteBudget.
+struct InProcBudget {
+    std::atomic<size_t> bytes{0};
+    std::atomic<size_t> messages{0};
+    // Only changed by the sender's delivery thread, so backpressure and writable reports can't cross
+    std::atomic<bool> blocked{false};
+    // Set while the sender has been asked to report backpressure, so it is asked once
+    std::atomic<bool> backpressurePosted{false};
+    // Set while the sender has been asked to check whether it is writable again, so it is asked once
+    std::atomic<bool> drainPosted{false};
+    std::shared_ptr<TransportCounters> counters;
+    // Weak so that frames, which hold their budget, never keep a mailbox alive
+    std::weak_ptr<InProcMailbox> sender;
+    Handle senderHandle{};
+};
+
+// A message, or a change to a connection, on its way to one end
+struct InProcFrame {
+    enum class Kind {
+        Connect,
+        Disconnect,
+        Message,
+        Chunk,
+        // Handed over as soon as it is sent, so there is no queued value for it to replace. The receiving
+        // connection still only handles the newest.
+        Latest,
+        // To the sender itself: a budget went over the limits. Reported from its delivery thread rather
+        // than the sending one, which may be inside a handler that goes on to disconnect.
+        Blocked,
+        // To the sender: the receiver has credited a blocked budget
+        Drained,
+        // To a server itself: an invoke went to a client that is gone
+        NoClient,
+        // To a server itself: listenAsync found the endpoint taken
+        ListenFailed,
+    };
+
+    Kind kind{};
+    // The receiver's handle for the connection
+    Handle connectionHandle{};
+    // The stream id for chunks, or the channel for latest values
+    Handle promiseId{};
+    bool last{};
+    Payload payload;
+    // What the frame was charged to, and how much, for messages, chunks and latest values
+    std::shared_ptr<InProcBudget> budget;
+    size_t charged{};
+    InProcFrame *next{};
+};
+
+// Where the frames for one end go. Senders push without locking and only wake the receiver when it
+// had nothing waiting.
+class InProcMailbox {
+public:
+    InProcMailbox() = default;
+    DELETE_COPY_AND_MOVE_CONSTRUCTORS(InProcMailbox);
+
+    void post(std::unique_ptr<InProcFrame> frame);
+    // Posts a run linked newest first, as IntrusiveMPSCQueue::pushList takes it
+    void postList(InProcFrame *newest, InProcFrame *oldest);
+    // Wakes the receiver without a frame, e.g. to look at its timers
+    void wake();
+    // Waits for frames, at most one timer tick if `tick`, and returns them oldest first
+    InProcFrame *take(bool tick);
+    void stop();
+    [[nodiscard]] bool stopping() const
+    {
+        return _stopping;
+    }
+    // Drops whatever wasn't delivered
+    void clear()
+    {
+        _frames.clear();
+    }
+
+private:
+    void notify();
+
+    IntrusiveMPSCQueue<InProcFrame> _frames;
+    std::mutex _mutex;
+    std::condition_variable _wake;
+    bool _woken{};
+    std::atomic<bool> _stopping{false};
+};
+
+// One direction of a connection: whose mailbox its frames go to, and what is charged for them
+struct InProcLink {
+    std::shared_ptr<InProcMailbox> to;
+    Handle toHandle{};
+    std::shared_ptr<InProcBudget> budget;
+};
+
+// What the in-process client and server have in common: a thread that delivers what arrives in the
+// mailbox to the handlers, and sending straight into the peer's mailbox from whichever thread sends
+class InProcTransportBase {
+public:
+    InProcTransportBase() = default;
+    virtual ~InProcTransportBase() = default;
+    DELETE_COPY_AND_MOVE_CONSTRUCTORS(InProcTransportBase);
+
+protected:
+    static std::shared_ptr<InProcLink> makeLink(std::shared_ptr<InProcMailbox> to,
+        Handle toHandle,
+        const std::shared_ptr<InProcMailbox> &from,
+        Handle fromHandle,
+        std::shared_ptr<TransportCounters> counters);
+    static std::unique_ptr<InProcFrame> newFrame(InProcFrame::Kind kind, Handle connectionHandle, Handle promiseId = 0);
+
+    void startDelivery();
+    // Joins the delivery thread, after which no handler runs again
+    void stopDelivery();
+    // Returns false, without sending, if `mustFit` and the link is over the write queue limits
+    bool sendThrough(InProcLink &link, std::unique_ptr<InProcFrame> frame, bool mustFit);
+    void trackInvokeTimeout(Handle connectionHandle, Handle promiseId, std::chrono::steady_clock::time_point deadline);
+    [[nodiscard]] bool overWriteLimits(const InProcBudget &budget, size_t extraBytes, size_t extraMessages) const;
+    void postBlocked(const std::shared_ptr<InProcBudget> &budget);
+    void reportWritableIfDrained(InProcBudget &budget);
+    void handleLog(Handle handle, LogLevel level, std::string message);
+    Handle getNextConnectionHandle();
+
+    // Called on the delivery thread for Connect, Disconnect, NoClient and ListenFailed frames, and
+    // for messages with a control handle
+    virtual void handleFrame(InProcFrame &frame) = 0;
+
+    ITransportBase::OnHandler _connectHandler;
+    ITransportBase::OnHandler _disconnectHandler;
+    ITransportBase::OnDataHandler _dataHandler;
+    ITransportBase::OnChunkHandler _chunkHandler;
+    ITransportBase::OnLatestHandler _latestHandler;
+    ITransportBase::OnNoInvokeClientHandler _noInvokeClientHandler;
+    ITransportBase::OnInvokeTimeoutHandler _invokeTimeoutHandler;
+    ITransportBase::OnHandler _errorHandler;
+    ITransportBase::OnHandler _backpressureHandler;
+    ITransportBase::OnHandler _writableHandler;
+    ITransportBase::OnLogHandler _logHandler;
+
+    std::shared_ptr<InProcMailbox> _mailbox{std::make_shared<InProcMailbox>()};
+    std::string _endpoint;
+    std::atomic<LogLevel> _logLevel{LogLevel::Warning};
+    std::atomic<size_t> _writeQueueMaxBytes{DefaultWriteQueueMaxBytes};
+    std::atomic<size_t> _writeQueueMaxMessages{DefaultWriteQueueMaxMessages};
+    std::shared_ptr<TransportCounters> _counters{std::make_shared<TransportCounters>()};
+    std::atomic<Handle> _lastConnectionHandle{0};
+    Handle _connectionHandleStep{1};
+
+private:
+    void runDelivery();
+    void deliver(std::unique_ptr<InProcFrame> frame);
+    void expireInvokes();
+
+    std::thread _deliveryThread;
+    std::mutex _timeoutsMutex;
+    TimerWheel<std::pair<Handle, Handle>> _invokeTimeouts;
+    std::vector<std::pair<Handle, Handle>> _expired;
+};
+} // namespace Twitch::IPC
@@ -0,0 +1,74 @@
+// Copyright Twitch Interactive, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "DeleteConstructors.h"
+#include <atomic>
+#include <memory>
+
+namespace Twitch::IPC {
+// Lock-free multi-producer/single-consumer queue of heap nodes linked through their own `T *next`.
+// Producers push with a single compare-and-swap; the consumer detaches the whole list in one exchange.
+template<typename T>
+class IntrusiveMPSCQueue {
+public:
+    IntrusiveMPSCQueue() = default;
+    ~IntrusiveMPSCQueue()
+    {
+        clear();
+    }
+    DELETE_COPY_AND_MOVE_CONSTRUCTORS(IntrusiveMPSCQueue);
+
+    // Returns true if the queue was empty beforehand, which is when the consumer needs waking up
+    bool push(std::unique_ptr<T> node)
+    {
+        auto *raw = node.release();
+        return pushList(raw, raw);
+    }
+
+    // Pushes a run of nodes in one step. The run must be linked newest first: newest->next...->oldest.
+    bool pushList(T *newest, T *oldest)
+    {
+        auto *head = _head.load(std::memory_order_relaxed);
+        do {
+            oldest->next = head;
+        } while(!_head.compare_exchange_weak(
+            head, newest, std::memory_order_release, std::memory_order_relaxed));
+        return head == nullptr;
+    }
+
+    // Detaches everything queued so far and returns it oldest first, still linked through `next`.
+    // Only the consumer may call this.
+    T *popAll()
+    {
+        auto *head = _head.exchange(nullptr, std::memory_order_acquire);
+        T *oldest = nullptr;
+        while(head) {
+            auto *next = head->next;
+            head->next = oldest;
+            oldest = head;
+            head = next;
+        }
+        return oldest;
+    }
+
+    [[nodiscard]] bool empty() const
+    {
+        return _head.load(std::memory_order_acquire) == nullptr;
+    }
+
+    void clear()
+    {
+        auto *node = popAll();
+        while(node) {
+            auto *next = node->next;
+            delete node;
+            node = next;
+        }
+    }
+
+private:
+    std::atomic<T *> _head{nullptr};
+};
+} // namespace Twitch::IPC
@@ -0,0 +1,40 @@
+// Copyright Twitch Interactive, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "IConnection.h"
+#include <atomic>
+#include <chrono>
+
+namespace Twitch::IPC {
+// Fills a LatencyHistogram from any number of threads at the cost of a few relaxed atomic adds
+class LatencyRecorder {
+public:
+    void record(std::chrono::steady_clock::duration elapsed)
+    {
+        const auto count = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+        const auto microseconds = count > 0 ? static_cast<uint64_t>(count) : 0;
+        _counts[LatencyHistogram::bucketFor(microseconds)].fetch_add(1, std::memory_order_relaxed);
+        _count.fetch_add(1, std::memory_order_relaxed);
+        auto max = _max.load(std::memory_order_relaxed);
+        while(microseconds > max && !_max.compare_exchange_weak(max, microseconds, std::memory_order_relaxed)) {
+        }
+    }
+
+    // Samples recorded while this runs may be missing from some of the fields
+    void snapshot(LatencyHistogram &histogram) const
+    {
+        for(size_t i = 0; i < LatencyHistogram::BucketCount; ++i) {
+            histogram.counts[i] = _counts[i].load(std::memory_order_relaxed);
+        }
+        histogram.count = _count.load(std::memory_order_relaxed);
+        histogram.maxMicroseconds = _max.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<uint64_t> _counts[LatencyHistogram::BucketCount]{};
+    std::atomic<uint64_t> _count{0};
+    std::atomic<uint64_t> _max{0};
+};
+} // namespace Twitch::IPC
@@ -3,9 +3,12 @@
 
 #pragma once
 
+// The level is checked with a single atomic load before anything is formatted, so disabled messages
+// cost nothing beyond that
+
 #define LOG(level, message)                                                                        \
     do {                                                                                           \
-        if(_logHandler && (level) >= _logLevel)                                                    \
+        if((level) >= _logLevel.load(std::memory_order_relaxed) && _logHandler)                    \
             handleLog(0, level, message);                                                          \
     } while(false)
 #define LOG_DEBUG(message) LOG(LogLevel::Debug, message)
@@ -15,7 +18,7 @@
 
 #define LOG_WITH_ERROR_CODE(level, message, error_code)                                            \
     do {                                                                                           \
-        if(_logHandler && (level) >= _logLevel)                                                    \
+        if((level) >= _logLevel.load(std::memory_order_relaxed) && _logHandler)                    \
             handleLog(0, level, message + std::string(" - ") +                                     \
                                 std::string(uv_err_name(error_code)) + ": " +                      \
                                 uv_strerror(error_code));                                          \
@@ -3,9 +3,11 @@
 
 #pragma once
 
+// As in LogMacrosNoHandle.h, with the connection handle to log for
+
 #define LOG(handle, level, message)                                                                \
     do {                                                                                           \
-        if(_logHandler && (level) >= _logLevel)                                                    \
+        if((level) >= _logLevel.load(std::memory_order_relaxed) && _logHandler)                    \
             handleLog(handle, level, message);                                                     \
     } while(false)
 #define LOG_DEBUG(handle, message) LOG(handle, LogLevel::Debug, message)
@@ -15,7 +17,7 @@
 
 #define LOG_WITH_ERROR_CODE(handle, level, message, error_code)                                    \
     do {                                                                                           \
-        if(_logHandler && (level) >= _logLevel)                                                    \
+        if((level) >= _logLevel.load(std::memory_order_relaxed) && _logHandler)                    \
             handleLog(handle,                                                                      \
                 level,                                                                             \
                 message + std::string(" - ") +                                                     \
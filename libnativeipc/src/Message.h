@@ -4,10 +4,210 @@
 #pragma once
 
 #include <IConnection.h>
+#include <cstddef>
 
 namespace Twitch::IPC {
 struct MessageHeader {
     Handle handle;
     uint32_t bodySize;
 };
+
+// Frames with a handle at or above this are transport control frames and never reach the connection.
+// Promise ids are kept below it even with ResponseFlag set.
+constexpr Handle ControlHandleBase = 0xFFFFFF00;
+// Set by the transport on frames whose body it compressed, and only towards peers whose hello says
+// they can read them. The connection layer keeps this bit clear in the handles it sends.
+constexpr Handle CompressedFlag = 0x40000000;
+
+namespace ControlHandle {
+// Writer -> reader: uint64_t ring capacity followed by the shared memory segment name
+constexpr Handle SharedMemoryAttach = ControlHandleBase;
+// Reader -> writer: the ring is mapped, frames may go through it from now on
+constexpr Handle SharedMemoryAttached = ControlHandleBase + 1;
+// Writer -> reader: uint32_t count of frames just written to the ring
+constexpr Handle SharedMemoryDoorbell = ControlHandleBase + 2;
+// Either way: uint64_t size of the shared memory whose handle travels with this frame. On Windows the
+// handle has already been duplicated into the receiver and its uint64_t value follows.
+constexpr Handle SharedHandle = ControlHandleBase + 3;
+// Client -> server: the name of a topic to start or stop receiving published messages for
+constexpr Handle Subscribe = ControlHandleBase + 4;
+constexpr Handle Unsubscribe = ControlHandleBase + 5;
+// Client -> server first thing once connected, then server -> client in reply: a Hello. Older peers
+// never send one, and get no control frame but the client's hello, so nothing that depends on what
+// it advertises is ever used with them.
+constexpr Handle Hello = ControlHandleBase + 6;
+// Either way, no body: every frame after this one on the stream has a compact header
+constexpr Handle CompactHeaders = ControlHandleBase + 7;
+// Either way: one piece of a streamed payload, followed by a StreamChunkTrailer. The connection gets
+// these through onChunk rather than onReceived.
+constexpr Handle StreamChunk = ControlHandleBase + 8;
+// Either way: the newest value of a channel, followed by a LatestValueTrailer. The connection gets these
+// through onLatest rather than onReceived.
+constexpr Handle LatestValue = ControlHandleBase + 9;
+} // namespace ControlHandle
+
+// Bumped whenever Hello gains a field or a capability changes meaning
+constexpr uint32_t ProtocolVersion = 1;
+
+namespace Capability {
+// Maps shared memory rings the peer offers, so offering one is worth it
+constexpr uint32_t SharedMemoryRing = 1;
+// Takes handles passed alongside SharedHandle frames
+constexpr uint32_t PassHandles = 2;
+// Reads compact frame headers once told to with ControlHandle::CompactHeaders
+constexpr uint32_t CompactHeaders = 4;
+// Takes StreamChunk frames
+constexpr uint32_t StreamChunks = 8;
+// Takes LatestValue frames
+constexpr uint32_t LatestValues = 16;
+} // namespace Capability
+
+// Later versions only append fields, so a reader takes what it knows from the front of a longer body
+struct Hello {
+    uint32_t version;
+    uint32_t capabilities;
+    // Compression codecs the sender can read
+    uint32_t compressionCodecs;
+    // Largest frame body the sender accepts, 0 for no limit
+    uint32_t maxFrameSize;
+};
+
+// Goes at the end of a StreamChunk body, so the chunk itself never has to move to make room for it
+#pragma pack(push, 1)
+struct StreamChunkTrailer {
+    Handle streamId;
+    // Nonzero on the final chunk of the stream
+    uint8_t last;
+};
+
+// Goes at the end of a LatestValue body, like StreamChunkTrailer
+struct LatestValueTrailer {
+    uint32_t channel;
+};
+#pragma pack(pop)
+
+// Compact frame headers replace the fixed MessageHeader on streams where both sides support them. The
+// lead byte covers the common cases, and varints follow it only when they don't fit:
+//   bits 7-6  00: handle 0, 01: the handle follows as a varint, 10: a control handle, whose offset from
+//             ControlHandleBase follows as one byte
+//   bit 5     the handle has bit 31 set, as responses do
+//   bit 4     the handle has CompressedFlag set
+//   bits 3-0  the body size if it is below 15, otherwise 15 and a varint of the rest of it follows
+// So a plain message of up to 14 bytes takes a single byte of header instead of eight.
+constexpr size_t MaxCompactHeaderSize = 11;
+
+namespace CompactHeader {
+constexpr uint8_t HandleFollows = 0x40;
+constexpr uint8_t ControlFollows = 0x80;
+constexpr uint8_t HighFlag = 0x20;
+constexpr uint8_t CompressedBit = 0x10;
+constexpr uint8_t SizeFollows = 0x0F;
+constexpr Handle FlagBits = 0x80000000 | CompressedFlag;
+
+inline uint8_t *writeVarint(uint8_t *out, uint32_t value)
+{
+    while(value >= 0x80) {
+        *out++ = static_cast<uint8_t>(value | 0x80);
+        value >>= 7;
+    }
+    *out++ = static_cast<uint8_t>(value);
+    return out;
+}
+
+// Returns how many bytes it took, 0 if more are needed, or -1 if it doesn't fit in 32 bits
+inline int readVarint(const uint8_t *data, size_t available, uint32_t &value)
+{
+    value = 0;
+    for(int i = 0; i < 5; ++i) {
+        if(static_cast<size_t>(i) == available) {
+            return 0;
+        }
+        const uint8_t byte = data[i];
+        if(i == 4 && byte > 0x0F) {
+            return -1;
+        }
+        value |= static_cast<uint32_t>(byte & 0x7F) << (7 * i);
+        if(!(byte & 0x80)) {
+            return i + 1;
+        }
+    }
+    return -1;
+}
+} // namespace CompactHeader
+
+inline size_t encodeCompactHeader(const MessageHeader &header, uint8_t *out)
+{
+    using namespace CompactHeader;
+    uint8_t *p = out + 1;
+    uint8_t lead = 0;
+    if(header.handle >= ControlHandleBase) {
+        lead = ControlFollows;
+        *p++ = static_cast<uint8_t>(header.handle - ControlHandleBase);
+    } else {
+        lead |= (header.handle & 0x80000000) ? HighFlag : 0;
+        lead |= (header.handle & CompressedFlag) ? CompressedBit : 0;
+        const Handle id = header.handle & ~FlagBits;
+        if(id) {
+            lead |= HandleFollows;
+            p = writeVarint(p, id);
+        }
+    }
+    if(header.bodySize < SizeFollows) {
+        lead |= static_cast<uint8_t>(header.bodySize);
+    } else {
+        lead |= SizeFollows;
+        p = writeVarint(p, header.bodySize - SizeFollows);
+    }
+    *out = lead;
+    return static_cast<size_t>(p - out);
+}
+
+// Returns how many bytes the header took, 0 if `available` doesn't hold all of it yet, or -1 if it is malformed
+inline int decodeCompactHeader(const uint8_t *data, size_t available, MessageHeader &header)
+{
+    using namespace CompactHeader;
+    if(!available) {
+        return 0;
+    }
+    const uint8_t lead = data[0];
+    size_t used = 1;
+    Handle handle = 0;
+    if(lead & ControlFollows) {
+        if(lead & (HandleFollows | HighFlag | CompressedBit)) {
+            return -1;
+        }
+        if(available == used) {
+            return 0;
+        }
+        handle = ControlHandleBase + data[used++];
+    } else {
+        if(lead & HandleFollows) {
+            const int read = readVarint(data + used, available - used, handle);
+            if(read <= 0) {
+                return read;
+            }
+            if(handle & FlagBits) {
+                return -1;
+            }
+            used += read;
+        }
+        handle |= (lead & HighFlag) ? 0x80000000 : 0;
+        handle |= (lead & CompressedBit) ? CompressedFlag : 0;
+    }
+    uint32_t bodySize = lead & SizeFollows;
+    if(bodySize == SizeFollows) {
+        uint32_t rest{};
+        const int read = readVarint(data + used, available - used, rest);
+        if(read <= 0) {
+            return read;
+        }
+        if(rest > UINT32_MAX - SizeFollows) {
+            return -1;
+        }
+        bodySize += rest;
+        used += read;
+    }
+    header = {handle, bodySize};
+    return static_cast<int>(used);
+}
 } // namespace Twitch::IPC
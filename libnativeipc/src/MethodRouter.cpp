@@ -0,0 +1,89 @@
+// Copyright Twitch Interactive, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: MIT
+
+#include "MethodRouter.h"
+#include "TypedMessage.h"
+
+using namespace Twitch::IPC;
+
+MethodRouter::~MethodRouter()
+{
+    stop();
+}
+
+void MethodRouter::add(uint32_t methodId, Handler handler, const MethodOptions &options)
+{
+    auto method = std::make_unique<Method>();
+    method->handler = std::move(handler);
+    method->options = options;
+    if(options.executor == MethodExecutor::Dedicated) {
+        method->dedicated = std::make_unique<OperationQueue>();
+        method->dedicated->setThreadCount(options.maxConcurrency);
+    }
+    _methods[methodId] = std::move(method);
+}
+
+bool MethodRouter::route(Handle connectionHandle, Handle promiseId, Payload &message, OperationQueue &pool)
+{
+    if(_methods.empty()) {
+        return false;
+    }
+    const auto found = _methods.find(methodOf(message));
+    if(found == _methods.end()) {
+        return false;
+    }
+    auto &method = *found->second;
+    Operation call = [&method, connectionHandle, promiseId, message = std::move(message)]() mutable {
+        method.handler(connectionHandle, promiseId, std::move(message));
+    };
+    {
+        std::lock_guard guard(method.mutex);
+        if(method.options.maxConcurrency && method.running >= method.options.maxConcurrency) {
+            method.waiting.push(std::move(call));
+            return true;
+        }
+        ++method.running;
+    }
+    start(method, std::move(call), pool);
+    return true;
+}
+
+void MethodRouter::stop()
+{
+    for(auto &[methodId, method] : _methods) {
+        if(method->dedicated) {
+            method->dedicated->stop();
+        }
+    }
+}
+
+void MethodRouter::start(Method &method, Operation call, OperationQueue &pool)
+{
+    switch(method.options.executor) {
+    case MethodExecutor::Inline:
+        drain(method, std::move(call));
+        break;
+    case MethodExecutor::Pool:
+        pool.enqueueUnordered([&method, call = std::move(call)]() mutable { drain(method, std::move(call)); });
+        break;
+    case MethodExecutor::Dedicated:
+        method.dedicated->enqueueUnordered(
+            [&method, call = std::move(call)]() mutable { drain(method, std::move(call)); });
+        break;
+    }
+}
+
+void MethodRouter::drain(Method &method, Operation call)
+{
+    // Rather than going back through the executor, the call that finishes runs the next one waiting
+    for(;;) {
+        call();
+        call.reset();
+        std::lock_guard guard(method.mutex);
+        if(method.waiting.empty()) {
+            --method.running;
+            return;
+        }
+        call = method.waiting.pop();
+    }
+}
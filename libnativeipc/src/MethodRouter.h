@@ -0,0 +1,48 @@
+// Copyright Twitch Interactive, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "DeleteConstructors.h"
+#include "IConnection.h"
+#include "OperationQueue.h"
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace Twitch::IPC {
+// Hands invokes to the handler registered for the method id they start with, each on the executor
+// its options ask for, and with no more calls of a method running at once than they allow
+class MethodRouter {
+public:
+    using Handler = std::function<void(Handle connectionHandle, Handle promiseId, Payload message)>;
+
+    MethodRouter() = default;
+    ~MethodRouter();
+    DELETE_COPY_AND_MOVE_CONSTRUCTORS(MethodRouter);
+
+    // Not thread safe, so only before the connection starts
+    void add(uint32_t methodId, Handler handler, const MethodOptions &options);
+    // Returns false, leaving `message` alone, if no method is registered under its method id.
+    // `pool` runs the methods with MethodExecutor::Pool.
+    bool route(Handle connectionHandle, Handle promiseId, Payload &message, OperationQueue &pool);
+    // Stops the dedicated threads, dropping calls that haven't started
+    void stop();
+
+private:
+    struct Method {
+        Handler handler;
+        MethodOptions options;
+        std::unique_ptr<OperationQueue> dedicated;
+        std::mutex mutex;
+        size_t running = 0;
+        // Calls held back by maxConcurrency, which the calls running take on as they finish
+        OperationRing waiting;
+    };
+
+    void start(Method &method, Operation call, OperationQueue &pool);
+    static void drain(Method &method, Operation call);
+
+    std::unordered_map<uint32_t, std::unique_ptr<Method>> _methods;
+};
+} // namespace Twitch::IPC
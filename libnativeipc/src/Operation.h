@@ -0,0 +1,184 @@
+// Copyright Twitch Interactive, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "Trace.h"
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace Twitch::IPC {
+// Move-only `void()` callable. Unlike std::function it never copies its target, and it keeps targets
+// of up to InlineSize bytes in place, which covers every handler lambda the connections enqueue.
+class Operation {
+public:
+    static constexpr size_t InlineSize = 80;
+
+    Operation() = default;
+    template<typename F, typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, Operation>>>
+    Operation(F &&function) // NOLINT(google-explicit-constructor)
+    {
+        using Target = std::decay_t<F>;
+        if constexpr(sizeof(Target) <= InlineSize && alignof(Target) <= alignof(std::max_align_t) &&
+                     std::is_nothrow_move_constructible_v<Target>) {
+            new(_storage) Target(std::forward<F>(function));
+            _ops = &InlineOps<Target>::ops;
+        } else {
+            new(_storage) Target *(new Target(std::forward<F>(function)));
+            _ops = &HeapOps<Target>::ops;
+        }
+    }
+    Operation(Operation &&other) noexcept
+    {
+        take(other);
+    }
+    Operation &operator=(Operation &&other) noexcept
+    {
+        if(this != &other) {
+            reset();
+            take(other);
+        }
+        return *this;
+    }
+    Operation(const Operation &) = delete;
+    Operation &operator=(const Operation &) = delete;
+    ~Operation()
+    {
+        reset();
+    }
+
+    explicit operator bool() const
+    {
+        return _ops != nullptr;
+    }
+    void operator()()
+    {
+        _ops->invoke(_storage);
+    }
+    void reset()
+    {
+        if(_ops) {
+            _ops->destroy(_storage);
+            _ops = nullptr;
+        }
+    }
+
+#if NATIVEIPC_TRACING
+    // When it was queued, for tracing how long it waited to run
+    uint64_t tracedAt{};
+#endif
+
+private:
+    struct Ops {
+        void (*invoke)(void *storage);
+        // Move-constructs into `to` and destroys what is left in `from`
+        void (*relocate)(void *to, void *from);
+        void (*destroy)(void *storage);
+    };
+
+    template<typename Target>
+    struct InlineOps {
+        static constexpr Ops ops{
+            [](void *storage) { (*static_cast<Target *>(storage))(); },
+            [](void *to, void *from) {
+                new(to) Target(std::move(*static_cast<Target *>(from)));
+                static_cast<Target *>(from)->~Target();
+            },
+            [](void *storage) { static_cast<Target *>(storage)->~Target(); },
+        };
+    };
+
+    template<typename Target>
+    struct HeapOps {
+        static constexpr Ops ops{
+            [](void *storage) { (**static_cast<Target **>(storage))(); },
+            [](void *to, void *from) { new(to) Target *(*static_cast<Target **>(from)); },
+            [](void *storage) { delete *static_cast<Target **>(storage); },
+        };
+    };
+
+    void take(Operation &other)
+    {
+#if NATIVEIPC_TRACING
+        tracedAt = other.tracedAt;
+#endif
+        if(other._ops) {
+            other._ops->relocate(_storage, other._storage);
+            _ops = other._ops;
+            other._ops = nullptr;
+        }
+    }
+
+    alignas(std::max_align_t) unsigned char _storage[InlineSize];
+    const Ops *_ops = nullptr;
+};
+
+// FIFO of operations in a circular buffer that only grows, so a queue that has reached its working
+// size stops allocating. Not thread safe.
+class OperationRing {
+public:
+    explicit OperationRing(size_t initialCapacity = 0)
+    {
+        if(initialCapacity) {
+            grow(initialCapacity);
+        }
+    }
+
+    [[nodiscard]] bool empty() const
+    {
+        return !_count;
+    }
+    [[nodiscard]] size_t size() const
+    {
+        return _count;
+    }
+
+    void push(Operation &&operation)
+    {
+        if(_count == _slots.size()) {
+            grow(_slots.empty() ? 16 : _slots.size() * 2);
+        }
+        _slots[(_head + _count) & (_slots.size() - 1)] = std::move(operation);
+        ++_count;
+    }
+
+    Operation pop()
+    {
+        auto operation = std::move(_slots[_head]);
+        _head = (_head + 1) & (_slots.size() - 1);
+        --_count;
+        return operation;
+    }
+
+    // Moves up to `limit` operations from the front onto the end of `batch`
+    void popInto(std::vector<Operation> &batch, size_t limit)
+    {
+        for(; limit && _count; --limit) {
+            batch.emplace_back(pop());
+        }
+    }
+
+private:
+    // Capacities stay powers of two so that wrapping is a mask
+    void grow(size_t capacity)
+    {
+        size_t rounded = 1;
+        while(rounded < capacity) {
+            rounded <<= 1;
+        }
+        std::vector<Operation> slots(rounded);
+        for(size_t i = 0; i < _count; ++i) {
+            slots[i] = std::move(_slots[(_head + i) & (_slots.size() - 1)]);
+        }
+        _slots.swap(slots);
+        _head = 0;
+    }
+
+    std::vector<Operation> _slots;
+    size_t _head = 0;
+    size_t _count = 0;
+};
+} // namespace Twitch::IPC
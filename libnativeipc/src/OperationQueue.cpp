@@ -2,34 +2,107 @@
 // SPDX-License-Identifier: MIT
 
 #include "OperationQueue.h"
+#include <algorithm>
 
 using namespace Twitch::IPC;
 
+namespace {
+// How many operations a worker runs from one strand before giving the other strands a turn
+constexpr size_t StrandBudget = 16;
+// How many operations a worker takes off the shared queue per lock acquisition
+constexpr size_t DrainBatch = 64;
+constexpr size_t InitialQueueCapacity = 256;
+} // namespace
+
 OperationQueue::OperationQueue()
+    : _queue(InitialQueueCapacity)
 {
-    _queueThread = std::thread([this] {
-        std::unique_lock lock(_mutex);
-        while(!_stop) {
-            _condVar.wait(lock, [this] { return !_queue.empty() || _stop; });
+    _queueThreads.emplace_back([this] { runWorker(); });
+}
 
-            if(_queue.empty() || _stop) {
-                continue;
-            }
-            auto operation = _queue.front();
-            _queue.pop();
+OperationQueue::~OperationQueue()
+{
+    stop();
+}
 
-            if(operation) {
-                lock.unlock();
-                operation();
-                lock.lock();
-            }
+void OperationQueue::setThreadCount(size_t threadCount)
+{
+    std::lock_guard guard(_mutex);
+    if(threadCount <= 1 || _stop) {
+        return;
+    }
+    _pooled = true;
+    while(_queueThreads.size() < threadCount) {
+        _queueThreads.emplace_back([this] { runWorker(); });
+    }
+}
+
+void OperationQueue::setInline(bool runInline)
+{
+    _inline = runInline;
+}
+
+void OperationQueue::runWorker()
+{
+    // Reused across batches so that draining doesn't allocate either
+    std::vector<Operation> batch;
+    batch.reserve(std::max(DrainBatch, StrandBudget));
+    std::unique_lock lock(_mutex);
+    while(!_stop) {
+        _condVar.wait(lock, [this] { return !_queue.empty() || !_ready.empty() || _stop; });
+
+        if(_stop) {
+            continue;
+        }
+        // Strands and the shared queue take turns, or strands that keep refilling would leave unordered
+        // operations waiting for as long as they do
+        if(!_ready.empty() && (_queue.empty() || !_queueTurn)) {
+            _queueTurn = true;
+            runStrand(lock, batch);
+            continue;
         }
-    });
+        _queueTurn = false;
+        // Only unordered operations reach the shared queue of a pool, so each goes to its own worker
+        _queue.popInto(batch, _pooled ? 1 : DrainBatch);
+        lock.unlock();
+        runBatch(0, batch);
+        lock.lock();
+    }
 }
 
-OperationQueue::~OperationQueue()
+void OperationQueue::runBatch(Handle key, std::vector<Operation> &batch)
 {
-    stop();
+    for(auto &operation : batch) {
+        if(_stop) {
+            break;
+        }
+        if(operation) {
+            TRACE_END("dispatch queue", operation.tracedAt, key, 0);
+            TRACE_SCOPE("handler", key);
+            operation();
+        }
+        _backlog.fetch_sub(1, std::memory_order_relaxed);
+    }
+    // Captured state is released here, outside the lock
+    batch.clear();
+}
+
+void OperationQueue::runStrand(std::unique_lock<std::mutex> &lock, std::vector<Operation> &batch)
+{
+    const auto key = _ready.front();
+    _ready.pop_front();
+    // Nobody else touches a strand while it is off the ready list, and map nodes don't move
+    auto &strand = _strands[key];
+    strand.operations.popInto(batch, StrandBudget);
+    lock.unlock();
+    runBatch(key, batch);
+    lock.lock();
+    if(strand.operations.empty()) {
+        _strands.erase(key);
+    } else {
+        _ready.push_back(key);
+        _condVar.notify_one();
+    }
 }
 
 void OperationQueue::stop()
@@ -38,18 +111,94 @@ void OperationQueue::stop()
         {
             std::lock_guard guard(_mutex);
             _stop = true;
-            _condVar.notify_one();
+            _condVar.notify_all();
         }
 
-        if(_queueThread.joinable()) {
-            _queueThread.join();
+        for(auto &thread : _queueThreads) {
+            if(thread.joinable()) {
+                thread.join();
+            }
+        }
+    }
+}
+
+void OperationQueue::enqueue(Operation &&operation)
+{
+    enqueue(0, std::move(operation));
+}
+
+void OperationQueue::enqueue(Handle key, Operation &&operation)
+{
+    if(_inline) {
+        if(operation && !_stop) {
+            TRACE_SCOPE("handler", key);
+            operation();
         }
+        return;
+    }
+    TRACE_BEGIN(operation.tracedAt);
+    _backlog.fetch_add(1, std::memory_order_relaxed);
+    std::lock_guard guard(_mutex);
+    if(!_pooled) {
+        _queue.push(std::move(operation));
+        _condVar.notify_one();
+        return;
+    }
+    // A scheduled strand is either on the ready list or being run, so it will get to this too
+    auto &strand = _strands[key];
+    strand.operations.push(std::move(operation));
+    if(!strand.scheduled) {
+        strand.scheduled = true;
+        _ready.push_back(key);
+        _condVar.notify_one();
     }
 }
 
-void OperationQueue::enqueue(std::function<void()> &&operation)
+bool OperationQueue::enqueueLatest(Handle key, uint64_t slot, Operation &&operation)
 {
+    if(_inline) {
+        enqueue(key, std::move(operation));
+        return false;
+    }
+    {
+        std::lock_guard guard(_mutex);
+        auto [latest, added] = _latest.try_emplace(slot);
+        // The one replaced goes with `operation` once the lock is released
+        std::swap(latest->second, operation);
+        if(!added) {
+            return true;
+        }
+    }
+    enqueue(key, [this, slot] { runLatest(slot); });
+    return false;
+}
+
+void OperationQueue::runLatest(uint64_t slot)
+{
+    Operation operation;
+    {
+        std::lock_guard guard(_mutex);
+        auto latest = _latest.find(slot);
+        operation = std::move(latest->second);
+        _latest.erase(latest);
+    }
+    if(operation) {
+        operation();
+    }
+}
+
+void OperationQueue::enqueueUnordered(Operation &&operation)
+{
+    if(_inline) {
+        if(operation && !_stop) {
+            TRACE_SCOPE("handler", 0);
+            operation();
+        }
+        return;
+    }
+    TRACE_BEGIN(operation.tracedAt);
+    _backlog.fetch_add(1, std::memory_order_relaxed);
     std::lock_guard guard(_mutex);
-    _queue.emplace(std::move(operation));
+    _queue.push(std::move(operation));
     _condVar.notify_one();
 }
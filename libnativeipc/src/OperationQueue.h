@@ -4,11 +4,15 @@
 #pragma once
 
 #include "DeleteConstructors.h"
-#include <functional>
+#include "IConnection.h"
+#include "Operation.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
 #include <mutex>
-#include <queue>
 #include <thread>
-#include <condition_variable>
+#include <unordered_map>
+#include <vector>
 
 namespace Twitch::IPC {
 class OperationQueue {
@@ -17,14 +21,53 @@ public:
     ~OperationQueue();
     DELETE_COPY_AND_MOVE_CONSTRUCTORS(OperationQueue);
 
-    void enqueue(std::function<void()> &&operation);
+    // Runs operations on up to `threadCount` threads. Operations enqueued with the same key still run
+    // one at a time and in order. Must be called before anything is enqueued.
+    void setThreadCount(size_t threadCount);
+    // Runs operations straight away on whichever thread enqueues them instead of handing them over.
+    // Must be called before anything is enqueued.
+    void setInline(bool runInline);
+
+    void enqueue(Operation &&operation);
+    void enqueue(Handle key, Operation &&operation);
+    // Like enqueue, but free to run alongside anything else on whichever thread is idle
+    void enqueueUnordered(Operation &&operation);
+    // Like enqueue, but takes the place of the operation for `slot` if that hasn't started yet, in which
+    // case it returns true. Whichever is newest runs where the first one was queued.
+    bool enqueueLatest(Handle key, uint64_t slot, Operation &&operation);
     void stop();
+    // How many operations are waiting or running right now
+    [[nodiscard]] size_t backlog() const
+    {
+        return _backlog.load(std::memory_order_relaxed);
+    }
 
 private:
-    std::queue<std::function<void()>> _queue;
+    // The pending operations for one key. A strand with work sits in _ready until a worker takes it,
+    // and only that worker runs it until it is empty or has used up its turn.
+    struct Strand {
+        OperationRing operations;
+        bool scheduled = false;
+    };
+
+    void runWorker();
+    void runStrand(std::unique_lock<std::mutex> &lock, std::vector<Operation> &batch);
+    void runBatch(Handle key, std::vector<Operation> &batch);
+    void runLatest(uint64_t slot);
+
+    OperationRing _queue;
+    std::unordered_map<Handle, Strand> _strands;
+    std::deque<Handle> _ready;
+    // Whether the shared queue goes next, when both it and a strand have work
+    bool _queueTurn = false;
+    // The newest operation of each slot that is queued and hasn't started
+    std::unordered_map<uint64_t, Operation> _latest;
+    bool _pooled = false;
+    std::atomic<bool> _inline{false};
     std::mutex _mutex;
     std::condition_variable _condVar;
-    std::thread _queueThread;
-    bool _stop = false;
+    std::vector<std::thread> _queueThreads;
+    std::atomic<bool> _stop{false};
+    std::atomic<size_t> _backlog{0};
 };
 } // namespace Twitch::IPC
@@ -2,9 +2,17 @@
 // SPDX-License-Identifier: MIT
 
 #include "Pipe-ClientTransport.h"
+#include "LogMacrosNoHandle.h"
+#include <algorithm>
+#include <string_view>
 
 using namespace Twitch::IPC;
 
+ClientTransport<Transport::Pipe>::ClientTransport()
+{
+    _canPassHandles = true;
+}
+
 ClientTransport<Transport::Pipe>::~ClientTransport()
 {
     destroy();
@@ -14,7 +22,61 @@ bool ClientTransport<Transport::Pipe>::connectSocket()
 {
     auto pipe = new uv_pipe_t;
     pipe->data = static_cast<UVTransportBase *>(this);
-    uv_pipe_init(&_loop, pipe, true);
+    uv_pipe_init(_loop, pipe, true);
+    trackHandle();
     uv_pipe_connect(&_connect, pipe, _endpoint.c_str(), connect_cb);
     return true;
 }
+
+#ifndef _WIN32
+void ClientTransport<Transport::Pipe>::watchEndpoint()
+{
+    if(!_canWatch || uv_is_active(reinterpret_cast<uv_handle_t *>(&_watch))) {
+        return;
+    }
+    if(!_watchOpen) {
+        _watch.data = static_cast<UVTransportBase *>(this);
+        uv_fs_event_init(_loop, &_watch);
+        trackHandle();
+        _watchOpen = true;
+    }
+    const auto slash = _endpoint.rfind('/');
+    const auto directory = slash == std::string::npos ? std::string(".") : _endpoint.substr(0, std::max<size_t>(slash, 1));
+    _socketName = _endpoint.substr(slash + 1);
+    if(const auto result = uv_fs_event_start(&_watch, watch_cb, directory.c_str(), 0)) {
+        // Not worth trying again on every retry
+        LOG_WARNING_WITH_ERROR_CODE("Can't watch " + directory + " for the server", result);
+        _canWatch = false;
+    }
+}
+
+void ClientTransport<Transport::Pipe>::pauseEndpointWatch()
+{
+    if(_watchOpen) {
+        uv_fs_event_stop(&_watch);
+    }
+}
+
+void ClientTransport<Transport::Pipe>::closeEndpointWatch()
+{
+    if(_watchOpen) {
+        closeHandle(reinterpret_cast<uv_handle_t *>(&_watch), false);
+        _watchOpen = false;
+    }
+}
+void ClientTransport<Transport::Pipe>::watch_cb(uv_fs_event_t *handle, const char *filename, int, int status)
+{
+    auto client = static_cast<ClientTransport *>(reinterpret_cast<UVTransportBase *>(handle->data));
+    if(status < 0 || !filename) {
+        return;
+    }
+    // Some platforms report the whole path
+    std::string_view name(filename);
+    if(const auto slash = name.rfind('/'); slash != std::string_view::npos) {
+        name.remove_prefix(slash + 1);
+    }
+    if(name == client->_socketName) {
+        client->retryNow();
+    }
+}
+#endif
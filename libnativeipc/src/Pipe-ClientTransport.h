@@ -8,14 +8,29 @@
 
 namespace Twitch::IPC {
 template<>
-class ClientTransport<Transport::Pipe> final
+class ClientTransport<Transport::Pipe>
     : public UVClientTransport {
 public:
-    ClientTransport() = default;
+    ClientTransport();
     ~ClientTransport();
     DELETE_COPY_AND_MOVE_CONSTRUCTORS(ClientTransport);
 
 protected:
     bool connectSocket() override;
+#ifndef _WIN32
+    void watchEndpoint() override;
+    void pauseEndpointWatch() override;
+    void closeEndpointWatch() override;
+
+private:
+    static void watch_cb(uv_fs_event_t *handle, const char *filename, int events, int status);
+
+    // Watches the directory the socket goes in for the server creating it. Windows has nothing to watch
+    // for a pipe that doesn't exist yet, so there the retry timer is all there is.
+    uv_fs_event_t _watch{};
+    std::string _socketName;
+    bool _watchOpen{};
+    bool _canWatch{true};
+#endif
 };
 } // namespace Twitch::IPC
@@ -11,6 +11,7 @@ ServerTransport<Transport::Pipe>::ServerTransport(
     : UVServerTransport(latestConnectionOnly, allowMultiuserAccess)
 {
     _binder.data = static_cast<UVTransportBase *>(this);
+    _canPassHandles = true;
 }
 
 ServerTransport<Transport::Pipe>::~ServerTransport()
@@ -23,14 +24,30 @@ int ServerTransport<Transport::Pipe>::acceptClient(uv_stream_t *stream, uv_strea
     assert(stream == reinterpret_cast<uv_stream_t*>(&_binder));
 
     auto pipe = new uv_pipe_t;
-    uv_pipe_init(&_loop, pipe, true);
+    uv_pipe_init(_loop, pipe, true);
+    trackHandle();
     clientStream = reinterpret_cast<uv_stream_t*>(pipe);
     return uv_accept(stream, reinterpret_cast<uv_stream_t *>(pipe));
 }
 
+int ServerTransport<Transport::Pipe>::openClient(NativeHandle socket, uv_stream_t *&clientStream)
+{
+    auto pipe = new uv_pipe_t;
+    uv_pipe_init(_loop, pipe, true);
+    trackHandle();
+    clientStream = reinterpret_cast<uv_stream_t*>(pipe);
+#ifdef _WIN32
+    (void)socket;
+    return UV_ENOTSUP;
+#else
+    return uv_pipe_open(pipe, socket);
+#endif
+}
+
 int ServerTransport<Transport::Pipe>::bind()
 {
-    uv_pipe_init(&_loop, &_binder, false);
+    uv_pipe_init(_loop, &_binder, false);
+    trackHandle();
     int ret = uv_pipe_bind(&_binder, _endpoint.c_str());
     if(ret == 0 && _allowMultiuserAccess) {
         ret = uv_pipe_chmod(&_binder, UV_WRITABLE | UV_READABLE);
@@ -46,5 +63,5 @@ int ServerTransport<Transport::Pipe>::startListening()
 
 void ServerTransport<Transport::Pipe>::closeBinder()
 {
-    uv_close(reinterpret_cast<uv_handle_t *>(&_binder), nullptr);
+    closeHandle(reinterpret_cast<uv_handle_t *>(&_binder), false);
 }
@@ -8,7 +8,7 @@
 
 namespace Twitch::IPC {
 template<>
-class ServerTransport<Transport::Pipe> final
+class ServerTransport<Transport::Pipe>
     : public UVServerTransport {
 public:
     ServerTransport(bool latestConnectionOnly, bool allowMultiuserAccess);
@@ -17,6 +17,7 @@ public:
 
 protected:
     int acceptClient(uv_stream_t *stream, uv_stream_t *&) override;
+    int openClient(NativeHandle socket, uv_stream_t *&) override;
     int bind() override;
     int startListening() override;
     void closeBinder() override;
@@ -0,0 +1,231 @@
+// Copyright Twitch Interactive, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: MIT
+
+#include "PromiseTable.h"
+#include <thread>
+
+using namespace Twitch::IPC;
+
+PromiseTable::PromiseTable(size_t capacity)
+{
+    // Capacities stay powers of two so that picking a slot is a mask
+    size_t rounded = 1;
+    while(rounded < capacity) {
+        rounded <<= 1;
+    }
+    _slots = std::make_unique<Slot[]>(rounded);
+    _mask = rounded - 1;
+}
+
+std::shared_ptr<PromiseTable::Window> PromiseTable::openConnection(Handle connectionHandle)
+{
+    std::lock_guard guard(_windowsMutex);
+    auto &window = _windows[connectionHandle];
+    if(!window) {
+        window = std::make_shared<Window>();
+        publishWindows(guard);
+    }
+    return window;
+}
+
+std::shared_ptr<PromiseTable::Window> PromiseTable::windowFor(Handle connectionHandle)
+{
+    const auto windows = _publishedWindows.acquire();
+    if(!windows) {
+        return nullptr;
+    }
+    const auto i = windows->find(connectionHandle);
+    return i != windows->end() ? i->second : nullptr;
+}
+
+void PromiseTable::publishWindows(const std::lock_guard<std::mutex> &)
+{
+    auto snapshot = std::make_unique<const Windows>(_windows);
+    _publishedWindows.replace(snapshot.get());
+    _windowsSnapshot = std::move(snapshot);
+}
+
+InvokeResultCode PromiseTable::insert(Handle promiseId,
+    Handle connectionHandle,
+    const std::shared_ptr<Window> &window,
+    PendingInvoke &&invoke)
+{
+    if(!window || !window->open.load(std::memory_order_acquire)) {
+        return InvokeResultCode::RemoteDisconnect;
+    }
+    const auto inFlight = ++window->inFlight;
+    const auto maxInFlight = _maxInFlight.load(std::memory_order_relaxed);
+    if(maxInFlight && inFlight > maxInFlight) {
+        --window->inFlight;
+        ++_rejected;
+        return InvokeResultCode::WindowFull;
+    }
+    auto peak = _peakInFlight.load(std::memory_order_relaxed);
+    while(inFlight > peak && !_peakInFlight.compare_exchange_weak(peak, inFlight, std::memory_order_relaxed)) {
+    }
+
+    auto &slot = slotFor(promiseId);
+    uint64_t expected = 0;
+    if(slot.state.compare_exchange_strong(expected, readyState(promiseId) | Busy, std::memory_order_acquire)) {
+        slot.connectionHandle = connectionHandle;
+        slot.invoke = std::move(invoke);
+        slot.window = window;
+        slot.state.store(readyState(promiseId), std::memory_order_release);
+    } else {
+        std::lock_guard guard(_overflowMutex);
+        _overflow[promiseId] = {connectionHandle, std::move(invoke), window};
+        ++_overflowCount;
+    }
+    ++_size;
+    return InvokeResultCode::Good;
+}
+
+bool PromiseTable::take(Handle promiseId, Handle connectionHandle, PendingInvoke &invoke)
+{
+    return takeInvoke(promiseId, connectionHandle, invoke) != nullptr;
+}
+
+bool PromiseTable::takeAnswered(Handle promiseId, Handle connectionHandle, PendingInvoke &invoke)
+{
+    const auto window = takeInvoke(promiseId, connectionHandle, invoke);
+    if(!window) {
+        return false;
+    }
+    auto last = window->lastAnswered.load(std::memory_order_relaxed);
+    while(true) {
+        const Handle behind = last - promiseId;
+        if(behind && behind < ReorderHorizon) {
+            ++_reordered;
+            break;
+        }
+        if(window->lastAnswered.compare_exchange_weak(last, promiseId, std::memory_order_relaxed)) {
+            break;
+        }
+    }
+    return true;
+}
+
+std::shared_ptr<PromiseTable::Window> PromiseTable::takeInvoke(Handle promiseId, Handle connectionHandle, PendingInvoke &invoke)
+{
+    std::shared_ptr<Window> window;
+    auto &slot = slotFor(promiseId);
+    const auto ready = readyState(promiseId);
+    auto expected = ready;
+    while(!slot.state.compare_exchange_weak(expected, ready | Busy, std::memory_order_acquire)) {
+        if(expected != ready && expected != (ready | Busy)) {
+            expected = 0;
+            break;
+        }
+        // Still being filled in, or someone is looking at it
+        if(expected == (ready | Busy)) {
+            std::this_thread::yield();
+        }
+        expected = ready;
+    }
+    if(expected == ready) {
+        if(slot.connectionHandle != connectionHandle) {
+            slot.state.store(ready, std::memory_order_release);
+            return nullptr;
+        }
+        invoke = std::move(slot.invoke);
+        slot.invoke = {};
+        window = std::move(slot.window);
+        slot.state.store(0, std::memory_order_release);
+    } else {
+        if(!_overflowCount.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+        std::lock_guard guard(_overflowMutex);
+        auto i = _overflow.find(promiseId);
+        if(i == _overflow.end() || i->second.connectionHandle != connectionHandle) {
+            return nullptr;
+        }
+        invoke = std::move(i->second.invoke);
+        window = std::move(i->second.window);
+        _overflow.erase(i);
+        --_overflowCount;
+    }
+    --window->inFlight;
+    --_size;
+    return window;
+}
+
+uint64_t PromiseTable::claimOccupied(Slot &slot)
+{
+    auto state = slot.state.load(std::memory_order_acquire);
+    while(state) {
+        if(state & Busy) {
+            std::this_thread::yield();
+            state = slot.state.load(std::memory_order_acquire);
+        } else if(slot.state.compare_exchange_weak(state, state | Busy, std::memory_order_acquire)) {
+            return state;
+        }
+    }
+    return 0;
+}
+
+template<typename Predicate>
+std::vector<PendingInvoke> PromiseTable::takeMatching(Predicate matches)
+{
+    std::vector<PendingInvoke> taken;
+    for(size_t i = 0; i <= _mask; ++i) {
+        auto &slot = _slots[i];
+        const auto state = claimOccupied(slot);
+        if(!state) {
+            continue;
+        }
+        if(matches(slot.connectionHandle)) {
+            taken.emplace_back(std::move(slot.invoke));
+            slot.invoke = {};
+            --slot.window->inFlight;
+            slot.window.reset();
+            slot.state.store(0, std::memory_order_release);
+            --_size;
+        } else {
+            slot.state.store(state, std::memory_order_release);
+        }
+    }
+    std::lock_guard guard(_overflowMutex);
+    for(auto i = _overflow.begin(); i != _overflow.end();) {
+        if(matches(i->second.connectionHandle)) {
+            taken.emplace_back(std::move(i->second.invoke));
+            --i->second.window->inFlight;
+            i = _overflow.erase(i);
+            --_overflowCount;
+            --_size;
+        } else {
+            ++i;
+        }
+    }
+    return taken;
+}
+
+std::vector<PendingInvoke> PromiseTable::takeConnection(Handle connectionHandle)
+{
+    // Closed first, so that nothing new is filed for it while the old invokes are swept up
+    {
+        std::lock_guard guard(_windowsMutex);
+        const auto i = _windows.find(connectionHandle);
+        if(i != _windows.end()) {
+            i->second->open = false;
+            _windows.erase(i);
+            publishWindows(guard);
+        }
+    }
+    return takeMatching([connectionHandle](Handle handle) { return handle == connectionHandle; });
+}
+
+std::vector<PendingInvoke> PromiseTable::takeAll()
+{
+    return takeMatching([](Handle) { return true; });
+}
+
+void PromiseTable::closeAll()
+{
+    std::lock_guard guard(_windowsMutex);
+    for(auto &i : _windows) {
+        i.second->open = false;
+    }
+    _windows.clear();
+    publishWindows(guard);
+}
@@ -0,0 +1,149 @@
+// Copyright Twitch Interactive, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "DeleteConstructors.h"
+#include "IConnection.h"
+#include "PublishedTransport.h"
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace Twitch::IPC {
+// An invoke waiting for its result, with when it was sent so the round trip can be measured
+struct PendingInvoke {
+    IConnection::PromiseCallback callback;
+    std::chrono::steady_clock::time_point sent;
+    // Run wherever the invoke is taken from the table instead of on the dispatch thread. Only for
+    // callbacks that just hand the result on, like the ones behind invokeAsync.
+    bool direct = false;
+};
+
+// The invokes waiting on a result, by promise id. Promise ids come out of getNextHandle in sequence,
+// so each one gets the slot its low bits pick and nothing else is touched on the way in or out: adding
+// and completing an invoke are one compare-exchange and one store on that slot. An id whose slot is
+// still held by a much older invoke goes to a mutex-guarded map instead.
+//
+// Each connection also has a window that counts its invokes in flight, which can be capped. Windows are
+// opened when a connection comes up and closed when it goes, so invokes to any other handle fail.
+// Callers hand insert the window itself, which a client keeps from openConnection and a server looks
+// up with windowFor in a published copy of the table, so filing an invoke takes no lock either way.
+class PromiseTable {
+public:
+    static constexpr size_t DefaultCapacity = 4096;
+
+    struct Window {
+        std::atomic<size_t> inFlight{0};
+        std::atomic<Handle> lastAnswered{0};
+        // Cleared when the connection goes, for callers still holding the window
+        std::atomic<bool> open{true};
+    };
+
+    explicit PromiseTable(size_t capacity = DefaultCapacity);
+    DELETE_COPY_AND_MOVE_CONSTRUCTORS(PromiseTable);
+
+    // Caps how many invokes each connection can have in flight. 0 means no limit.
+    void setWindow(size_t maxInFlight)
+    {
+        _maxInFlight = maxInFlight;
+    }
+    // Lets invokes be filed for `connectionHandle` until takeConnection or closeAll, and returns its window
+    std::shared_ptr<Window> openConnection(Handle connectionHandle);
+    // The window of `connectionHandle`, or null if it isn't open. Takes no lock.
+    std::shared_ptr<Window> windowFor(Handle connectionHandle);
+    // Files the invoke in `window`, the one of `connectionHandle`, and returns Good. Returns
+    // RemoteDisconnect if the window is null or closed, or WindowFull if it is full, and then leaves
+    // `invoke` as it was.
+    InvokeResultCode insert(Handle promiseId,
+        Handle connectionHandle,
+        const std::shared_ptr<Window> &window,
+        PendingInvoke &&invoke);
+    // Moves the invoke for `promiseId` into `invoke` if it is waiting and was sent to `connectionHandle`
+    bool take(Handle promiseId, Handle connectionHandle, PendingInvoke &invoke);
+    // Like take, for an invoke the peer answered. Counts it as reordered if a later invoke on the same
+    // connection was answered first.
+    bool takeAnswered(Handle promiseId, Handle connectionHandle, PendingInvoke &invoke);
+    // Removes and returns every invoke sent to `connectionHandle`, and forgets its window
+    std::vector<PendingInvoke> takeConnection(Handle connectionHandle);
+    std::vector<PendingInvoke> takeAll();
+    // Forgets every window, for when all connections went at once
+    void closeAll();
+    [[nodiscard]] size_t size() const
+    {
+        return _size.load(std::memory_order_relaxed);
+    }
+    // The most invokes any one connection has had in flight
+    [[nodiscard]] size_t peakInFlight() const
+    {
+        return _peakInFlight.load(std::memory_order_relaxed);
+    }
+    [[nodiscard]] uint64_t rejected() const
+    {
+        return _rejected.load(std::memory_order_relaxed);
+    }
+    [[nodiscard]] uint64_t reordered() const
+    {
+        return _reordered.load(std::memory_order_relaxed);
+    }
+
+private:
+    // A slot's state is 0 when empty, otherwise the promise id shifted up by one with the low bit set
+    // while a thread has the slot to itself to fill or empty it
+    static constexpr uint64_t Busy = 1;
+    // An answered id up to this far behind the latest one answered is older than it; anything further
+    // back has rolled over. About half of what getNextHandle hands out before rolling over.
+    static constexpr Handle ReorderHorizon = 0x20000000;
+
+    struct Slot {
+        std::atomic<uint64_t> state{0};
+        Handle connectionHandle{};
+        PendingInvoke invoke;
+        std::shared_ptr<Window> window;
+    };
+
+    static uint64_t readyState(Handle promiseId)
+    {
+        return static_cast<uint64_t>(promiseId) << 1;
+    }
+    Slot &slotFor(Handle promiseId)
+    {
+        return _slots[promiseId & _mask];
+    }
+    // Spins past anyone filling or emptying the slot, then claims it if it is still occupied
+    static uint64_t claimOccupied(Slot &slot);
+    template<typename Predicate>
+    std::vector<PendingInvoke> takeMatching(Predicate matches);
+    void publishWindows(const std::lock_guard<std::mutex> &);
+    // Returns the window the invoke was counted in, or null if it wasn't waiting
+    std::shared_ptr<Window> takeInvoke(Handle promiseId, Handle connectionHandle, PendingInvoke &invoke);
+
+    std::unique_ptr<Slot[]> _slots;
+    size_t _mask;
+    std::atomic<size_t> _size{0};
+
+    struct OverflowEntry {
+        Handle connectionHandle;
+        PendingInvoke invoke;
+        std::shared_ptr<Window> window;
+    };
+    std::mutex _overflowMutex;
+    std::unordered_map<Handle, OverflowEntry> _overflow;
+    // Lets take skip the mutex while the map is empty, which is almost always
+    std::atomic<size_t> _overflowCount{0};
+
+    std::atomic<size_t> _maxInFlight{0};
+    using Windows = std::unordered_map<Handle, std::shared_ptr<Window>>;
+    // Changed under the mutex, then copied and published for windowFor
+    std::mutex _windowsMutex;
+    Windows _windows;
+    std::unique_ptr<const Windows> _windowsSnapshot;
+    PublishedTransport<const Windows> _publishedWindows;
+    std::atomic<size_t> _peakInFlight{0};
+    std::atomic<uint64_t> _rejected{0};
+    std::atomic<uint64_t> _reordered{0};
+};
+} // namespace Twitch::IPC
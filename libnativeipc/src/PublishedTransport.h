@@ -0,0 +1,96 @@
+// Copyright Twitch Interactive, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "DeleteConstructors.h"
+#include <atomic>
+#include <cstddef>
+#include <thread>
+
+namespace Twitch::IPC {
+// Lets senders reach a connection's transport without taking _transportMutex. Senders register
+// before loading the pointer, and retract clears it and then waits for the registered ones to leave,
+// so the transport can be destroyed as soon as retract returns. The same handshake guards
+// UVTransportBase::wakeLoop, and UVTransportBase swaps its table of write budgets through replace.
+//
+// Senders register in one of several counters, each on a cache line of its own and picked per thread,
+// so senders on different threads don't pass one line back and forth. A sender that registers after
+// retract has looked at its counter finds the pointer already cleared.
+template<typename Transport>
+class PublishedTransport {
+public:
+    // Keeps the transport alive for as long as it is held. Holders must not block or call back into
+    // anything that could retract it.
+    class Ref {
+    public:
+        explicit Ref(PublishedTransport &owner)
+            : _users(owner._users[threadSlot()].count)
+        {
+            ++_users;
+            _transport = owner._transport.load();
+        }
+        ~Ref()
+        {
+            --_users;
+        }
+        DELETE_COPY_AND_MOVE_CONSTRUCTORS(Ref);
+
+        explicit operator bool() const
+        {
+            return _transport != nullptr;
+        }
+        Transport *operator->() const
+        {
+            return _transport;
+        }
+
+    private:
+        std::atomic<int> &_users;
+        Transport *_transport;
+    };
+
+    PublishedTransport() = default;
+    DELETE_COPY_AND_MOVE_CONSTRUCTORS(PublishedTransport);
+
+    Ref acquire()
+    {
+        return Ref(*this);
+    }
+    void publish(Transport *transport)
+    {
+        _transport = transport;
+    }
+    void retract()
+    {
+        replace(nullptr);
+    }
+    // Publishes `transport` in place of the current one, which nobody holds any more once this returns
+    void replace(Transport *transport)
+    {
+        _transport = transport;
+        for(auto &users : _users) {
+            while(users.count) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+private:
+    static constexpr size_t SlotCount = 16;
+    struct alignas(64) Users {
+        std::atomic<int> count{0};
+    };
+
+    // Threads take the slots in turn as they first send, so up to SlotCount senders never share one
+    static size_t threadSlot()
+    {
+        static std::atomic<size_t> nextSlot{0};
+        thread_local const size_t slot = nextSlot++ % SlotCount;
+        return slot;
+    }
+
+    std::atomic<Transport *> _transport{nullptr};
+    Users _users[SlotCount];
+};
+} // namespace Twitch::IPC
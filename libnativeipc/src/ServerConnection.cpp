@@ -4,6 +4,8 @@
 #include "ServerConnection.h"
 #include "ClientConnection.h"
 #include "LogMacrosWithHandle.h"
+#include "ShardedServerTransport.h"
+#include <algorithm>
 
 using namespace Twitch::IPC;
 
@@ -23,15 +25,30 @@ ServerConnection::~ServerConnection()
     {
         std::lock_guard guard(_transportMutex);
         _shuttingDown = true;
+        _sendTransport.retract();
     }
     _outputQueue.stop();
+    _methods.stop();
     _transport.reset();
+    // Nothing else is left to complete the futures still waiting
+    auto invokes = _promises.takeAll();
+    failDirectInvokes(invokes, InvokeResultCode::LocalDisconnect);
 }
 
 void ServerConnection::connect()
 {
     LOG_INFO(0, "`connect`");
+    start(true);
+}
+
+void ServerConnection::connectAsync()
+{
+    LOG_INFO(0, "`connectAsync`");
+    start(false);
+}
 
+void ServerConnection::start(bool wait)
+{
     if (_endpoint.empty()) {
         LOG_ERROR(0, "No endpoint specified.");
         return;
@@ -48,25 +65,29 @@ void ServerConnection::connect()
         return;
     }
 
-    _transport = _factory->makeServerProtocol(_latestConnectionOnly, _allowMultiuserAccess);
+    _transport = makeTransport();
     _transport->onData([this](Handle connectionHandle, Handle handle, Payload data) {
         handleData(connectionHandle, handle, std::move(data));
     });
+    _transport->onSharedData([this](Handle connectionHandle, SharedPayload data) {
+        handleSharedData(connectionHandle, std::move(data));
+    });
+    _transport->onChunk([this](Handle connectionHandle, Handle streamId, Payload chunk, bool last) {
+        handleChunk(connectionHandle, streamId, std::move(chunk), last);
+    });
+    _transport->onLatest([this](Handle connectionHandle, uint32_t channel, Payload value) {
+        handleLatest(connectionHandle, channel, std::move(value));
+    });
     _transport->onNoInvokeClientHandler([this](Handle connectionHandle, Handle promiseId) {
-        std::unique_lock guard(_callbacksMutex);
-        auto i = _callbacks.find(connectionHandle);
-        if(i != _callbacks.end()) {
-            auto &callbacks = i->second;
-            auto j = callbacks.find(promiseId);
-            if (j != callbacks.end()) {
-                auto cb = std::move(j->second);
-                callbacks.erase(j);
-                guard.unlock();
-                LOG_DEBUG(connectionHandle, "Rejecting invoke for missing client");
-                cb(InvokeResultCode::RemoteDisconnect, {});
-            }
+        PendingInvoke invoke;
+        if(_promises.take(promiseId, connectionHandle, invoke)) {
+            LOG_DEBUG(connectionHandle, "Rejecting invoke for missing client");
+            invoke.callback(InvokeResultCode::RemoteDisconnect, {});
         }
     });
+    _transport->onInvokeTimeout([this](Handle connectionHandle, Handle promiseId) {
+        handleInvokeTimeout(connectionHandle, promiseId);
+    });
     _transport->onConnect([this](Handle connectionHandle) {
         LOG_INFO(connectionHandle, "`onConnect` called");
         handleRemoteConnected(connectionHandle);
@@ -80,13 +101,44 @@ void ServerConnection::connect()
             handleLog(handle, level, std::move(message), "transport");
         },
         _logLevel);
+    _transport->onBackpressure([this](Handle connectionHandle) { handleBackpressure(connectionHandle, true); });
+    _transport->onWritable([this](Handle connectionHandle) { handleBackpressure(connectionHandle, false); });
+    _transport->setWriteBatchLimits(_writeBatchMaxBytes, _writeBatchMaxMessages);
+    _transport->setWriteQueueLimits(_writeQueueMaxBytes, _writeQueueMaxMessages);
+    _transport->setCompressionThreshold(_compressionThreshold);
+    _transport->setMaxFrameSize(_maxFrameSize);
+    _transport->setCounters(_counters);
+    // Published first so that handlers running as soon as it listens can already send
+    _sendTransport.publish(_transport.get());
+    if(!wait) {
+        _transport->onError([this](Handle) {
+            LOG_ERROR(0, "Failed to start server");
+            handleError(0);
+        });
+        _transport->listenAsync(_endpoint);
+        return;
+    }
     if(!_transport->listen(_endpoint)) {
         LOG_ERROR(0, "Failed to start server");
+        _sendTransport.retract();
         _transport.reset();
         handleError(0);
     }
 }
 
+std::unique_ptr<IServerTransport> ServerConnection::makeTransport() const
+{
+    std::vector<std::unique_ptr<IServerTransport>> shards;
+    while(shards.empty() || shards.size() < _ioThreads) {
+        shards.emplace_back(_factory->makeServerProtocol(_latestConnectionOnly, _allowMultiuserAccess));
+        shards.back()->setLoopThread(_factory->nextLoopThread());
+    }
+    if(shards.size() == 1) {
+        return std::move(shards.front());
+    }
+    return std::make_unique<ShardedServerTransport>(std::move(shards));
+}
+
 void ServerConnection::disconnect()
 {
     LOG_INFO(0, "`disconnect`");
@@ -94,87 +146,272 @@ void ServerConnection::disconnect()
     if (_shuttingDown) {
         return;
     }
-    _transport.reset();
-    
-    decltype(_callbacks) callbacks;
-    {
-        std::lock_guard callbackGuard(_callbacksMutex);
-        callbacks.swap(_callbacks);
-    }
+    // Once no sender has it, destroyed outside the lock: with inline dispatch the loop thread may be
+    // waiting for it to send
+    _sendTransport.retract();
+    auto transport = std::move(_transport);
+
+    auto invokes = _promises.takeAll();
+    _promises.closeAll();
     guard.unlock();
-    for (auto &client_callback : callbacks) {
-        for (auto &cb : client_callback.second) {
-            cb.second(InvokeResultCode::LocalDisconnect, {});
-        }
+    transport.reset();
+    for (auto &invoke : invokes) {
+        invoke.callback(InvokeResultCode::LocalDisconnect, {});
     }
 }
 
 int ServerConnection::activeConnections()
 {
-    std::lock_guard guard(_transportMutex);
-    if (_transport && !_shuttingDown) {
-        return _transport->activeConnections();
+    if(auto transport = _sendTransport.acquire()) {
+        return transport->activeConnections();
     }
     return 0;
 }
 
 void ServerConnection::broadcast(Payload message)
 {
-    std::lock_guard guard(_transportMutex);
-    if (_transport && !_shuttingDown) {
-        _transport->broadcast(std::move(message));
+    if(auto transport = _sendTransport.acquire()) {
+        transport->broadcast(std::move(message));
+    }
+}
+
+void ServerConnection::publish(const std::string &topic, Payload message)
+{
+    if(auto transport = _sendTransport.acquire()) {
+        transport->publish(topic, std::move(message));
     }
 }
 
 void ServerConnection::send(Handle connectionHandle, Payload message)
 {
     LOG_DEBUG(connectionHandle, "Sending message of length " + std::to_string(message.size()));
-    std::lock_guard guard(_transportMutex);
-    if (_transport && !_shuttingDown) {
-        _transport->send(connectionHandle, 0, std::move(message));
+    if(auto transport = _sendTransport.acquire()) {
+        transport->send(connectionHandle, 0, std::move(message));
     }
 }
 
+void ServerConnection::send(Handle connectionHandle, Payload message, Priority priority)
+{
+    LOG_DEBUG(connectionHandle, "Sending message of length " + std::to_string(message.size()));
+    if(auto transport = _sendTransport.acquire()) {
+        transport->sendWithPriority(connectionHandle, 0, std::move(message), priority, {});
+    }
+}
+
+bool ServerConnection::trySend(Handle connectionHandle, Payload message)
+{
+    auto transport = _sendTransport.acquire();
+    return transport && transport->trySend(connectionHandle, 0, std::move(message));
+}
+
+bool ServerConnection::sendShared(Handle connectionHandle, NativeHandle handle, size_t size)
+{
+    LOG_DEBUG(connectionHandle, "Sending shared payload of length " + std::to_string(size));
+    auto transport = _sendTransport.acquire();
+    return transport && transport->sendShared(connectionHandle, handle, size);
+}
+
+Handle ServerConnection::openStream()
+{
+    return getNextHandle();
+}
+
+bool ServerConnection::sendChunk(Handle connectionHandle, Handle streamId, Payload chunk, bool last)
+{
+    LOG_DEBUG(connectionHandle,
+        "Sending chunk of stream " + std::to_string(streamId) + " of length " + std::to_string(chunk.size()));
+    auto transport = _sendTransport.acquire();
+    return transport && transport->sendChunk(connectionHandle, streamId, std::move(chunk), last);
+}
+
+bool ServerConnection::sendLatest(Handle connectionHandle, uint32_t channel, Payload value)
+{
+    LOG_DEBUG(connectionHandle,
+        "Sending latest value of channel " + std::to_string(channel) + " of length " + std::to_string(value.size()));
+    auto transport = _sendTransport.acquire();
+    return transport && transport->sendLatest(connectionHandle, channel, std::move(value));
+}
+
 Handle ServerConnection::invoke(Handle connectionHandle, Payload message)
 {
     LOG_DEBUG(connectionHandle, "Sending invoke of length " + std::to_string(message.size()));
     const auto promiseId = getNextHandle();
-    std::lock_guard guard(_transportMutex);
-    if (_transport && !_shuttingDown) {
-        _transport->send(connectionHandle, promiseId, std::move(message));
+    if(auto transport = _sendTransport.acquire()) {
+        transport->send(connectionHandle, promiseId, std::move(message));
     }
     return promiseId;
 }
 
 void ServerConnection::invoke(Handle connectionHandle, Payload message, PromiseCallback onResult)
+{
+    invoke(connectionHandle, std::move(message), std::move(onResult), std::chrono::milliseconds::zero());
+}
+
+void ServerConnection::invoke(Handle connectionHandle,
+    Payload message,
+    PromiseCallback onResult,
+    std::chrono::milliseconds timeout)
 {
     LOG_DEBUG(connectionHandle, "Sending invoke of length " + std::to_string(message.size()));
-    const auto promiseId = getNextHandle();
-    std::unique_lock guard(_transportMutex);
-    if (_transport && !_shuttingDown) {
-        {
-            std::lock_guard callbackGuard(_callbacksMutex);
-            _callbacks[connectionHandle][promiseId] = std::move(onResult);
-        }
-        _transport->send(connectionHandle, promiseId, std::move(message));
-    } else if (!_shuttingDown) {
-        guard.unlock();
-        onResult(InvokeResultCode::LocalDisconnect, {});
+    PendingInvoke invoke;
+    invoke.callback = std::move(onResult);
+    const auto resultCode = queueInvoke(connectionHandle, getNextHandle(), std::move(message), invoke, timeout);
+    if(resultCode == InvokeResultCode::Good || (resultCode == InvokeResultCode::LocalDisconnect && _shuttingDown)) {
+        return;
     }
+    // Outside queueInvoke, which holds the transport, in case the callback disconnects
+    invoke.callback(resultCode, {});
+}
+
+void ServerConnection::invoke(Handle connectionHandle, Payload message, PromiseCallback onResult, Priority priority)
+{
+    LOG_DEBUG(connectionHandle, "Sending invoke of length " + std::to_string(message.size()));
+    PendingInvoke invoke;
+    invoke.callback = std::move(onResult);
+    const auto resultCode = queueInvoke(
+        connectionHandle, getNextHandle(), std::move(message), invoke, std::chrono::milliseconds::zero(), priority);
+    if(resultCode == InvokeResultCode::Good || (resultCode == InvokeResultCode::LocalDisconnect && _shuttingDown)) {
+        return;
+    }
+    invoke.callback(resultCode, {});
+}
+
+InvokeFuture ServerConnection::invokeAsync(Handle connectionHandle, Payload message, std::chrono::milliseconds timeout)
+{
+    LOG_DEBUG(connectionHandle, "Sending invoke of length " + std::to_string(message.size()));
+    auto state = std::make_shared<InvokeFuture::State>();
+    auto invoke = asyncInvoke(state);
+    const auto resultCode = queueInvoke(connectionHandle, getNextHandle(), std::move(message), invoke, timeout);
+    if(resultCode != InvokeResultCode::Good) {
+        state->complete(resultCode, {});
+    }
+    return InvokeFuture(std::move(state));
+}
+
+InvokeResult ServerConnection::invokeBlocking(Handle connectionHandle, Payload message, std::chrono::milliseconds timeout)
+{
+    return waitBlocking(invokeAsync(connectionHandle, std::move(message), timeout));
+}
+
+InvokeResultCode ServerConnection::queueInvoke(Handle connectionHandle,
+    Handle promiseId,
+    Payload message,
+    PendingInvoke &invoke,
+    std::chrono::milliseconds timeout,
+    Priority priority)
+{
+    auto transport = _sendTransport.acquire();
+    if(!transport) {
+        return InvokeResultCode::LocalDisconnect;
+    }
+    if(!transport->fitsPeer(connectionHandle, message.size())) {
+        return InvokeResultCode::FrameTooLarge;
+    }
+    invoke.sent = std::chrono::steady_clock::now();
+    const auto deadline = invoke.sent + timeout;
+    const auto filed =
+        _promises.insert(promiseId, connectionHandle, _promises.windowFor(connectionHandle), std::move(invoke));
+    if(filed != InvokeResultCode::Good) {
+        return filed;
+    }
+    if(priority != Priority::Normal) {
+        const auto timesOut = timeout > std::chrono::milliseconds::zero();
+        transport->sendWithPriority(connectionHandle,
+            promiseId,
+            std::move(message),
+            priority,
+            timesOut ? deadline : std::chrono::steady_clock::time_point{});
+    } else if(timeout > std::chrono::milliseconds::zero()) {
+        transport->sendInvoke(connectionHandle, promiseId, std::move(message), deadline);
+    } else {
+        transport->send(connectionHandle, promiseId, std::move(message));
+    }
+    return InvokeResultCode::Good;
 }
 
 void ServerConnection::sendResult(Handle connectionHandle, Handle promiseId, Payload message)
 {
     LOG_DEBUG(connectionHandle, "Sending invoke result of length " + std::to_string(message.size()));
-    std::lock_guard guard(_transportMutex);
-    if (_transport && !_shuttingDown) {
-        _transport->send(connectionHandle, promiseId | ResponseFlag, std::move(message));
+    if(auto transport = _sendTransport.acquire()) {
+        transport->send(connectionHandle, promiseId | ResponseFlag, std::move(message));
+    }
+}
+
+void ServerConnection::send(Handle connectionHandle, std::vector<Payload> messages)
+{
+    LOG_DEBUG(connectionHandle, "Sending " + std::to_string(messages.size()) + " messages");
+    if(auto transport = _sendTransport.acquire()) {
+        transport->sendMany(connectionHandle, {}, std::move(messages));
+    }
+}
+
+std::vector<Handle> ServerConnection::invokeMany(Handle connectionHandle, std::vector<Payload> messages)
+{
+    LOG_DEBUG(connectionHandle, "Sending " + std::to_string(messages.size()) + " invokes");
+    std::vector<Handle> promiseIds(messages.size());
+    for(auto &promiseId : promiseIds) {
+        promiseId = getNextHandle();
+    }
+    if(auto transport = _sendTransport.acquire()) {
+        transport->sendMany(connectionHandle, promiseIds, std::move(messages));
+    }
+    return promiseIds;
+}
+
+void ServerConnection::invokeMany(Handle connectionHandle, std::vector<Payload> messages, BatchPromiseCallback onResult)
+{
+    LOG_DEBUG(connectionHandle, "Sending " + std::to_string(messages.size()) + " invokes");
+    std::vector<Handle> promiseIds(messages.size());
+    for(auto &promiseId : promiseIds) {
+        promiseId = getNextHandle();
+    }
+    // Every promise of the batch shares the one callback
+    const auto shared = std::make_shared<BatchPromiseCallback>(std::move(onResult));
+    std::vector<size_t> rejected;
+    std::vector<InvokeResultCode> failures;
+    {
+        auto transport = _sendTransport.acquire();
+        if(transport) {
+            const auto sent = std::chrono::steady_clock::now();
+            const auto window = _promises.windowFor(connectionHandle);
+            for(size_t i = 0; i < promiseIds.size(); ++i) {
+                PendingInvoke invoke;
+                invoke.callback = [shared, i](InvokeResultCode resultCode, Payload result) {
+                    (*shared)(i, resultCode, std::move(result));
+                };
+                invoke.sent = sent;
+                const auto filed = transport->fitsPeer(connectionHandle, messages[i].size())
+                    ? _promises.insert(promiseIds[i], connectionHandle, window, std::move(invoke))
+                    : InvokeResultCode::FrameTooLarge;
+                if(filed != InvokeResultCode::Good) {
+                    rejected.push_back(i);
+                    failures.push_back(filed);
+                }
+            }
+            dropRejected(rejected, promiseIds, messages);
+            if(!promiseIds.empty()) {
+                transport->sendMany(connectionHandle, promiseIds, std::move(messages));
+            }
+        } else if(_shuttingDown) {
+            return;
+        } else {
+            rejected.resize(messages.size());
+            failures.assign(messages.size(), InvokeResultCode::LocalDisconnect);
+            for(size_t i = 0; i < rejected.size(); ++i) {
+                rejected[i] = i;
+            }
+        }
+    }
+    // Let go of the transport first, in case the callback disconnects
+    for(size_t i = 0; i < rejected.size(); ++i) {
+        (*shared)(rejected[i], failures[i], {});
     }
 }
 
 void ServerConnection::handleRemoteConnected(Handle handle)
 {
-    _outputQueue.enqueue([this, handle] {
+    _promises.openConnection(handle);
+    _outputQueue.enqueue(handle, [this, handle] {
         if(_connectHandler) {
             _connectHandler(handle);
         }
@@ -184,18 +421,11 @@ void ServerConnection::handleRemoteConnected(Handle handle)
 void ServerConnection::handleRemoteDisconnected(Handle handle)
 {
     // Remove any lingering invoke callbacks for this connection
-    std::unordered_map<Handle, PromiseCallback> expiredInvokeCallbacks;
-    {
-        std::unique_lock guard(_callbacksMutex);
-        auto callbacks = _callbacks.find(handle);
-        if (callbacks != _callbacks.end()) {
-            expiredInvokeCallbacks.swap(callbacks->second);
-            _callbacks.erase(callbacks);
-        }
-    }
-    _outputQueue.enqueue([this, handle, expiredInvokeCallbacks = std::move(expiredInvokeCallbacks)] {
-        for (auto &cb : expiredInvokeCallbacks) {
-            cb.second(InvokeResultCode::RemoteDisconnect, {});
+    auto expiredInvokes = _promises.takeConnection(handle);
+    failDirectInvokes(expiredInvokes, InvokeResultCode::RemoteDisconnect);
+    _outputQueue.enqueue(handle, [this, handle, expiredInvokes = std::move(expiredInvokes)]() mutable {
+        for (auto &invoke : expiredInvokes) {
+            invoke.callback(InvokeResultCode::RemoteDisconnect, {});
         }
         if(_disconnectHandler) {
             _disconnectHandler(handle);
@@ -205,37 +435,18 @@ void ServerConnection::handleRemoteDisconnected(Handle handle)
 
 void ServerConnection::handleData(Handle connectionHandle, Handle handle, Payload message)
 {
-    _outputQueue.enqueue([this, connectionHandle, handle, message = std::move(message)]() mutable {
+    if(handle & ResponseFlag) {
+        handleResult(connectionHandle, handle & ~ResponseFlag, std::move(message));
+        return;
+    }
+    if(handle && _methods.route(connectionHandle, handle, message, _outputQueue)) {
+        return;
+    }
+    _outputQueue.enqueue(connectionHandle, [this, connectionHandle, handle, message = std::move(message)]() mutable {
         if(!handle) {
             if(_receivedHandler) {
                 _receivedHandler(connectionHandle, std::move(message));
             }
-        } else if(handle & ResponseFlag) {
-            const auto promiseId = handle & ~ResponseFlag;
-            {
-                std::unique_lock guard(_callbacksMutex);
-                auto &callbacks = _callbacks[connectionHandle];
-                auto i = callbacks.find(promiseId);
-                if(i != callbacks.end()) {
-                    auto cb = std::move(i->second);
-                    callbacks.erase(i);
-                    guard.unlock();
-                    LOG_DEBUG(connectionHandle,
-                        "Processing invoke result " + std::to_string(promiseId) + " of length " +
-                            std::to_string(message.size()));
-                    cb(InvokeResultCode::Good, std::move(message));
-                    return;
-                }
-            }
-            if(_resultHandler) {
-                LOG_DEBUG(connectionHandle,
-                    "Processing invoke result " + std::to_string(promiseId) + " of length " +
-                        std::to_string(message.size()) + "with global handler");
-                _resultHandler(connectionHandle, promiseId, std::move(message));
-            } else {
-                LOG_DEBUG(connectionHandle,
-                    "Could not process invoke result " + std::to_string(promiseId));
-            }
         } else if(_invokedPromiseIdHandler || _invokedImmediateHandler || _invokedCallbackHandler) {
             auto promiseId = handle;
             LOG_DEBUG(connectionHandle,
@@ -248,34 +459,124 @@ void ServerConnection::handleData(Handle connectionHandle, Handle handle, Payloa
                 LOG_DEBUG(connectionHandle,
                     "Sending invoke result " + std::to_string(promiseId) + " of length " +
                         std::to_string(result.size()));
-                std::lock_guard guard(_transportMutex);
-                if (_transport && !_shuttingDown) {
-                    _transport->send(connectionHandle, promiseId | ResponseFlag, std::move(result));
+                if(auto transport = _sendTransport.acquire()) {
+                    transport->send(connectionHandle, promiseId | ResponseFlag, std::move(result));
                 }
             } else {
-                _invokedCallbackHandler(connectionHandle,
-                    std::move(message),
-                    [this, connectionHandle, promiseId, shieldLocker = std::weak_ptr<int>(_lambdaShield)](Payload result) {
-                        auto lock = shieldLocker.lock();
-                        if (lock) {
-                            LOG_DEBUG(connectionHandle,
-                                      "Sending invoke result " + std::to_string(promiseId) + " of length " +
-                                      std::to_string(result.size()));
-                            std::lock_guard guard(_transportMutex);
-                            if (_transport && !_shuttingDown) {
-                                _transport->send(
-                                        connectionHandle, promiseId | ResponseFlag, std::move(result));
-                            }
-                        }
-                    });
+                _invokedCallbackHandler(connectionHandle, std::move(message), resultCallback(connectionHandle, promiseId));
+            }
+        }
+    });
+}
+
+IServerConnection::ResultCallback ServerConnection::resultCallback(Handle connectionHandle, Handle promiseId)
+{
+    return [this, connectionHandle, promiseId, shieldLocker = std::weak_ptr<int>(_lambdaShield)](Payload result) {
+        auto lock = shieldLocker.lock();
+        if (lock) {
+            LOG_DEBUG(connectionHandle,
+                      "Sending invoke result " + std::to_string(promiseId) + " of length " +
+                      std::to_string(result.size()));
+            if(auto transport = _sendTransport.acquire()) {
+                transport->send(connectionHandle, promiseId | ResponseFlag, std::move(result));
             }
         }
+    };
+}
+
+void ServerConnection::handleResult(Handle connectionHandle, Handle promiseId, Payload message)
+{
+    // Taken here on the I/O thread so that the futures of invokeAsync don't wait on the dispatch thread
+    PendingInvoke invoke;
+    if(_promises.takeAnswered(promiseId, connectionHandle, invoke)) {
+        LOG_DEBUG(connectionHandle,
+            "Processing invoke result " + std::to_string(promiseId) + " of length " +
+                std::to_string(message.size()));
+        if(invoke.direct) {
+            completeInvoke(invoke, std::move(message));
+        } else {
+            _outputQueue.enqueue(connectionHandle, [this, invoke = std::move(invoke), message = std::move(message)]() mutable {
+                completeInvoke(invoke, std::move(message));
+            });
+        }
+        return;
+    }
+    _outputQueue.enqueue(connectionHandle, [this, connectionHandle, promiseId, message = std::move(message)]() mutable {
+        if(_resultHandler) {
+            LOG_DEBUG(connectionHandle,
+                "Processing invoke result " + std::to_string(promiseId) + " of length " +
+                    std::to_string(message.size()) + "with global handler");
+            _resultHandler(connectionHandle, promiseId, std::move(message));
+        } else {
+            LOG_DEBUG(connectionHandle,
+                "Could not process invoke result " + std::to_string(promiseId));
+        }
+    });
+}
+
+void ServerConnection::handleSharedData(Handle connectionHandle, SharedPayload message)
+{
+    _outputQueue.enqueue(connectionHandle, [this, connectionHandle, message = std::move(message)]() mutable {
+        if(_receivedSharedHandler) {
+            _receivedSharedHandler(connectionHandle, std::move(message));
+        }
+    });
+}
+
+void ServerConnection::handleChunk(Handle connectionHandle, Handle streamId, Payload chunk, bool last)
+{
+    _outputQueue.enqueue(connectionHandle, [this, connectionHandle, streamId, chunk = std::move(chunk), last]() mutable {
+        if(_chunkHandler) {
+            _chunkHandler(connectionHandle, streamId, std::move(chunk), last);
+        }
+    });
+}
+
+void ServerConnection::handleLatest(Handle connectionHandle, uint32_t channel, Payload value)
+{
+    // Every client has channels of its own
+    const auto slot = (uint64_t{connectionHandle} << 32) | channel;
+    const bool replaced = _outputQueue.enqueueLatest(
+        connectionHandle, slot, [this, connectionHandle, channel, value = std::move(value)]() mutable {
+            if(_latestHandler) {
+                _latestHandler(connectionHandle, channel, std::move(value));
+            }
+        });
+    if(replaced) {
+        ++_counters->latestValuesReplaced;
+    }
+}
+
+void ServerConnection::handleBackpressure(Handle connectionHandle, bool blocked)
+{
+    _outputQueue.enqueue(connectionHandle, [this, connectionHandle, blocked] {
+        const auto &handler = blocked ? _backpressureHandler : _writableHandler;
+        if(handler) {
+            handler(connectionHandle);
+        }
+    });
+}
+
+void ServerConnection::handleInvokeTimeout(Handle connectionHandle, Handle promiseId)
+{
+    PendingInvoke invoke;
+    // Already answered, or failed by a disconnect
+    if(!_promises.take(promiseId, connectionHandle, invoke)) {
+        return;
+    }
+    LOG_DEBUG(connectionHandle, "Invoke " + std::to_string(promiseId) + " timed out");
+    if(invoke.direct) {
+        invoke.callback(InvokeResultCode::Timeout, {});
+        return;
+    }
+    _outputQueue.enqueue(connectionHandle, [invoke = std::move(invoke)]() mutable {
+        invoke.callback(InvokeResultCode::Timeout, {});
     });
 }
 
 void ServerConnection::handleError(Handle handle)
 {
-    _outputQueue.enqueue([this, handle] {
+    _outputQueue.enqueue(handle, [this, handle] {
         if(_errorHandler) {
             _errorHandler(handle);
         }
@@ -285,11 +586,11 @@ void ServerConnection::handleError(Handle handle)
 void ServerConnection::handleLog(
     Handle handle, LogLevel level, std::string message, std::string category)
 {
-    if(_logHandler && level >= _logLevel) {
-        _outputQueue.enqueue(
+    if(level >= _logLevel.load(std::memory_order_relaxed) && _logHandler) {
+        _outputQueue.enqueue(handle,
             [this, handle, level, message = std::move(message), category = std::move(category)]() {
                 // check again just in case this changed since we were enqueued
-                if(_logHandler && static_cast<int>(level) >= static_cast<int>(_logLevel)) {
+                if(level >= _logLevel.load(std::memory_order_relaxed) && _logHandler) {
                     _logHandler(handle, level, message, category);
                 }
             });
@@ -301,6 +602,21 @@ void ServerConnection::onReceived(OnDataHandler dataHandler)
     _receivedHandler = dataHandler;
 }
 
+void ServerConnection::onReceivedShared(OnSharedDataHandler dataHandler)
+{
+    _receivedSharedHandler = dataHandler;
+}
+
+void ServerConnection::onChunk(OnChunkHandler chunkHandler)
+{
+    _chunkHandler = chunkHandler;
+}
+
+void ServerConnection::onLatest(OnLatestHandler latestHandler)
+{
+    _latestHandler = latestHandler;
+}
+
 void ServerConnection::onInvoked(OnInvokedPromiseIdHandler dataHandler)
 {
     _invokedPromiseIdHandler = dataHandler;
@@ -327,6 +643,16 @@ void ServerConnection::onResult(OnResultHandler dataHandler)
     _resultHandler = dataHandler;
 }
 
+void ServerConnection::registerMethod(uint32_t methodId, OnInvokedCallbackHandler handler, MethodOptions options)
+{
+    _methods.add(
+        methodId,
+        [this, handler = std::move(handler)](Handle connectionHandle, Handle promiseId, Payload message) {
+            handler(connectionHandle, std::move(message), resultCallback(connectionHandle, promiseId));
+        },
+        options);
+}
+
 void ServerConnection::onConnect(OnHandler connectHandler)
 {
     _connectHandler = connectHandler;
@@ -342,6 +668,16 @@ void ServerConnection::onError(OnHandler errorHandler)
     _errorHandler = errorHandler;
 }
 
+void ServerConnection::onBackpressure(OnHandler backpressureHandler)
+{
+    _backpressureHandler = backpressureHandler;
+}
+
+void ServerConnection::onWritable(OnHandler writableHandler)
+{
+    _writableHandler = writableHandler;
+}
+
 void ServerConnection::onLog(OnLogHandler logHandler, LogLevel level)
 {
     // Set _logLevel if level is anything but None
@@ -361,3 +697,86 @@ void ServerConnection::setLogLevel(LogLevel level)
         _transport->setLogLevel(level);
     }
 }
+
+void ServerConnection::setWriteBatchLimits(size_t maxBytes, size_t maxMessages)
+{
+    std::lock_guard guard(_transportMutex);
+    _writeBatchMaxBytes = maxBytes;
+    _writeBatchMaxMessages = maxMessages;
+    if(_transport) {
+        _transport->setWriteBatchLimits(maxBytes, maxMessages);
+    }
+}
+
+void ServerConnection::setWriteQueueLimits(size_t maxBytes, size_t maxMessages)
+{
+    std::lock_guard guard(_transportMutex);
+    _writeQueueMaxBytes = maxBytes;
+    _writeQueueMaxMessages = maxMessages;
+    if(_transport) {
+        _transport->setWriteQueueLimits(maxBytes, maxMessages);
+    }
+}
+
+void ServerConnection::setCompressionThreshold(size_t minBytes)
+{
+    std::lock_guard guard(_transportMutex);
+    _compressionThreshold = minBytes;
+    if(_transport) {
+        _transport->setCompressionThreshold(minBytes);
+    }
+}
+
+void ServerConnection::setMaxFrameSize(size_t maxBytes)
+{
+    std::lock_guard guard(_transportMutex);
+    _maxFrameSize = maxBytes;
+    if(_transport) {
+        _transport->setMaxFrameSize(maxBytes);
+    }
+}
+
+void ServerConnection::setInvokeWindow(size_t maxInFlight)
+{
+    _promises.setWindow(maxInFlight);
+}
+
+void ServerConnection::setDispatchThreads(size_t threadCount)
+{
+    std::lock_guard guard(_transportMutex);
+    if(_transport) {
+        LOG_WARNING(0, "`setDispatchThreads` called after `connect`; ignoring");
+        return;
+    }
+    _outputQueue.setThreadCount(threadCount);
+}
+
+void ServerConnection::setInlineDispatch(bool runInline)
+{
+    std::lock_guard guard(_transportMutex);
+    if(_transport) {
+        LOG_WARNING(0, "`setInlineDispatch` called after `connect`; ignoring");
+        return;
+    }
+    _outputQueue.setInline(runInline);
+}
+
+void ServerConnection::setIOThreads(size_t threadCount)
+{
+    std::lock_guard guard(_transportMutex);
+    if(_transport) {
+        LOG_WARNING(0, "`setIOThreads` called after `connect`; ignoring");
+        return;
+    }
+#ifdef _WIN32
+    // Accepted sockets can't move between loops there
+    threadCount = 1;
+#endif
+    // The one client of a single connection server has nowhere to be spread
+    _ioThreads = _latestConnectionOnly ? 1 : std::max<size_t>(threadCount, 1);
+}
+
+ConnectionStats ServerConnection::stats()
+{
+    return collectStats(_outputQueue.backlog());
+}
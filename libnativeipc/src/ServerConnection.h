@@ -5,8 +5,9 @@
 
 #include "ConnectionBase.h"
 #include "IServerConnection.h"
+#include "MethodRouter.h"
 #include "OperationQueue.h"
-#include <unordered_map>
+#include "PublishedTransport.h"
 
 namespace Twitch::IPC {
 
@@ -19,38 +20,76 @@ public:
     DELETE_COPY_AND_MOVE_CONSTRUCTORS(ServerConnection);
 
     void connect() override;
+    void connectAsync() override;
     void disconnect() override;
 
     int activeConnections() override;
 
     void broadcast(Payload message) override;
+    void publish(const std::string &topic, Payload message) override;
     void send(Handle connectionHandle, Payload message) override;
+    void send(Handle connectionHandle, Payload message, Priority priority) override;
+    bool trySend(Handle connectionHandle, Payload message) override;
+    bool sendShared(Handle connectionHandle, NativeHandle handle, size_t size) override;
+    Handle openStream() override;
+    bool sendChunk(Handle connectionHandle, Handle streamId, Payload chunk, bool last) override;
+    bool sendLatest(Handle connectionHandle, uint32_t channel, Payload value) override;
     void invoke(Handle connectionHandle, Payload message, PromiseCallback onResult) override;
+    void invoke(Handle connectionHandle,
+        Payload message,
+        PromiseCallback onResult,
+        std::chrono::milliseconds timeout) override;
     Handle invoke(Handle connectionHandle, Payload message) override;
+    void invoke(Handle connectionHandle, Payload message, PromiseCallback onResult, Priority priority) override;
+    InvokeFuture invokeAsync(Handle connectionHandle, Payload message, std::chrono::milliseconds timeout) override;
+    InvokeResult invokeBlocking(Handle connectionHandle, Payload message, std::chrono::milliseconds timeout) override;
     void sendResult(Handle connectionHandle, Handle promiseId, Payload message) override;
+    void send(Handle connectionHandle, std::vector<Payload> messages) override;
+    void invokeMany(Handle connectionHandle, std::vector<Payload> messages, BatchPromiseCallback onResult) override;
+    std::vector<Handle> invokeMany(Handle connectionHandle, std::vector<Payload> messages) override;
 
     void onReceived(OnDataHandler dataHandler) override;
+    void onReceivedShared(OnSharedDataHandler dataHandler) override;
+    void onChunk(OnChunkHandler chunkHandler) override;
+    void onLatest(OnLatestHandler latestHandler) override;
     void onInvoked(OnInvokedPromiseIdHandler dataHandler) override;
     void onInvoked(OnInvokedImmediateHandler dataHandler) override;
     void onInvoked(OnInvokedCallbackHandler dataHandler) override;
     void onResult(OnResultHandler dataHandler) override;
+    void registerMethod(uint32_t methodId, OnInvokedCallbackHandler handler, MethodOptions options) override;
     void onConnect(OnHandler connectHandler) override;
     void onDisconnect(OnHandler disconnectHandler) override;
     void onError(OnHandler errorHandler) override;
+    void onBackpressure(OnHandler backpressureHandler) override;
+    void onWritable(OnHandler writableHandler) override;
     void onLog(OnLogHandler logHandler, LogLevel level) override;
     void setLogLevel(LogLevel level) override;
+    void setWriteBatchLimits(size_t maxBytes, size_t maxMessages) override;
+    void setWriteQueueLimits(size_t maxBytes, size_t maxMessages) override;
+    void setCompressionThreshold(size_t minBytes) override;
+    void setMaxFrameSize(size_t maxBytes) override;
+    void setInvokeWindow(size_t maxInFlight) override;
+    void setDispatchThreads(size_t threadCount) override;
+    void setInlineDispatch(bool runInline) override;
+    void setIOThreads(size_t threadCount) override;
+    ConnectionStats stats() override;
 
 protected:
-    LogLevel _logLevel = LogLevel::None;
+    std::atomic<LogLevel> _logLevel{LogLevel::None};
     OperationQueue _outputQueue;
+    MethodRouter _methods;
 
+    // Owned under _transportMutex; the send paths reach it through _sendTransport instead
     std::unique_ptr<IServerTransport> _transport;
-    std::unordered_map<Handle, std::unordered_map<Handle, PromiseCallback>> _callbacks;
-    std::mutex _callbacksMutex;
+    PublishedTransport<IServerTransport> _sendTransport;
     bool _latestConnectionOnly;
     bool _allowMultiuserAccess;
+    size_t _ioThreads = 1;
 
     OnDataHandler _receivedHandler;
+    OnSharedDataHandler _receivedSharedHandler;
+    OnChunkHandler _chunkHandler;
+    OnLatestHandler _latestHandler;
     OnInvokedPromiseIdHandler _invokedPromiseIdHandler;
     OnInvokedImmediateHandler _invokedImmediateHandler;
     OnInvokedCallbackHandler _invokedCallbackHandler;
@@ -58,12 +97,33 @@ protected:
     OnHandler _connectHandler;
     OnHandler _disconnectHandler;
     OnHandler _errorHandler;
+    OnHandler _backpressureHandler;
+    OnHandler _writableHandler;
     OnLogHandler _logHandler;
 
+    // Files `invoke` and sends the message, unless there is no transport to send it with or its window
+    // is full. Returns Good if it went out.
+    InvokeResultCode queueInvoke(Handle connectionHandle,
+        Handle promiseId,
+        Payload message,
+        PendingInvoke &invoke,
+        std::chrono::milliseconds timeout,
+        Priority priority = Priority::Normal);
+
+    std::unique_ptr<IServerTransport> makeTransport() const;
+    void start(bool wait);
+    // Sends the result of an invoke, for as long as the connection is around to send it
+    ResultCallback resultCallback(Handle connectionHandle, Handle promiseId);
     void handleError(Handle handle);
     void handleRemoteDisconnected(Handle handle);
     void handleRemoteConnected(Handle handle);
     void handleData(Handle connectionHandle, Handle handle, Payload message);
+    void handleResult(Handle connectionHandle, Handle promiseId, Payload message);
+    void handleSharedData(Handle connectionHandle, SharedPayload message);
+    void handleChunk(Handle connectionHandle, Handle streamId, Payload chunk, bool last);
+    void handleLatest(Handle connectionHandle, uint32_t channel, Payload value);
+    void handleBackpressure(Handle connectionHandle, bool blocked);
+    void handleInvokeTimeout(Handle connectionHandle, Handle promiseId);
     void handleLog(
         Handle handle, LogLevel level, std::string message, std::string category = DefaultCategory);
 };
@@ -20,6 +20,11 @@ void ServerConnectionSingle::connect()
     _connection.connect();
 }
 
+void ServerConnectionSingle::connectAsync()
+{
+    _connection.connectAsync();
+}
+
 void ServerConnectionSingle::disconnect()
 {
     _connection.disconnect();
@@ -32,6 +37,47 @@ void ServerConnectionSingle::send(Payload message)
     }
 }
 
+void ServerConnectionSingle::send(Payload message, Priority priority)
+{
+    if(_connectionHandle) {
+        _connection.send(_connectionHandle, std::move(message), priority);
+    }
+}
+
+bool ServerConnectionSingle::trySend(Payload message)
+{
+    return _connectionHandle && _connection.trySend(_connectionHandle, std::move(message));
+}
+
+bool ServerConnectionSingle::sendShared(NativeHandle handle, size_t size)
+{
+    return _connectionHandle && _connection.sendShared(_connectionHandle, handle, size);
+}
+
+Handle ServerConnectionSingle::openStream()
+{
+    return _connection.openStream();
+}
+
+bool ServerConnectionSingle::sendChunk(Handle streamId, Payload chunk, bool last)
+{
+    return _connectionHandle && _connection.sendChunk(_connectionHandle, streamId, std::move(chunk), last);
+}
+
+bool ServerConnectionSingle::sendLatest(uint32_t channel, Payload value)
+{
+    return _connectionHandle && _connection.sendLatest(_connectionHandle, channel, std::move(value));
+}
+
+void ServerConnectionSingle::subscribe(const std::string &)
+{
+    // Servers publish rather than subscribe
+}
+
+void ServerConnectionSingle::unsubscribe(const std::string &)
+{
+}
+
 Handle ServerConnectionSingle::invoke(Payload message)
 {
     if(_connectionHandle) {
@@ -47,6 +93,38 @@ void ServerConnectionSingle::invoke(Payload message, PromiseCallback onResult)
     }
 }
 
+void ServerConnectionSingle::invoke(Payload message, PromiseCallback onResult, std::chrono::milliseconds timeout)
+{
+    if(_connectionHandle) {
+        _connection.invoke(_connectionHandle, std::move(message), std::move(onResult), timeout);
+    }
+}
+
+void ServerConnectionSingle::invoke(Payload message, PromiseCallback onResult, Priority priority)
+{
+    if(_connectionHandle) {
+        _connection.invoke(_connectionHandle, std::move(message), std::move(onResult), priority);
+    }
+}
+
+InvokeFuture ServerConnectionSingle::invokeAsync(Payload message, std::chrono::milliseconds timeout)
+{
+    if(_connectionHandle) {
+        return _connection.invokeAsync(_connectionHandle, std::move(message), timeout);
+    }
+    auto state = std::make_shared<InvokeFuture::State>();
+    state->complete(InvokeResultCode::LocalDisconnect, {});
+    return InvokeFuture(std::move(state));
+}
+
+InvokeResult ServerConnectionSingle::invokeBlocking(Payload message, std::chrono::milliseconds timeout)
+{
+    if(_connectionHandle) {
+        return _connection.invokeBlocking(_connectionHandle, std::move(message), timeout);
+    }
+    return {InvokeResultCode::LocalDisconnect, {}};
+}
+
 void ServerConnectionSingle::sendResult(Handle connectionHandle, Handle promiseId, Payload message)
 {
     if(_connectionHandle && _connectionHandle == connectionHandle) {
@@ -54,11 +132,58 @@ void ServerConnectionSingle::sendResult(Handle connectionHandle, Handle promiseI
     }
 }
 
+void ServerConnectionSingle::send(std::vector<Payload> messages)
+{
+    if(_connectionHandle) {
+        _connection.send(_connectionHandle, std::move(messages));
+    }
+}
+
+void ServerConnectionSingle::invokeMany(std::vector<Payload> messages, BatchPromiseCallback onResult)
+{
+    if(_connectionHandle) {
+        _connection.invokeMany(_connectionHandle, std::move(messages), std::move(onResult));
+    }
+}
+
+std::vector<Handle> ServerConnectionSingle::invokeMany(std::vector<Payload> messages)
+{
+    if(_connectionHandle) {
+        return _connection.invokeMany(_connectionHandle, std::move(messages));
+    }
+    return std::vector<Handle>(messages.size());
+}
+
 void ServerConnectionSingle::setLogLevel(LogLevel level)
 {
     _connection.setLogLevel(level);
 }
 
+void ServerConnectionSingle::setWriteBatchLimits(size_t maxBytes, size_t maxMessages)
+{
+    _connection.setWriteBatchLimits(maxBytes, maxMessages);
+}
+
+void ServerConnectionSingle::setWriteQueueLimits(size_t maxBytes, size_t maxMessages)
+{
+    _connection.setWriteQueueLimits(maxBytes, maxMessages);
+}
+
+void ServerConnectionSingle::setCompressionThreshold(size_t minBytes)
+{
+    _connection.setCompressionThreshold(minBytes);
+}
+
+void ServerConnectionSingle::setMaxFrameSize(size_t maxBytes)
+{
+    _connection.setMaxFrameSize(maxBytes);
+}
+
+void ServerConnectionSingle::setInvokeWindow(size_t maxInFlight)
+{
+    _connection.setInvokeWindow(maxInFlight);
+}
+
 void ServerConnectionSingle::onReceived(OnDataHandler dataHandler)
 {
     if(!dataHandler) {
@@ -72,6 +197,45 @@ void ServerConnectionSingle::onReceived(OnDataHandler dataHandler)
     }
 }
 
+void ServerConnectionSingle::onReceivedShared(OnSharedDataHandler dataHandler)
+{
+    if(!dataHandler) {
+        _connection.onReceivedShared(nullptr);
+    } else {
+        _connection.onReceivedShared([this, dataHandler](Handle connectionHandle, SharedPayload message) {
+            if(_connectionHandle && _connectionHandle == connectionHandle) {
+                dataHandler(std::move(message));
+            }
+        });
+    }
+}
+
+void ServerConnectionSingle::onChunk(OnChunkHandler chunkHandler)
+{
+    if(!chunkHandler) {
+        _connection.onChunk(nullptr);
+    } else {
+        _connection.onChunk([this, chunkHandler](Handle connectionHandle, Handle streamId, Payload chunk, bool last) {
+            if(_connectionHandle && _connectionHandle == connectionHandle) {
+                chunkHandler(streamId, std::move(chunk), last);
+            }
+        });
+    }
+}
+
+void ServerConnectionSingle::onLatest(OnLatestHandler latestHandler)
+{
+    if(!latestHandler) {
+        _connection.onLatest(nullptr);
+    } else {
+        _connection.onLatest([this, latestHandler](Handle connectionHandle, uint32_t channel, Payload value) {
+            if(_connectionHandle && _connectionHandle == connectionHandle) {
+                latestHandler(channel, std::move(value));
+            }
+        });
+    }
+}
+
 void ServerConnectionSingle::onInvoked(OnInvokedPromiseIdHandler dataHandler)
 {
     if(!dataHandler) {
@@ -128,6 +292,18 @@ void ServerConnectionSingle::onResult(OnResultHandler dataHandler)
     }
 }
 
+void ServerConnectionSingle::registerMethod(uint32_t methodId, OnInvokedCallbackHandler handler, MethodOptions options)
+{
+    _connection.registerMethod(
+        methodId,
+        [this, handler = std::move(handler)](Handle connectionHandle, Payload message, ResultCallback callback) {
+            if(_connectionHandle && _connectionHandle == connectionHandle) {
+                handler(std::move(message), std::move(callback));
+            }
+        },
+        options);
+}
+
 void ServerConnectionSingle::onConnect(OnHandler handler)
 {
     if(!handler) {
@@ -160,6 +336,24 @@ void ServerConnectionSingle::onError(OnHandler handler)
     }
 }
 
+void ServerConnectionSingle::onBackpressure(OnHandler handler)
+{
+    if(!handler) {
+        _connection.onBackpressure(nullptr);
+    } else {
+        _connection.onBackpressure([handler](Handle) { handler(); });
+    }
+}
+
+void ServerConnectionSingle::onWritable(OnHandler handler)
+{
+    if(!handler) {
+        _connection.onWritable(nullptr);
+    } else {
+        _connection.onWritable([handler](Handle) { handler(); });
+    }
+}
+
 void ServerConnectionSingle::onLog(OnLogHandler handler, LogLevel level)
 {
     if(!handler) {
@@ -172,3 +366,18 @@ void ServerConnectionSingle::onLog(OnLogHandler handler, LogLevel level)
             level);
     }
 }
+
+void ServerConnectionSingle::setInlineDispatch(bool runInline)
+{
+    _connection.setInlineDispatch(runInline);
+}
+
+void ServerConnectionSingle::setReconnectPolicy(const ReconnectPolicy &)
+{
+    // The client does the reconnecting
+}
+
+ConnectionStats ServerConnectionSingle::stats()
+{
+    return _connection.stats();
+}
@@ -14,23 +14,53 @@ public:
     DELETE_COPY_AND_MOVE_CONSTRUCTORS(ServerConnectionSingle);
 
     void connect() override;
+    void connectAsync() override;
     void disconnect() override;
 
     void send(Payload message) override;
+    void send(Payload message, Priority priority) override;
+    bool trySend(Payload message) override;
+    bool sendShared(NativeHandle handle, size_t size) override;
+    Handle openStream() override;
+    bool sendChunk(Handle streamId, Payload chunk, bool last) override;
+    bool sendLatest(uint32_t channel, Payload value) override;
     void invoke(Payload message, PromiseCallback onResult) override;
+    void invoke(Payload message, PromiseCallback onResult, std::chrono::milliseconds timeout) override;
     Handle invoke(Payload message) override;
+    void invoke(Payload message, PromiseCallback onResult, Priority priority) override;
+    InvokeFuture invokeAsync(Payload message, std::chrono::milliseconds timeout) override;
+    InvokeResult invokeBlocking(Payload message, std::chrono::milliseconds timeout) override;
     void sendResult(Handle connectionHandle, Handle promiseId, Payload message) override;
+    void send(std::vector<Payload> messages) override;
+    void invokeMany(std::vector<Payload> messages, BatchPromiseCallback onResult) override;
+    std::vector<Handle> invokeMany(std::vector<Payload> messages) override;
+    void subscribe(const std::string &topic) override;
+    void unsubscribe(const std::string &topic) override;
 
     void onReceived(OnDataHandler dataHandler) override;
+    void onReceivedShared(OnSharedDataHandler dataHandler) override;
+    void onChunk(OnChunkHandler chunkHandler) override;
+    void onLatest(OnLatestHandler latestHandler) override;
     void onInvoked(OnInvokedPromiseIdHandler dataHandler) override;
     void onInvoked(OnInvokedImmediateHandler dataHandler) override;
     void onInvoked(OnInvokedCallbackHandler dataHandler) override;
     void onResult(OnResultHandler dataHandler) override;
+    void registerMethod(uint32_t methodId, OnInvokedCallbackHandler handler, MethodOptions options) override;
     void onConnect(OnHandler connectHandler) override;
     void onDisconnect(OnHandler disconnectHandler) override;
     void onError(OnHandler errorHandler) override;
+    void onBackpressure(OnHandler backpressureHandler) override;
+    void onWritable(OnHandler writableHandler) override;
     void onLog(OnLogHandler logHandler, LogLevel level) override;
     void setLogLevel(LogLevel level) override;
+    void setWriteBatchLimits(size_t maxBytes, size_t maxMessages) override;
+    void setWriteQueueLimits(size_t maxBytes, size_t maxMessages) override;
+    void setCompressionThreshold(size_t minBytes) override;
+    void setMaxFrameSize(size_t maxBytes) override;
+    void setInvokeWindow(size_t maxInFlight) override;
+    void setInlineDispatch(bool runInline) override;
+    void setReconnectPolicy(const ReconnectPolicy &policy) override;
+    ConnectionStats stats() override;
 
 protected:
     Handle _connectionHandle{};
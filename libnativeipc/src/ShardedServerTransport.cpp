@@ -0,0 +1,282 @@
+// Copyright Twitch Interactive, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: MIT
+
+#include "ShardedServerTransport.h"
+#include <cassert>
+
+using namespace Twitch::IPC;
+
+ShardedServerTransport::ShardedServerTransport(std::vector<std::unique_ptr<IServerTransport>> shards)
+    : _shards(std::move(shards))
+{
+    assert(!_shards.empty());
+    const auto count = static_cast<Handle>(_shards.size());
+    for(Handle i = 0; i < count; ++i) {
+        _shards[i]->setConnectionHandles(i + 1, count);
+    }
+}
+
+ShardedServerTransport::~ShardedServerTransport()
+{
+    // The listener goes first, so that nothing is handed to a shard that has already gone
+    for(auto &shard : _shards) {
+        shard.reset();
+    }
+}
+
+bool ShardedServerTransport::listen(std::string endpoint)
+{
+    std::vector<IServerTransport *> workers;
+    for(auto &shard : _shards) {
+        workers.push_back(shard.get());
+        if(shard != _shards.front() && !shard->serve()) {
+            return false;
+        }
+    }
+    _shards.front()->shareClients(std::move(workers));
+    return _shards.front()->listen(std::move(endpoint));
+}
+
+void ShardedServerTransport::listenAsync(std::string endpoint)
+{
+    // The workers are still started before returning, so that none is handed a client before it can
+    // take it. Only opening a handle each, they don't keep the caller long.
+    std::vector<IServerTransport *> workers;
+    for(auto &shard : _shards) {
+        workers.push_back(shard.get());
+        if(shard != _shards.front()) {
+            shard->serve();
+        }
+    }
+    _shards.front()->shareClients(std::move(workers));
+    _shards.front()->listenAsync(std::move(endpoint));
+}
+
+void ShardedServerTransport::send(Handle connectionHandle, Handle promiseId, Payload message)
+{
+    shardFor(connectionHandle).send(connectionHandle, promiseId, std::move(message));
+}
+
+void ShardedServerTransport::sendMany(Handle connectionHandle, const std::vector<Handle> &promiseIds, std::vector<Payload> messages)
+{
+    shardFor(connectionHandle).sendMany(connectionHandle, promiseIds, std::move(messages));
+}
+
+bool ShardedServerTransport::trySend(Handle connectionHandle, Handle promiseId, Payload message)
+{
+    return shardFor(connectionHandle).trySend(connectionHandle, promiseId, std::move(message));
+}
+
+void ShardedServerTransport::sendInvoke(Handle connectionHandle,
+    Handle promiseId,
+    Payload message,
+    std::chrono::steady_clock::time_point deadline)
+{
+    shardFor(connectionHandle).sendInvoke(connectionHandle, promiseId, std::move(message), deadline);
+}
+
+void ShardedServerTransport::sendWithPriority(Handle connectionHandle,
+    Handle promiseId,
+    Payload message,
+    Priority priority,
+    std::chrono::steady_clock::time_point deadline)
+{
+    shardFor(connectionHandle).sendWithPriority(connectionHandle, promiseId, std::move(message), priority, deadline);
+}
+
+void ShardedServerTransport::broadcast(Payload message)
+{
+    for(size_t i = 1; i < _shards.size(); ++i) {
+        _shards[i]->broadcast(message);
+    }
+    _shards.front()->broadcast(std::move(message));
+}
+
+void ShardedServerTransport::publish(std::string topic, Payload message)
+{
+    for(size_t i = 1; i < _shards.size(); ++i) {
+        _shards[i]->publish(topic, message);
+    }
+    _shards.front()->publish(std::move(topic), std::move(message));
+}
+
+int ShardedServerTransport::activeConnections()
+{
+    int count = 0;
+    for(auto &shard : _shards) {
+        count += shard->activeConnections();
+    }
+    return count;
+}
+
+void ShardedServerTransport::setLogLevel(LogLevel level)
+{
+    for(auto &shard : _shards) {
+        shard->setLogLevel(level);
+    }
+}
+
+void ShardedServerTransport::setWriteBatchLimits(size_t maxBytes, size_t maxMessages)
+{
+    for(auto &shard : _shards) {
+        shard->setWriteBatchLimits(maxBytes, maxMessages);
+    }
+}
+
+void ShardedServerTransport::setWriteQueueLimits(size_t maxBytes, size_t maxMessages)
+{
+    for(auto &shard : _shards) {
+        shard->setWriteQueueLimits(maxBytes, maxMessages);
+    }
+}
+
+void ShardedServerTransport::setCompressionThreshold(size_t minBytes)
+{
+    for(auto &shard : _shards) {
+        shard->setCompressionThreshold(minBytes);
+    }
+}
+
+void ShardedServerTransport::setMaxFrameSize(size_t maxBytes)
+{
+    for(auto &shard : _shards) {
+        shard->setMaxFrameSize(maxBytes);
+    }
+}
+
+bool ShardedServerTransport::fitsPeer(Handle connectionHandle, size_t size)
+{
+    return shardFor(connectionHandle).fitsPeer(connectionHandle, size);
+}
+
+void ShardedServerTransport::setCounters(std::shared_ptr<TransportCounters> counters)
+{
+    for(auto &shard : _shards) {
+        shard->setCounters(counters);
+    }
+}
+
+void ShardedServerTransport::setLoopThread(std::shared_ptr<LoopThread>)
+{
+    // Each shard was given its own as it was made
+}
+
+void ShardedServerTransport::setConnectionHandles(Handle, Handle)
+{
+    assert(false && "shards number their own connections");
+}
+
+void ShardedServerTransport::shareClients(std::vector<IServerTransport *>)
+{
+    assert(false && "shards can't be nested");
+}
+
+bool ShardedServerTransport::serve()
+{
+    assert(false && "shards can't be nested");
+    return false;
+}
+
+void ShardedServerTransport::adoptClient(NativeHandle socket)
+{
+    _shards.front()->adoptClient(socket);
+}
+
+bool ShardedServerTransport::sendShared(Handle connectionHandle, NativeHandle handle, size_t size)
+{
+    return shardFor(connectionHandle).sendShared(connectionHandle, handle, size);
+}
+
+bool ShardedServerTransport::sendChunk(Handle connectionHandle, Handle streamId, Payload chunk, bool last)
+{
+    return shardFor(connectionHandle).sendChunk(connectionHandle, streamId, std::move(chunk), last);
+}
+
+bool ShardedServerTransport::sendLatest(Handle connectionHandle, uint32_t channel, Payload value)
+{
+    return shardFor(connectionHandle).sendLatest(connectionHandle, channel, std::move(value));
+}
+
+void ShardedServerTransport::onConnect(OnHandler handler)
+{
+    for(auto &shard : _shards) {
+        shard->onConnect(handler);
+    }
+}
+
+void ShardedServerTransport::onDisconnect(OnHandler handler)
+{
+    for(auto &shard : _shards) {
+        shard->onDisconnect(handler);
+    }
+}
+
+void ShardedServerTransport::onData(OnDataHandler handler)
+{
+    for(auto &shard : _shards) {
+        shard->onData(handler);
+    }
+}
+
+void ShardedServerTransport::onSharedData(OnSharedDataHandler handler)
+{
+    for(auto &shard : _shards) {
+        shard->onSharedData(handler);
+    }
+}
+
+void ShardedServerTransport::onChunk(OnChunkHandler handler)
+{
+    for(auto &shard : _shards) {
+        shard->onChunk(handler);
+    }
+}
+
+void ShardedServerTransport::onLatest(OnLatestHandler handler)
+{
+    for(auto &shard : _shards) {
+        shard->onLatest(handler);
+    }
+}
+
+void ShardedServerTransport::onNoInvokeClientHandler(OnNoInvokeClientHandler handler)
+{
+    for(auto &shard : _shards) {
+        shard->onNoInvokeClientHandler(handler);
+    }
+}
+
+void ShardedServerTransport::onError(OnHandler handler)
+{
+    for(auto &shard : _shards) {
+        shard->onError(handler);
+    }
+}
+
+void ShardedServerTransport::onInvokeTimeout(OnInvokeTimeoutHandler handler)
+{
+    for(auto &shard : _shards) {
+        shard->onInvokeTimeout(handler);
+    }
+}
+
+void ShardedServerTransport::onBackpressure(OnHandler handler)
+{
+    for(auto &shard : _shards) {
+        shard->onBackpressure(handler);
+    }
+}
+
+void ShardedServerTransport::onWritable(OnHandler handler)
+{
+    for(auto &shard : _shards) {
+        shard->onWritable(handler);
+    }
+}
+
+void ShardedServerTransport::onLog(OnLogHandler handler, LogLevel level)
+{
+    for(auto &shard : _shards) {
+        shard->onLog(handler, level);
+    }
+}
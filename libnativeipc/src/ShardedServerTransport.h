@@ -0,0 +1,75 @@
+// Copyright Twitch Interactive, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "IServerTransport.h"
+#include <memory>
+#include <vector>
+
+namespace Twitch::IPC {
+// Serves one endpoint's clients with several server transports, each on a loop thread of its own.
+// The first one listens and hands the clients it accepts to each of them in turn. A client then stays
+// on that transport's loop for good, so its reads and writes never cross over to another loop.
+class ShardedServerTransport final : public IServerTransport {
+public:
+    explicit ShardedServerTransport(std::vector<std::unique_ptr<IServerTransport>> shards);
+    ~ShardedServerTransport() override;
+    DELETE_COPY_AND_MOVE_CONSTRUCTORS(ShardedServerTransport);
+
+    bool listen(std::string endpoint) override;
+    void listenAsync(std::string endpoint) override;
+    void send(Handle connectionHandle, Handle promiseId, Payload message) override;
+    void sendMany(Handle connectionHandle, const std::vector<Handle> &promiseIds, std::vector<Payload> messages) override;
+    bool trySend(Handle connectionHandle, Handle promiseId, Payload message) override;
+    void sendInvoke(Handle connectionHandle,
+        Handle promiseId,
+        Payload message,
+        std::chrono::steady_clock::time_point deadline) override;
+    void sendWithPriority(Handle connectionHandle,
+        Handle promiseId,
+        Payload message,
+        Priority priority,
+        std::chrono::steady_clock::time_point deadline) override;
+    void broadcast(Payload message) override;
+    void publish(std::string topic, Payload message) override;
+    int activeConnections() override;
+    void setLogLevel(LogLevel level) override;
+    void setWriteBatchLimits(size_t maxBytes, size_t maxMessages) override;
+    void setWriteQueueLimits(size_t maxBytes, size_t maxMessages) override;
+    void setCompressionThreshold(size_t minBytes) override;
+    void setMaxFrameSize(size_t maxBytes) override;
+    bool fitsPeer(Handle connectionHandle, size_t size) override;
+    void setCounters(std::shared_ptr<TransportCounters> counters) override;
+    void setLoopThread(std::shared_ptr<LoopThread> loopThread) override;
+    void setConnectionHandles(Handle first, Handle step) override;
+    void shareClients(std::vector<IServerTransport *> workers) override;
+    bool serve() override;
+    void adoptClient(NativeHandle socket) override;
+    bool sendShared(Handle connectionHandle, NativeHandle handle, size_t size) override;
+    bool sendChunk(Handle connectionHandle, Handle streamId, Payload chunk, bool last) override;
+    bool sendLatest(Handle connectionHandle, uint32_t channel, Payload value) override;
+
+    void onConnect(OnHandler handler) override;
+    void onDisconnect(OnHandler handler) override;
+    void onData(OnDataHandler handler) override;
+    void onSharedData(OnSharedDataHandler handler) override;
+    void onChunk(OnChunkHandler handler) override;
+    void onLatest(OnLatestHandler handler) override;
+    void onNoInvokeClientHandler(OnNoInvokeClientHandler handler) override;
+    void onError(OnHandler handler) override;
+    void onInvokeTimeout(OnInvokeTimeoutHandler handler) override;
+    void onBackpressure(OnHandler handler) override;
+    void onWritable(OnHandler handler) override;
+    void onLog(OnLogHandler handler, LogLevel level) override;
+
+private:
+    // Shard i numbers its connections i + 1, i + 1 + shard count, ...
+    IServerTransport &shardFor(Handle connectionHandle)
+    {
+        return *_shards[(connectionHandle - 1) % _shards.size()];
+    }
+
+    std::vector<std::unique_ptr<IServerTransport>> _shards;
+};
+} // namespace Twitch::IPC
@@ -0,0 +1,11 @@
+// Copyright Twitch Interactive, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: MIT
+
+#include "SharedMemory-ClientTransport.h"
+
+using namespace Twitch::IPC;
+
+ClientTransport<Transport::SharedMemory>::ClientTransport()
+{
+    _sharedMemoryRingSize = DefaultSharedMemoryRingSize;
+}
@@ -0,0 +1,18 @@
+// Copyright Twitch Interactive, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "Pipe-ClientTransport.h"
+#include "Transport.h"
+
+namespace Twitch::IPC {
+// Connects like the pipe transport, then offers the server a shared memory ring for our messages
+template<>
+class ClientTransport<Transport::SharedMemory> final
+    : public ClientTransport<Transport::Pipe> {
+public:
+    ClientTransport();
+    DELETE_COPY_AND_MOVE_CONSTRUCTORS(ClientTransport);
+};
+} // namespace Twitch::IPC
@@ -0,0 +1,14 @@
+// Copyright Twitch Interactive, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: MIT
+
+#include "SharedMemory-ServerTransport.h"
+
+using namespace Twitch::IPC;
+
+ServerTransport<Transport::SharedMemory>::ServerTransport(
+    bool latestConnectionOnly, bool allowMultiuserAccess)
+    : ServerTransport<Transport::Pipe>(latestConnectionOnly, allowMultiuserAccess)
+{
+    _sharedMemoryRingSize = DefaultSharedMemoryRingSize;
+    _sharedMemoryMultiuserAccess = allowMultiuserAccess;
+}
@@ -0,0 +1,18 @@
+// Copyright Twitch Interactive, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "Pipe-ServerTransport.h"
+#include "Transport.h"
+
+namespace Twitch::IPC {
+// Listens like the pipe transport, then offers each client a shared memory ring for our messages
+template<>
+class ServerTransport<Transport::SharedMemory> final
+    : public ServerTransport<Transport::Pipe> {
+public:
+    ServerTransport(bool latestConnectionOnly, bool allowMultiuserAccess);
+    DELETE_COPY_AND_MOVE_CONSTRUCTORS(ServerTransport);
+};
+} // namespace Twitch::IPC
@@ -0,0 +1,224 @@
+// Copyright Twitch Interactive, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: MIT
+
+#define NOMINMAX
+
+#include "SharedMemoryRing.h"
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace Twitch::IPC;
+
+namespace {
+constexpr uint32_t RingMagic = 0x474e4952; // "RING"
+constexpr uint32_t RingVersion = 1;
+// Rejects absurd sizes announced by a misbehaving peer
+constexpr size_t MaxRingCapacity = size_t{1} << 30;
+
+std::atomic<uint32_t> s_lastSegment{0};
+
+std::string nextSegmentName()
+{
+    // Kept short: macOS limits shared memory names to 31 characters
+#ifdef _WIN32
+    const auto pid = std::to_string(GetCurrentProcessId());
+    return "Local\\tnipc-" + pid + "-" + std::to_string(++s_lastSegment);
+#else
+    const auto pid = std::to_string(getpid());
+    return "/tnipc-" + pid + "-" + std::to_string(++s_lastSegment);
+#endif
+}
+} // namespace
+
+SharedMemoryRing::SharedMemoryRing(std::string name, size_t capacity, bool owner)
+    : _name(std::move(name))
+    , _capacity(capacity)
+    , _owner(owner)
+{
+}
+
+SharedMemoryRing::~SharedMemoryRing()
+{
+#ifdef _WIN32
+    if(_shared) {
+        UnmapViewOfFile(_shared);
+    }
+    if(_mapping) {
+        CloseHandle(_mapping);
+    }
+#else
+    if(_shared) {
+        munmap(_shared, mappedSize());
+    }
+    if(_owner) {
+        // The peer normally removed the name already when it mapped the segment
+        shm_unlink(_name.c_str());
+    }
+#endif
+}
+
+std::unique_ptr<SharedMemoryRing> SharedMemoryRing::create(size_t capacity, bool allowMultiuserAccess)
+{
+    if(!capacity || capacity > MaxRingCapacity) {
+        return nullptr;
+    }
+    std::unique_ptr<SharedMemoryRing> ring(new SharedMemoryRing(nextSegmentName(), capacity, false));
+    const auto size = static_cast<uint64_t>(ring->mappedSize());
+#ifdef _WIN32
+    (void)allowMultiuserAccess;
+    ring->_mapping = CreateFileMappingA(INVALID_HANDLE_VALUE,
+        nullptr,
+        PAGE_READWRITE,
+        static_cast<DWORD>(size >> 32),
+        static_cast<DWORD>(size),
+        ring->_name.c_str());
+    if(!ring->_mapping || GetLastError() == ERROR_ALREADY_EXISTS) {
+        return nullptr;
+    }
+    auto address = MapViewOfFile(ring->_mapping, FILE_MAP_ALL_ACCESS, 0, 0, static_cast<SIZE_T>(size));
+    if(!address) {
+        return nullptr;
+    }
+#else
+    const auto fd = shm_open(ring->_name.c_str(), O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+    if(fd < 0) {
+        return nullptr;
+    }
+    ring->_owner = true;
+    constexpr auto everyone = S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH | S_IWOTH;
+    if((allowMultiuserAccess && fchmod(fd, everyone) != 0) || ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        close(fd);
+        return nullptr;
+    }
+    auto address = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if(address == MAP_FAILED) {
+        return nullptr;
+    }
+#endif
+    auto shared = new(address) Shared{};
+    shared->magic = RingMagic;
+    shared->version = RingVersion;
+    shared->capacity = capacity;
+    ring->setMapping(address);
+    return ring;
+}
+
+std::unique_ptr<SharedMemoryRing> SharedMemoryRing::open(const std::string &name, size_t capacity)
+{
+    if(!capacity || capacity > MaxRingCapacity) {
+        return nullptr;
+    }
+    std::unique_ptr<SharedMemoryRing> ring(new SharedMemoryRing(name, capacity, false));
+    const auto size = static_cast<uint64_t>(ring->mappedSize());
+#ifdef _WIN32
+    ring->_mapping = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, name.c_str());
+    if(!ring->_mapping) {
+        return nullptr;
+    }
+    auto address = MapViewOfFile(ring->_mapping, FILE_MAP_ALL_ACCESS, 0, 0, static_cast<SIZE_T>(size));
+    if(!address) {
+        return nullptr;
+    }
+#else
+    const auto fd = shm_open(name.c_str(), O_RDWR, 0);
+    if(fd < 0) {
+        return nullptr;
+    }
+    struct stat info {};
+    if(fstat(fd, &info) != 0 || static_cast<uint64_t>(info.st_size) != size) {
+        close(fd);
+        return nullptr;
+    }
+    auto address = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if(address == MAP_FAILED) {
+        return nullptr;
+    }
+    shm_unlink(name.c_str());
+#endif
+    ring->setMapping(address);
+    const auto shared = ring->_shared;
+    if(shared->magic != RingMagic || shared->version != RingVersion || shared->capacity != capacity) {
+        return nullptr;
+    }
+    return ring;
+}
+
+void SharedMemoryRing::setMapping(void *address)
+{
+    _shared = static_cast<Shared *>(address);
+    _data = static_cast<uint8_t *>(address) + sizeof(Shared);
+}
+
+bool SharedMemoryRing::tryWrite(const MessageHeader &header, const uint8_t *body)
+{
+    const auto frameSize = sizeof(MessageHeader) + header.bodySize;
+    const auto write = _shared->writeIndex.load(std::memory_order_relaxed);
+    const auto read = _shared->readIndex.load(std::memory_order_acquire);
+    if(frameSize > _capacity - static_cast<size_t>(write - read)) {
+        return false;
+    }
+    copyIn(write, &header, sizeof(MessageHeader));
+    copyIn(write + sizeof(MessageHeader), body, header.bodySize);
+    _shared->writeIndex.store(write + frameSize, std::memory_order_release);
+    return true;
+}
+
+bool SharedMemoryRing::readHeader(MessageHeader &header)
+{
+    const auto read = _shared->readIndex.load(std::memory_order_relaxed);
+    const auto available = static_cast<size_t>(_shared->writeIndex.load(std::memory_order_acquire) - read);
+    if(available < sizeof(MessageHeader)) {
+        return false;
+    }
+    copyOut(read, &header, sizeof(MessageHeader));
+    if(header.bodySize > available - sizeof(MessageHeader)) {
+        return false;
+    }
+    _pendingBodySize = header.bodySize;
+    return true;
+}
+
+void SharedMemoryRing::readBody(uint8_t *body)
+{
+    const auto read = _shared->readIndex.load(std::memory_order_relaxed);
+    copyOut(read + sizeof(MessageHeader), body, _pendingBodySize);
+    _shared->readIndex.store(read + sizeof(MessageHeader) + _pendingBodySize, std::memory_order_release);
+    _pendingBodySize = 0;
+}
+
+void SharedMemoryRing::copyIn(uint64_t index, const void *source, size_t size)
+{
+    const auto offset = static_cast<size_t>(index % _capacity);
+    const auto first = std::min(size, _capacity - offset);
+    if(first) {
+        memcpy(_data + offset, source, first);
+    }
+    if(size > first) {
+        memcpy(_data, static_cast<const uint8_t *>(source) + first, size - first);
+    }
+}
+
+void SharedMemoryRing::copyOut(uint64_t index, void *destination, size_t size) const
+{
+    const auto offset = static_cast<size_t>(index % _capacity);
+    const auto first = std::min(size, _capacity - offset);
+    if(first) {
+        memcpy(destination, _data + offset, first);
+    }
+    if(size > first) {
+        memcpy(static_cast<uint8_t *>(destination) + first, _data, size - first);
+    }
+}
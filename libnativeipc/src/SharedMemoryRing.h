@@ -0,0 +1,75 @@
+// Copyright Twitch Interactive, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "DeleteConstructors.h"
+#include "Message.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace Twitch::IPC {
+constexpr size_t DefaultSharedMemoryRingSize = 32 * 1024 * 1024;
+
+// Single-producer/single-consumer ring of frames in a named shared memory segment. The writing side
+// of a connection creates one for its outgoing frames and the peer maps it by name. Frames are
+// stored as a MessageHeader followed by the body and may wrap around the end of the buffer.
+class SharedMemoryRing {
+public:
+    // Creates and maps a new segment with room for `capacity` bytes of frames
+    static std::unique_ptr<SharedMemoryRing> create(size_t capacity, bool allowMultiuserAccess);
+    // Maps a segment created by the peer. The name is removed once mapped since nobody else needs it.
+    static std::unique_ptr<SharedMemoryRing> open(const std::string &name, size_t capacity);
+
+    ~SharedMemoryRing();
+    DELETE_COPY_AND_MOVE_CONSTRUCTORS(SharedMemoryRing);
+
+    [[nodiscard]] const std::string &name() const
+    {
+        return _name;
+    }
+    [[nodiscard]] size_t capacity() const
+    {
+        return _capacity;
+    }
+
+    // Producer: copies the frame in, or returns false if it doesn't fit in the free space right now
+    bool tryWrite(const MessageHeader &header, const uint8_t *body);
+
+    // Consumer: reads the header of the next frame, then readBody copies its body out and frees the space
+    bool readHeader(MessageHeader &header);
+    void readBody(uint8_t *body);
+
+private:
+    struct Shared {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t capacity;
+        alignas(64) std::atomic<uint64_t> writeIndex;
+        alignas(64) std::atomic<uint64_t> readIndex;
+    };
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "ring indices are shared between processes");
+
+    SharedMemoryRing(std::string name, size_t capacity, bool owner);
+    void setMapping(void *address);
+    void copyIn(uint64_t index, const void *source, size_t size);
+    void copyOut(uint64_t index, void *destination, size_t size) const;
+    [[nodiscard]] size_t mappedSize() const
+    {
+        return sizeof(Shared) + _capacity;
+    }
+
+    std::string _name;
+    size_t _capacity;
+    bool _owner;
+    Shared *_shared{};
+    uint8_t *_data{};
+    uint32_t _pendingBodySize{};
+#ifdef _WIN32
+    void *_mapping{};
+#endif
+};
+} // namespace Twitch::IPC
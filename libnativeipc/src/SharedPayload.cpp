@@ -0,0 +1,76 @@
+// Copyright Twitch Interactive, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: MIT
+
+#include "IConnection.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+using namespace Twitch::IPC;
+
+struct SharedPayload::Mapping {
+    NativeHandle handle;
+    void *address;
+    size_t size;
+
+    Mapping(NativeHandle h, void *a, size_t s)
+        : handle(h)
+        , address(a)
+        , size(s)
+    {
+    }
+    ~Mapping()
+    {
+#ifdef _WIN32
+        if(address) {
+            UnmapViewOfFile(address);
+        }
+        CloseHandle(handle);
+#else
+        if(address) {
+            munmap(address, size);
+        }
+        close(handle);
+#endif
+    }
+    Mapping(const Mapping &) = delete;
+    Mapping &operator=(const Mapping &) = delete;
+};
+
+SharedPayload SharedPayload::map(NativeHandle handle, size_t size)
+{
+    SharedPayload payload;
+    void *address = nullptr;
+    if(size) {
+#ifdef _WIN32
+        address = MapViewOfFile(handle, FILE_MAP_READ, 0, 0, size);
+        if(!address) {
+            CloseHandle(handle);
+            return payload;
+        }
+#else
+        address = mmap(nullptr, size, PROT_READ, MAP_SHARED, handle, 0);
+        if(address == MAP_FAILED) {
+            close(handle);
+            return payload;
+        }
+#endif
+    }
+    payload._mapping = std::make_shared<const Mapping>(handle, address, size);
+    return payload;
+}
+
+const uint8_t *SharedPayload::data() const
+{
+    return _mapping ? static_cast<const uint8_t *>(_mapping->address) : nullptr;
+}
+
+size_t SharedPayload::size() const
+{
+    return _mapping ? _mapping->size : 0;
+}
@@ -5,6 +5,11 @@
 
 using namespace Twitch::IPC;
 
+ClientTransport<Transport::TCP>::ClientTransport(const TCPOptions &options)
+    : _options(options)
+{
+}
+
 ClientTransport<Transport::TCP>::~ClientTransport()
 {
     destroy();
@@ -12,29 +17,26 @@ ClientTransport<Transport::TCP>::~ClientTransport()
 
 bool ClientTransport<Transport::TCP>::connectSocket()
 {
-    std::string ipAddress = "127.0.0.1";
-    int port = -1;
-    auto i = _endpoint.find(':');
-    if (i != std::string::npos) {
-        port = std::atoi(_endpoint.c_str() + i + 1);
-        if (i) {
-            ipAddress = _endpoint.substr(0, i);
-        }
-    }
-    if (port <= 0) {
-        handleLog(0, LogLevel::Error, "Invalid address. Should be something like \"127.0.0.1:10000\" or \":10000\"");
-        return false;
-    }
-
-    struct sockaddr_in addr;
-    if (uv_ip4_addr(ipAddress.c_str(), port, &addr)) {
-        handleLog(0, LogLevel::Error, "Invalid address. Should be something like \"127.0.0.1:10000\" or \":10000\"");
+    TCPAddress addr{};
+    if (!parseTCPEndpoint(_endpoint, "127.0.0.1", addr)) {
+        handleLog(0, LogLevel::Error, "Invalid address. Should be something like \"127.0.0.1:10000\", \"[::1]:10000\" or \":10000\"");
         return false;
     }
 
     auto tcp = std::make_unique<uv_tcp_t>();
     tcp->data = static_cast<UVTransportBase *>(this);
-    uv_tcp_init(&_loop, tcp.get());
-    uv_tcp_connect(&_connect, tcp.release(), reinterpret_cast<struct sockaddr*>(&addr), connect_cb);
+    if (const auto status = uv_tcp_init_ex(_loop, tcp.get(), addr.base.sa_family)) {
+        handleLog(0, LogLevel::Error, std::string("Could not create a socket: ") + uv_strerror(status));
+        return false;
+    }
+    trackHandle();
+    if (const auto status = applyTCPOptions(tcp.get(), _options)) {
+        handleLog(0, LogLevel::Warning, std::string("Could not apply TCP options: ") + uv_strerror(status));
+    }
+    const auto stream = reinterpret_cast<uv_stream_t *>(tcp.release());
+    if (const auto status = uv_tcp_connect(&_connect, reinterpret_cast<uv_tcp_t *>(stream), &addr.base, connect_cb)) {
+        // Failed before it started, e.g. with no route to the host, so it gets retried like any other
+        handleConnected(stream, status);
+    }
     return true;
 }
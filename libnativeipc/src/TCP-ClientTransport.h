@@ -4,6 +4,7 @@
 #pragma once
 
 #include "UVClientTransport.h"
+#include "TCP-Socket.h"
 #include "Transport.h"
 #include <thread>
 
@@ -12,11 +13,13 @@ template<>
 class ClientTransport<Transport::TCP> final
     : public UVClientTransport {
 public:
-    ClientTransport() = default;
+    explicit ClientTransport(const TCPOptions &options);
     ~ClientTransport();
     DELETE_COPY_AND_MOVE_CONSTRUCTORS(ClientTransport);
 
 protected:
     bool connectSocket() override;
+
+    TCPOptions _options;
 };
 } // namespace Twitch::IPC
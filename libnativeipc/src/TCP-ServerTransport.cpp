@@ -7,8 +7,9 @@
 using namespace Twitch::IPC;
 
 ServerTransport<Transport::TCP>::ServerTransport(
-    bool latestConnectionOnly, bool allowMultiuserAccess)
+    bool latestConnectionOnly, bool allowMultiuserAccess, const TCPOptions &options)
     : UVServerTransport(latestConnectionOnly, allowMultiuserAccess)
+    , _options(options)
 {
     _binder.data = static_cast<UVTransportBase *>(this);
 }
@@ -23,35 +24,50 @@ int ServerTransport<Transport::TCP>::acceptClient(uv_stream_t *stream, uv_stream
     assert(stream == reinterpret_cast<uv_stream_t*>(&_binder));
 
     auto tcp = new uv_tcp_t;
-    uv_tcp_init(&_loop, tcp);
+    uv_tcp_init(_loop, tcp);
+    trackHandle();
     clientStream = reinterpret_cast<uv_stream_t*>(tcp);
-    return uv_accept(stream, reinterpret_cast<uv_stream_t *>(tcp));
+    const auto status = uv_accept(stream, reinterpret_cast<uv_stream_t *>(tcp));
+    if (!status) {
+        if (const auto optionStatus = applyTCPOptions(tcp, _options)) {
+            handleLog(0, LogLevel::Warning, std::string("Could not apply TCP options: ") + uv_strerror(optionStatus));
+        }
+    }
+    return status;
 }
 
-int ServerTransport<Transport::TCP>::bind()
+int ServerTransport<Transport::TCP>::openClient(NativeHandle socket, uv_stream_t *&clientStream)
 {
-    uv_tcp_init(&_loop, &_binder);
+    // The socket options came along with the socket
+    auto tcp = new uv_tcp_t;
+    uv_tcp_init(_loop, tcp);
+    trackHandle();
+    clientStream = reinterpret_cast<uv_stream_t*>(tcp);
+#ifdef _WIN32
+    (void)socket;
+    return UV_ENOTSUP;
+#else
+    return uv_tcp_open(tcp, socket);
+#endif
+}
 
-    std::string ipAddress = "0.0.0.0";
-    int port = -1;
-    auto i = _endpoint.find(':');
-    if (i != std::string::npos) {
-        port = std::atoi(_endpoint.c_str() + i + 1);
-        if (i) {
-            ipAddress = _endpoint.substr(0, i);
-        }
-    }
-    if (port <= 0) {
-        handleLog(0, LogLevel::Error, "Invalid address. Should be something like \"127.0.0.1:10000\" or \":10000\"");
+int ServerTransport<Transport::TCP>::bind()
+{
+    TCPAddress addr{};
+    const bool valid = parseTCPEndpoint(_endpoint, "0.0.0.0", addr);
+    // Initialized either way, since closeBinder closes it
+    uv_tcp_init_ex(_loop, &_binder, valid ? addr.base.sa_family : AF_UNSPEC);
+    trackHandle();
+    if (!valid) {
+        handleLog(0, LogLevel::Error, "Invalid address. Should be something like \"127.0.0.1:10000\", \"[::]:10000\" or \":10000\"");
         return 1;
     }
-    
-    struct sockaddr_in addr;
-    if (uv_ip4_addr(ipAddress.c_str(), port, &addr)) {
-        handleLog(0, LogLevel::Error, "Invalid address. Should be something like \"127.0.0.1:10000\" or \":10000\"");
-        return 1;
+    // Accepted sockets start out with the listening socket's buffer sizes
+    if (const auto status = applyTCPOptions(&_binder, _options)) {
+        handleLog(0, LogLevel::Warning, std::string("Could not apply TCP options: ") + uv_strerror(status));
     }
-    return uv_tcp_bind(&_binder, reinterpret_cast<struct sockaddr*>(&addr), 0);
+    const unsigned flags = addr.base.sa_family == AF_INET6 && _options.ipv6Only ? UV_TCP_IPV6ONLY : 0;
+    return uv_tcp_bind(&_binder, &addr.base, flags);
 }
 
 int ServerTransport<Transport::TCP>::startListening()
@@ -61,5 +77,5 @@ int ServerTransport<Transport::TCP>::startListening()
 
 void ServerTransport<Transport::TCP>::closeBinder()
 {
-    uv_close(reinterpret_cast<uv_handle_t *>(&_binder), nullptr);
+    closeHandle(reinterpret_cast<uv_handle_t *>(&_binder), false);
 }
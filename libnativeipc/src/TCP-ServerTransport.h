@@ -4,6 +4,7 @@
 #pragma once
 
 #include "UVServerTransport.h"
+#include "TCP-Socket.h"
 #include "Transport.h"
 
 #include <atomic>
@@ -16,16 +17,18 @@ template<>
 class ServerTransport<Transport::TCP> final
     : public UVServerTransport {
 public:
-    ServerTransport(bool latestConnectionOnly, bool allowMultiuserAccess);
+    ServerTransport(bool latestConnectionOnly, bool allowMultiuserAccess, const TCPOptions &options);
     ~ServerTransport();
     DELETE_COPY_AND_MOVE_CONSTRUCTORS(ServerTransport);
 
 protected:
     int acceptClient(uv_stream_t *stream, uv_stream_t *&) override;
+    int openClient(NativeHandle socket, uv_stream_t *&) override;
     int bind() override;
     int startListening() override;
     void closeBinder() override;
 
     uv_tcp_t _binder{};
+    TCPOptions _options;
 };
 } // namespace Twitch::IPC
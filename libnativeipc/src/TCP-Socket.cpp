@@ -0,0 +1,48 @@
+// Copyright Twitch Interactive, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: MIT
+
+#include "TCP-Socket.h"
+#include <cstdlib>
+
+namespace Twitch::IPC {
+bool parseTCPEndpoint(const std::string &endpoint, const char *defaultHost, TCPAddress &address)
+{
+    // The port follows the last colon, since IPv6 hosts have colons of their own
+    const auto i = endpoint.rfind(':');
+    if(i == std::string::npos) {
+        return false;
+    }
+    const int port = std::atoi(endpoint.c_str() + i + 1);
+    if(port <= 0 || port > 65535) {
+        return false;
+    }
+    std::string host = i ? endpoint.substr(0, i) : defaultHost;
+    if(host.size() >= 2 && host.front() == '[' && host.back() == ']') {
+        host = host.substr(1, host.size() - 2);
+    }
+    address = {};
+    if(host.find(':') != std::string::npos) {
+        return uv_ip6_addr(host.c_str(), port, &address.v6) == 0;
+    }
+    return uv_ip4_addr(host.c_str(), port, &address.v4) == 0;
+}
+
+int applyTCPOptions(uv_tcp_t *tcp, const TCPOptions &options)
+{
+    int status = uv_tcp_nodelay(tcp, options.noDelay ? 1 : 0);
+    if(!status) {
+        status = uv_tcp_keepalive(tcp, options.keepAlive ? 1 : 0, options.keepAliveDelaySeconds);
+    }
+    auto handle = reinterpret_cast<uv_handle_t *>(tcp);
+    // libuv reads the size back when it is 0, so only ask when there is something to set
+    if(!status && options.sendBufferSize > 0) {
+        auto size = options.sendBufferSize;
+        status = uv_send_buffer_size(handle, &size);
+    }
+    if(!status && options.receiveBufferSize > 0) {
+        auto size = options.receiveBufferSize;
+        status = uv_recv_buffer_size(handle, &size);
+    }
+    return status;
+}
+} // namespace Twitch::IPC
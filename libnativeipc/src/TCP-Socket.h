@@ -0,0 +1,25 @@
+// Copyright Twitch Interactive, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "ConnectionFactory.h"
+#include <uv.h>
+#include <string>
+
+namespace Twitch::IPC {
+// Where a TCP endpoint points: "host:port", "[v6 host]:port" or ":port" for `defaultHost`
+union TCPAddress {
+    sockaddr base;
+    sockaddr_in v4;
+    sockaddr_in6 v6;
+};
+
+// Returns false if the endpoint isn't a valid address
+bool parseTCPEndpoint(const std::string &endpoint, const char *defaultHost, TCPAddress &address);
+
+// Sets the options on a socket that already exists, e.g. from uv_tcp_init_ex. Buffer sizes set before
+// connecting or listening also shape the window advertised in the handshake. Returns the first libuv
+// error, if any.
+int applyTCPOptions(uv_tcp_t *tcp, const TCPOptions &options);
+} // namespace Twitch::IPC
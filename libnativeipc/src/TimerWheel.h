@@ -0,0 +1,88 @@
+// Copyright Twitch Interactive, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace Twitch::IPC {
+// Hashed timer wheel for deadlines that mostly never fire, like invoke timeouts. Adding is O(1) and
+// each tick only looks at the one slot it lands on. Entries can't be cancelled, so whoever handles an
+// expiry has to ignore keys that are already done. Not thread safe.
+template<typename Key>
+class TimerWheel {
+public:
+    using Clock = std::chrono::steady_clock;
+    static constexpr auto Resolution = std::chrono::milliseconds(10);
+    // A power of two; deadlines further out than a turn of the wheel just stay in their slot for
+    // more than one turn
+    static constexpr size_t SlotCount = 512;
+
+    [[nodiscard]] bool empty() const
+    {
+        return !_size;
+    }
+    [[nodiscard]] size_t size() const
+    {
+        return _size;
+    }
+
+    // Never fires before `deadline`, and at most a tick after it when advanced every tick
+    void add(Key key, Clock::time_point deadline)
+    {
+        const auto since = deadline.time_since_epoch();
+        // Rounded up, and never into a tick that has already been processed
+        auto tick = (since + Resolution - Clock::duration(1)) / Resolution;
+        if(tick <= _lastTick) {
+            tick = _lastTick + 1;
+        }
+        _slots[static_cast<size_t>(tick) & (SlotCount - 1)].push_back({std::move(key), tick});
+        ++_size;
+    }
+
+    // Calls `expired(key)` for, and drops, every entry whose deadline is at or before `now`
+    template<typename F>
+    void advance(Clock::time_point now, F &&expired)
+    {
+        const int64_t nowTick = now.time_since_epoch() / Resolution;
+        if(nowTick <= _lastTick) {
+            return;
+        }
+        // After a long gap one turn still visits every slot once
+        auto tick = std::max(_lastTick + 1, nowTick - static_cast<int64_t>(SlotCount) + 1);
+        _lastTick = nowTick;
+        for(; tick <= nowTick && _size; ++tick) {
+            auto &slot = _slots[static_cast<size_t>(tick) & (SlotCount - 1)];
+            size_t kept = 0;
+            for(size_t i = 0; i < slot.size(); ++i) {
+                if(slot[i].tick <= nowTick) {
+                    --_size;
+                    expired(slot[i].key);
+                } else {
+                    if(kept != i) {
+                        slot[kept] = std::move(slot[i]);
+                    }
+                    ++kept;
+                }
+            }
+            slot.erase(slot.begin() + static_cast<std::ptrdiff_t>(kept), slot.end());
+        }
+    }
+
+private:
+    struct Entry {
+        Key key;
+        int64_t tick;
+    };
+
+    std::array<std::vector<Entry>, SlotCount> _slots;
+    int64_t _lastTick = 0;
+    size_t _size = 0;
+};
+} // namespace Twitch::IPC
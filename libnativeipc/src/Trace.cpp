@@ -0,0 +1,128 @@
+// Copyright Twitch Interactive, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: MIT
+
+#include "Trace.h"
+#include "Tracing.h"
+#include <uv.h>
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+using namespace Twitch::IPC;
+
+std::atomic<bool> Trace::g_enabled{false};
+
+namespace {
+constexpr size_t RingCapacity = 8192;
+
+// The most recent events of one thread. Only that thread writes, so recording is a store and a
+// counter bump; dump copies out what was written since it last looked.
+struct EventRing {
+    explicit EventRing(uint32_t t)
+        : thread(t)
+    {
+    }
+
+    Trace::Event events[RingCapacity]{};
+    std::atomic<uint64_t> written{0};
+    // Guarded by s_ringsMutex
+    uint64_t dumped{0};
+    const uint32_t thread;
+};
+
+std::mutex s_ringsMutex;
+std::vector<std::shared_ptr<EventRing>> s_rings;
+uint32_t s_nextThread = 1;
+thread_local std::shared_ptr<EventRing> t_ring;
+
+EventRing &threadRing()
+{
+    if(!t_ring) {
+        std::lock_guard lock(s_ringsMutex);
+        t_ring = std::make_shared<EventRing>(s_nextThread++);
+        s_rings.push_back(t_ring);
+    }
+    return *t_ring;
+}
+
+void appendEvent(std::string &json, const Trace::Event &event, uint32_t thread, int processId)
+{
+    char line[256];
+    snprintf(line,
+        sizeof(line),
+        R"(%s{"name":"%s","cat":"nativeipc","ph":"X","pid":%d,"tid":%u,"ts":%.3f,"dur":%.3f,)"
+        R"("args":{"connection":%u,"id":%u}})",
+        json.back() == '[' ? "" : ",\n",
+        event.name,
+        processId,
+        thread,
+        static_cast<double>(event.start) / 1000.0,
+        static_cast<double>(event.duration) / 1000.0,
+        event.connection,
+        event.id);
+    json += line;
+}
+} // namespace
+
+void Trace::record(const char *name, uint64_t start, Handle connection, Handle id)
+{
+    auto &ring = threadRing();
+    const auto written = ring.written.load(std::memory_order_relaxed);
+    ring.events[written % RingCapacity] = {name, start, now() - start, connection, id};
+    ring.written.store(written + 1, std::memory_order_release);
+}
+
+namespace Twitch::IPC::Tracing {
+NATIVEIPC_LIBSPEC bool available()
+{
+    return NATIVEIPC_TRACING != 0;
+}
+
+NATIVEIPC_LIBSPEC void start()
+{
+    Trace::g_enabled = true;
+}
+
+NATIVEIPC_LIBSPEC void stop()
+{
+    Trace::g_enabled = false;
+}
+
+NATIVEIPC_LIBSPEC std::string dump()
+{
+    // Timestamps are on the steady clock, which processes on the same machine share, so the dumps of
+    // both ends of a connection can be loaded together
+    const auto processId = static_cast<int>(uv_os_getpid());
+    std::string json = R"({"displayTimeUnit":"ns","traceEvents":[)";
+    std::vector<Trace::Event> events;
+    std::lock_guard lock(s_ringsMutex);
+    for(auto &ring : s_rings) {
+        const auto end = ring->written.load(std::memory_order_acquire);
+        const auto begin = std::max(ring->dumped, end > RingCapacity ? end - RingCapacity : 0);
+        events.clear();
+        for(auto i = begin; i < end; ++i) {
+            events.push_back(ring->events[i % RingCapacity]);
+        }
+        // The thread kept going while we copied, and anything it has lapped since may be torn
+        const auto lapped = ring->written.load(std::memory_order_acquire);
+        const auto firstIntact = lapped > RingCapacity ? lapped - RingCapacity : 0;
+        for(auto i = begin; i < end; ++i) {
+            if(i >= firstIntact) {
+                appendEvent(json, events[i - begin], ring->thread, processId);
+            }
+        }
+        ring->dumped = end;
+    }
+    // Threads that have exited won't record any more, and have just been drained
+    s_rings.erase(std::remove_if(s_rings.begin(),
+                      s_rings.end(),
+                      [](const std::shared_ptr<EventRing> &ring) {
+                          return ring.use_count() == 1 && ring->dumped == ring->written.load();
+                      }),
+        s_rings.end());
+    json += "]}";
+    return json;
+}
+} // namespace Twitch::IPC::Tracing
@@ -0,0 +1,82 @@
+// Copyright Twitch Interactive, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include "IConnection.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#ifndef NATIVEIPC_TRACING
+#define NATIVEIPC_TRACING 1
+#endif
+
+namespace Twitch::IPC::Trace {
+// One stage of one message: where it was, from when, and for how long, in steady clock nanoseconds
+struct Event {
+    const char *name;
+    uint64_t start;
+    uint64_t duration;
+    uint32_t connection;
+    uint32_t id;
+};
+
+extern std::atomic<bool> g_enabled;
+
+inline uint64_t now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+// A start time for record, or 0 while tracing is off so that the end of the stage is skipped too
+inline uint64_t begin()
+{
+    return g_enabled.load(std::memory_order_relaxed) ? now() : 0;
+}
+
+// Adds a stage that started at `start` and ends now to this thread's ring
+void record(const char *name, uint64_t start, Handle connection, Handle id);
+
+class Scope {
+public:
+    Scope(const char *name, Handle connection, Handle id = 0)
+        : _name(name)
+        , _start(begin())
+        , _connection(connection)
+        , _id(id)
+    {
+    }
+    ~Scope()
+    {
+        if(_start) {
+            record(_name, _start, _connection, _id);
+        }
+    }
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+
+private:
+    const char *_name;
+    uint64_t _start;
+    Handle _connection;
+    Handle _id;
+};
+} // namespace Twitch::IPC::Trace
+
+// Stages either start with TRACE_BEGIN into a `tracedAt` field kept only in tracing builds and end with
+// TRACE_END, or cover a block with TRACE_SCOPE. Without NATIVEIPC_TRACING they expand to nothing.
+#if NATIVEIPC_TRACING
+#define TRACE_BEGIN(startField) ((startField) = Twitch::IPC::Trace::begin())
+#define TRACE_END(name, startField, connection, id)                                                \
+    do {                                                                                           \
+        if(startField)                                                                             \
+            Twitch::IPC::Trace::record(name, startField, connection, id);                          \
+    } while(false)
+#define TRACE_SCOPE(name, ...) const Twitch::IPC::Trace::Scope traceScope(name, __VA_ARGS__)
+#else
+#define TRACE_BEGIN(startField) ((void)0)
+#define TRACE_END(name, startField, connection, id) ((void)0)
+#define TRACE_SCOPE(name, ...) ((void)0)
+#endif
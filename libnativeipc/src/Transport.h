@@ -5,5 +5,9 @@
 
 namespace Twitch::IPC::Transport {
 struct Pipe;
+// A pipe for connection setup and wakeups, with the messages themselves going through shared memory
+struct SharedMemory;
 struct TCP;
+// Both ends in the same process, handing payloads straight to each other without serializing them
+struct InProc;
 } // namespace Twitch::IPC::Transport
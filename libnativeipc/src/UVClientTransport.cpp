@@ -5,6 +5,7 @@
 
 #include "UVClientTransport.h"
 #include "LogMacrosNoHandle.h"
+#include <algorithm>
 #include <cassert>
 
 using namespace Twitch::IPC;
@@ -12,12 +13,15 @@ using namespace Twitch::IPC;
 UVClientTransport::UVClientTransport()
 {
     _connect.data = this;
-    _retry.data = this;
+    _retry.data = static_cast<UVTransportBase *>(this);
+    // Everything the client sends goes to connection 0
+    openWriteBudget(0);
 }
 
 void UVClientTransport::destroy()
 {
-    if(_thread.joinable()) {
+    waitUntilStarted();
+    if(_loop) {
         LOG_DEBUG("Waiting for disconnect to complete");
         {
             std::lock_guard guard(_mutex);
@@ -29,9 +33,8 @@ void UVClientTransport::destroy()
                 sendStateChanged(guard);
             }
         }
-        _thread.join();
+        waitUntilFinished();
     }
-    closeLoop();
 }
 
 ConnectResult UVClientTransport::connect(std::string endpoint)
@@ -43,10 +46,8 @@ ConnectResult UVClientTransport::connect(std::string endpoint)
     _status = Status::Connecting;
     _endpoint = std::move(endpoint);
 
-    initSemaphore();
-    _thread = std::thread([this] { runLoopThread(); });
-    waitForSemaphore();
-    
+    startOnLoop([this] { startConnecting(); });
+
     switch(_status) {
     case Status::Connecting:
         return ConnectResult::Connecting;
@@ -61,16 +62,113 @@ ConnectResult UVClientTransport::connect(std::string endpoint)
     return ConnectResult::Failed;
 }
 
+void UVClientTransport::connectAsync(std::string endpoint)
+{
+    assert(_status == Status::Disconnected);
+    assert(_endpoint.empty());
+    LOG_INFO("Connecting to " + endpoint + " in the background");
+
+    _status = Status::Connecting;
+    _endpoint = std::move(endpoint);
+
+    startOnLoop([this] { startConnecting(); }, false);
+}
+
 void UVClientTransport::send(Handle connectionHandle, Handle promiseId, Payload message)
 {
     addToWriteQueue(connectionHandle, promiseId, std::move(message));
 }
 
+void UVClientTransport::sendMany(Handle connectionHandle, const std::vector<Handle> &promiseIds, std::vector<Payload> messages)
+{
+    addManyToWriteQueue(connectionHandle, promiseIds, std::move(messages));
+}
+
+bool UVClientTransport::trySend(Handle connectionHandle, Handle promiseId, Payload message)
+{
+    return addToWriteQueue(connectionHandle, promiseId, std::move(message), true);
+}
+
+void UVClientTransport::sendInvoke(Handle connectionHandle,
+    Handle promiseId,
+    Payload message,
+    std::chrono::steady_clock::time_point deadline)
+{
+    addInvokeToWriteQueue(connectionHandle, promiseId, std::move(message), deadline);
+}
+
+void UVClientTransport::sendWithPriority(Handle connectionHandle,
+    Handle promiseId,
+    Payload message,
+    Priority priority,
+    std::chrono::steady_clock::time_point deadline)
+{
+    addInvokeToWriteQueue(connectionHandle, promiseId, std::move(message), deadline, priority);
+}
+
 void UVClientTransport::setLogLevel(LogLevel level)
 {
     _logLevel = level;
 }
 
+void UVClientTransport::setWriteBatchLimits(size_t maxBytes, size_t maxMessages)
+{
+    _writeBatchMaxBytes = maxBytes;
+    _writeBatchMaxMessages = maxMessages;
+}
+
+void UVClientTransport::setWriteQueueLimits(size_t maxBytes, size_t maxMessages)
+{
+    _writeQueueMaxBytes = maxBytes;
+    _writeQueueMaxMessages = maxMessages;
+}
+
+void UVClientTransport::setCompressionThreshold(size_t minBytes)
+{
+    _compressionThreshold = minBytes;
+}
+
+void UVClientTransport::setMaxFrameSize(size_t maxBytes)
+{
+    _maxFrameSize = maxBytes;
+}
+
+bool UVClientTransport::fitsPeer(Handle connectionHandle, size_t size)
+{
+    return fitsPeerFrame(connectionHandle, size);
+}
+
+void UVClientTransport::setCounters(std::shared_ptr<TransportCounters> counters)
+{
+    useCounters(std::move(counters));
+}
+
+void UVClientTransport::setLoopThread(std::shared_ptr<LoopThread> loopThread)
+{
+    useLoopThread(std::move(loopThread));
+}
+
+void UVClientTransport::setReconnectPolicy(const ReconnectPolicy &policy)
+{
+    assert(_status == Status::Disconnected);
+    _reconnectPolicy = policy;
+}
+
+bool UVClientTransport::sendShared(Handle connectionHandle, NativeHandle handle, size_t size)
+{
+    return addSharedToWriteQueue(connectionHandle, handle, size);
+}
+
+bool UVClientTransport::sendChunk(Handle connectionHandle, Handle streamId, Payload chunk, bool last)
+{
+    return addChunkToWriteQueue(connectionHandle, streamId, std::move(chunk), last);
+}
+
+bool UVClientTransport::sendLatest(Handle connectionHandle, uint32_t channel, Payload value)
+{
+    return addLatestToWriteQueue(connectionHandle, channel, std::move(value));
+}
+
 void UVClientTransport::onConnect(OnHandler handler)
 {
     _connectHandler = std::move(handler);
@@ -86,11 +184,41 @@ void UVClientTransport::onData(OnDataHandler handler)
     _dataHandler = std::move(handler);
 }
 
+void UVClientTransport::onSharedData(OnSharedDataHandler handler)
+{
+    _sharedDataHandler = std::move(handler);
+}
+
+void UVClientTransport::onChunk(OnChunkHandler handler)
+{
+    _chunkHandler = std::move(handler);
+}
+
+void UVClientTransport::onLatest(OnLatestHandler handler)
+{
+    _latestHandler = std::move(handler);
+}
+
 void UVClientTransport::onError(OnHandler handler)
 {
     _errorHandler = std::move(handler);
 }
 
+void UVClientTransport::onBackpressure(OnHandler handler)
+{
+    _backpressureHandler = std::move(handler);
+}
+
+void UVClientTransport::onWritable(OnHandler handler)
+{
+    _writableHandler = std::move(handler);
+}
+
+void UVClientTransport::onInvokeTimeout(OnInvokeTimeoutHandler handler)
+{
+    _invokeTimeoutHandler = std::move(handler);
+}
+
 void UVClientTransport::onLog(OnLogHandler handler, LogLevel level)
 {
     _logLevel = level;
@@ -99,7 +227,7 @@ void UVClientTransport::onLog(OnLogHandler handler, LogLevel level)
 
 UVTransportBase::ClientInfo *UVClientTransport::getClientInfo(uv_stream_t *stream)
 {
-    return _clientInfo->stream == stream ? _clientInfo.get() : nullptr;
+    return _clientInfo && _clientInfo->stream == stream ? _clientInfo.get() : nullptr;
 }
 
 UVTransportBase::ClientInfo *UVClientTransport::getClientInfo(Handle connectionHandle)
@@ -114,18 +242,28 @@ void UVClientTransport::connect_cb(uv_connect_t *req, int status)
 
 void UVClientTransport::handleConnected(uv_stream_t *stream, int status)
 {
+    // A connect cancelled by closing the socket, which has been dealt with already
+    if(uv_is_closing(reinterpret_cast<uv_handle_t *>(stream))) {
+        return;
+    }
     _socket.reset(stream);
     if(!status) {
-        if (_retrying) {
-            uv_close(reinterpret_cast<uv_handle_t *>(&_retry), nullptr);
-            _retrying = false;
-        }
+        // The retry timer stays open for the next time the server goes away. Closing it here could leave
+        // it still closing when a quick disconnect wants it again.
+        pauseEndpointWatch();
+        resetRetryDelay();
         if (_status == Status::Connecting) {
             assert(stream == reinterpret_cast<uv_stream_t*>(_socket.get()));
             LOG_INFO("Successfully connected to " + _endpoint);
             setStatus(Status::Connected);
+            if(_wasConnected) {
+                ++_counters->reconnects;
+            }
+            _wasConnected = true;
             _clientInfo = std::make_unique<ClientInfo>(stream, getNextConnectionHandle());
             uv_read_start(stream, alloc_cb, read_cb);
+            meetPeer(_clientInfo.get(), 0);
+            sendHello(_clientInfo.get());
             if(_connectHandler) {
                 _connectHandler(0);
             }
@@ -137,22 +275,23 @@ void UVClientTransport::handleConnected(uv_stream_t *stream, int status)
         closeSocket();
         if(_status == Status::Connecting) {
             if (!_retrying) {
-                uv_timer_init(&_loop, &_retry);
+                uv_timer_init(_loop, &_retry);
+                trackHandle();
                 _retrying = true;
             }
-            if(_retryDelay < 1000) {
-                ++_retryDelay;
+            uv_timer_start(&_retry, timer_cb, nextRetryDelay(), 0);
+            if(_reconnectPolicy.waitForServer) {
+                watchEndpoint();
             }
-            uv_timer_start(&_retry, timer_cb, _retryDelay / 10, 0);
         }
     }
 }
 
 void UVClientTransport::timer_cb(uv_timer_t *handle)
 {
-    auto client = reinterpret_cast<UVClientTransport *>(handle->data);
+    auto &client = static_cast<UVClientTransport &>(*reinterpret_cast<UVTransportBase *>(handle->data));
     uv_timer_stop(handle);
-    client->handleTimer();
+    client.handleTimer();
 }
 
 void UVClientTransport::handleTimer()
@@ -162,12 +301,33 @@ void UVClientTransport::handleTimer()
     }
 }
 
+void UVClientTransport::retryNow()
+{
+    // Only while waiting on the timer; a connect that is already under way will start it again if it fails
+    if(_status != Status::Connecting || !_retrying || !uv_is_active(reinterpret_cast<uv_handle_t *>(&_retry))) {
+        return;
+    }
+    uv_timer_stop(&_retry);
+    // The socket can show up a moment before the server listens on it, so if this attempt is too early
+    // the next few follow quickly
+    _retryDelay = std::min(1.0, static_cast<double>(_reconnectPolicy.initialDelay.count()));
+    _retryGrowth = 2;
+    connectSocket();
+}
+
 void UVClientTransport::handleDisconnected(uv_stream_t *stream)
 {
+    // A write that failed on a stream the read side has already seen close
+    if(stream != _socket.get()) {
+        return;
+    }
     LOG_DEBUG("Disconnected by server");
 
     uv_read_stop(stream);
     closeSocket();
+    if(_clientInfo) {
+        forgetPeer(_clientInfo.get());
+    }
     _clientInfo.reset();
 
     // If the client still expects us to be connected, start the reconnect logic
@@ -184,13 +344,14 @@ void UVClientTransport::handleDisconnected(uv_stream_t *stream)
 void UVClientTransport::doDisconnectCleanup(const std::unique_lock<std::mutex>&)
 {
     if (_socket) {
-        disconnectStream(reinterpret_cast<uv_stream_t *>(_socket.release()), _status == Status::Disconnecting && !_retrying);
+        disconnectStream(reinterpret_cast<uv_stream_t *>(_socket.release()), _status == Status::Disconnecting);
     }
     if (_retrying) {
         uv_timer_stop(&_retry);
-        uv_close(reinterpret_cast<uv_handle_t *>(&_retry), nullptr);
+        closeHandle(reinterpret_cast<uv_handle_t *>(&_retry), false);
         _retrying = false;
     }
+    closeEndpointWatch();
     if(_status == Status::Disconnecting) {
         _status = Status::Disconnected;
     }
@@ -222,36 +383,61 @@ void UVClientTransport::handleWrite(uv_stream_t *stream, int status)
     }
 }
 
-void UVClientTransport::runLoopThread()
+void UVClientTransport::startConnecting()
 {
-    _retryDelay = 20;
+    resetRetryDelay();
     if (!connectSocket()) {
         _endpoint.clear();
         _status = Status::Disconnected;
+        finishOnLoop();
+        if(startedAsync() && _errorHandler) {
+            _errorHandler(0);
+        }
         postSemaphore();
         return;
     }
     initStateChanged();
     postSemaphore();
-    uv_run(&_loop, UV_RUN_DEFAULT);
+}
+
+void UVClientTransport::resetRetryDelay()
+{
+    _retryDelay = static_cast<double>(_reconnectPolicy.initialDelay.count());
+    _retryGrowth = std::max(_reconnectPolicy.multiplier, 1.0);
+}
+
+uint64_t UVClientTransport::nextRetryDelay()
+{
+    const auto maxDelay = static_cast<double>(_reconnectPolicy.maxDelay.count());
+    auto delay = std::min(_retryDelay, maxDelay);
+    _retryDelay = std::min(delay * _retryGrowth, maxDelay);
+    if(_reconnectPolicy.jitter > 0) {
+        std::uniform_real_distribution<double> spread(-_reconnectPolicy.jitter, _reconnectPolicy.jitter);
+        delay += delay * spread(_jitter);
+    }
+    return static_cast<uint64_t>(std::max(delay, 0.0) + 0.5);
+}
+
+void UVClientTransport::closeOnLoop()
+{
     {
         std::lock_guard guard(_mutex);
         closeStateChanged(guard);
     }
+    closeInvokeTimer();
     closeSocket();
-    uv_run(&_loop, UV_RUN_DEFAULT);
+    closeEndpointWatch();
 
     _endpoint.clear();
     _clientInfo.reset();
     LOG_INFO("Connection finished with status " + statusName(_status));
+    finishOnLoop();
 }
 
 void UVClientTransport::closeSocket()
 {
     if (_socket) {
-        uv_close(reinterpret_cast<uv_handle_t *>(_socket.release()), [](uv_handle_t *handle){
-            delete handle;
-        });
+        closeHandle(reinterpret_cast<uv_handle_t *>(_socket.release()), true);
     }
 }
 
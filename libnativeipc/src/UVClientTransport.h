@@ -5,7 +5,7 @@
 
 #include "IClientTransport.h"
 #include "UVTransportBase.h"
-#include <thread>
+#include <random>
 
 namespace Twitch::IPC {
 class UVClientTransport
@@ -16,13 +16,42 @@ public:
     DELETE_COPY_AND_MOVE_CONSTRUCTORS(UVClientTransport);
 
     ConnectResult connect(std::string endpoint) override;
+    void connectAsync(std::string endpoint) override;
     void send(Handle connectionHandle, Handle promiseId, Payload message) override;
+    void sendMany(Handle connectionHandle, const std::vector<Handle> &promiseIds, std::vector<Payload> messages) override;
+    bool trySend(Handle connectionHandle, Handle promiseId, Payload message) override;
+    void sendInvoke(Handle connectionHandle,
+        Handle promiseId,
+        Payload message,
+        std::chrono::steady_clock::time_point deadline) override;
+    void sendWithPriority(Handle connectionHandle,
+        Handle promiseId,
+        Payload message,
+        Priority priority,
+        std::chrono::steady_clock::time_point deadline) override;
     void setLogLevel(LogLevel level) override;
+    void setWriteBatchLimits(size_t maxBytes, size_t maxMessages) override;
+    void setWriteQueueLimits(size_t maxBytes, size_t maxMessages) override;
+    void setCompressionThreshold(size_t minBytes) override;
+    void setMaxFrameSize(size_t maxBytes) override;
+    bool fitsPeer(Handle connectionHandle, size_t size) override;
+    void setCounters(std::shared_ptr<TransportCounters> counters) override;
+    void setLoopThread(std::shared_ptr<LoopThread> loopThread) override;
+    void setReconnectPolicy(const ReconnectPolicy &policy) override;
+    bool sendShared(Handle connectionHandle, NativeHandle handle, size_t size) override;
+    bool sendChunk(Handle connectionHandle, Handle streamId, Payload chunk, bool last) override;
+    bool sendLatest(Handle connectionHandle, uint32_t channel, Payload value) override;
 
     void onConnect(OnHandler handler) override;
     void onDisconnect(OnHandler handler) override;
     void onData(OnDataHandler handler) override;
+    void onSharedData(OnSharedDataHandler handler) override;
+    void onChunk(OnChunkHandler handler) override;
+    void onLatest(OnLatestHandler handler) override;
     void onError(OnHandler errorHandler) override;
+    void onBackpressure(OnHandler handler) override;
+    void onWritable(OnHandler handler) override;
+    void onInvokeTimeout(OnInvokeTimeoutHandler handler) override;
     void onLog(OnLogHandler logHandler, LogLevel level) override;
 
 protected:
@@ -40,8 +69,14 @@ protected:
     std::unique_ptr<uv_stream_t> _socket;
     uv_connect_t _connect{};
     uv_timer_t _retry{};
-    int _retryDelay{};
+    ReconnectPolicy _reconnectPolicy;
+    // How long the next retry waits before jitter, in milliseconds, and what it is multiplied by after
+    double _retryDelay{};
+    double _retryGrowth{};
+    std::minstd_rand _jitter{std::random_device{}()};
     bool _retrying{};
+    // Later connections are reconnects after the server went away
+    bool _wasConnected{};
 
     Status _status{Status::Disconnected};
 
@@ -53,6 +88,7 @@ protected:
     void handleWrite(uv_stream_t *handle, int status) override;
     void handleDisconnected(uv_stream_t *stream) override;
     void doDisconnectCleanup(const std::unique_lock<std::mutex>&) override;
+    void closeOnLoop() override;
 
     ClientInfo *getClientInfo(uv_stream_t *stream) override;
     ClientInfo *getClientInfo(Handle connectionHandle) override;
@@ -61,9 +97,17 @@ protected:
 
     void closeSocket();
     void setStatus(Status value);
-    void runLoopThread();
+    void startConnecting();
+    void resetRetryDelay();
+    uint64_t nextRetryDelay();
+    // Skips what is left of the wait, for when the server looks to be there
+    void retryNow();
     static std::string statusName(Status status);
 
     virtual bool connectSocket() = 0;
+    // Transports that can tell when the server comes up call retryNow once it does
+    virtual void watchEndpoint() {}
+    virtual void pauseEndpointWatch() {}
+    virtual void closeEndpointWatch() {}
 };
 } // namespace Twitch::IPC
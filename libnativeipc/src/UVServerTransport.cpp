@@ -17,6 +17,7 @@ UVServerTransport::UVServerTransport(bool latestConnectionOnly, bool allowMultiu
 
 void UVServerTransport::destroy()
 {
+    waitUntilStarted();
     {
         std::lock_guard guard(_mutex);
         if(_status == Status::Listening) {
@@ -24,11 +25,10 @@ void UVServerTransport::destroy()
             sendStateChanged(guard);
         }
     }
-    if(_thread.joinable()) {
+    if(_loop) {
         LOG_DEBUG(0, "Waiting for disconnect to complete");
-        _thread.join();
+        waitUntilFinished();
     }
-    closeLoop();
 }
 
 bool UVServerTransport::listen(std::string endpoint)
@@ -37,34 +37,159 @@ bool UVServerTransport::listen(std::string endpoint)
     assert(_endpoint.empty());
     _status = Status::Listening;
     _endpoint = std::move(endpoint);
-    initSemaphore();
-    _thread = std::thread([this] { runLoopThread(); });
-    waitForSemaphore();
+    startOnLoop([this] { listenOnLoop(); });
     return _status != Status::ListenFailed;
 }
 
+void UVServerTransport::listenAsync(std::string endpoint)
+{
+    assert(_status == Status::Disconnected);
+    assert(_endpoint.empty());
+    _status = Status::Listening;
+    _endpoint = std::move(endpoint);
+    startOnLoop([this] { listenOnLoop(); }, false);
+}
+
+bool UVServerTransport::serve()
+{
+    assert(_status == Status::Disconnected);
+    _status = Status::Listening;
+    startOnLoop([this] {
+        initStateChanged();
+        openAdoption();
+        postSemaphore();
+    });
+    return true;
+}
+
+void UVServerTransport::adoptClient(NativeHandle socket)
+{
+    bool adopted = false;
+    {
+        std::lock_guard guard(_adoptMutex);
+        if(_adoptOpen) {
+            _adopted.push_back(socket);
+            adopted = true;
+        }
+    }
+    // Gone already, or going
+    if(!adopted) {
+        closeNativeHandle(socket);
+        return;
+    }
+    wakeLoop();
+}
+
 void UVServerTransport::send(Handle connectionHandle, Handle promiseId, Payload message)
 {
     addToWriteQueue(connectionHandle, promiseId, std::move(message));
 }
 
+void UVServerTransport::sendMany(Handle connectionHandle, const std::vector<Handle> &promiseIds, std::vector<Payload> messages)
+{
+    addManyToWriteQueue(connectionHandle, promiseIds, std::move(messages));
+}
+
+bool UVServerTransport::trySend(Handle connectionHandle, Handle promiseId, Payload message)
+{
+    return addToWriteQueue(connectionHandle, promiseId, std::move(message), true);
+}
+
+void UVServerTransport::sendInvoke(Handle connectionHandle,
+    Handle promiseId,
+    Payload message,
+    std::chrono::steady_clock::time_point deadline)
+{
+    addInvokeToWriteQueue(connectionHandle, promiseId, std::move(message), deadline);
+}
+
+void UVServerTransport::sendWithPriority(Handle connectionHandle,
+    Handle promiseId,
+    Payload message,
+    Priority priority,
+    std::chrono::steady_clock::time_point deadline)
+{
+    addInvokeToWriteQueue(connectionHandle, promiseId, std::move(message), deadline, priority);
+}
+
 void UVServerTransport::broadcast(Payload message)
 {
-    size_t count = 0;
-    decltype(_clientsByStream) clients;
-    {
-        std::lock_guard guard(_clientMutex);
-        clients = _clientsByStream;
+    addBroadcastToWriteQueue(std::move(message));
+}
+
+void UVServerTransport::publish(std::string topic, Payload message)
+{
+    if(!topic.empty()) {
+        addBroadcastToWriteQueue(std::move(message), std::move(topic));
     }
-    for(auto &i : clients) {
-        if(count < clients.size() - 1) {
-            send(i.second->handle, 0, message);
-        } else {
-            send(i.second->handle, 0, std::move(message));
-            return;
+}
+
+void UVServerTransport::expandBroadcast(const WriteRequest &broadcastReq, std::vector<WritePair> &pending)
+{
+    if(broadcastReq.topic.empty()) {
+        for(const auto &i : _clientsByStream) {
+            expandBroadcastTo(i.second->handle, broadcastReq, pending);
         }
-        ++count;
+        return;
     }
+    const auto subscribers = _subscribers.find(broadcastReq.topic);
+    if(subscribers == _subscribers.end()) {
+        return;
+    }
+    for(const auto handle : subscribers->second) {
+        expandBroadcastTo(handle, broadcastReq, pending);
+    }
+}
+
+void UVServerTransport::expandBroadcastTo(Handle handle, const WriteRequest &broadcastReq, std::vector<WritePair> &pending)
+{
+    // Only a client that reads no frames this large misses out
+    auto budget = findWriteBudget(handle);
+    if(!fitsPeerFrame(budget.get(), broadcastReq.sharedData->size())) {
+        warnOverPeerFrame(handle, broadcastReq.sharedData->size());
+        return;
+    }
+    auto writeReq = newWriteRequest(handle, broadcastReq.header.handle, broadcastReq.sharedData);
+    chargeWrite(*writeReq, std::move(budget));
+    pending.emplace_back(handle, std::move(writeReq));
+}
+
+void UVServerTransport::handleSubscription(ClientInfo *client, bool subscribe, std::string topic)
+{
+    const auto handle = client->handle;
+    if(subscribe) {
+        LOG_DEBUG(handle, "Subscribed to " + topic);
+        _subscribers[topic].insert(handle);
+        _topicsByClient[handle].insert(std::move(topic));
+        return;
+    }
+    const auto subscribers = _subscribers.find(topic);
+    if(subscribers == _subscribers.end() || !subscribers->second.erase(handle)) {
+        return;
+    }
+    LOG_DEBUG(handle, "Unsubscribed from " + topic);
+    if(subscribers->second.empty()) {
+        _subscribers.erase(subscribers);
+    }
+    _topicsByClient[handle].erase(topic);
+}
+
+void UVServerTransport::removeSubscriptions(Handle connectionHandle)
+{
+    const auto topics = _topicsByClient.find(connectionHandle);
+    if(topics == _topicsByClient.end()) {
+        return;
+    }
+    for(const auto &topic : topics->second) {
+        const auto subscribers = _subscribers.find(topic);
+        if(subscribers != _subscribers.end()) {
+            subscribers->second.erase(connectionHandle);
+            if(subscribers->second.empty()) {
+                _subscribers.erase(subscribers);
+            }
+        }
+    }
+    _topicsByClient.erase(topics);
 }
 
 void UVServerTransport::setLogLevel(LogLevel level)
@@ -72,6 +197,68 @@ void UVServerTransport::setLogLevel(LogLevel level)
     _logLevel = level;
 }
 
+void UVServerTransport::setWriteBatchLimits(size_t maxBytes, size_t maxMessages)
+{
+    _writeBatchMaxBytes = maxBytes;
+    _writeBatchMaxMessages = maxMessages;
+}
+
+void UVServerTransport::setWriteQueueLimits(size_t maxBytes, size_t maxMessages)
+{
+    _writeQueueMaxBytes = maxBytes;
+    _writeQueueMaxMessages = maxMessages;
+}
+
+void UVServerTransport::setCompressionThreshold(size_t minBytes)
+{
+    _compressionThreshold = minBytes;
+}
+
+void UVServerTransport::setMaxFrameSize(size_t maxBytes)
+{
+    _maxFrameSize = maxBytes;
+}
+
+bool UVServerTransport::fitsPeer(Handle connectionHandle, size_t size)
+{
+    return fitsPeerFrame(connectionHandle, size);
+}
+
+void UVServerTransport::setCounters(std::shared_ptr<TransportCounters> counters)
+{
+    useCounters(std::move(counters));
+}
+
+void UVServerTransport::setLoopThread(std::shared_ptr<LoopThread> loopThread)
+{
+    useLoopThread(std::move(loopThread));
+}
+
+void UVServerTransport::setConnectionHandles(Handle first, Handle step)
+{
+    useConnectionHandles(first, step);
+}
+
+void UVServerTransport::shareClients(std::vector<IServerTransport *> workers)
+{
+    _workers = std::move(workers);
+}
+
+bool UVServerTransport::sendShared(Handle connectionHandle, NativeHandle handle, size_t size)
+{
+    return addSharedToWriteQueue(connectionHandle, handle, size);
+}
+
+bool UVServerTransport::sendChunk(Handle connectionHandle, Handle streamId, Payload chunk, bool last)
+{
+    return addChunkToWriteQueue(connectionHandle, streamId, std::move(chunk), last);
+}
+
+bool UVServerTransport::sendLatest(Handle connectionHandle, uint32_t channel, Payload value)
+{
+    return addLatestToWriteQueue(connectionHandle, channel, std::move(value));
+}
+
 int UVServerTransport::activeConnections()
 {
     std::lock_guard guard(_clientMutex);
@@ -93,6 +280,41 @@ void UVServerTransport::onData(OnDataHandler handler)
     _dataHandler = std::move(handler);
 }
 
+void UVServerTransport::onSharedData(OnSharedDataHandler handler)
+{
+    _sharedDataHandler = std::move(handler);
+}
+
+void UVServerTransport::onChunk(OnChunkHandler handler)
+{
+    _chunkHandler = std::move(handler);
+}
+
+void UVServerTransport::onLatest(OnLatestHandler handler)
+{
+    _latestHandler = std::move(handler);
+}
+
+void UVServerTransport::onBackpressure(OnHandler handler)
+{
+    _backpressureHandler = std::move(handler);
+}
+
+void UVServerTransport::onWritable(OnHandler handler)
+{
+    _writableHandler = std::move(handler);
+}
+
+void UVServerTransport::onError(OnHandler handler)
+{
+    _errorHandler = std::move(handler);
+}
+
+void UVServerTransport::onInvokeTimeout(OnInvokeTimeoutHandler handler)
+{
+    _invokeTimeoutHandler = std::move(handler);
+}
+
 void UVServerTransport::onNoInvokeClientHandler(OnNoInvokeClientHandler handler)
 {
     _noInvokeClientHandler = std::move(handler);
@@ -106,20 +328,14 @@ void UVServerTransport::onLog(OnLogHandler handler, LogLevel level)
 
 UVTransportBase::ClientInfo *UVServerTransport::getClientInfo(uv_stream_t *stream)
 {
-    std::lock_guard guard(_clientMutex);
     auto i = _clientsByStream.find(stream);
     return i == _clientsByStream.end() ? nullptr : i->second.get();
 }
 
 UVTransportBase::ClientInfo *UVServerTransport::getClientInfo(Handle connectionHandle)
 {
-    std::lock_guard guard(_clientMutex);
-    for(auto &i : _clientsByStream) {
-        if(i.second->handle == connectionHandle) {
-            return i.second.get();
-        }
-    }
-    return nullptr;
+    auto i = _clientsByHandle.find(connectionHandle);
+    return i == _clientsByHandle.end() ? nullptr : i->second;
 }
 
 void UVServerTransport::shutdownClients()
@@ -127,8 +343,12 @@ void UVServerTransport::shutdownClients()
     std::lock_guard guard(_clientMutex);
     for(const auto &i : _clientsByStream) {
         disconnectStream(i.second->stream, true);
+        closeWriteBudget(i.second->handle);
     }
     _clientsByStream.clear();
+    _clientsByHandle.clear();
+    _subscribers.clear();
+    _topicsByClient.clear();
 }
 
 void UVServerTransport::handleConnected(uv_stream_t *stream, int connectStatus)
@@ -142,33 +362,107 @@ void UVServerTransport::handleConnected(uv_stream_t *stream, int connectStatus)
     if((status = acceptClient(stream, clientStream)) != 0) {
         LOG_WARNING_WITH_ERROR_CODE(0, "Accept failed", status);
         handleDisconnected(clientStream);
-    } else {
-        clientStream->data = static_cast<UVTransportBase *>(this);
-        uv_read_start(clientStream, alloc_cb, read_cb);
-        auto handle = getNextConnectionHandle();
-        if(_latestConnectionOnly) {
-            decltype(_clientsByStream) tmp;
-            {
-                std::lock_guard guard(_clientMutex);
-                tmp.swap(_clientsByStream);
-            }
-            for(const auto &i : tmp) {
-                disconnectStream(i.second->stream, true);
-                if(_disconnectHandler) {
-                    _disconnectHandler(i.second->handle);
-                }
-            }
+    } else if(!handOffClient(clientStream)) {
+        addClient(clientStream);
+    }
+}
+
+bool UVServerTransport::handOffClient(uv_stream_t *clientStream)
+{
+    if(_workers.empty()) {
+        return false;
+    }
+    auto *worker = _workers[_nextWorker++ % _workers.size()];
+    if(worker == this) {
+        return false;
+    }
+#ifdef _WIN32
+    // Sockets and pipe instances stay tied to the completion port of the loop that opened them
+    return false;
+#else
+    uv_os_fd_t fd = -1;
+    NativeHandle socket{};
+    if(uv_fileno(reinterpret_cast<uv_handle_t *>(clientStream), &fd) || !duplicateNativeHandle(fd, socket)) {
+        LOG_WARNING(0, "Could not hand over a client, so serving it here");
+        return false;
+    }
+    // Only our descriptor closes, so the connection carries on through the worker's copy
+    closeHandle(reinterpret_cast<uv_handle_t *>(clientStream), true);
+    worker->adoptClient(socket);
+    return true;
+#endif
+}
+
+void UVServerTransport::handleWakeup()
+{
+    std::vector<NativeHandle> sockets;
+    {
+        std::lock_guard guard(_adoptMutex);
+        sockets.swap(_adopted);
+    }
+    for(const auto socket : sockets) {
+        uv_stream_t *clientStream{};
+        if(const auto status = openClient(socket, clientStream)) {
+            LOG_WARNING_WITH_ERROR_CODE(0, "Could not take over a client", status);
+            closeNativeHandle(socket);
+            handleDisconnected(clientStream);
+        } else {
+            addClient(clientStream);
         }
+    }
+}
+
+void UVServerTransport::openAdoption()
+{
+    std::lock_guard guard(_adoptMutex);
+    _adoptOpen = true;
+}
+
+void UVServerTransport::closeAdoption()
+{
+    std::lock_guard guard(_adoptMutex);
+    _adoptOpen = false;
+    for(const auto socket : _adopted) {
+        closeNativeHandle(socket);
+    }
+    _adopted.clear();
+}
+
+void UVServerTransport::addClient(uv_stream_t *clientStream)
+{
+    clientStream->data = static_cast<UVTransportBase *>(this);
+    uv_read_start(clientStream, alloc_cb, read_cb);
+    auto handle = getNextConnectionHandle();
+    if(_latestConnectionOnly) {
+        decltype(_clientsByStream) tmp;
         {
             std::lock_guard guard(_clientMutex);
-            _clientsByStream[clientStream] = std::make_shared<ClientInfo>(clientStream, handle);
+            tmp.swap(_clientsByStream);
+            _clientsByHandle.clear();
         }
-
-        LOG_DEBUG(handle, "Client connected");
-        if(_connectHandler) {
-            _connectHandler(handle);
+        _subscribers.clear();
+        _topicsByClient.clear();
+        for(const auto &i : tmp) {
+            disconnectStream(i.second->stream, true);
+            closeWriteBudget(i.second->handle);
+            if(_disconnectHandler) {
+                _disconnectHandler(i.second->handle);
+            }
         }
     }
+    auto client = std::make_shared<ClientInfo>(clientStream, handle);
+    openWriteBudget(handle);
+    {
+        std::lock_guard guard(_clientMutex);
+        _clientsByStream[clientStream] = client;
+        _clientsByHandle[handle] = client.get();
+    }
+    meetPeer(client.get(), handle);
+
+    LOG_DEBUG(handle, "Client connected");
+    if(_connectHandler) {
+        _connectHandler(handle);
+    }
 }
 
 void UVServerTransport::handleDisconnected(uv_stream_t *stream)
@@ -180,7 +474,11 @@ void UVServerTransport::handleDisconnected(uv_stream_t *stream)
         if(_disconnectHandler) {
             _disconnectHandler(client->handle);
         }
+        removeSubscriptions(client->handle);
+        forgetPeer(client);
+        closeWriteBudget(client->handle);
         std::lock_guard guard(_clientMutex);
+        _clientsByHandle.erase(client->handle);
         _clientsByStream.erase(stream);
     }
 }
@@ -215,7 +513,7 @@ void UVServerTransport::handleWrite(uv_stream_t *stream, int status)
     }
 }
 
-void UVServerTransport::runLoopThread()
+void UVServerTransport::listenOnLoop()
 {
 #ifndef _WIN32
     // libuv cleans up but we'll do this in case we crashed last time
@@ -226,6 +524,7 @@ void UVServerTransport::runLoopThread()
     initStateChanged();
 
     int status;
+    _bound = true;
     if((status = bind()) != 0) {
         // status codes >0 mean bad params rather than libuv error
         if (status < 0) {
@@ -237,21 +536,33 @@ void UVServerTransport::runLoopThread()
         setStatus(Status::ListenFailed);
     } else {
         LOG_INFO(0, "Started successfully");
+        openAdoption();
     }
-    postSemaphore();
-    if(_status != Status::ListenFailed) {
-        uv_run(&_loop, UV_RUN_DEFAULT);
+    if(_status == Status::ListenFailed) {
+        closeOnLoop();
+        if(startedAsync() && _errorHandler) {
+            _errorHandler(0);
+        }
     }
+    postSemaphore();
+}
+
+void UVServerTransport::closeOnLoop()
+{
     {
         std::lock_guard guard(_mutex);
         closeStateChanged(guard);
     }
+    closeAdoption();
+    closeInvokeTimer();
     LOG_INFO(0, "Shutting down");
-    closeBinder();
+    if(_bound) {
+        closeBinder();
+    }
     shutdownClients();
 
-    uv_run(&_loop, UV_RUN_NOWAIT);
     _endpoint.clear();
+    finishOnLoop();
 }
 
 void UVServerTransport::setStatus(Status value)
@@ -7,9 +7,10 @@
 #include "UVTransportBase.h"
 
 #include <atomic>
+#include <memory>
 #include <mutex>
-#include <thread>
 #include <unordered_map>
+#include <unordered_set>
 
 namespace Twitch::IPC {
 class UVServerTransport
@@ -20,14 +21,48 @@ public:
     DELETE_COPY_AND_MOVE_CONSTRUCTORS(UVServerTransport);
 
     bool listen(std::string endpoint) override;
+    void listenAsync(std::string endpoint) override;
     void send(Handle connectionHandle, Handle promiseId, Payload message) override;
+    void sendMany(Handle connectionHandle, const std::vector<Handle> &promiseIds, std::vector<Payload> messages) override;
+    bool trySend(Handle connectionHandle, Handle promiseId, Payload message) override;
+    void sendInvoke(Handle connectionHandle,
+        Handle promiseId,
+        Payload message,
+        std::chrono::steady_clock::time_point deadline) override;
+    void sendWithPriority(Handle connectionHandle,
+        Handle promiseId,
+        Payload message,
+        Priority priority,
+        std::chrono::steady_clock::time_point deadline) override;
     void broadcast(Payload message) override;
+    void publish(std::string topic, Payload message) override;
     void setLogLevel(LogLevel level) override;
+    void setWriteBatchLimits(size_t maxBytes, size_t maxMessages) override;
+    void setWriteQueueLimits(size_t maxBytes, size_t maxMessages) override;
+    void setCompressionThreshold(size_t minBytes) override;
+    void setMaxFrameSize(size_t maxBytes) override;
+    bool fitsPeer(Handle connectionHandle, size_t size) override;
+    void setCounters(std::shared_ptr<TransportCounters> counters) override;
+    void setLoopThread(std::shared_ptr<LoopThread> loopThread) override;
+    bool sendShared(Handle connectionHandle, NativeHandle handle, size_t size) override;
+    bool sendChunk(Handle connectionHandle, Handle streamId, Payload chunk, bool last) override;
+    bool sendLatest(Handle connectionHandle, uint32_t channel, Payload value) override;
     int activeConnections() override;
+    void setConnectionHandles(Handle first, Handle step) override;
+    void shareClients(std::vector<IServerTransport *> workers) override;
+    bool serve() override;
+    void adoptClient(NativeHandle socket) override;
 
     void onConnect(OnHandler handler) override;
     void onDisconnect(OnHandler handler) override;
     void onData(OnDataHandler handler) override;
+    void onSharedData(OnSharedDataHandler handler) override;
+    void onChunk(OnChunkHandler handler) override;
+    void onLatest(OnLatestHandler handler) override;
+    void onBackpressure(OnHandler handler) override;
+    void onWritable(OnHandler handler) override;
+    void onError(OnHandler handler) override;
+    void onInvokeTimeout(OnInvokeTimeoutHandler handler) override;
     void onNoInvokeClientHandler(OnNoInvokeClientHandler) override;
     void onLog(OnLogHandler handler, LogLevel level) override;
 
@@ -41,16 +76,43 @@ protected:
         Disconnecting,
     };
 
+    // Only the loop thread changes the client maps. It takes _clientMutex to do so, which keeps
+    // broadcast and activeConnections safe elsewhere, but its own lookups don't need the lock.
     std::mutex _clientMutex;
     std::unordered_map<uv_stream_t *, std::shared_ptr<ClientInfo>> _clientsByStream;
+    std::unordered_map<Handle, ClientInfo *> _clientsByHandle;
+    // Subscribers by topic along with each client's topics, so publishing only visits the subscribers
+    // and a disconnect only visits the client's own topics. Loop thread only.
+    std::unordered_map<std::string, std::unordered_set<Handle>> _subscribers;
+    std::unordered_map<Handle, std::unordered_set<std::string>> _topicsByClient;
     bool _latestConnectionOnly;
     bool _allowMultiuserAccess;
+    // Where accepted clients go in turn, when there is more than one loop to serve them. Loop thread only.
+    std::vector<IServerTransport *> _workers;
+    size_t _nextWorker{};
+    // Sockets handed over by the transport that accepted them, until the loop thread takes them
+    std::mutex _adoptMutex;
+    std::vector<NativeHandle> _adopted;
+    bool _adoptOpen{};
+    // Set once bind has initialized the binder, which transports that only serve never do
+    bool _bound{};
 
     Status _status{Status::Disconnected};
 
     void handleConnected(uv_stream_t *stream, int status) override;
     void handleDisconnected(uv_stream_t *stream) override;
     void handleWrite(uv_stream_t *stream, int status) override;
+    void handleWakeup() override;
+    void closeOnLoop() override;
+    // Returns false if the client is ours to serve
+    bool handOffClient(uv_stream_t *clientStream);
+    void addClient(uv_stream_t *clientStream);
+    void openAdoption();
+    void closeAdoption();
+    void expandBroadcast(const WriteRequest &broadcastReq, std::vector<WritePair> &pending) override;
+    void expandBroadcastTo(Handle handle, const WriteRequest &broadcastReq, std::vector<WritePair> &pending);
+    void handleSubscription(ClientInfo *client, bool subscribe, std::string topic) override;
+    void removeSubscriptions(Handle connectionHandle);
 
     ClientInfo *getClientInfo(uv_stream_t *stream) override;
     ClientInfo *getClientInfo(Handle connectionHandle) override;
@@ -60,9 +122,11 @@ protected:
 
     static std::string statusName(Status status);
     void setStatus(Status value);
-    void runLoopThread();
+    void listenOnLoop();
 
     virtual int acceptClient(uv_stream_t *stream, uv_stream_t *&) = 0;
+    // Wraps a socket that another transport accepted in a stream on our loop
+    virtual int openClient(NativeHandle socket, uv_stream_t *&) = 0;
     virtual int bind() = 0;
     virtual int startListening() = 0;
     virtual void closeBinder() = 0;
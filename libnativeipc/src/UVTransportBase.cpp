@@ -4,32 +4,167 @@
 #define NOMINMAX
 
 #include "UVTransportBase.h"
+#include "Compression.h"
 #include "LogMacrosWithHandle.h"
+#include <algorithm>
 #include <cassert>
+#include <cstring>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 using namespace Twitch::IPC;
 
-UVTransportBase::UVTransportBase()
+namespace {
+constexpr size_t MaxRecycledWriteRequests = 4096;
+constexpr size_t MaxFreeWriteBatches = 16;
+
+// Written requests come back from the loop threads through this list. A sending thread takes the
+// whole list into its own cache when it runs dry, so reusing a request never contends with other senders.
+IntrusiveMPSCQueue<WriteRequest> s_recycledWriteRequests;
+std::atomic<size_t> s_recycledWriteRequestCount{0};
+
+struct WriteRequestCache {
+    WriteRequest *head{};
+    WriteRequestCache() = default;
+    ~WriteRequestCache()
+    {
+        while(head) {
+            auto *next = head->next;
+            delete head;
+            head = next;
+        }
+    }
+    DELETE_COPY_AND_MOVE_CONSTRUCTORS(WriteRequestCache);
+};
+thread_local WriteRequestCache t_writeRequestCache;
+} // namespace
+
+void Twitch::IPC::closeNativeHandle(NativeHandle handle)
 {
-    uv_loop_init(&_loop);
+#ifdef _WIN32
+    CloseHandle(handle);
+#else
+    close(handle);
+#endif
 }
 
-void UVTransportBase::closeLoop()
+bool Twitch::IPC::duplicateNativeHandle(NativeHandle handle, NativeHandle &duplicate)
 {
-    if (uv_loop_close(&_loop)) {
-        uv_run(&_loop, UV_RUN_DEFAULT); /* Run pending callbacks */
-        auto result = uv_loop_close(&_loop);
-        if (result) {
-            uv_walk(&_loop,
-                [](uv_handle_t *handle, void *) {
-                if (!uv_is_closing(handle)) {
-                    uv_close(handle, nullptr);
-                }
-            }, nullptr); /* Close all handles */
-            uv_run(&_loop, UV_RUN_DEFAULT); /* Run pending callbacks */
-            result = uv_loop_close(&_loop);
+#ifdef _WIN32
+    const auto process = GetCurrentProcess();
+    return DuplicateHandle(process, handle, process, &duplicate, 0, FALSE, DUPLICATE_SAME_ACCESS);
+#else
+    duplicate = fcntl(handle, F_DUPFD_CLOEXEC, 0);
+    return duplicate >= 0;
+#endif
+}
+
+WriteRequest::~WriteRequest()
+{
+    releasePassedHandle();
+    // Dropped without being written, e.g. still queued when the transport went away
+    if(budget) {
+        if(inFlightBytes) {
+            budget->bytesInFlight -= inFlightBytes;
+        }
+        if(coalesces) {
+            budget->takeLatest(channel);
         }
-        assert(result == 0);
+        budget->credit(sizeof(MessageHeader) + header.bodySize);
+    }
+}
+
+void WriteRequest::releasePassedHandle()
+{
+    if(passesHandle) {
+        closeNativeHandle(passedHandle);
+        passesHandle = false;
+    }
+}
+
+void UVTransportBase::useLoopThread(std::shared_ptr<LoopThread> loopThread)
+{
+    assert(!_loop);
+    _loopThread = std::move(loopThread);
+}
+
+void UVTransportBase::startOnLoop(std::function<void()> setup, bool wait)
+{
+    if(!_loopThread) {
+        _loopThread = std::make_shared<LoopThread>();
+    }
+    _loop = _loopThread->loop();
+    initSemaphore();
+    _startPending = !wait;
+    _loopThread->post(std::move(setup));
+    if(wait) {
+        waitForSemaphore();
+    }
+}
+
+void UVTransportBase::waitUntilStarted()
+{
+    if(_startPending) {
+        waitForSemaphore();
+        _startPending = false;
+    }
+}
+
+void UVTransportBase::finishOnLoop()
+{
+    _finishing = true;
+    if(!_openHandles) {
+        std::lock_guard guard(_finishedMutex);
+        _finished = true;
+        _finishedCondVar.notify_all();
+    }
+}
+
+void UVTransportBase::waitUntilFinished()
+{
+    std::unique_lock lock(_finishedMutex);
+    _finishedCondVar.wait(lock, [this] { return _finished; });
+}
+
+void UVTransportBase::closeHandle(uv_handle_t *handle, bool owned)
+{
+    handle->data = this;
+    uv_close(handle, owned ? closeOwned_cb : close_cb);
+}
+
+void UVTransportBase::close_cb(uv_handle_t *handle)
+{
+    reinterpret_cast<UVTransportBase *>(handle->data)->handleClosed();
+}
+
+void UVTransportBase::closeOwned_cb(uv_handle_t *handle)
+{
+    const auto transport = reinterpret_cast<UVTransportBase *>(handle->data);
+    switch(handle->type) {
+    case UV_NAMED_PIPE:
+        delete reinterpret_cast<uv_pipe_t *>(handle);
+        break;
+    case UV_TCP:
+        delete reinterpret_cast<uv_tcp_t *>(handle);
+        break;
+    default:
+        delete handle;
+        break;
+    }
+    transport->handleClosed();
+}
+
+void UVTransportBase::handleClosed()
+{
+    assert(_openHandles);
+    // Once finished the transport may be destroyed at any moment, so this is the last thing it does
+    if(!--_openHandles && _finishing) {
+        std::lock_guard guard(_finishedMutex);
+        _finished = true;
+        _finishedCondVar.notify_all();
     }
 }
 
@@ -41,9 +176,46 @@ void UVTransportBase::connection_cb(uv_stream_t *stream, int status)
 void UVTransportBase::write_cb(uv_write_t *req, int status)
 {
     const auto handle = req->handle;
-    const auto writeReq = reinterpret_cast<WriteRequest *>(req);
-    delete writeReq;
-    reinterpret_cast<UVTransportBase *>(handle->data)->handleWrite(handle, status);
+    const auto transport = reinterpret_cast<UVTransportBase *>(handle->data);
+    std::unique_ptr<WriteRequest> writeReq(reinterpret_cast<WriteRequest *>(req));
+    TRACE_END("uv_write", writeReq->tracedAt, writeReq->connectionHandle, writeReq->header.handle);
+    --transport->_counters->writesInFlight;
+    if(status >= 0) {
+        transport->countSent(*writeReq);
+    }
+    transport->recycleWriteRequest(std::move(writeReq));
+    if(status >= 0) {
+        transport->resumeLanes(handle);
+    }
+    transport->handleWrite(handle, status);
+}
+
+void UVTransportBase::batchWrite_cb(uv_write_t *req, int status)
+{
+    const auto handle = req->handle;
+    const auto transport = reinterpret_cast<UVTransportBase *>(handle->data);
+    std::unique_ptr<WriteBatch> batch(reinterpret_cast<WriteBatch *>(req));
+    // The frames of a batch went to libuv together, so one event covers them all
+    TRACE_END("uv_write",
+        batch->requests.front()->tracedAt,
+        batch->requests.front()->connectionHandle,
+        static_cast<Handle>(batch->requests.size()));
+    --transport->_counters->writesInFlight;
+    for(auto &writeReq : batch->requests) {
+        if(status >= 0) {
+            transport->countSent(*writeReq);
+        }
+        transport->recycleWriteRequest(std::move(writeReq));
+    }
+    if(transport->_freeWriteBatches.size() < MaxFreeWriteBatches) {
+        batch->requests.clear();
+        batch->bufs.clear();
+        transport->_freeWriteBatches.emplace_back(std::move(batch));
+    }
+    if(status >= 0) {
+        transport->resumeLanes(handle);
+    }
+    transport->handleWrite(handle, status);
 }
 
 void UVTransportBase::stateChanged_cb(uv_async_t *req)
@@ -51,6 +223,11 @@ void UVTransportBase::stateChanged_cb(uv_async_t *req)
     reinterpret_cast<UVTransportBase *>(req->data)->handleStateChanged();
 }
 
+void UVTransportBase::invokeTimer_cb(uv_timer_t *handle)
+{
+    reinterpret_cast<UVTransportBase *>(handle->data)->handleInvokeTimer();
+}
+
 void UVTransportBase::alloc_cb(uv_handle_t *handle, size_t suggestedSize, uv_buf_t *buf)
 {
     reinterpret_cast<UVTransportBase *>(handle->data)->handleAlloc(handle, suggestedSize, buf);
@@ -78,6 +255,13 @@ void UVTransportBase::handleAlloc(uv_handle_t *handle, size_t suggestedSize, uv_
         return;
     }
 
+    if(client->directBody) {
+        const auto remaining = client->messageHeader.bodySize - client->bodyReceived;
+        buf->base = reinterpret_cast<char *>(client->messageBuffer.data() + client->bodyReceived);
+        buf->len = static_cast<decltype(buf->len)>(remaining);
+        return;
+    }
+
     if(client->receiveBuffer.size() < suggestedSize) {
         client->receiveBuffer.resize(suggestedSize);
     }
@@ -104,36 +288,28 @@ void UVTransportBase::handleRead(uv_stream_t *stream, ssize_t nread, const uv_bu
 
 void UVTransportBase::handleStateChanged()
 {
+    if(_finishing) {
+        return;
+    }
+    handleWakeup();
+    reportPostedBackpressure();
     std::unique_lock writeCondLock(_mutex);
     while(!_writeQueue.empty() && isConnected(writeCondLock)) {
-        auto [connectionHandle, writeReq] = readFromWriteQueue(writeCondLock);
         writeCondLock.unlock();
-
-        const auto client = getClientInfo(connectionHandle);
-        if(client) {
-            const auto buf = &writeReq->buf;
-            uv_write(reinterpret_cast<uv_write_t *>(writeReq.release()),
-                client->stream,
-                buf,
-                1,
-                write_cb);
-        } else if(_noInvokeClientHandler) {
-            auto *header = reinterpret_cast<MessageHeader *>(writeReq->buf.base);
-            if (header->handle) {
-                _noInvokeClientHandler(connectionHandle, header->handle);
-            }
-        }
+        takeWriteQueue();
+        writePending(_pendingWrites);
         writeCondLock.lock();
     }
     if(isDisconnecting(writeCondLock)) {
         doDisconnectCleanup(writeCondLock);
-        uv_stop(&_loop);
+        writeCondLock.unlock();
+        closeOnLoop();
     }
 }
 
 void UVTransportBase::handleLog(Handle handle, LogLevel level, std::string message)
 {
-    if(_logHandler && level >= _logLevel) {
+    if(level >= _logLevel.load(std::memory_order_relaxed) && _logHandler) {
         _logHandler(handle, level, message);
     }
 }
@@ -163,67 +339,822 @@ void UVTransportBase::postSemaphore()
 void UVTransportBase::initStateChanged()
 {
     _stateChanged.data = this;
-    uv_async_init(&_loop, &_stateChanged, stateChanged_cb);
+    uv_async_init(_loop, &_stateChanged, stateChanged_cb);
+    trackHandle();
+    _stateChangedOpen = true;
 }
 
 void UVTransportBase::sendStateChanged(const std::lock_guard<std::mutex> &)
 {
-    if(_stateChanged.data) {
+    wakeLoop();
+}
+
+void UVTransportBase::wakeLoop()
+{
+    // Senders don't hold _mutex, so they register themselves before checking the handle is open.
+    // closeStateChanged waits for them to leave before closing the handle out from under them.
+    ++_stateChangedSenders;
+    if(_stateChangedOpen) {
         uv_async_send(&_stateChanged);
     }
+    --_stateChangedSenders;
 }
 
 void UVTransportBase::closeStateChanged(const std::lock_guard<std::mutex> &)
 {
-    _stateChanged.data = nullptr;
-    uv_close(reinterpret_cast<uv_handle_t *>(&_stateChanged), nullptr);
+    _stateChangedOpen = false;
+    while(_stateChangedSenders) {
+        std::this_thread::yield();
+    }
+    closeHandle(reinterpret_cast<uv_handle_t *>(&_stateChanged), false);
+}
+
+void UVTransportBase::closeInvokeTimer()
+{
+    if(_invokeTimerOpen) {
+        closeHandle(reinterpret_cast<uv_handle_t *>(&_invokeTimer), false);
+        _invokeTimerOpen = false;
+    }
+}
+
+void UVTransportBase::trackInvokeTimeout(const WriteRequest &writeReq)
+{
+    _invokeTimeouts.add({writeReq.connectionHandle, writeReq.header.handle}, writeReq.deadline);
+    if(!_invokeTimerOpen) {
+        _invokeTimer.data = this;
+        uv_timer_init(_loop, &_invokeTimer);
+        trackHandle();
+        _invokeTimerOpen = true;
+    }
+    if(!uv_is_active(reinterpret_cast<uv_handle_t *>(&_invokeTimer))) {
+        const auto interval = static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::milliseconds>(decltype(_invokeTimeouts)::Resolution).count());
+        uv_timer_start(&_invokeTimer, invokeTimer_cb, interval, interval);
+    }
+}
+
+void UVTransportBase::handleInvokeTimer()
+{
+    _invokeTimeouts.advance(std::chrono::steady_clock::now(), [this](const std::pair<Handle, Handle> &invoke) {
+        if(_invokeTimeoutHandler) {
+            _invokeTimeoutHandler(invoke.first, invoke.second);
+        }
+    });
+    // Nothing left to time out, so the loop can go back to sleeping until there is
+    if(_invokeTimeouts.empty()) {
+        uv_timer_stop(&_invokeTimer);
+    }
+}
+
+bool UVTransportBase::addToWriteQueue(Handle connectionHandle, Handle promiseId, Payload &&message, bool mustFit)
+{
+    auto budget = findWriteBudget(connectionHandle);
+    if(!fitsPeerFrame(budget.get(), message.size())) {
+        warnOverPeerFrame(connectionHandle, message.size());
+        return false;
+    }
+    if(mustFit) {
+        // Nothing can drain for a connection we don't know, and an empty queue takes any message
+        if(!budget) {
+            return false;
+        }
+        if(budget->messages && overWriteLimits(*budget, sizeof(MessageHeader) + message.size(), 1)) {
+            reportBlocked(connectionHandle, budget);
+            return false;
+        }
+    }
+    auto writeReq = newWriteRequest(connectionHandle, promiseId, std::move(message));
+    compressBody(*writeReq, budget.get());
+    chargeWrite(*writeReq, std::move(budget));
+    // Only the push that finds the queue empty needs to wake the loop; later ones ride along
+    if(_writeQueue.push(std::move(writeReq))) {
+        wakeLoop();
+    }
+    return true;
+}
+
+void UVTransportBase::addInvokeToWriteQueue(Handle connectionHandle,
+    Handle promiseId,
+    Payload &&message,
+    std::chrono::steady_clock::time_point deadline,
+    Priority priority)
+{
+    auto budget = findWriteBudget(connectionHandle);
+    if(!fitsPeerFrame(budget.get(), message.size())) {
+        warnOverPeerFrame(connectionHandle, message.size());
+        return;
+    }
+    auto writeReq = newWriteRequest(connectionHandle, promiseId, std::move(message));
+    compressBody(*writeReq, budget.get());
+    writeReq->deadline = deadline;
+    writeReq->priority = priority;
+    chargeWrite(*writeReq, std::move(budget));
+    if(_writeQueue.push(std::move(writeReq))) {
+        wakeLoop();
+    }
+}
+
+void UVTransportBase::addManyToWriteQueue(
+    Handle connectionHandle, const std::vector<Handle> &promiseIds, std::vector<Payload> &&messages)
+{
+    if(messages.empty()) {
+        return;
+    }
+    // Linked newest first so the whole run goes onto the queue with one push and at most one wakeup
+    const auto budget = findWriteBudget(connectionHandle);
+    WriteRequest *newest = nullptr;
+    WriteRequest *oldest = nullptr;
+    for(size_t i = 0; i < messages.size(); ++i) {
+        if(!fitsPeerFrame(budget.get(), messages[i].size())) {
+            warnOverPeerFrame(connectionHandle, messages[i].size());
+            continue;
+        }
+        auto writeReq = newWriteRequest(connectionHandle, promiseIds.empty() ? 0 : promiseIds[i], std::move(messages[i]));
+        compressBody(*writeReq, budget.get());
+        chargeWrite(*writeReq, budget);
+        writeReq->next = newest;
+        newest = writeReq.release();
+        if(!oldest) {
+            oldest = newest;
+        }
+    }
+    if(newest && _writeQueue.pushList(newest, oldest)) {
+        wakeLoop();
+    }
+}
+
+void UVTransportBase::openWriteBudget(Handle connectionHandle)
+{
+    auto budget = std::make_shared<WriteBudget>();
+    std::lock_guard guard(_budgetMutex);
+    budget->counters = _counters;
+    _budgets[connectionHandle] = std::move(budget);
+    publishWriteBudgets(guard);
+}
+
+void UVTransportBase::closeWriteBudget(Handle connectionHandle)
+{
+    std::lock_guard guard(_budgetMutex);
+    _budgets.erase(connectionHandle);
+    publishWriteBudgets(guard);
+}
+
+void UVTransportBase::publishWriteBudgets(const std::lock_guard<std::mutex> &)
+{
+    auto snapshot = std::make_unique<const WriteBudgets>(_budgets);
+    _publishedBudgets.replace(snapshot.get());
+    _budgetSnapshot = std::move(snapshot);
+}
+
+void UVTransportBase::compressBody(WriteRequest &writeReq, const WriteBudget *budget)
+{
+    // Runs on the sending thread, so the loop thread only ever pays for decompressing
+    const size_t threshold = _compressionThreshold;
+    if(!threshold || !budget || !(budget->peerCodecs & Compression::Lz4Block) || writeReq.header.bodySize < threshold) {
+        return;
+    }
+    std::vector<uint8_t> compressed;
+    if(!Compression::compressFrame(writeReq.body(), writeReq.header.bodySize, compressed)) {
+        return;
+    }
+    writeReq.assign(writeReq.connectionHandle, writeReq.header.handle | CompressedFlag, std::move(compressed));
+}
+
+std::shared_ptr<WriteBudget> UVTransportBase::findWriteBudget(Handle connectionHandle)
+{
+    const auto budgets = _publishedBudgets.acquire();
+    if(!budgets) {
+        return nullptr;
+    }
+    const auto i = budgets->find(connectionHandle);
+    return i == budgets->end() ? nullptr : i->second;
+}
+
+void UVTransportBase::chargeWrite(WriteRequest &writeReq, std::shared_ptr<WriteBudget> budget)
+{
+    if(!budget) {
+        return;
+    }
+    budget->charge(sizeof(MessageHeader) + writeReq.header.bodySize);
+    if(overWriteLimits(*budget, 0, 0)) {
+        reportBlocked(writeReq.connectionHandle, budget);
+    }
+    writeReq.budget = std::move(budget);
+}
+
+bool UVTransportBase::overWriteLimits(const WriteBudget &budget, size_t extraBytes, size_t extraMessages) const
+{
+    const size_t maxBytes = _writeQueueMaxBytes;
+    const size_t maxMessages = _writeQueueMaxMessages;
+    return (maxBytes && budget.bytes + extraBytes > maxBytes) ||
+           (maxMessages && budget.messages + extraMessages > maxMessages);
+}
+
+bool UVTransportBase::fitsPeerFrame(Handle connectionHandle, size_t size)
+{
+    const auto budgets = _publishedBudgets.acquire();
+    if(!budgets) {
+        return true;
+    }
+    const auto i = budgets->find(connectionHandle);
+    return i == budgets->end() || fitsPeerFrame(i->second.get(), size);
+}
+
+bool UVTransportBase::fitsPeerFrame(const WriteBudget *budget, size_t size)
+{
+    const uint32_t limit = budget ? budget->peerMaxFrameSize.load() : 0;
+    return !limit || size <= limit;
+}
+
+void UVTransportBase::warnOverPeerFrame(Handle connectionHandle, size_t size)
+{
+    LOG_WARNING(connectionHandle, "Dropped a message of " + std::to_string(size) + " bytes, more than the peer reads");
+}
+
+void UVTransportBase::reportBlocked(Handle connectionHandle, const std::shared_ptr<WriteBudget> &budget)
+{
+    if(budget->blocked || budget->backpressurePosted.exchange(true)) {
+        return;
+    }
+    {
+        std::lock_guard guard(_backpressureMutex);
+        _postedBackpressure.emplace_back(connectionHandle, budget);
+    }
+    wakeLoop();
+}
+
+void UVTransportBase::reportPostedBackpressure()
+{
+    {
+        std::lock_guard guard(_backpressureMutex);
+        _reportingBackpressure.swap(_postedBackpressure);
+    }
+    for(const auto &[connectionHandle, budget] : _reportingBackpressure) {
+        budget->blocked = true;
+        if(_backpressureHandler) {
+            _backpressureHandler(connectionHandle);
+        }
+        budget->backpressurePosted = false;
+        // Everything may have drained while the report waited
+        reportWritableIfDrained(connectionHandle, *budget);
+    }
+    _reportingBackpressure.clear();
+}
+
+void UVTransportBase::reportWritableIfDrained(Handle connectionHandle, WriteBudget &budget)
+{
+    // Writable again once at half the limits, so a producer hovering at the limit doesn't flap
+    const size_t maxBytes = _writeQueueMaxBytes;
+    const size_t maxMessages = _writeQueueMaxMessages;
+    if(budget.blocked && (!maxBytes || budget.bytes <= maxBytes / 2) &&
+        (!maxMessages || budget.messages <= maxMessages / 2) &&
+        budget.blocked.exchange(false)) {
+        if(_writableHandler) {
+            _writableHandler(connectionHandle);
+        }
+    }
 }
 
-void UVTransportBase::addToWriteQueue(Handle connectionHandle, Handle promiseId, Payload &&message)
+void UVTransportBase::useCounters(std::shared_ptr<TransportCounters> counters)
 {
-    MessageHeader header{promiseId, static_cast<uint32_t>(message.size())};
+    // Budgets opened before this, like the client's, move over to the new counters
+    std::lock_guard guard(_budgetMutex);
+    _counters = std::move(counters);
+    for(auto &budget : _budgets) {
+        budget.second->counters = _counters;
+    }
+}
+
+void UVTransportBase::countSent(const WriteRequest &writeReq)
+{
+    // Only what the connection was asked to send; control frames are the transport's own business
+    if(writeReq.header.handle < ControlHandleBase) {
+        ++_counters->messagesSent;
+        _counters->bytesSent += writeReq.header.bodySize;
+    } else if(writeReq.header.handle == ControlHandle::StreamChunk) {
+        ++_counters->messagesSent;
+        _counters->bytesSent += writeReq.header.bodySize - sizeof(StreamChunkTrailer);
+    } else if(writeReq.header.handle == ControlHandle::LatestValue) {
+        ++_counters->messagesSent;
+        _counters->bytesSent += writeReq.header.bodySize - sizeof(LatestValueTrailer);
+    }
+}
+
+void UVTransportBase::addBroadcastToWriteQueue(Payload &&message, std::string topic)
+{
+    // Queued once and fanned out on the loop thread, so the body is never copied per client
+    auto writeReq = newWriteRequest(0, 0, std::make_shared<const std::vector<uint8_t>>(std::move(message)));
+    writeReq->broadcast = true;
+    writeReq->topic = std::move(topic);
+    if(_writeQueue.push(std::move(writeReq))) {
+        wakeLoop();
+    }
+}
+
+std::unique_ptr<WriteRequest> UVTransportBase::reuseWriteRequest()
+{
+    auto &cache = t_writeRequestCache;
+    if(!cache.head) {
+        cache.head = s_recycledWriteRequests.popAll();
+        for(auto *i = cache.head; i; i = i->next) {
+            --s_recycledWriteRequestCount;
+        }
+    }
+    if(!cache.head) {
+        return std::make_unique<WriteRequest>();
+    }
+    std::unique_ptr<WriteRequest> writeReq(cache.head);
+    cache.head = cache.head->next;
+    return writeReq;
+}
+
+std::unique_ptr<WriteRequest> UVTransportBase::newWriteRequest(
+    Handle connectionHandle, Handle promiseId, Payload &&message)
+{
+    auto writeReq = reuseWriteRequest();
+    writeReq->assign(connectionHandle, promiseId, std::move(message));
+    return writeReq;
+}
+
+std::unique_ptr<WriteRequest> UVTransportBase::newWriteRequest(
+    Handle connectionHandle, Handle promiseId, const WriteRequest::SharedBody &message)
+{
+    auto writeReq = reuseWriteRequest();
+    writeReq->assignShared(connectionHandle, promiseId, message);
+    return writeReq;
+}
+
+bool UVTransportBase::addSharedToWriteQueue(Handle connectionHandle, NativeHandle handle, size_t size)
+{
+    // A peer on an older version may still take handles; one that said hello without offering to can't
+    const auto budget = findWriteBudget(connectionHandle);
+    if(budget && budget->peerHello && !(budget->peerCapabilities & Capability::PassHandles)) {
+        return false;
+    }
+    NativeHandle duplicate{};
+    if(!_canPassHandles || !duplicateNativeHandle(handle, duplicate)) {
+        return false;
+    }
+    const uint64_t size64 = size;
+    const auto sizeBytes = reinterpret_cast<const uint8_t *>(&size64);
+    auto writeReq = newWriteRequest(connectionHandle,
+        ControlHandle::SharedHandle,
+        Payload(std::vector<uint8_t>(sizeBytes, sizeBytes + sizeof(size64))));
+    writeReq->passesHandle = true;
+    writeReq->passedHandle = duplicate;
+    if(_writeQueue.push(std::move(writeReq))) {
+        wakeLoop();
+    }
+    return true;
+}
+
+bool UVTransportBase::addChunkToWriteQueue(Handle connectionHandle, Handle streamId, Payload &&chunk, bool last)
+{
+    auto budget = findWriteBudget(connectionHandle);
+    if(budget && budget->peerHello && !(budget->peerCapabilities & Capability::StreamChunks)) {
+        return false;
+    }
+    if(chunk.size() > UINT32_MAX - sizeof(StreamChunkTrailer)) {
+        LOG_WARNING(connectionHandle, "Stream chunks must each fit in a frame; split it further");
+        return false;
+    }
+    if(!fitsPeerFrame(budget.get(), chunk.size() + sizeof(StreamChunkTrailer))) {
+        warnOverPeerFrame(connectionHandle, chunk.size());
+        return false;
+    }
+    // Appended rather than prepended, so the chunk stays where the caller put it
+    StreamChunkTrailer trailer{streamId, static_cast<uint8_t>(last ? 1 : 0)};
+    const auto trailerBytes = reinterpret_cast<const uint8_t *>(&trailer);
+    chunk.insert(chunk.end(), trailerBytes, trailerBytes + sizeof(trailer));
+    auto writeReq = newWriteRequest(connectionHandle, ControlHandle::StreamChunk, std::move(chunk));
+    // Streams carry what is too large to send at once, and other frames can go in between their chunks
+    writeReq->priority = Priority::Bulk;
+    // Charged like any message, so a producer that watches backpressure streams in bounded memory
+    chargeWrite(*writeReq, std::move(budget));
+    if(_writeQueue.push(std::move(writeReq))) {
+        wakeLoop();
+    }
+    return true;
+}
+
+bool UVTransportBase::addLatestToWriteQueue(Handle connectionHandle, uint32_t channel, Payload &&value)
+{
+    auto budget = findWriteBudget(connectionHandle);
+    if(budget && budget->peerHello && !(budget->peerCapabilities & Capability::LatestValues)) {
+        return false;
+    }
+    if(value.size() > UINT32_MAX - sizeof(LatestValueTrailer)) {
+        LOG_WARNING(connectionHandle, "Latest values must each fit in a frame");
+        return false;
+    }
+    if(!fitsPeerFrame(budget.get(), value.size() + sizeof(LatestValueTrailer))) {
+        warnOverPeerFrame(connectionHandle, value.size());
+        return false;
+    }
+    LatestValueTrailer trailer{channel};
+    const auto trailerBytes = reinterpret_cast<const uint8_t *>(&trailer);
+    value.insert(value.end(), trailerBytes, trailerBytes + sizeof(trailer));
+    // While the channel has a value queued, this one only takes its place. The one it replaces, if any
+    // did already, is dropped here rather than on the loop thread.
+    if(budget && budget->replaceLatest(channel, value)) {
+        ++_counters->latestValuesReplaced;
+        return true;
+    }
+    auto writeReq = newWriteRequest(connectionHandle, ControlHandle::LatestValue, std::move(value));
+    writeReq->coalesces = budget != nullptr;
+    writeReq->channel = channel;
+    chargeWrite(*writeReq, std::move(budget));
+    if(_writeQueue.push(std::move(writeReq))) {
+        wakeLoop();
+    }
+    return true;
+}
 
-    message.insert(message.begin(),
-        reinterpret_cast<uint8_t *>(&header),
-        reinterpret_cast<uint8_t *>(&header + 1));
+void UVTransportBase::takeLatestValue(WriteRequest &writeReq)
+{
+    writeReq.coalesces = false;
+    auto newer = writeReq.budget->takeLatest(writeReq.channel);
+    if(newer.empty()) {
+        return;
+    }
+    writeReq.budget->recharge(writeReq.header.bodySize, newer.size());
+    _bufferPool.release(std::move(writeReq.data));
+    writeReq.replaceBody(std::move(newer));
+}
 
-    std::lock_guard guard(_mutex);
-    _writeQueue.emplace(connectionHandle, new WriteRequest(std::move(message)));
-    sendStateChanged(guard);
+void UVTransportBase::recycleWriteRequest(std::unique_ptr<WriteRequest> writeReq)
+{
+    if(writeReq->sendHandle) {
+        closeHandle(reinterpret_cast<uv_handle_t *>(writeReq->sendHandle), true);
+        writeReq->sendHandle = nullptr;
+    }
+    writeReq->releasePassedHandle();
+    if(writeReq->budget) {
+        auto &budget = *writeReq->budget;
+        budget.bytesInFlight -= writeReq->inFlightBytes;
+        writeReq->inFlightBytes = 0;
+        if(writeReq->coalesces) {
+            budget.takeLatest(writeReq->channel);
+            writeReq->coalesces = false;
+        }
+        budget.credit(sizeof(MessageHeader) + writeReq->header.bodySize);
+        reportWritableIfDrained(writeReq->connectionHandle, budget);
+        writeReq->budget.reset();
+    }
+    // The last of a broadcast's requests frees its body here
+    writeReq->sharedData.reset();
+    _bufferPool.release(std::move(writeReq->data));
+    if(s_recycledWriteRequestCount < MaxRecycledWriteRequests) {
+        ++s_recycledWriteRequestCount;
+        s_recycledWriteRequests.push(std::move(writeReq));
+    }
 }
 
 void UVTransportBase::disconnectStream(uv_stream_t *stream, bool shutdown)
 {
     uv_read_stop(stream);
     if (shutdown) {
-        uv_shutdown(new uv_shutdown_t, stream, shutdown_cb);
-    } else {
-        uv_close(reinterpret_cast<uv_handle_t *>(stream), [](uv_handle_t *handle) {
-            delete handle;
-        });
+        auto req = new uv_shutdown_t;
+        if (!uv_shutdown(req, stream, shutdown_cb)) {
+            return;
+        }
+        // Nothing left to flush on a stream that can't be shut down, like one that already failed
+        delete req;
     }
+    closeHandle(reinterpret_cast<uv_handle_t *>(stream), true);
+}
+
+void UVTransportBase::useConnectionHandles(Handle first, Handle step)
+{
+    assert(!_loop && step);
+    _connectionHandleStep = step;
+    _lastConnectionHandle = first - step;
 }
 
 Handle UVTransportBase::getNextConnectionHandle()
 {
-    auto h = ++_lastConnectionHandle;
-    return h ? h : ++_lastConnectionHandle;
+    auto h = _lastConnectionHandle += _connectionHandleStep;
+    return h ? h : _lastConnectionHandle += _connectionHandleStep;
 }
 
 void UVTransportBase::handleShutdown(uv_stream_t *stream, int)
 {
     if (!uv_is_closing(reinterpret_cast<uv_handle_t *>(stream))) {
-        uv_close(reinterpret_cast<uv_handle_t *>(stream), [](uv_handle_t *handle) {
-            delete handle;
+        closeHandle(reinterpret_cast<uv_handle_t *>(stream), true);
+    }
+}
+
+void UVTransportBase::takeWriteQueue()
+{
+    auto *writeReq = _writeQueue.popAll();
+    while(writeReq) {
+        auto *next = writeReq->next;
+        writeReq->next = nullptr;
+        if(writeReq->broadcast) {
+            std::unique_ptr<WriteRequest> broadcastReq(writeReq);
+            expandBroadcast(*broadcastReq, _pendingWrites);
+            recycleWriteRequest(std::move(broadcastReq));
+        } else {
+            if(writeReq->deadline != std::chrono::steady_clock::time_point{}) {
+                trackInvokeTimeout(*writeReq);
+            }
+            _pendingWrites.emplace_back(writeReq->connectionHandle, writeReq);
+        }
+        writeReq = next;
+    }
+}
+
+void UVTransportBase::writePending(std::vector<WritePair> &pending)
+{
+    // Group messages by connection, keeping the order within each connection
+    _pendingWriteOrder.clear();
+    for(const auto &i : pending) {
+        _pendingWriteOrder.emplace(i.first, _pendingWriteOrder.size());
+    }
+    if(_pendingWriteOrder.size() > 1) {
+        std::stable_sort(pending.begin(), pending.end(), [this](const WritePair &a, const WritePair &b) {
+            return _pendingWriteOrder.at(a.first) < _pendingWriteOrder.at(b.first);
         });
     }
+
+    auto begin = pending.begin();
+    while(begin != pending.end()) {
+        const auto connectionHandle = begin->first;
+        const auto end = std::find_if(
+            begin, pending.end(), [connectionHandle](const WritePair &i) { return i.first != connectionHandle; });
+
+        const auto client = getClientInfo(connectionHandle);
+        if(client) {
+            for(auto i = begin; i != end; ++i) {
+                // An older peer would take a control frame for the result of an invoke, so none go out
+                // before its hello says it is newer
+                if(i->second->header.handle >= ControlHandleBase && !client->peer.version) {
+                    client->awaitingHello.emplace_back(std::move(i->second));
+                    continue;
+                }
+                client->lanes[static_cast<size_t>(i->second->priority)].emplace_back(std::move(i->second));
+                ++client->laneFrames;
+            }
+            drainLanes(client);
+        } else if(_noInvokeClientHandler) {
+            for(auto i = begin; i != end; ++i) {
+                const auto promiseId = i->second->header.handle;
+                if(promiseId && promiseId < ControlHandleBase) {
+                    _noInvokeClientHandler(connectionHandle, promiseId);
+                }
+            }
+        }
+        begin = end;
+    }
+    pending.clear();
 }
 
-UVTransportBase::WritePair UVTransportBase::readFromWriteQueue(const std::unique_lock<std::mutex> &)
+void UVTransportBase::drainLanes(ClientInfo *client)
 {
-    auto writeReq = std::move(_writeQueue.front());
-    _writeQueue.pop();
-    return writeReq;
+    const size_t maxBytes = _writeBatchMaxBytes;
+    const size_t maxMessages = std::max<size_t>(_writeBatchMaxMessages, 1);
+    const auto budget = client->budget.get();
+    const auto canWrite = [&] {
+        return client->laneFrames && (!budget || budget->bytesInFlight < MaxBytesInFlight);
+    };
+    // Each pass makes one write, as large as the batch limits allow
+    while(canWrite()) {
+        size_t bytes = 0;
+        while(canWrite() && _laneWrites.size() < maxMessages) {
+            auto &lanes = client->lanes;
+            auto &normal = lanes[static_cast<size_t>(Priority::Normal)];
+            auto &bulk = lanes[static_cast<size_t>(Priority::Bulk)];
+            auto *lane = &lanes[static_cast<size_t>(Priority::Control)];
+            if(lane->empty()) {
+                lane = !normal.empty() && (bulk.empty() || client->normalStreak < NormalFramesPerBulk) ? &normal : &bulk;
+            }
+            if(lane->front()->coalesces) {
+                takeLatestValue(*lane->front());
+            }
+            const auto size = sizeof(MessageHeader) + lane->front()->header.bodySize;
+            if(!_laneWrites.empty() && bytes + size > maxBytes) {
+                break;
+            }
+            if(lane == &normal) {
+                ++client->normalStreak;
+            } else if(lane == &bulk) {
+                client->normalStreak = 0;
+            }
+            auto writeReq = std::move(lane->front());
+            lane->pop_front();
+            --client->laneFrames;
+            bytes += size;
+            if(writeReq->budget) {
+                writeReq->inFlightBytes = size;
+                writeReq->budget->bytesInFlight += size;
+            }
+            _laneWrites.emplace_back(client->handle, std::move(writeReq));
+        }
+        writeToStream(client, _laneWrites.begin(), _laneWrites.end());
+        _laneWrites.clear();
+    }
+}
+
+void UVTransportBase::resumeLanes(uv_stream_t *stream)
+{
+    const auto client = getClientInfo(stream);
+    if(client && client->laneFrames) {
+        drainLanes(client);
+    }
+}
+
+void UVTransportBase::writeToStream(ClientInfo *client,
+    std::vector<WritePair>::iterator begin,
+    std::vector<WritePair>::iterator end)
+{
+    if(client->outboundRingAttached) {
+        writeThroughRing(client, begin, end);
+    } else {
+        writeFrames(client, begin, end);
+    }
+}
+
+void UVTransportBase::writeThroughRing(ClientInfo *client,
+    std::vector<WritePair>::iterator begin,
+    std::vector<WritePair>::iterator end)
+{
+    // Frames that fit go into the ring and the stream only carries a doorbell for each run of them.
+    // A frame that doesn't fit goes on the stream right after the doorbell for the frames before it,
+    // so the peer still sees everything in order.
+    auto &ring = *client->outboundRing;
+    uint32_t ringFrames = 0;
+    const auto ringDoorbell = [&] {
+        if(ringFrames) {
+            auto body = _bufferPool.acquire(sizeof(ringFrames));
+            const auto bytes = reinterpret_cast<const uint8_t *>(&ringFrames);
+            body.assign(bytes, bytes + sizeof(ringFrames));
+            _ringWrites.emplace_back(client->handle,
+                newWriteRequest(client->handle, ControlHandle::SharedMemoryDoorbell, std::move(body)));
+            ringFrames = 0;
+        }
+    };
+    for(auto i = begin; i != end; ++i) {
+        if(!i->second->passesHandle && ring.tryWrite(i->second->header, i->second->body())) {
+            traceWritten(*i->second);
+            ++ringFrames;
+            countSent(*i->second);
+            recycleWriteRequest(std::move(i->second));
+        } else {
+            ringDoorbell();
+            _ringWrites.emplace_back(std::move(*i));
+        }
+    }
+    ringDoorbell();
+    writeFrames(client, _ringWrites.begin(), _ringWrites.end());
+    _ringWrites.clear();
+}
+
+void UVTransportBase::traceWritten(WriteRequest &writeReq)
+{
+    TRACE_END("write queue", writeReq.tracedAt, writeReq.connectionHandle, writeReq.header.handle);
+    TRACE_BEGIN(writeReq.tracedAt);
+}
+
+void UVTransportBase::writeControlFrame(ClientInfo *client, Handle control, std::vector<uint8_t> &&body)
+{
+    std::vector<WritePair> frame;
+    frame.emplace_back(client->handle, newWriteRequest(client->handle, control, std::move(body)));
+    writeFrames(client, frame.begin(), frame.end());
+}
+
+void UVTransportBase::writeFrames(ClientInfo *client,
+    std::vector<WritePair>::iterator begin,
+    std::vector<WritePair>::iterator end)
+{
+    // A passed handle needs a write of its own so that it travels with its frame
+    auto run = begin;
+    for(auto i = begin; i != end; ++i) {
+        if(i->second->passesHandle) {
+            if(run != i) {
+                writeBatch(client, run, i);
+            }
+            writeWithHandle(client, std::move(i->second));
+            run = i + 1;
+        }
+    }
+    if(run != end) {
+        writeBatch(client, run, end);
+    }
+}
+
+void UVTransportBase::writeWithHandle(ClientInfo *client, std::unique_ptr<WriteRequest> writeReq)
+{
+    traceWritten(*writeReq);
+    const auto stream = client->stream;
+    const auto connectionHandle = writeReq->connectionHandle;
+#ifdef _WIN32
+    // libuv only passes sockets on Windows, so duplicate the handle straight into the peer process
+    // and send its value there instead
+    uv_os_fd_t pipe{};
+    ULONG serverProcess{};
+    ULONG clientProcess{};
+    uv_fileno(reinterpret_cast<uv_handle_t *>(stream), &pipe);
+    GetNamedPipeServerProcessId(pipe, &serverProcess);
+    GetNamedPipeClientProcessId(pipe, &clientProcess);
+    const auto peerProcessId = serverProcess == GetCurrentProcessId() ? clientProcess : serverProcess;
+    const auto peer = OpenProcess(PROCESS_DUP_HANDLE, FALSE, peerProcessId);
+    HANDLE remote{};
+    const auto duplicated = peer &&
+        DuplicateHandle(GetCurrentProcess(), writeReq->passedHandle, peer, &remote, 0, FALSE, DUPLICATE_SAME_ACCESS);
+    if(peer) {
+        CloseHandle(peer);
+    }
+    if(!duplicated) {
+        LOG_WARNING(connectionHandle, "Could not pass a shared payload handle to the peer");
+        recycleWriteRequest(std::move(writeReq));
+        return;
+    }
+    writeReq->releasePassedHandle();
+    const uint64_t remoteValue = reinterpret_cast<uintptr_t>(remote);
+    const auto remoteBytes = reinterpret_cast<const uint8_t *>(&remoteValue);
+    auto body = std::move(writeReq->data);
+    body.insert(body.end(), remoteBytes, remoteBytes + sizeof(remoteValue));
+    writeReq->assign(connectionHandle, ControlHandle::SharedHandle, std::move(body));
+    if(client->compactHeadersOut) {
+        writeReq->useCompactHeader();
+    }
+    const auto bufs = writeReq->bufs;
+    const auto bufCount = writeReq->bufCount();
+    ++_counters->writesInFlight;
+    uv_write(reinterpret_cast<uv_write_t *>(writeReq.release()), stream, bufs, bufCount, write_cb);
+#else
+    auto sendHandle = new uv_pipe_t;
+    uv_pipe_init(_loop, sendHandle, 0);
+    trackHandle();
+    const auto result = uv_pipe_open(sendHandle, writeReq->passedHandle);
+    if(result) {
+        LOG_WARNING_WITH_ERROR_CODE(connectionHandle, "Could not pass a shared payload handle", result);
+        closeHandle(reinterpret_cast<uv_handle_t *>(sendHandle), true);
+        recycleWriteRequest(std::move(writeReq));
+        return;
+    }
+    // The wrapper owns the descriptor now and is closed once the write completes
+    writeReq->passesHandle = false;
+    writeReq->sendHandle = sendHandle;
+    if(client->compactHeadersOut) {
+        writeReq->useCompactHeader();
+    }
+    const auto bufs = writeReq->bufs;
+    const auto bufCount = writeReq->bufCount();
+    ++_counters->writesInFlight;
+    uv_write2(reinterpret_cast<uv_write_t *>(writeReq.release()),
+        stream,
+        bufs,
+        bufCount,
+        reinterpret_cast<uv_stream_t *>(sendHandle),
+        write_cb);
+#endif
+}
+
+void UVTransportBase::writeBatch(ClientInfo *client,
+    std::vector<WritePair>::iterator begin,
+    std::vector<WritePair>::iterator end)
+{
+    const auto stream = client->stream;
+    for(auto i = begin; i != end; ++i) {
+        traceWritten(*i->second);
+        if(client->compactHeadersOut) {
+            i->second->useCompactHeader();
+        }
+    }
+    if(end - begin == 1) {
+        auto &writeReq = begin->second;
+        const auto bufs = writeReq->bufs;
+        const auto bufCount = writeReq->bufCount();
+        ++_counters->writesInFlight;
+        uv_write(reinterpret_cast<uv_write_t *>(writeReq.release()), stream, bufs, bufCount, write_cb);
+        return;
+    }
+
+    std::unique_ptr<WriteBatch> batch;
+    if(_freeWriteBatches.empty()) {
+        batch = std::make_unique<WriteBatch>();
+    } else {
+        batch = std::move(_freeWriteBatches.back());
+        _freeWriteBatches.pop_back();
+    }
+    batch->requests.reserve(end - begin);
+    batch->bufs.reserve(2 * (end - begin));
+    for(auto i = begin; i != end; ++i) {
+        auto &writeReq = i->second;
+        batch->bufs.insert(batch->bufs.end(), writeReq->bufs, writeReq->bufs + writeReq->bufCount());
+        batch->requests.emplace_back(std::move(writeReq));
+    }
+    const auto bufs = batch->bufs.data();
+    const auto bufCount = static_cast<unsigned>(batch->bufs.size());
+    ++_counters->writesInFlight;
+    uv_write(reinterpret_cast<uv_write_t *>(batch.release()), stream, bufs, bufCount, batchWrite_cb);
+}
+
+bool UVTransportBase::overFrameLimit(size_t bodySize) const
+{
+    const size_t limit = _maxFrameSize;
+    return limit && bodySize > limit;
 }
 
 void UVTransportBase::processBuffer(uv_stream_t *stream, const char *data, ssize_t length)
@@ -235,50 +1166,441 @@ void UVTransportBase::processBuffer(uv_stream_t *stream, const char *data, ssize
                 std::to_string(length));
         return;
     }
+    TRACE_SCOPE("read", client->handle, static_cast<Handle>(length));
 
     auto &messageBuffer = client->messageBuffer;
     auto &messageHeader = client->messageHeader;
 
     auto curPtr = reinterpret_cast<const uint8_t *>(data);
     const auto endPtr = curPtr + length;
-    const int headerSize = sizeof(MessageHeader);
+
+    // libuv read straight into the body handed out by handleAlloc, so there is nothing to copy
+    if(client->directBody && curPtr == messageBuffer.data() + client->bodyReceived) {
+        client->bodyReceived += static_cast<size_t>(length);
+        if(client->bodyComplete()) {
+            completeMessage(client);
+        }
+        return;
+    }
 
     while(curPtr < endPtr) {
-        if(messageBuffer.size() < headerSize) {
-            client->readToMessageBuffer(curPtr, endPtr, headerSize);
+        if(!client->headerComplete) {
+            int headerSize = 0;
+            if(messageBuffer.empty() && (headerSize = client->readHeader(curPtr, endPtr - curPtr)) > 0) {
+                curPtr += headerSize;
+
+                // The whole frame is already in the read buffer, so build the payload straight
+                // from it. Only frames that span reads go through messageBuffer.
+                if(!overFrameLimit(messageHeader.bodySize) && static_cast<size_t>(endPtr - curPtr) >= messageHeader.bodySize) {
+                    const auto body = curPtr;
+                    curPtr += messageHeader.bodySize;
+                    auto payload = _bufferPool.acquire(messageHeader.bodySize);
+                    payload.assign(body, curPtr);
+                    const auto promiseId = messageHeader.handle;
+                    messageHeader = {};
+                    deliverFrame(client, promiseId, std::move(payload));
+                    continue;
+                }
+            } else if(headerSize == 0) {
+                // The header spans reads. Gather what there is of it and see whether it is complete.
+                const auto had = messageBuffer.size();
+                client->readToMessageBuffer(curPtr, endPtr, client->maxHeaderSize());
+                headerSize = client->readHeader(messageBuffer.data(), messageBuffer.size());
+                if(headerSize == 0) {
+                    break;
+                }
+                if(headerSize > 0) {
+                    // Whatever was read past the header belongs to the body
+                    curPtr -= messageBuffer.size() - had;
+                    curPtr += headerSize - had;
+                    messageBuffer.clear();
+                }
+            }
+            if(headerSize < 0) {
+                LOG_WARNING(client->handle, "Malformed frame header. Dropping the connection");
+                handleDisconnected(stream);
+                return;
+            }
+            if(overFrameLimit(messageHeader.bodySize)) {
+                LOG_WARNING(client->handle,
+                    "Frame of " + std::to_string(messageHeader.bodySize) + " bytes is over the limit. Dropping the connection");
+                handleDisconnected(stream);
+                return;
+            }
+            client->headerComplete = true;
+            messageBuffer = _bufferPool.acquire(messageHeader.bodySize);
+            if(messageHeader.bodySize >= DirectReadThreshold) {
+                messageBuffer.resize(messageHeader.bodySize);
+                client->bodyReceived = 0;
+                client->directBody = true;
+            }
         }
 
-        if(messageBuffer.size() < headerSize) {
-            break;
+        if(client->directBody) {
+            client->readToDirectBody(curPtr, endPtr);
+        } else {
+            client->readToMessageBuffer(curPtr, endPtr, messageHeader.bodySize);
         }
 
-        if(messageHeader.bodySize == 0) {
-            messageHeader = reinterpret_cast<std::vector<MessageHeader> &>(messageBuffer)[0];
-            messageBuffer.clear();
+        if(client->bodyComplete()) {
+            completeMessage(client);
         }
+    }
+}
 
-        client->readToMessageBuffer(curPtr, endPtr, messageHeader.bodySize);
+void UVTransportBase::completeMessage(ClientInfo *client)
+{
+    std::vector<uint8_t> tmp;
+    std::swap(tmp, client->messageBuffer);
+    const auto promiseId = client->messageHeader.handle;
+    client->messageHeader = {};
+    client->headerComplete = false;
+    client->directBody = false;
+    client->bodyReceived = 0;
+    deliverFrame(client, promiseId, std::move(tmp));
+}
 
-        if(messageBuffer.size() == static_cast<size_t>(messageHeader.bodySize)) {
-            std::vector<uint8_t> tmp;
-            std::swap(tmp, messageBuffer);
-            if(_dataHandler) {
-                _dataHandler(client->handle, messageHeader.handle, std::move(tmp));
-            }
-            messageHeader = {};
+void UVTransportBase::deliverFrame(ClientInfo *client, Handle promiseId, std::vector<uint8_t> &&payload)
+{
+    if(promiseId == ControlHandle::StreamChunk) {
+        receiveChunk(client, std::move(payload));
+    } else if(promiseId == ControlHandle::LatestValue) {
+        receiveLatest(client, std::move(payload));
+    } else if(promiseId >= ControlHandleBase) {
+        handleControlFrame(client, promiseId, payload);
+        _bufferPool.release(std::move(payload));
+    } else {
+        ++_counters->messagesReceived;
+        _counters->bytesReceived += payload.size();
+        if(!decompressBody(client, promiseId, payload)) {
+            return;
+        }
+        if(_dataHandler) {
+            _dataHandler(client->handle, promiseId, std::move(payload));
+        }
+    }
+}
+
+bool UVTransportBase::decompressBody(ClientInfo *client, Handle &promiseId, std::vector<uint8_t> &payload)
+{
+    // Peers that never said they read compressed frames may use the bit in their own promise ids
+    if(!(client->peer.compressionCodecs & Compression::Lz4Block) || !(promiseId & CompressedFlag)) {
+        return true;
+    }
+    promiseId &= ~CompressedFlag;
+    auto body = _bufferPool.acquire(0);
+    const size_t maxFrameSize = _maxFrameSize;
+    const bool decompressed =
+        Compression::decompressFrame(payload.data(), payload.size(), body, maxFrameSize ? maxFrameSize : UINT32_MAX);
+    _bufferPool.release(std::move(payload));
+    if(!decompressed) {
+        LOG_WARNING(client->handle, "Dropped a compressed message that would not decompress");
+        _bufferPool.release(std::move(body));
+        return false;
+    }
+    payload = std::move(body);
+    return true;
+}
+
+void UVTransportBase::startSharedMemory(ClientInfo *client)
+{
+    if(!_sharedMemoryRingSize) {
+        return;
+    }
+    client->outboundRing = SharedMemoryRing::create(_sharedMemoryRingSize, _sharedMemoryMultiuserAccess);
+    if(!client->outboundRing) {
+        LOG_WARNING(client->handle, "Could not create a shared memory ring. Messages stay on the stream");
+        return;
+    }
+    const auto &name = client->outboundRing->name();
+    const uint64_t capacity = client->outboundRing->capacity();
+    const auto capacityBytes = reinterpret_cast<const uint8_t *>(&capacity);
+    auto body = _bufferPool.acquire(sizeof(capacity) + name.size());
+    body.insert(body.end(), capacityBytes, capacityBytes + sizeof(capacity));
+    body.insert(body.end(), name.begin(), name.end());
+    writeControlFrame(client, ControlHandle::SharedMemoryAttach, std::move(body));
+}
+
+void UVTransportBase::meetPeer(ClientInfo *client, Handle budgetHandle)
+{
+    client->budget = findWriteBudget(budgetHandle);
+    forgetPeer(client);
+}
+
+void UVTransportBase::sendHello(ClientInfo *client)
+{
+    client->helloSent = true;
+    // Codecs are advertised even when we don't compress ourselves, so the peer can
+    Hello hello{};
+    hello.version = ProtocolVersion;
+    hello.capabilities = Capability::SharedMemoryRing | Capability::CompactHeaders | Capability::StreamChunks |
+        Capability::LatestValues | (_canPassHandles ? Capability::PassHandles : 0);
+    hello.compressionCodecs = Compression::Lz4Block;
+    hello.maxFrameSize = static_cast<uint32_t>(std::min<size_t>(_maxFrameSize, UINT32_MAX));
+    const auto helloBytes = reinterpret_cast<const uint8_t *>(&hello);
+    auto body = _bufferPool.acquire(sizeof(hello));
+    body.insert(body.end(), helloBytes, helloBytes + sizeof(hello));
+    writeControlFrame(client, ControlHandle::Hello, std::move(body));
+}
+
+void UVTransportBase::forgetPeer(ClientInfo *client)
+{
+    // Credited back, as a peer that never said hello is gone without having taken them
+    for(auto &writeReq : client->awaitingHello) {
+        recycleWriteRequest(std::move(writeReq));
+    }
+    client->awaitingHello.clear();
+    client->peer = {};
+    if(client->budget) {
+        client->budget->peerHello = false;
+        client->budget->peerCapabilities = 0;
+        client->budget->peerCodecs = 0;
+        client->budget->peerMaxFrameSize = 0;
+    }
+}
+
+void UVTransportBase::handleHello(ClientInfo *client, const std::vector<uint8_t> &body)
+{
+    if(body.size() < sizeof(Hello) || client->peer.version) {
+        LOG_WARNING(client->handle, "Malformed or repeated hello");
+        return;
+    }
+    memcpy(&client->peer, body.data(), sizeof(Hello));
+    LOG_DEBUG(client->handle, "Peer speaks protocol version " + std::to_string(client->peer.version));
+    if(client->budget) {
+        client->budget->peerCapabilities = client->peer.capabilities;
+        client->budget->peerCodecs = client->peer.compressionCodecs;
+        client->budget->peerMaxFrameSize = client->peer.maxFrameSize;
+        client->budget->peerHello = true;
+    }
+    // Servers only answer a client's hello, so that clients on older versions never see one
+    if(!client->helloSent) {
+        sendHello(client);
+    }
+    if(client->peer.capabilities & Capability::CompactHeaders) {
+        // The switch itself still goes out with a fixed header
+        writeControlFrame(client, ControlHandle::CompactHeaders, {});
+        client->compactHeadersOut = true;
+    }
+    if(client->peer.capabilities & Capability::SharedMemoryRing) {
+        startSharedMemory(client);
+    }
+    releaseAwaitingHello(client);
+}
+
+void UVTransportBase::releaseAwaitingHello(ClientInfo *client)
+{
+    const auto capabilities = client->peer.capabilities;
+    for(auto &writeReq : client->awaitingHello) {
+        const auto control = writeReq->header.handle;
+        if((control == ControlHandle::StreamChunk && !(capabilities & Capability::StreamChunks)) ||
+            (control == ControlHandle::LatestValue && !(capabilities & Capability::LatestValues)) ||
+            (control == ControlHandle::SharedHandle && !(capabilities & Capability::PassHandles))) {
+            LOG_WARNING(client->handle, "Dropped a frame sent before the peer said it can't take them");
+            recycleWriteRequest(std::move(writeReq));
+            continue;
+        }
+        ++client->laneFrames;
+        client->lanes[static_cast<size_t>(writeReq->priority)].emplace_back(std::move(writeReq));
+    }
+    client->awaitingHello.clear();
+    drainLanes(client);
+}
+
+void UVTransportBase::handleControlFrame(ClientInfo *client, Handle control, const std::vector<uint8_t> &body)
+{
+    switch(control) {
+    case ControlHandle::SharedMemoryAttach: {
+        // Any transport maps a ring the peer offers, so a shared memory client works with a pipe server
+        uint64_t capacity{};
+        if(body.size() <= sizeof(capacity)) {
+            LOG_WARNING(client->handle, "Malformed shared memory attach request");
+            return;
+        }
+        memcpy(&capacity, body.data(), sizeof(capacity));
+        const std::string name(body.begin() + sizeof(capacity), body.end());
+        client->inboundRing = SharedMemoryRing::open(name, static_cast<size_t>(capacity));
+        if(!client->inboundRing) {
+            LOG_WARNING(client->handle, "Could not map shared memory ring " + name + ". Messages stay on the stream");
+            return;
+        }
+        LOG_DEBUG(client->handle, "Mapped shared memory ring " + name);
+        writeControlFrame(client, ControlHandle::SharedMemoryAttached, {});
+        break;
+    }
+    case ControlHandle::SharedMemoryAttached:
+        client->outboundRingAttached = client->outboundRing != nullptr;
+        break;
+    case ControlHandle::SharedMemoryDoorbell: {
+        uint32_t count{};
+        if(body.size() != sizeof(count)) {
+            LOG_WARNING(client->handle, "Malformed shared memory doorbell");
+            return;
         }
+        memcpy(&count, body.data(), sizeof(count));
+        readFromRing(client, count);
+        break;
+    }
+    case ControlHandle::SharedHandle:
+        receiveShared(client, body);
+        break;
+    case ControlHandle::Subscribe:
+    case ControlHandle::Unsubscribe:
+        handleSubscription(client, control == ControlHandle::Subscribe, std::string(body.begin(), body.end()));
+        break;
+    case ControlHandle::Hello:
+        handleHello(client, body);
+        break;
+    case ControlHandle::CompactHeaders:
+        client->compactHeadersIn = true;
+        break;
+    default:
+        // Sent by a newer peer; it can't rely on us understanding it
+        break;
     }
 }
 
+void UVTransportBase::readFromRing(ClientInfo *client, uint32_t count)
+{
+    const auto ring = client->inboundRing.get();
+    if(!ring) {
+        LOG_WARNING(client->handle, "Shared memory doorbell received without a mapped ring");
+        return;
+    }
+    TRACE_SCOPE("read", client->handle, count);
+    MessageHeader header{};
+    for(uint32_t i = 0; i < count; ++i) {
+        if(!ring->readHeader(header)) {
+            LOG_WARNING(client->handle, "Shared memory ring holds fewer messages than announced");
+            return;
+        }
+        if(overFrameLimit(header.bodySize)) {
+            // Left unread rather than dropping the connection, which would pull the client out from under
+            // the read that got us here
+            LOG_WARNING(client->handle, "Frame in the shared memory ring is over the limit. No longer reading the ring");
+            return;
+        }
+        auto payload = _bufferPool.acquire(header.bodySize);
+        payload.resize(header.bodySize);
+        ring->readBody(payload.data());
+        // Stream chunks and other control frames come through the ring too
+        deliverFrame(client, header.handle, std::move(payload));
+    }
+}
+
+int UVTransportBase::ClientInfo::readHeader(const uint8_t *data, size_t available)
+{
+    if(compactHeadersIn) {
+        return decodeCompactHeader(data, available, messageHeader);
+    }
+    if(available < sizeof(MessageHeader)) {
+        return 0;
+    }
+    memcpy(&messageHeader, data, sizeof(MessageHeader));
+    return sizeof(MessageHeader);
+}
+
 void UVTransportBase::ClientInfo::readToMessageBuffer(
-    const uint8_t *&curPtr, const uint8_t *endPtr, int finalLength)
+    const uint8_t *&curPtr, const uint8_t *endPtr, size_t finalLength)
 {
-    const auto bytesRemaining = static_cast<int>(endPtr - curPtr);
-    const auto bytesAvailable =
-        std::min(bytesRemaining, finalLength - static_cast<int>(messageBuffer.size()));
+    const auto bytesRemaining = static_cast<size_t>(endPtr - curPtr);
+    const auto bytesAvailable = std::min(bytesRemaining, finalLength - messageBuffer.size());
 
     messageBuffer.reserve(finalLength);
     messageBuffer.insert(messageBuffer.end(), curPtr, curPtr + bytesAvailable);
 
     curPtr += bytesAvailable;
 }
+
+void UVTransportBase::ClientInfo::readToDirectBody(const uint8_t *&curPtr, const uint8_t *endPtr)
+{
+    const auto bytesRemaining = static_cast<size_t>(endPtr - curPtr);
+    const auto bytesAvailable = std::min(bytesRemaining, messageHeader.bodySize - bodyReceived);
+
+    memcpy(messageBuffer.data() + bodyReceived, curPtr, bytesAvailable);
+    bodyReceived += bytesAvailable;
+    curPtr += bytesAvailable;
+}
+
+void UVTransportBase::receiveShared(ClientInfo *client, const std::vector<uint8_t> &body)
+{
+    uint64_t size{};
+    NativeHandle handle{};
+#ifdef _WIN32
+    uint64_t handleValue{};
+    if(body.size() != sizeof(size) + sizeof(handleValue)) {
+        LOG_WARNING(client->handle, "Malformed shared payload");
+        return;
+    }
+    memcpy(&handleValue, body.data() + sizeof(size), sizeof(handleValue));
+    handle = reinterpret_cast<NativeHandle>(static_cast<uintptr_t>(handleValue));
+#else
+    // libuv queues the descriptor that came with this frame on the stream, in order
+    const auto pipe = reinterpret_cast<uv_pipe_t *>(client->stream);
+    if(body.size() != sizeof(size) || !uv_pipe_pending_count(pipe)) {
+        LOG_WARNING(client->handle, "Shared payload arrived without its handle");
+        return;
+    }
+    auto received = new uv_pipe_t;
+    uv_pipe_init(_loop, received, 0);
+    trackHandle();
+    uv_os_fd_t fd = -1;
+    if(uv_accept(client->stream, reinterpret_cast<uv_stream_t *>(received)) == 0) {
+        uv_fileno(reinterpret_cast<uv_handle_t *>(received), &fd);
+        fd = fd < 0 ? fd : fcntl(fd, F_DUPFD_CLOEXEC, 0);
+    }
+    closeHandle(reinterpret_cast<uv_handle_t *>(received), true);
+    if(fd < 0) {
+        LOG_WARNING(client->handle, "Could not take the shared payload handle");
+        return;
+    }
+    handle = fd;
+#endif
+    memcpy(&size, body.data(), sizeof(size));
+    auto payload = SharedPayload::map(handle, static_cast<size_t>(size));
+    if(payload.size() != size) {
+        LOG_WARNING(client->handle, "Could not map the shared payload");
+        return;
+    }
+    if(_sharedDataHandler) {
+        _sharedDataHandler(client->handle, std::move(payload));
+    }
+}
+
+void UVTransportBase::receiveChunk(ClientInfo *client, std::vector<uint8_t> &&body)
+{
+    StreamChunkTrailer trailer{};
+    if(body.size() < sizeof(trailer)) {
+        LOG_WARNING(client->handle, "Malformed stream chunk");
+        _bufferPool.release(std::move(body));
+        return;
+    }
+    memcpy(&trailer, body.data() + body.size() - sizeof(trailer), sizeof(trailer));
+    body.resize(body.size() - sizeof(trailer));
+    ++_counters->messagesReceived;
+    _counters->bytesReceived += body.size();
+    if(_chunkHandler) {
+        _chunkHandler(client->handle, trailer.streamId, std::move(body), trailer.last != 0);
+    } else {
+        _bufferPool.release(std::move(body));
+    }
+}
+
+void UVTransportBase::receiveLatest(ClientInfo *client, std::vector<uint8_t> &&body)
+{
+    LatestValueTrailer trailer{};
+    if(body.size() < sizeof(trailer)) {
+        LOG_WARNING(client->handle, "Malformed latest value");
+        _bufferPool.release(std::move(body));
+        return;
+    }
+    memcpy(&trailer, body.data() + body.size() - sizeof(trailer), sizeof(trailer));
+    body.resize(body.size() - sizeof(trailer));
+    ++_counters->messagesReceived;
+    _counters->bytesReceived += body.size();
+    if(_latestHandler) {
+        _latestHandler(client->handle, trailer.channel, std::move(body));
+    } else {
+        _bufferPool.release(std::move(body));
+    }
+}
@@ -5,51 +5,288 @@
 
 #include <atomic>
 
+#include "BufferPool.h"
+#include "EventLoop.h"
 #include "ITransportBase.h"
+#include "IntrusiveMPSCQueue.h"
 #include "Message.h"
+#include "PublishedTransport.h"
+#include "SharedMemoryRing.h"
+#include "TimerWheel.h"
+#include "Trace.h"
 
 #include <uv.h>
+#include <condition_variable>
+#include <deque>
+#include <memory>
 #include <mutex>
-#include <queue>
-#include <thread>
+#include <unordered_map>
 #include <vector>
 
 namespace Twitch::IPC {
+// For the OS handles that go along with frames or get handed between transports
+void closeNativeHandle(NativeHandle handle);
+bool duplicateNativeHandle(NativeHandle handle, NativeHandle &duplicate);
 
+// Bodies at least this large are read directly into their final buffer instead of through receiveBuffer
+constexpr size_t DirectReadThreshold = 64 * 1024;
+// Past this much handed to libuv and not yet written for a connection, frames wait in its priority
+// lanes instead, where a more urgent frame can still overtake them
+constexpr size_t MaxBytesInFlight = 256 * 1024;
+// How many normal frames go out for each bulk one while both lanes have frames waiting
+constexpr unsigned NormalFramesPerBulk = 4;
+
+// What is queued or being written for one connection. Senders charge it and the loop thread credits
+// it back as writes complete, so it also covers what sits in libuv's own write queue.
+struct WriteBudget {
+    std::atomic<size_t> bytes{0};
+    std::atomic<size_t> messages{0};
+    // Set between reporting backpressure and reporting the connection writable again. Both are reported
+    // from the loop thread, which is the only one to change it.
+    std::atomic<bool> blocked{false};
+    // Set while a backpressure report waits for the loop thread, so senders only post it once
+    std::atomic<bool> backpressurePosted{false};
+    // From the peer's hello, for the sending threads, and cleared again when it disconnects. Until a
+    // hello arrives the peer may be on an older version.
+    std::atomic<bool> peerHello{false};
+    std::atomic<uint32_t> peerCapabilities{0};
+    std::atomic<uint32_t> peerCodecs{0};
+    // The largest body the peer reads, 0 if it has no limit
+    std::atomic<uint32_t> peerMaxFrameSize{0};
+    // Written requests handed to libuv that it hasn't finished with. Loop thread only.
+    size_t bytesInFlight{0};
+    // The transport-wide totals that follow this budget
+    std::shared_ptr<TransportCounters> counters;
+    // The latest-value channels with a value queued, and whatever has replaced it since, if anything
+    std::mutex latestMutex;
+    std::unordered_map<uint32_t, std::vector<uint8_t>> latestValues;
+
+    void charge(size_t size)
+    {
+        bytes += size;
+        ++messages;
+        counters->writeQueueBytes += size;
+        ++counters->writeQueueMessages;
+    }
+    void credit(size_t size)
+    {
+        bytes -= size;
+        --messages;
+        counters->writeQueueBytes -= size;
+        --counters->writeQueueMessages;
+    }
+    // For a queued request whose body went from `from` to `to` bytes
+    void recharge(size_t from, size_t to)
+    {
+        bytes += to - from;
+        counters->writeQueueBytes += to - from;
+    }
+    // Swaps `value` in for the one replacing the queued value of `channel`, if one is queued, and
+    // otherwise marks it queued and returns false
+    bool replaceLatest(uint32_t channel, std::vector<uint8_t> &value)
+    {
+        std::lock_guard lock(latestMutex);
+        const auto [latest, added] = latestValues.try_emplace(channel);
+        if(added) {
+            return false;
+        }
+        latest->second.swap(value);
+        return true;
+    }
+    // Ends the wait of the queued value of `channel`, returning whatever replaced it or nothing. The
+    // channel is forgotten until it sends again, so ids that are used once don't pile up.
+    std::vector<uint8_t> takeLatest(uint32_t channel)
+    {
+        std::lock_guard lock(latestMutex);
+        auto latest = latestValues.find(channel);
+        if(latest == latestValues.end()) {
+            return {};
+        }
+        auto newer = std::move(latest->second);
+        latestValues.erase(latest);
+        return newer;
+    }
+};
+
+// The header lives inline so the payload can be handed to uv_write as-is without shifting it.
+// Requests are recycled once written, so everything is (re)set through assign.
 struct WriteRequest {
+    using SharedBody = std::shared_ptr<const std::vector<uint8_t>>;
+
     uv_write_t req{};
-    uv_buf_t buf;
+    MessageHeader header{};
+    // What goes out instead of `header` on streams that switched to compact headers
+    uint8_t compactHeader[MaxCompactHeaderSize]{};
     std::vector<uint8_t> data;
-    explicit WriteRequest(std::vector<uint8_t> &&data)
-        : buf(uv_buf_init(
-              reinterpret_cast<char *>(data.data()), static_cast<unsigned>(data.size())))
-        , data(std::move(data))
+    // Used instead of `data` when several requests carry the same body, like the copies of a broadcast
+    SharedBody sharedData;
+    uv_buf_t bufs[2]{};
+    Handle connectionHandle{};
+    WriteRequest *next{};
+    // Goes to every connected client rather than to connectionHandle, or only to the subscribers of
+    // `topic` when that is set
+    bool broadcast{};
+    std::string topic;
+    // A handle to pass along with the frame, owned by the request until it is written
+    bool passesHandle{};
+    NativeHandle passedHandle{};
+    uv_pipe_t *sendHandle{};
+    // Credited once the request is written, if it was charged to a connection
+    std::shared_ptr<WriteBudget> budget;
+    // When an invoke times out, if it does. The loop thread starts tracking it as it takes the request.
+    std::chrono::steady_clock::time_point deadline{};
+    Priority priority{Priority::Normal};
+    // What was added to the budget's bytesInFlight when it went to libuv, taken off again once written
+    size_t inFlightBytes{};
+    // A latest value whose body may still be replaced, until the loop thread takes it from its lane
+    bool coalesces{};
+    uint32_t channel{};
+#if NATIVEIPC_TRACING
+    // When it was queued, then when it was handed to libuv
+    uint64_t tracedAt{};
+#endif
+    WriteRequest() = default;
+    ~WriteRequest();
+    DELETE_COPY_AND_MOVE_CONSTRUCTORS(WriteRequest);
+    void releasePassedHandle();
+    void assign(Handle connection, Handle promiseId, std::vector<uint8_t> &&payload)
+    {
+        data = std::move(payload);
+        sharedData.reset();
+        setFrame(connection, promiseId, data.data(), data.size());
+    }
+    void assignShared(Handle connection, Handle promiseId, SharedBody payload)
+    {
+        sharedData = std::move(payload);
+        setFrame(connection, promiseId, sharedData->data(), sharedData->size());
+    }
+    // Keeps everything else, including the place in its queue
+    void replaceBody(std::vector<uint8_t> &&payload)
     {
+        data = std::move(payload);
+        header.bodySize = static_cast<uint32_t>(data.size());
+        bufs[1] = uv_buf_init(reinterpret_cast<char *>(data.data()), static_cast<unsigned>(data.size()));
     }
+    void useCompactHeader()
+    {
+        const auto size = encodeCompactHeader(header, compactHeader);
+        bufs[0] = uv_buf_init(reinterpret_cast<char *>(compactHeader), static_cast<unsigned>(size));
+    }
+    [[nodiscard]] const uint8_t *body() const
+    {
+        return reinterpret_cast<const uint8_t *>(bufs[1].base);
+    }
+    [[nodiscard]] unsigned bufCount() const
+    {
+        return header.bodySize ? 2 : 1;
+    }
+
+private:
+    void setFrame(Handle connection, Handle promiseId, const uint8_t *body, size_t size)
+    {
+        releasePassedHandle();
+        header = {promiseId, static_cast<uint32_t>(size)};
+        bufs[0] = uv_buf_init(reinterpret_cast<char *>(&header), sizeof(MessageHeader));
+        // libuv never writes through the buffers it sends
+        bufs[1] = uv_buf_init(reinterpret_cast<char *>(const_cast<uint8_t *>(body)), static_cast<unsigned>(size));
+        connectionHandle = connection;
+        deadline = {};
+        priority = Priority::Normal;
+        TRACE_BEGIN(tracedAt);
+        broadcast = false;
+        topic.clear();
+        coalesces = false;
+        next = nullptr;
+    }
+};
+
+// Several queued messages for the same stream going out through a single uv_write
+struct WriteBatch {
+    uv_write_t req{};
+    std::vector<std::unique_ptr<WriteRequest>> requests;
+    std::vector<uv_buf_t> bufs;
 };
 
 class UVTransportBase {
 public:
-    UVTransportBase();
+    UVTransportBase() = default;
     virtual ~UVTransportBase() = default;
     DELETE_COPY_AND_MOVE_CONSTRUCTORS(UVTransportBase);
 
 protected:
-    void closeLoop();
+    using WritePair = std::pair<Handle, std::unique_ptr<WriteRequest>>;
+
+    void useLoopThread(std::shared_ptr<LoopThread> loopThread);
+    // Runs `setup` on the loop thread, running one of our own if none was given, and waits for it to
+    // call postSemaphore unless `wait` is false
+    void startOnLoop(std::function<void()> setup, bool wait = true);
+    // For a start that didn't wait: waits for its setup to be done, so that it can be closed
+    void waitUntilStarted();
+    // Whether the caller went on without waiting, so failures to start have to be reported some other way
+    bool startedAsync() const
+    {
+        return _startPending;
+    }
+    // Called on the loop thread once the transport has started closing everything it opened.
+    // waitUntilFinished returns once the last of it has closed, after which the transport can go away
+    // while the loop carries on for anyone sharing it.
+    void finishOnLoop();
+    void waitUntilFinished();
+    // Every handle the transport opens is counted from when it is initialized until it has closed.
+    // `owned` handles were allocated on their own and are deleted once closed.
+    void trackHandle()
+    {
+        ++_openHandles;
+    }
+    void closeHandle(uv_handle_t *handle, bool owned);
 
     struct ClientInfo {
         uv_stream_t *stream;
         const Handle handle;
         MessageHeader messageHeader{};
+        bool headerComplete{};
+        // Large bodies are sized up front and libuv reads the rest of them straight into place
+        bool directBody{};
+        size_t bodyReceived{};
         std::vector<uint8_t> messageBuffer;
         std::vector<char> receiveBuffer;
+        // Shared memory rings, when the transport or the peer asked for them. Outgoing frames only use
+        // ours once the peer has confirmed it mapped the ring.
+        std::unique_ptr<SharedMemoryRing> outboundRing;
+        std::unique_ptr<SharedMemoryRing> inboundRing;
+        bool outboundRingAttached{};
+        // The peer's hello, all zero until one arrives
+        Hello peer{};
+        bool helloSent{};
+        // Control frames queued before the peer's hello, which go out once it arrives. Peers on older
+        // versions never send one, so these stay here, still charged to the budget, until disconnect.
+        std::deque<std::unique_ptr<WriteRequest>> awaitingHello;
+        // Each way, set once the CompactHeaders switch has gone past on the stream
+        bool compactHeadersIn{};
+        bool compactHeadersOut{};
+        std::shared_ptr<WriteBudget> budget;
+        // Frames waiting for the stream to catch up, indexed by Priority
+        std::deque<std::unique_ptr<WriteRequest>> lanes[3];
+        size_t laneFrames{};
+        unsigned normalStreak{};
 
         explicit ClientInfo(uv_stream_t *s, const Handle h)
             : stream(s)
             , handle(h)
         {
         }
-        void readToMessageBuffer(const uint8_t *&curPtr, const uint8_t *endPtr, int finalLength);
+        // Returns how many bytes the header took, 0 if more are needed, or -1 if it is malformed
+        int readHeader(const uint8_t *data, size_t available);
+        [[nodiscard]] size_t maxHeaderSize() const
+        {
+            return compactHeadersIn ? MaxCompactHeaderSize : sizeof(MessageHeader);
+        }
+        void readToMessageBuffer(const uint8_t *&curPtr, const uint8_t *endPtr, size_t finalLength);
+        void readToDirectBody(const uint8_t *&curPtr, const uint8_t *endPtr);
+        [[nodiscard]] bool bodyComplete() const
+        {
+            return (directBody ? bodyReceived : messageBuffer.size()) == messageHeader.bodySize;
+        }
     };
 
     ClientInfo *getClientInfo(uv_handle_t *handle)
@@ -64,6 +301,13 @@ protected:
     virtual void handleWrite(uv_stream_t *stream, int status) = 0;
     virtual void handleDisconnected(uv_stream_t *stream) = 0;
     virtual void doDisconnectCleanup(const std::unique_lock<std::mutex>&) {}
+    // Called on the loop thread every time it is woken, before it writes what has been queued
+    virtual void handleWakeup() {}
+    // Closes everything the transport has open on the loop, then calls finishOnLoop
+    virtual void closeOnLoop() = 0;
+    // Replaces a queued broadcast with a request per connected client, all sharing its body
+    virtual void expandBroadcast(const WriteRequest &, std::vector<WritePair> &) {}
+    virtual void handleSubscription(ClientInfo *, bool, std::string) {}
 
     static void connection_cb(uv_stream_t *stream, int status);
     static void alloc_cb(uv_handle_t *handle, size_t suggestedSize, uv_buf_t *buf);
@@ -74,48 +318,188 @@ protected:
     void handleStateChanged();
     void handleLog(Handle handle, LogLevel level, std::string message);
 
-    using WritePair = std::pair<Handle, std::unique_ptr<WriteRequest>>;
     void initSemaphore();
     void waitForSemaphore();
     void postSemaphore();
 
     void initStateChanged();
     void sendStateChanged(const std::lock_guard<std::mutex> &);
+    void wakeLoop();
     void closeStateChanged(const std::lock_guard<std::mutex> &);
+    void closeInvokeTimer();
 
-    void addToWriteQueue(Handle connectionHandle, Handle promiseId, Payload &&message);
+    // Returns false, without queuing, if `mustFit` and the connection is over its write queue limits
+    bool addToWriteQueue(Handle connectionHandle, Handle promiseId, Payload &&message, bool mustFit = false);
+    void addInvokeToWriteQueue(Handle connectionHandle,
+        Handle promiseId,
+        Payload &&message,
+        std::chrono::steady_clock::time_point deadline,
+        Priority priority = Priority::Normal);
+    void addManyToWriteQueue(Handle connectionHandle, const std::vector<Handle> &promiseIds, std::vector<Payload> &&messages);
+    void addBroadcastToWriteQueue(Payload &&message, std::string topic = {});
+    bool addSharedToWriteQueue(Handle connectionHandle, NativeHandle handle, size_t size);
+    bool addChunkToWriteQueue(Handle connectionHandle, Handle streamId, Payload &&chunk, bool last);
+    bool addLatestToWriteQueue(Handle connectionHandle, uint32_t channel, Payload &&value);
+    static std::unique_ptr<WriteRequest> newWriteRequest(
+        Handle connectionHandle, Handle promiseId, Payload &&message);
+    static std::unique_ptr<WriteRequest> newWriteRequest(
+        Handle connectionHandle, Handle promiseId, const WriteRequest::SharedBody &message);
+    void recycleWriteRequest(std::unique_ptr<WriteRequest> writeReq);
     void disconnectStream(uv_stream_t *stream, bool shutdown);
+    // Starts over with a newly connected peer, whose writes are charged to `budgetHandle`. Clients
+    // then send their hello; servers wait for the client's.
+    void meetPeer(ClientInfo *client, Handle budgetHandle);
+    // Tells the peer what we support
+    void sendHello(ClientInfo *client);
+    void forgetPeer(ClientInfo *client);
+    void openWriteBudget(Handle connectionHandle);
+    void closeWriteBudget(Handle connectionHandle);
+    // Takes no lock, so it is cheap enough for every write
+    std::shared_ptr<WriteBudget> findWriteBudget(Handle connectionHandle);
+    void chargeWrite(WriteRequest &writeReq, std::shared_ptr<WriteBudget> budget);
+    [[nodiscard]] bool overWriteLimits(const WriteBudget &budget, size_t extraBytes, size_t extraMessages) const;
+    // Checked before a message is queued rather than when it is written, so that it can still be turned
+    // away. The body is checked before compression, as the peer has to have room for it either way.
+    bool fitsPeerFrame(Handle connectionHandle, size_t size);
+    [[nodiscard]] static bool fitsPeerFrame(const WriteBudget *budget, size_t size);
+    void warnOverPeerFrame(Handle connectionHandle, size_t size);
+    // Posts the report to the loop thread. Senders may be handlers that go on to disconnect, which
+    // would wait on themselves if the backpressure handler ran on their thread.
+    void reportBlocked(Handle connectionHandle, const std::shared_ptr<WriteBudget> &budget);
+    void reportPostedBackpressure();
+    void reportWritableIfDrained(Handle connectionHandle, WriteBudget &budget);
+    void countSent(const WriteRequest &writeReq);
+    void useCounters(std::shared_ptr<TransportCounters> counters);
+    void useConnectionHandles(Handle first, Handle step);
     Handle getNextConnectionHandle();
 
     ITransportBase::OnHandler _connectHandler;
     ITransportBase::OnHandler _disconnectHandler;
     ITransportBase::OnDataHandler _dataHandler;
+    ITransportBase::OnSharedDataHandler _sharedDataHandler;
+    ITransportBase::OnChunkHandler _chunkHandler;
+    ITransportBase::OnLatestHandler _latestHandler;
     ITransportBase::OnNoInvokeClientHandler _noInvokeClientHandler;
+    ITransportBase::OnInvokeTimeoutHandler _invokeTimeoutHandler;
     ITransportBase::OnHandler _errorHandler;
+    ITransportBase::OnHandler _backpressureHandler;
+    ITransportBase::OnHandler _writableHandler;
     ITransportBase::OnLogHandler _logHandler;
 
-    uv_loop_t _loop{};
-
-    std::thread _thread;
+    // Null until connect or listen starts the transport on a loop
+    uv_loop_t *_loop{};
+    std::shared_ptr<LoopThread> _loopThread;
     std::mutex _mutex;
     std::string _endpoint;
 
-    LogLevel _logLevel = LogLevel::Warning;
+    std::atomic<LogLevel> _logLevel{LogLevel::Warning};
+    std::atomic<size_t> _writeBatchMaxBytes{DefaultWriteBatchMaxBytes};
+    std::atomic<size_t> _writeBatchMaxMessages{DefaultWriteBatchMaxMessages};
+    std::atomic<size_t> _writeQueueMaxBytes{DefaultWriteQueueMaxBytes};
+    std::atomic<size_t> _writeQueueMaxMessages{DefaultWriteQueueMaxMessages};
+    std::shared_ptr<TransportCounters> _counters{std::make_shared<TransportCounters>()};
+    // Size of the ring offered to each peer for our outgoing frames; 0 keeps everything on the stream
+    size_t _sharedMemoryRingSize{};
+    bool _sharedMemoryMultiuserAccess{};
+    // Bodies at least this large are compressed for peers that read compressed frames; 0 sends all raw
+    std::atomic<size_t> _compressionThreshold{0};
+    // Peers are told this in the hello and dropped if they send a larger frame anyway; 0 is unlimited
+    std::atomic<size_t> _maxFrameSize{DefaultMaxFrameSize};
+    // Only IPC pipes can carry handles alongside the byte stream
+    bool _canPassHandles{};
 
 private:
     static void stateChanged_cb(uv_async_t *req);
     static void write_cb(uv_write_t *req, int status);
+    static void batchWrite_cb(uv_write_t *req, int status);
     static void shutdown_cb(uv_shutdown_t *req, int status);
+    static void invokeTimer_cb(uv_timer_t *handle);
+    static void close_cb(uv_handle_t *handle);
+    static void closeOwned_cb(uv_handle_t *handle);
 
     void handleShutdown(uv_stream_t *stream, int status);
-    WritePair readFromWriteQueue(const std::unique_lock<std::mutex> &);
+    void handleClosed();
+    void trackInvokeTimeout(const WriteRequest &writeReq);
+    void handleInvokeTimer();
+    void writePending(std::vector<WritePair> &pending);
+    // Writes what is waiting in the client's lanes, most urgent first, until enough is in flight
+    void drainLanes(ClientInfo *client);
+    void resumeLanes(uv_stream_t *stream);
+    // Ends a request's wait in the write queue and lanes as it goes to libuv or the ring
+    void traceWritten(WriteRequest &writeReq);
+    void writeToStream(ClientInfo *client,
+        std::vector<WritePair>::iterator begin,
+        std::vector<WritePair>::iterator end);
+    void writeFrames(ClientInfo *client,
+        std::vector<WritePair>::iterator begin,
+        std::vector<WritePair>::iterator end);
+    void writeBatch(ClientInfo *client,
+        std::vector<WritePair>::iterator begin,
+        std::vector<WritePair>::iterator end);
+    void writeWithHandle(ClientInfo *client, std::unique_ptr<WriteRequest> writeReq);
+    void writeThroughRing(ClientInfo *client,
+        std::vector<WritePair>::iterator begin,
+        std::vector<WritePair>::iterator end);
+    void writeControlFrame(ClientInfo *client, Handle control, std::vector<uint8_t> &&body);
     void processBuffer(uv_stream_t *stream, const char *data, ssize_t length);
+    [[nodiscard]] bool overFrameLimit(size_t bodySize) const;
+    void completeMessage(ClientInfo *client);
+    void deliverFrame(ClientInfo *client, Handle promiseId, std::vector<uint8_t> &&payload);
+    void handleControlFrame(ClientInfo *client, Handle control, const std::vector<uint8_t> &body);
+    void handleHello(ClientInfo *client, const std::vector<uint8_t> &body);
+    void releaseAwaitingHello(ClientInfo *client);
+    void startSharedMemory(ClientInfo *client);
+    void readFromRing(ClientInfo *client, uint32_t count);
+    void receiveShared(ClientInfo *client, const std::vector<uint8_t> &body);
+    void receiveChunk(ClientInfo *client, std::vector<uint8_t> &&body);
+    void receiveLatest(ClientInfo *client, std::vector<uint8_t> &&body);
+    // Puts whatever replaced a queued latest value into its request, now that it is about to be written
+    void takeLatestValue(WriteRequest &writeReq);
+    void compressBody(WriteRequest &writeReq, const WriteBudget *budget);
+    // Returns false, having released the payload, if its frame was compressed and won't decompress
+    bool decompressBody(ClientInfo *client, Handle &promiseId, std::vector<uint8_t> &payload);
+
+    void takeWriteQueue();
+    void publishWriteBudgets(const std::lock_guard<std::mutex> &);
+    static std::unique_ptr<WriteRequest> reuseWriteRequest();
 
-    std::queue<WritePair> _writeQueue;
+    // Budgets that went over their limits since the loop thread last looked
+    std::mutex _backpressureMutex;
+    std::vector<std::pair<Handle, std::shared_ptr<WriteBudget>>> _postedBackpressure;
+    std::vector<std::pair<Handle, std::shared_ptr<WriteBudget>>> _reportingBackpressure;
+    IntrusiveMPSCQueue<WriteRequest> _writeQueue;
+    std::vector<WritePair> _pendingWrites;
+    std::vector<WritePair> _ringWrites;
+    std::vector<WritePair> _laneWrites;
+    std::vector<std::unique_ptr<WriteBatch>> _freeWriteBatches;
+    BufferPool _bufferPool;
+    std::unordered_map<Handle, size_t> _pendingWriteOrder;
     uv_sem_t _semaphore{};
     uv_async_t _stateChanged{};
+    std::atomic<bool> _stateChangedOpen{false};
+    std::atomic<int> _stateChangedSenders{0};
     bool _postedSemaphore = false;
+    bool _startPending = false;
     std::atomic<Handle> _lastConnectionHandle{0};
+    Handle _connectionHandleStep{1};
+    // Senders look their budget up on every write, so they get a copy of the table that is replaced
+    // whenever a budget is opened or closed, rather than the table itself and the mutex around it
+    using WriteBudgets = std::unordered_map<Handle, std::shared_ptr<WriteBudget>>;
+    std::mutex _budgetMutex;
+    WriteBudgets _budgets;
+    std::unique_ptr<const WriteBudgets> _budgetSnapshot;
+    PublishedTransport<const WriteBudgets> _publishedBudgets;
+    // Invokes waiting to time out, by connection and promise id. One timer ticks the wheel while
+    // it has anything in it.
+    TimerWheel<std::pair<Handle, Handle>> _invokeTimeouts;
+    uv_timer_t _invokeTimer{};
+    bool _invokeTimerOpen = false;
+    // Loop thread only
+    size_t _openHandles{};
+    bool _finishing{};
+    std::mutex _finishedMutex;
+    std::condition_variable _finishedCondVar;
+    bool _finished{};
 };
 
 } // namespace Twitch::IPC
@@ -0,0 +1,236 @@
+// Copyright Twitch Interactive, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: MIT
+
+#include "ConnectionFactory.h"
+#include "Message.h"
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+
+#ifndef _WIN32
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace Twitch::IPC;
+using namespace std::chrono_literals;
+
+namespace {
+// A peer on a version from before the hello, which frames everything with a fixed header and takes
+// any handle with the top bit set for the result of an invoke
+class BaselinePeer {
+public:
+    struct Frame {
+        Handle handle;
+        std::string body;
+    };
+
+    explicit BaselinePeer(int socket)
+        : _socket(socket)
+    {
+    }
+    ~BaselinePeer()
+    {
+        if(_socket >= 0) {
+            close(_socket);
+        }
+    }
+    BaselinePeer(const BaselinePeer &) = delete;
+    BaselinePeer &operator=(const BaselinePeer &) = delete;
+
+    static sockaddr_un address(const std::string &endpoint)
+    {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        const auto path = "/tmp/" + endpoint;
+        strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+        return address;
+    }
+
+    static std::unique_ptr<BaselinePeer> connectTo(const std::string &endpoint)
+    {
+        const auto peer = address(endpoint);
+        const auto deadline = std::chrono::steady_clock::now() + 10s;
+        while(std::chrono::steady_clock::now() < deadline) {
+            const int s = socket(AF_UNIX, SOCK_STREAM, 0);
+            if(!connect(s, reinterpret_cast<const sockaddr *>(&peer), sizeof(peer))) {
+                return std::make_unique<BaselinePeer>(s);
+            }
+            close(s);
+            std::this_thread::sleep_for(1ms);
+        }
+        return nullptr;
+    }
+
+    void send(Handle handle, const std::string &body)
+    {
+        const MessageHeader header{handle, static_cast<uint32_t>(body.size())};
+        std::string frame(reinterpret_cast<const char *>(&header), sizeof(header));
+        frame += body;
+        ASSERT_EQ(static_cast<ssize_t>(frame.size()), write(_socket, frame.data(), frame.size()));
+    }
+
+    // Reads frames until `done` says so, then for as long again as `quiet` goes by without any
+    template<typename Done>
+    std::vector<Frame> read(Done done, std::chrono::milliseconds quiet)
+    {
+        const auto deadline = std::chrono::steady_clock::now() + 10s;
+        bool settling = false;
+        while(std::chrono::steady_clock::now() < deadline) {
+            pollfd readable{_socket, POLLIN, 0};
+            if(poll(&readable, 1, static_cast<int>(quiet.count())) <= 0) {
+                if(settling) {
+                    break;
+                }
+                continue;
+            }
+            char data[4096];
+            const auto length = ::read(_socket, data, sizeof(data));
+            if(length <= 0) {
+                break;
+            }
+            _received.append(data, static_cast<size_t>(length));
+            parse();
+            settling = settling || done(_frames);
+        }
+        return _frames;
+    }
+
+private:
+    void parse()
+    {
+        MessageHeader header{};
+        while(_received.size() >= sizeof(header)) {
+            memcpy(&header, _received.data(), sizeof(header));
+            if(_received.size() < sizeof(header) + header.bodySize) {
+                return;
+            }
+            _frames.push_back({header.handle, _received.substr(sizeof(header), header.bodySize)});
+            _received.erase(0, sizeof(header) + header.bodySize);
+        }
+    }
+
+    int _socket;
+    std::string _received;
+    std::vector<Frame> _frames;
+};
+
+bool hasFrame(const std::vector<BaselinePeer::Frame> &frames, Handle handle, const std::string &body)
+{
+    for(const auto &frame : frames) {
+        if(frame.handle == handle && frame.body == body) {
+            return true;
+        }
+    }
+    return false;
+}
+} // namespace
+
+TEST(BaselinePeerTest, ServerSendsNoControlFramesToOlderClient)
+{
+    const std::string endpoint = "twitch-native-ipc.test.baseline.server.sock";
+    auto server = ConnectionFactory::newMulticonnectServerConnection(endpoint);
+    std::atomic<Handle> connected{0};
+    server->onConnect([&](Handle connectionHandle) { connected = connectionHandle; });
+    server->onInvoked([](Handle, Payload) { return Payload("pong"); });
+    server->connect();
+    auto client = BaselinePeer::connectTo(endpoint);
+    ASSERT_TRUE(client);
+    const auto deadline = std::chrono::steady_clock::now() + 10s;
+    while(!connected && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(1ms);
+    }
+    ASSERT_NE(0u, connected.load());
+
+    // Neither of these can reach a client that never said hello, so they wait for one
+    EXPECT_TRUE(server->sendLatest(connected, 1, Payload("latest")));
+    EXPECT_TRUE(server->sendChunk(connected, server->openStream(), Payload("chunk"), true));
+    server->send(connected, Payload("message"));
+    client->send(7, "ping");
+
+    const auto frames = client->read(
+        [](const std::vector<BaselinePeer::Frame> &frames) {
+            return hasFrame(frames, 0, "message") && hasFrame(frames, 7 | 0x80000000, "pong");
+        },
+        100ms);
+    EXPECT_TRUE(hasFrame(frames, 0, "message"));
+    EXPECT_TRUE(hasFrame(frames, 7 | 0x80000000, "pong"));
+    for(const auto &frame : frames) {
+        EXPECT_LT(frame.handle, ControlHandleBase);
+    }
+}
+
+TEST(BaselinePeerTest, ServerDropsOlderClientOverFrameLimit)
+{
+    const std::string endpoint = "twitch-native-ipc.test.baseline.framelimit.sock";
+    auto server = ConnectionFactory::newServerConnection(endpoint);
+    std::atomic_int connected{0};
+    std::atomic_int disconnected{0};
+    std::atomic_int received{0};
+    server->setMaxFrameSize(1024);
+    server->onConnect([&] { ++connected; });
+    server->onDisconnect([&] { ++disconnected; });
+    server->onReceived([&](Payload) { ++received; });
+    server->connect();
+    auto client = BaselinePeer::connectTo(endpoint);
+    ASSERT_TRUE(client);
+    const auto waitFor = [](const std::atomic_int &value) {
+        const auto deadline = std::chrono::steady_clock::now() + 10s;
+        while(!value && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(1ms);
+        }
+        return value.load();
+    };
+    ASSERT_EQ(1, waitFor(connected));
+
+    // A client that never heard the limit can still go over it, and is dropped when it does
+    client->send(0, std::string(1024, 'a'));
+    ASSERT_EQ(1, waitFor(received));
+    client->send(0, std::string(1025, 'b'));
+    EXPECT_EQ(1, waitFor(disconnected));
+    EXPECT_EQ(1, received);
+}
+
+TEST(BaselinePeerTest, ClientSendsOnlyItsHelloToOlderServer)
+{
+    const std::string endpoint = "twitch-native-ipc.test.baseline.client.sock";
+    const auto address = BaselinePeer::address(endpoint);
+    unlink(address.sun_path);
+    const int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    ASSERT_EQ(0, bind(listener, reinterpret_cast<const sockaddr *>(&address), sizeof(address)));
+    ASSERT_EQ(0, listen(listener, 1));
+
+    auto client = ConnectionFactory::newClientConnection(endpoint);
+    client->subscribe("topic");
+    client->connect();
+    BaselinePeer server(accept(listener, nullptr, nullptr));
+    close(listener);
+
+    EXPECT_TRUE(client->sendLatest(1, Payload("latest")));
+    client->unsubscribe("topic");
+    client->send(Payload("message"));
+
+    const auto frames =
+        server.read([](const std::vector<BaselinePeer::Frame> &frames) { return hasFrame(frames, 0, "message"); }, 100ms);
+    EXPECT_TRUE(hasFrame(frames, 0, "message"));
+    // An older server takes this for the result of an invoke nobody made, and has to ignore it
+    size_t controlFrames = 0;
+    for(const auto &frame : frames) {
+        if(frame.handle >= ControlHandleBase) {
+            EXPECT_EQ(ControlHandle::Hello, frame.handle);
+            ++controlFrames;
+        }
+    }
+    EXPECT_EQ(1u, controlFrames);
+
+    // What waited for a hello that never came is let go with the connection
+    client->disconnect();
+    EXPECT_EQ(0u, client->stats().writeQueueBytes);
+    unlink(address.sun_path);
+}
+#endif
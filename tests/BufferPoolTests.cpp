@@ -0,0 +1,42 @@
+// Copyright Twitch Interactive, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: MIT
+
+#include "BufferPool.h"
+#include <gtest/gtest.h>
+
+using namespace Twitch::IPC;
+
+TEST(BufferPoolTest, RoundsUpByAQuarterAtMost)
+{
+    BufferPool pool;
+    for(size_t size : {1, 64, 65, 80, 81, 1000, 1024, 1025, 65537, 3 * 1024 * 1024 + 1, 16 * 1024 * 1024}) {
+        const auto buffer = pool.acquire(size);
+        EXPECT_GE(buffer.capacity(), size);
+        EXPECT_LE(buffer.capacity(), std::max<size_t>(64, size + size / 4));
+    }
+    // Past the largest class, buffers are exactly as big as asked for
+    EXPECT_EQ(size_t{20 * 1024 * 1024}, pool.acquire(20 * 1024 * 1024).capacity());
+}
+
+TEST(BufferPoolTest, ReusesReleasedBuffers)
+{
+    BufferPool pool;
+    auto buffer = pool.acquire(1000);
+    const auto capacity = buffer.capacity();
+    const auto data = buffer.data();
+    pool.release(std::move(buffer));
+    EXPECT_EQ(capacity, pool.retainedBytes());
+
+    // Anything in the same class gets the buffer back
+    const auto again = pool.acquire(capacity - 10);
+    EXPECT_EQ(data, again.data());
+    EXPECT_EQ(0u, pool.retainedBytes());
+
+    // A buffer only ever serves sizes it can hold
+    std::vector<uint8_t> odd;
+    odd.reserve(1100);
+    pool.release(std::move(odd));
+    EXPECT_GE(pool.acquire(1024).capacity(), 1024u);
+    EXPECT_EQ(0u, pool.retainedBytes());
+    EXPECT_LE(pool.acquire(1100).capacity(), 1280u);
+}
@@ -0,0 +1,83 @@
+// Copyright Twitch Interactive, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: MIT
+
+#include "Compression.h"
+#include <random>
+#include <string>
+#include <gtest/gtest.h>
+
+using namespace Twitch::IPC;
+
+namespace {
+std::vector<uint8_t> roundTrip(const std::vector<uint8_t> &body)
+{
+    std::vector<uint8_t> compressed;
+    EXPECT_TRUE(Compression::compressFrame(body.data(), body.size(), compressed));
+    EXPECT_LT(compressed.size(), body.size());
+    std::vector<uint8_t> decompressed;
+    EXPECT_TRUE(Compression::decompressFrame(compressed.data(), compressed.size(), decompressed));
+    return decompressed;
+}
+} // namespace
+
+TEST(CompressionTest, RoundTripsRepetitiveBodies)
+{
+    std::string text;
+    for(auto i = 0; i < 5000; ++i) {
+        text += R"({"id":)" + std::to_string(i) + R"(,"value":"something fairly repetitive"})";
+    }
+    const std::vector<uint8_t> json(text.begin(), text.end());
+    EXPECT_EQ(json, roundTrip(json));
+
+    // Runs come out as matches overlapping what they produce, and some lengths spill past the token
+    std::vector<uint8_t> runs(100000, 'x');
+    for(size_t i = 0; i < runs.size(); i += 997) {
+        runs[i] = static_cast<uint8_t>(i);
+    }
+    EXPECT_EQ(runs, roundTrip(runs));
+
+    const std::vector<uint8_t> shortRun(20, 7);
+    EXPECT_EQ(shortRun, roundTrip(shortRun));
+}
+
+TEST(CompressionTest, LeavesIncompressibleBodiesAlone)
+{
+    std::mt19937 random(1);
+    std::vector<uint8_t> noise(4096);
+    for(auto &byte : noise) {
+        byte = static_cast<uint8_t>(random());
+    }
+    std::vector<uint8_t> out;
+    EXPECT_FALSE(Compression::compressFrame(noise.data(), noise.size(), out));
+    EXPECT_FALSE(Compression::compressFrame(noise.data(), 3, out));
+}
+
+TEST(CompressionTest, RejectsMalformedFrames)
+{
+    const std::vector<uint8_t> body(1000, 'a');
+    std::vector<uint8_t> compressed;
+    ASSERT_TRUE(Compression::compressFrame(body.data(), body.size(), compressed));
+    std::vector<uint8_t> out;
+
+    for(size_t size = 0; size < compressed.size(); ++size) {
+        EXPECT_FALSE(Compression::decompressFrame(compressed.data(), size, out));
+    }
+    EXPECT_FALSE(Compression::decompressFrame(compressed.data(), compressed.size(), out, body.size() - 1));
+
+    // A match reaching back before the start of the body
+    auto badOffset = compressed;
+    badOffset[sizeof(uint32_t) + 2] = 0xFF;
+    badOffset[sizeof(uint32_t) + 3] = 0xFF;
+    EXPECT_FALSE(Compression::decompressFrame(badOffset.data(), badOffset.size(), out));
+
+    // A claimed size the block doesn't fill
+    auto badSize = compressed;
+    badSize[0] = static_cast<uint8_t>(badSize[0] + 1);
+    EXPECT_FALSE(Compression::decompressFrame(badSize.data(), badSize.size(), out));
+
+    // A tiny frame claiming a huge body is turned away before anything is allocated for it
+    std::vector<uint8_t> huge{0xFF, 0xFF, 0xFF, 0xFF, 0xF0, 0xFF, 0xFF, 0xFF, 0xFF};
+    std::vector<uint8_t> untouched;
+    EXPECT_FALSE(Compression::decompressFrame(huge.data(), huge.size(), untouched));
+    EXPECT_EQ(0u, untouched.capacity());
+}
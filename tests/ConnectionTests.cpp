@@ -6,6 +6,7 @@
 #include <gtest/gtest.h>
 
 #include "ConnectionFactory.h"
+#include "TypedMessage.h"
 #include <atomic>
 #include <random>
 
@@ -15,8 +16,10 @@ using namespace std::chrono_literals;
 #include <condition_variable>
 #include <cstdint>
 #include <functional>
+#include <map>
 #include <mutex>
 #include <queue>
+#include <set>
 #include <thread>
 #include <vector>
 
@@ -28,6 +31,8 @@ constexpr std::chrono::milliseconds OnLogSleepMilliseconds = 0ms;
 #define DO_EXPLICIT_CHECKS 0
 #define TEST_MANY_MESSAGES_SINGLE_DIRECTION 0
 #define USE_TCP 0
+#define USE_SHARED_MEMORY 0
+#define USE_IN_PROCESS 0
 #define INCLUDE_LATENCY_TEST 0
 
 constexpr auto ManyMessageCount = 100;
@@ -207,6 +212,18 @@ struct TestSettings {
 #define newMulticonnectServerConnection newMulticonnectServerConnectionTCP
 #endif
 
+#if USE_SHARED_MEMORY
+#define newClientConnection newClientConnectionShm
+#define newServerConnection newServerConnectionShm
+#define newMulticonnectServerConnection newMulticonnectServerConnectionShm
+#endif
+
+#if USE_IN_PROCESS
+#define newClientConnection newClientConnectionInProc
+#define newServerConnection newServerConnectionInProc
+#define newMulticonnectServerConnection newMulticonnectServerConnectionInProc
+#endif
+
 class NativeIPCTestBase : public ::testing::TestWithParam<TestSettings> {
 public:
     using LogVector = std::vector<std::tuple<Handle, LogLevel, std::string, std::string>>;
@@ -1428,6 +1445,1274 @@ TEST_P(MultiTransmitTest, ManyBidirectionalMessagesTest)
     WAIT_UNTIL_REACHES(ManyMessageCount, gotServerData, 60);
 }
 
+TEST_P(MultiTransmitTest, BatchedMessageOrderTest)
+{
+    constexpr int messageCount = 1000;
+    std::atomic_int gotClientData{0};
+    std::atomic_int outOfOrder{0};
+    std::atomic_int serverConnected{0};
+
+    serverConnection->setWriteBatchLimits(4096, 16);
+    clientConnection->setWriteBatchLimits(4096, 16);
+    serverConnection->onReceived([&](Handle, Payload data) {
+        if(data.asString() != std::to_string(gotClientData)) {
+            ++outOfOrder;
+        }
+        ++gotClientData;
+    });
+    serverConnection->onConnect([&](Handle) {
+        Sleep(_sleepOnConnect);
+        ++serverConnected;
+    });
+
+    serverConnection->connect();
+    clientConnection->connect();
+    WAIT_UNTIL_REACHES(1, serverConnected, 10);
+
+    for(auto i = 0; i < messageCount; ++i) {
+        clientConnection->send(std::to_string(i));
+    }
+
+    WAIT_UNTIL_REACHES(messageCount, gotClientData, 20);
+    EXPECT_EQ(0, outOfOrder);
+}
+
+TEST_P(MultiTransmitTest, SendManyAndInvokeManyTest)
+{
+    constexpr int batchSize = 100;
+    constexpr int rounds = 10;
+    std::atomic_int gotClientData{0};
+    std::atomic_int outOfOrder{0};
+    std::atomic_int results{0};
+    std::atomic_int badResults{0};
+    std::atomic_int serverConnected{0};
+
+    serverConnection->onReceived([&](Handle, Payload data) {
+        if(data.asString() != std::to_string(gotClientData)) {
+            ++outOfOrder;
+        }
+        ++gotClientData;
+    });
+    serverConnection->onInvoked([](Handle, Payload data) -> Payload { return data; });
+    serverConnection->onConnect([&](Handle) {
+        Sleep(_sleepOnConnect);
+        ++serverConnected;
+    });
+
+    serverConnection->connect();
+    clientConnection->connect();
+    WAIT_UNTIL_REACHES(1, serverConnected, 10);
+
+    // Batches and single sends share one queue, so they arrive in the order they were made
+    int next = 0;
+    for(auto round = 0; round < rounds; ++round) {
+        std::vector<Payload> batch;
+        for(auto i = 0; i < batchSize; ++i) {
+            batch.emplace_back(std::to_string(next++));
+        }
+        clientConnection->send(std::move(batch));
+        clientConnection->send(std::to_string(next++));
+    }
+    std::vector<Payload> invokes;
+    for(auto i = 0; i < batchSize; ++i) {
+        invokes.emplace_back(std::to_string(i));
+    }
+    clientConnection->invokeMany(std::move(invokes), [&](size_t index, InvokeResultCode code, Payload data) {
+        if(code != InvokeResultCode::Good || data.asString() != std::to_string(index)) {
+            ++badResults;
+        }
+        ++results;
+    });
+
+    WAIT_UNTIL_REACHES(rounds * (batchSize + 1), gotClientData, 20);
+    WAIT_UNTIL_REACHES(batchSize, results, 20);
+    EXPECT_EQ(0, outOfOrder);
+    EXPECT_EQ(0, badResults);
+}
+
+TEST_P(MultiTransmitTest, DispatchThreadsTest)
+{
+    // The slow client's handler blocks until every fast message got through on another thread
+    constexpr int messageCount = 500;
+    std::atomic_int fastReceived{0};
+    std::atomic_int outOfOrder{0};
+    std::atomic_int slowFinished{0};
+    std::atomic_int serverConnected{0};
+    bool slowSawEverything = false;
+
+    serverConnection->setDispatchThreads(4);
+    serverConnection->onReceived([&](Handle, Payload data) {
+        const auto message = data.asString();
+        if(message == "slow") {
+            const auto start = std::chrono::steady_clock::now();
+            while(fastReceived < messageCount && std::chrono::steady_clock::now() - start < 10s) {
+                std::this_thread::sleep_for(1ms);
+            }
+            slowSawEverything = fastReceived == messageCount;
+            ++slowFinished;
+            return;
+        }
+        if(message != std::to_string(fastReceived)) {
+            ++outOfOrder;
+        }
+        ++fastReceived;
+    });
+    serverConnection->onConnect([&](Handle) {
+        Sleep(_sleepOnConnect);
+        ++serverConnected;
+    });
+
+    auto slowClient = MakeClient();
+    serverConnection->connect();
+    clientConnection->connect();
+    slowClient->connect();
+    WAIT_UNTIL_REACHES(2, serverConnected, 10);
+
+    slowClient->send("slow");
+    std::this_thread::sleep_for(10ms);
+    for(auto i = 0; i < messageCount; ++i) {
+        clientConnection->send(std::to_string(i));
+    }
+
+    WAIT_UNTIL_REACHES(1, slowFinished, 20);
+    EXPECT_TRUE(slowSawEverything);
+    EXPECT_EQ(0, outOfOrder);
+}
+
+TEST_P(TransmitTest, InlineDispatchTest)
+{
+    constexpr int invokeCount = 1000;
+    std::atomic_int clientsConnected{0};
+    std::atomic_int results{0};
+    std::atomic_int outOfOrder{0};
+    std::atomic_int wrongThread{0};
+    const auto testThread = std::this_thread::get_id();
+
+    serverConnection->setInlineDispatch(true);
+    clientConnection->setInlineDispatch(true);
+    serverConnection->onInvoked([&](Payload data) {
+        if(std::this_thread::get_id() == testThread) {
+            ++wrongThread;
+        }
+        return data;
+    });
+    clientConnection->onConnect([&] { ++clientsConnected; });
+
+    serverConnection->connect();
+    clientConnection->connect();
+    WAIT_UNTIL_REACHES(1, clientsConnected, 10);
+
+    for(auto i = 0; i < invokeCount; ++i) {
+        clientConnection->invoke(std::to_string(i), [&, i](InvokeResultCode code, Payload data) {
+            if(code != InvokeResultCode::Good || data.asString() != std::to_string(i) || results != i) {
+                ++outOfOrder;
+            }
+            ++results;
+        });
+    }
+
+    WAIT_UNTIL_REACHES(invokeCount, results, 20);
+    EXPECT_EQ(0, outOfOrder);
+    EXPECT_EQ(0, wrongThread);
+}
+
+TEST_P(TransmitTest, LogLevelChangeTest)
+{
+    std::atomic_int clientsConnected{0};
+    std::atomic_int received{0};
+    std::atomic_int debugMessages{0};
+
+    serverConnection->onReceived([&](Payload) { ++received; });
+    clientConnection->onConnect([&] { ++clientsConnected; });
+    clientConnection->onLog(
+        [&](LogLevel level, std::string, std::string) {
+            if(level == LogLevel::Debug) {
+                ++debugMessages;
+            }
+        },
+        LogLevel::Warning);
+
+    serverConnection->connect();
+    clientConnection->connect();
+    WAIT_UNTIL_REACHES(1, clientsConnected, 10);
+
+    for(auto i = 0; i < 100; ++i) {
+        clientConnection->send("quiet");
+    }
+    WAIT_UNTIL_REACHES(100, received, 10);
+    EXPECT_EQ(0, debugMessages);
+
+    // Takes effect for the next message, even while other threads are logging
+    clientConnection->setLogLevel(LogLevel::Debug);
+    clientConnection->send("loud");
+    WAIT_UNTIL_REACHES(1, debugMessages, 10);
+}
+
+TEST_P(TransmitTest, StatsTest)
+{
+    constexpr int messageCount = 50;
+    constexpr int invokeCount = 100;
+    std::atomic_int clientsConnected{0};
+    std::atomic_int received{0};
+    std::atomic_int results{0};
+
+    serverConnection->onReceived([&](Payload) { ++received; });
+    serverConnection->onInvoked([](Payload data) { return data; });
+    clientConnection->onConnect([&] { ++clientsConnected; });
+
+    serverConnection->connect();
+    clientConnection->connect();
+    WAIT_UNTIL_REACHES(1, clientsConnected, 10);
+
+    for(auto i = 0; i < messageCount; ++i) {
+        clientConnection->send("1234");
+    }
+    for(auto i = 0; i < invokeCount; ++i) {
+        clientConnection->invoke("12", [&](InvokeResultCode, Payload) { ++results; });
+    }
+    WAIT_UNTIL_REACHES(messageCount, received, 10);
+    WAIT_UNTIL_REACHES(invokeCount, results, 10);
+    WAIT_UNTIL_EQ(0, [&] { return static_cast<int>(clientConnection->stats().writeQueueMessages); }, 10);
+
+    const auto client = clientConnection->stats();
+    EXPECT_EQ(static_cast<uint64_t>(messageCount + invokeCount), client.messagesSent);
+    EXPECT_EQ(static_cast<uint64_t>(4 * messageCount + 2 * invokeCount), client.bytesSent);
+    EXPECT_EQ(static_cast<uint64_t>(invokeCount), client.messagesReceived);
+    EXPECT_EQ(0u, client.pendingInvokes);
+    EXPECT_EQ(0u, client.reconnects);
+    EXPECT_EQ(static_cast<uint64_t>(invokeCount), client.invokeLatency.count);
+    EXPECT_LE(client.invokeLatency.percentile(0.5), client.invokeLatency.maxMicroseconds);
+
+    const auto server = serverConnection->stats();
+    EXPECT_EQ(static_cast<uint64_t>(messageCount + invokeCount), server.messagesReceived);
+    EXPECT_EQ(static_cast<uint64_t>(invokeCount), server.messagesSent + server.writeQueueMessages);
+}
+
+TEST_P(TransmitTest, InvokeTimeoutTest)
+{
+    constexpr int unansweredCount = 20;
+    std::atomic_int clientsConnected{0};
+    std::atomic_int timedOut{0};
+    std::atomic_int answered{0};
+    std::atomic_int lateResults{0};
+
+    // Only answers invokes that ask for it
+    serverConnection->onInvoked([&](Handle connectionHandle, Handle promiseId, Payload data) {
+        if(data.asString() == "answer") {
+            serverConnection->sendResult(connectionHandle, promiseId, "answered");
+        }
+    });
+    clientConnection->onConnect([&] { ++clientsConnected; });
+    clientConnection->onResult([&](Handle, Payload) { ++lateResults; });
+
+    serverConnection->connect();
+    clientConnection->connect();
+    WAIT_UNTIL_REACHES(1, clientsConnected, 10);
+
+    const auto start = std::chrono::steady_clock::now();
+    for(auto i = 0; i < unansweredCount; ++i) {
+        clientConnection->invoke("ignore", [&](InvokeResultCode resultCode, Payload) {
+            EXPECT_EQ(InvokeResultCode::Timeout, resultCode);
+            EXPECT_GE(std::chrono::steady_clock::now() - start, 50ms);
+            ++timedOut;
+        }, 50ms);
+    }
+    clientConnection->invoke("answer", [&](InvokeResultCode resultCode, Payload data) {
+        EXPECT_EQ(InvokeResultCode::Good, resultCode);
+        EXPECT_EQ("answered", data.asString());
+        ++answered;
+    }, 10s);
+
+    WAIT_UNTIL_REACHES(1, answered, 10);
+    WAIT_UNTIL_REACHES(unansweredCount, timedOut, 10);
+    EXPECT_EQ(0u, clientConnection->stats().pendingInvokes);
+    EXPECT_EQ(0, lateResults);
+}
+
+TEST_P(TransmitTest, InvokeAsyncTest)
+{
+    constexpr int invokeCount = 1000;
+    std::atomic_int clientsConnected{0};
+    std::atomic_int continued{0};
+
+    serverConnection->onInvoked([&](Handle connectionHandle, Handle promiseId, Payload data) {
+        if(data.asString() != "ignore") {
+            serverConnection->sendResult(connectionHandle, promiseId, data);
+        }
+    });
+    clientConnection->onConnect([&] { ++clientsConnected; });
+
+    serverConnection->connect();
+    clientConnection->connect();
+    WAIT_UNTIL_REACHES(1, clientsConnected, 10);
+
+    // Everything in flight at once, half of it picked up by continuations
+    std::vector<InvokeFuture> futures;
+    for(auto i = 0; i < invokeCount; ++i) {
+        auto future = clientConnection->invokeAsync(std::to_string(i));
+        if(i % 2) {
+            future.then([&continued, i](InvokeResult result) {
+                EXPECT_EQ(InvokeResultCode::Good, result.resultCode);
+                EXPECT_EQ(std::to_string(i), result.payload.asString());
+                ++continued;
+            });
+        } else {
+            futures.emplace_back(std::move(future));
+        }
+    }
+    for(size_t i = 0; i < futures.size(); ++i) {
+        ASSERT_TRUE(futures[i].waitFor(10s));
+        auto result = futures[i].get();
+        EXPECT_EQ(InvokeResultCode::Good, result.resultCode);
+        EXPECT_EQ(std::to_string(i * 2), result.payload.asString());
+    }
+    WAIT_UNTIL_REACHES(invokeCount / 2, continued, 10);
+
+    EXPECT_EQ(InvokeResultCode::Timeout, clientConnection->invokeAsync("ignore", 20ms).get().resultCode);
+    auto unanswered = clientConnection->invokeAsync("ignore");
+    EXPECT_FALSE(unanswered.ready());
+    clientConnection->disconnect();
+    EXPECT_EQ(InvokeResultCode::LocalDisconnect, unanswered.get().resultCode);
+    EXPECT_EQ(InvokeResultCode::LocalDisconnect, clientConnection->invokeAsync("late").get().resultCode);
+}
+
+TEST_P(TransmitTest, InvokeBlockingTest)
+{
+    std::atomic_int clientsConnected{0};
+    std::atomic_int handled{0};
+
+    serverConnection->onInvoked([&](Handle connectionHandle, Handle promiseId, Payload data) {
+        if(data.asString() != "ignore") {
+            serverConnection->sendResult(connectionHandle, promiseId, data);
+        }
+    });
+    clientConnection->onConnect([&] { ++clientsConnected; });
+    // Results skip the dispatch thread, so even a handler running on it can block on one
+    clientConnection->onReceived([&](Payload) {
+        EXPECT_EQ("nested", clientConnection->invokeBlocking("nested", 10s).payload.asString());
+        ++handled;
+    });
+
+    serverConnection->connect();
+    clientConnection->connect();
+    WAIT_UNTIL_REACHES(1, clientsConnected, 10);
+
+    for(auto i = 0; i < 200; ++i) {
+        auto result = clientConnection->invokeBlocking(std::to_string(i), 10s);
+        EXPECT_EQ(InvokeResultCode::Good, result.resultCode);
+        EXPECT_EQ(std::to_string(i), result.payload.asString());
+    }
+    serverConnection->send("go");
+    WAIT_UNTIL_REACHES(1, handled, 10);
+    EXPECT_EQ(InvokeResultCode::Timeout, clientConnection->invokeBlocking("ignore", 20ms).resultCode);
+}
+
+TEST_P(TransmitTest, InvokeWindowTest)
+{
+    constexpr size_t window = 8;
+    std::atomic_int clientsConnected{0};
+    std::atomic_int answered{0};
+    std::atomic_int rejected{0};
+    std::atomic_int held{0};
+    std::mutex mutex;
+    std::vector<std::pair<Handle, Handle>> unanswered;
+
+    // Holds on to every invoke until told to answer them, newest first
+    serverConnection->onInvoked([&](Handle connectionHandle, Handle promiseId, Payload) {
+        std::lock_guard guard(mutex);
+        unanswered.emplace_back(connectionHandle, promiseId);
+        ++held;
+    });
+    clientConnection->onConnect([&] { ++clientsConnected; });
+    clientConnection->setInvokeWindow(window);
+
+    serverConnection->connect();
+    clientConnection->connect();
+    WAIT_UNTIL_REACHES(1, clientsConnected, 10);
+
+    for(size_t i = 0; i < window * 2; ++i) {
+        clientConnection->invoke("held", [&](InvokeResultCode resultCode, Payload) {
+            ++(resultCode == InvokeResultCode::WindowFull ? rejected : answered);
+        });
+    }
+    EXPECT_EQ(static_cast<int>(window), rejected);
+    EXPECT_EQ(InvokeResultCode::WindowFull, clientConnection->invokeAsync("held").get().resultCode);
+    WAIT_UNTIL_REACHES(static_cast<int>(window), held, 10);
+    {
+        std::lock_guard guard(mutex);
+        for(auto i = unanswered.rbegin(); i != unanswered.rend(); ++i) {
+            serverConnection->sendResult(i->first, i->second, "done");
+        }
+    }
+    WAIT_UNTIL_REACHES(static_cast<int>(window), answered, 10);
+
+    const auto stats = clientConnection->stats();
+    EXPECT_EQ(0u, stats.pendingInvokes);
+    EXPECT_EQ(window, stats.peakPendingInvokes);
+    EXPECT_EQ(window + 1, stats.invokesRejected);
+    EXPECT_EQ(window - 1, stats.reorderedResults);
+}
+
+// In-process payloads are never compressed
+#if !USE_IN_PROCESS
+TEST_P(TransmitTest, CompressionTest)
+{
+    std::string large;
+    for(auto i = 0; i < 2000; ++i) {
+        large += R"({"id":)" + std::to_string(i) + R"(,"name":"item","tags":["a","b","c"]},)";
+    }
+    std::atomic_int clientsConnected{0};
+
+    serverConnection->onInvoked([&](Handle connectionHandle, Handle promiseId, Payload data) {
+        serverConnection->sendResult(connectionHandle, promiseId, data);
+    });
+    clientConnection->onConnect([&] { ++clientsConnected; });
+    serverConnection->setCompressionThreshold(1024);
+    clientConnection->setCompressionThreshold(1024);
+
+    serverConnection->connect();
+    clientConnection->connect();
+    WAIT_UNTIL_REACHES(1, clientsConnected, 10);
+
+    // The server's hello is ahead of its first result on the stream
+    EXPECT_EQ("small", clientConnection->invokeBlocking("small", 10s).payload.asString());
+    const auto sentBefore = clientConnection->stats().bytesSent;
+    for(auto i = 0; i < 10; ++i) {
+        auto result = clientConnection->invokeBlocking(large, 10s);
+        EXPECT_EQ(InvokeResultCode::Good, result.resultCode);
+        EXPECT_EQ(large, result.payload.asString());
+    }
+    const auto stats = clientConnection->stats();
+    EXPECT_LT(stats.bytesSent - sentBefore, large.size() * 10 / 4);
+    EXPECT_LT(stats.bytesReceived, large.size() * 10 / 4);
+}
+#endif
+
+TEST_P(MultiTransmitTest, StreamChunksTest)
+{
+    constexpr size_t chunkCount = 20;
+    constexpr size_t chunkSize = 100 * 1024;
+    std::atomic_int serverConnected{0};
+    std::atomic_int finished{0};
+    std::atomic_int messages{0};
+    std::mutex mutex;
+    std::map<Handle, std::vector<uint8_t>> received;
+    Handle clientHandle{};
+
+    serverConnection->onConnect([&](Handle handle) {
+        clientHandle = handle;
+        ++serverConnected;
+    });
+    clientConnection->onReceived([&](Payload) { ++messages; });
+    clientConnection->onChunk([&](Handle streamId, Payload chunk, bool last) {
+        std::lock_guard guard(mutex);
+        auto &stream = received[streamId];
+        stream.insert(stream.end(), chunk.begin(), chunk.end());
+        if(last) {
+            ++finished;
+        }
+    });
+
+    serverConnection->connect();
+    clientConnection->connect();
+    WAIT_UNTIL_REACHES(1, serverConnected, 10);
+
+    // Two streams and plain messages interleaved on the one connection
+    const auto first = serverConnection->openStream();
+    const auto second = serverConnection->openStream();
+    EXPECT_NE(first, second);
+    for(size_t i = 0; i < chunkCount; ++i) {
+        const bool last = i + 1 == chunkCount;
+        EXPECT_TRUE(serverConnection->sendChunk(clientHandle, first, std::vector<uint8_t>(chunkSize, static_cast<uint8_t>(i)), last));
+        EXPECT_TRUE(serverConnection->sendChunk(clientHandle, second, std::vector<uint8_t>(i, static_cast<uint8_t>(i)), last));
+        serverConnection->send(clientHandle, "between");
+    }
+    WAIT_UNTIL_REACHES(2, finished, 20);
+    WAIT_UNTIL_REACHES(static_cast<int>(chunkCount), messages, 10);
+
+    std::lock_guard guard(mutex);
+    ASSERT_EQ(chunkCount * chunkSize, received[first].size());
+    for(size_t i = 0; i < chunkCount; ++i) {
+        EXPECT_EQ(static_cast<uint8_t>(i), received[first][i * chunkSize]);
+        EXPECT_EQ(static_cast<uint8_t>(i), received[first][(i + 1) * chunkSize - 1]);
+    }
+    EXPECT_EQ(chunkCount * (chunkCount - 1) / 2, received[second].size());
+}
+
+TEST_P(MultiTransmitTest, LatestValuesTest)
+{
+    constexpr int valueCount = 2000;
+    std::atomic_int serverConnected{0};
+    std::atomic_int lastSeen{-1};
+    std::atomic_int otherChannel{0};
+    std::mutex mutex;
+    std::vector<int> handled;
+
+    serverConnection->onConnect([&](Handle) { ++serverConnected; });
+    serverConnection->onLatest([&](Handle, uint32_t channel, Payload value) {
+        if(channel == 2) {
+            ++otherChannel;
+            return;
+        }
+        const auto number = std::stoi(value.asString());
+        {
+            std::lock_guard guard(mutex);
+            handled.push_back(number);
+        }
+        // A slow reader, so newer values pile up behind it
+        std::this_thread::sleep_for(1ms);
+        lastSeen = number;
+    });
+
+    serverConnection->connect();
+    clientConnection->connect();
+    WAIT_UNTIL_REACHES(1, serverConnected, 10);
+
+    EXPECT_TRUE(clientConnection->sendLatest(2, "other"));
+    for(int i = 0; i < valueCount; ++i) {
+        EXPECT_TRUE(clientConnection->sendLatest(1, std::to_string(i)));
+    }
+    WAIT_UNTIL_REACHES(valueCount - 1, lastSeen, 20);
+    WAIT_UNTIL_REACHES(1, otherChannel, 10);
+
+    std::lock_guard guard(mutex);
+    // Always in order and always ending on the newest, but skipping what was replaced on the way
+    EXPECT_TRUE(std::is_sorted(handled.begin(), handled.end()));
+    EXPECT_EQ(std::adjacent_find(handled.begin(), handled.end()), handled.end());
+    EXPECT_EQ(valueCount - 1, handled.back());
+    EXPECT_LT(handled.size(), static_cast<size_t>(valueCount));
+    EXPECT_EQ(1, otherChannel);
+    const auto replaced = clientConnection->stats().latestValuesReplaced + serverConnection->stats().latestValuesReplaced;
+    EXPECT_EQ(static_cast<uint64_t>(valueCount) - handled.size(), replaced);
+}
+
+TEST(TCPOptionsTest, DualStackServerTest)
+{
+    TCPOptions options;
+    options.keepAlive = true;
+    options.sendBufferSize = 1024 * 1024;
+    options.receiveBufferSize = 1024 * 1024;
+    auto server = ConnectionFactory::newMulticonnectServerConnectionTCP("[::]:10001", options);
+    server->onInvoked([](Handle, Payload message) { return message; });
+    server->connect();
+
+    // An IPv6 server also takes IPv4 clients unless told not to
+    for(const auto *endpoint : {"[::1]:10001", "127.0.0.1:10001"}) {
+        auto client = ConnectionFactory::newClientConnectionTCP(endpoint, options);
+        std::atomic_int connected{0};
+        client->onConnect([&] { ++connected; });
+        client->connect();
+        const auto deadline = std::chrono::steady_clock::now() + 10s;
+        while(!connected && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(1ms);
+        }
+        ASSERT_EQ(1, connected) << endpoint;
+        const auto result = client->invokeBlocking("ping", 10s);
+        EXPECT_EQ(InvokeResultCode::Good, result.resultCode) << endpoint;
+        EXPECT_EQ("ping", result.payload.asString()) << endpoint;
+    }
+}
+
+TEST(InProcTest, WaitsForServerAndReconnectsTest)
+{
+    const std::string endpoint = "twitch-native-ipc.test.inproc";
+    std::atomic_int serverConnected{0};
+    std::atomic_int clientConnected{0};
+    std::atomic_int clientDisconnected{0};
+    std::mutex receivedMutex;
+    std::vector<std::string> received;
+    const auto waitFor = [](int expected, const std::atomic_int &value) {
+        const auto deadline = std::chrono::steady_clock::now() + 10s;
+        while(value < expected && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(1ms);
+        }
+        return value.load();
+    };
+    const auto makeServer = [&] {
+        auto server = ConnectionFactory::newMulticonnectServerConnectionInProc(endpoint);
+        server->onConnect([&](Handle) { ++serverConnected; });
+        server->onInvoked([](Handle, Payload message) { return message; });
+        server->connect();
+        return server;
+    };
+
+    // Nobody is listening yet, so the client waits with its subscription held back
+    auto client = ConnectionFactory::newClientConnectionInProc(endpoint);
+    client->onConnect([&] { ++clientConnected; });
+    client->onDisconnect([&] { ++clientDisconnected; });
+    client->onReceived([&](Payload message) {
+        std::lock_guard lock(receivedMutex);
+        received.push_back(message.asString());
+    });
+    client->subscribe("news");
+    client->connect();
+    EXPECT_EQ(0, clientConnected);
+
+    auto server = makeServer();
+    ASSERT_EQ(1, waitFor(1, clientConnected));
+    ASSERT_EQ(1, waitFor(1, serverConnected));
+    auto result = client->invokeBlocking("ping", 10s);
+    EXPECT_EQ(InvokeResultCode::Good, result.resultCode);
+    EXPECT_EQ("ping", result.payload.asString());
+    server->publish("news", "n1");
+    const auto deadline = std::chrono::steady_clock::now() + 10s;
+    for(;;) {
+        {
+            std::lock_guard lock(receivedMutex);
+            if(!received.empty() || std::chrono::steady_clock::now() > deadline) {
+                break;
+            }
+        }
+        std::this_thread::sleep_for(1ms);
+    }
+    {
+        std::lock_guard lock(receivedMutex);
+        EXPECT_EQ((std::vector<std::string>{"n1"}), received);
+    }
+
+    // A second server can't take the endpoint while the first has it
+    auto rival = ConnectionFactory::newServerConnectionInProc(endpoint);
+    std::atomic_int rivalErrors{0};
+    rival->onError([&] { ++rivalErrors; });
+    rival->connect();
+    EXPECT_EQ(1, waitFor(1, rivalErrors));
+    rival.reset();
+
+    server.reset();
+    ASSERT_EQ(1, waitFor(1, clientDisconnected));
+    server = makeServer();
+    ASSERT_EQ(2, waitFor(2, clientConnected));
+    result = client->invokeBlocking("again", 10s);
+    EXPECT_EQ(InvokeResultCode::Good, result.resultCode);
+    EXPECT_EQ("again", result.payload.asString());
+    EXPECT_EQ(1u, client->stats().reconnects);
+}
+
+// In-process connections never run on a loop
+#if !USE_IN_PROCESS
+TEST(EventLoopTest, SharedLoopTest)
+{
+    constexpr int ClientCount = 8;
+    auto eventLoop = ConnectionFactory::newEventLoop(2);
+    EXPECT_EQ(2u, eventLoop->threadCount());
+    auto server = ConnectionFactory::newMulticonnectServerConnection("twitch-native-ipc.test.eventloop.sock", false, eventLoop);
+    server->onInvoked([](Handle, Payload message) { return message; });
+    server->connect();
+
+    std::atomic_int connected{0};
+    std::vector<std::unique_ptr<IConnection>> clients;
+    for(int i = 0; i < ClientCount; ++i) {
+        clients.emplace_back(ConnectionFactory::newClientConnection("twitch-native-ipc.test.eventloop.sock", eventLoop));
+        clients.back()->onConnect([&] { ++connected; });
+        clients.back()->connect();
+    }
+    // The connections keep their loop threads going without it
+    eventLoop.reset();
+    const auto deadline = std::chrono::steady_clock::now() + 10s;
+    while(connected < ClientCount && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(1ms);
+    }
+    ASSERT_EQ(ClientCount, connected);
+
+    for(int i = 0; i < ClientCount; ++i) {
+        const auto result = clients[i]->invokeBlocking(std::to_string(i), 10s);
+        EXPECT_EQ(InvokeResultCode::Good, result.resultCode);
+        EXPECT_EQ(std::to_string(i), result.payload.asString());
+    }
+    // Going away one at a time leaves the others running on the same loops
+    clients.erase(clients.begin(), clients.begin() + ClientCount / 2);
+    for(int i = 0; i < ClientCount / 2; ++i) {
+        const auto result = clients[i]->invokeBlocking("again", 10s);
+        EXPECT_EQ(InvokeResultCode::Good, result.resultCode);
+    }
+}
+#endif
+
+TEST(EventLoopTest, IOThreadsTest)
+{
+    constexpr int ClientCount = 8;
+    const std::vector<std::pair<std::string, bool>> endpoints = {
+        {"twitch-native-ipc.test.iothreads.sock", false}, {"127.0.0.1:10002", true}};
+    for(const auto &[endpoint, tcp] : endpoints) {
+        auto server = tcp ? ConnectionFactory::newMulticonnectServerConnectionTCP(endpoint)
+                          : ConnectionFactory::newMulticonnectServerConnection(endpoint);
+        server->setIOThreads(4);
+        std::mutex mutex;
+        std::set<Handle> handles;
+        server->onConnect([&](Handle connectionHandle) {
+            std::lock_guard guard(mutex);
+            handles.insert(connectionHandle);
+        });
+        server->onInvoked([](Handle, Payload message) { return message; });
+        server->connect();
+
+        std::atomic_int connected{0};
+        std::atomic_int broadcasts{0};
+        std::vector<std::unique_ptr<IConnection>> clients;
+        for(int i = 0; i < ClientCount; ++i) {
+            clients.emplace_back(tcp ? ConnectionFactory::newClientConnectionTCP(endpoint)
+                                     : ConnectionFactory::newClientConnection(endpoint));
+            clients.back()->onConnect([&] { ++connected; });
+            clients.back()->onReceived([&](Payload) { ++broadcasts; });
+            clients.back()->onInvoked([](Payload message) { return message; });
+            clients.back()->connect();
+        }
+        auto deadline = std::chrono::steady_clock::now() + 10s;
+        while((connected < ClientCount || server->activeConnections() < ClientCount) &&
+              std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(1ms);
+        }
+        ASSERT_EQ(ClientCount, connected) << endpoint;
+        ASSERT_EQ(ClientCount, server->activeConnections()) << endpoint;
+
+        for(int i = 0; i < ClientCount; ++i) {
+            const auto result = clients[i]->invokeBlocking(std::to_string(i), 10s);
+            EXPECT_EQ(InvokeResultCode::Good, result.resultCode) << endpoint;
+            EXPECT_EQ(std::to_string(i), result.payload.asString()) << endpoint;
+        }
+        // Every shard reaches its own clients
+        {
+            std::lock_guard guard(mutex);
+            EXPECT_EQ(static_cast<size_t>(ClientCount), handles.size()) << endpoint;
+            for(const auto handle : handles) {
+                const auto result = server->invokeBlocking(handle, "from server", 10s);
+                EXPECT_EQ(InvokeResultCode::Good, result.resultCode) << endpoint;
+            }
+        }
+        server->broadcast("everyone");
+        deadline = std::chrono::steady_clock::now() + 10s;
+        while(broadcasts < ClientCount && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(1ms);
+        }
+        EXPECT_EQ(ClientCount, broadcasts) << endpoint;
+    }
+}
+
+TEST(ReconnectPolicyTest, WaitForServerTest)
+{
+    const std::string endpoint = "twitch-native-ipc.test.reconnect.sock";
+    ReconnectPolicy policy;
+    // Far longer than the test waits, so only noticing the server come up can connect it in time
+    policy.initialDelay = 60s;
+    policy.maxDelay = 60s;
+    policy.jitter = 0;
+    auto client = ConnectionFactory::newClientConnection(endpoint);
+    client->setReconnectPolicy(policy);
+    std::atomic_bool connected{false};
+    client->onConnect([&] { connected = true; });
+    client->connect();
+
+    std::this_thread::sleep_for(100ms);
+    EXPECT_FALSE(connected);
+    auto server = ConnectionFactory::newServerConnection(endpoint);
+    server->connect();
+    const auto deadline = std::chrono::steady_clock::now() + 10s;
+    while(!connected && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(1ms);
+    }
+    EXPECT_TRUE(connected);
+}
+
+TEST(ConnectAsyncTest, ParallelStartTest)
+{
+    constexpr int ClientCount = 16;
+    const std::string endpoint = "twitch-native-ipc.test.connectasync.sock";
+    auto server = ConnectionFactory::newMulticonnectServerConnection(endpoint);
+    server->connectAsync();
+
+    std::atomic_int connected{0};
+    std::vector<std::unique_ptr<IConnection>> clients;
+    for(int i = 0; i < ClientCount; ++i) {
+        clients.emplace_back(ConnectionFactory::newClientConnection(endpoint));
+        clients.back()->onConnect([&] { ++connected; });
+        clients.back()->connectAsync();
+    }
+    // Going away before it has even started has to wait for the start, not hang or crash
+    ConnectionFactory::newClientConnection(endpoint + ".nobody")->connectAsync();
+
+    const auto deadline = std::chrono::steady_clock::now() + 10s;
+    while((connected < ClientCount || server->activeConnections() < ClientCount) &&
+          std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(1ms);
+    }
+    EXPECT_EQ(ClientCount, connected);
+    EXPECT_EQ(ClientCount, server->activeConnections());
+}
+
+TEST(ConnectAsyncTest, FailureReportedTest)
+{
+    std::atomic_int errors{0};
+    auto client = ConnectionFactory::newClientConnectionTCP("not an address");
+    client->onError([&] { ++errors; });
+    client->connectAsync();
+    auto server = ConnectionFactory::newServerConnectionTCP("not an address");
+    server->onError([&] { ++errors; });
+    server->connectAsync();
+
+    const auto deadline = std::chrono::steady_clock::now() + 10s;
+    while(errors < 2 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(1ms);
+    }
+    EXPECT_EQ(2, errors);
+}
+
+TEST(TeardownTest, ResultCallbackRacesDestroyTest)
+{
+    const std::string endpoint = "twitch-native-ipc.test.teardown.sock";
+    auto server = ConnectionFactory::newServerConnection(endpoint);
+    std::mutex mutex;
+    IConnection::ResultCallback stored;
+    server->onInvoked([&](Payload, IConnection::ResultCallback callback) {
+        std::lock_guard guard(mutex);
+        stored = std::move(callback);
+    });
+    server->connect();
+    auto client = ConnectionFactory::newClientConnection(endpoint);
+    client->connect();
+    client->invoke("test", [](InvokeResultCode, Payload) {});
+
+    auto deadline = std::chrono::steady_clock::now() + 10s;
+    while(std::chrono::steady_clock::now() < deadline) {
+        std::lock_guard guard(mutex);
+        if(stored) {
+            break;
+        }
+    }
+    // Keeps the callback running while the server goes away, which has to wait for whichever call is
+    // under way and no longer
+    std::atomic_bool stop{false};
+    std::thread caller([&] {
+        while(!stop) {
+            std::lock_guard guard(mutex);
+            if(stored) {
+                stored("result");
+            }
+        }
+    });
+    const auto start = std::chrono::steady_clock::now();
+    server.reset();
+    EXPECT_LT(std::chrono::steady_clock::now() - start, 1s);
+    stop = true;
+    caller.join();
+}
+
+namespace {
+struct SlowMethod {
+    static constexpr auto MethodId = methodId("slow");
+    uint32_t index;
+};
+struct FastMethod {
+    static constexpr auto MethodId = methodId("fast");
+    uint32_t index;
+};
+} // namespace
+
+TEST(MethodRoutingTest, ConcurrencyLimitTest)
+{
+    constexpr int SlowCount = 8;
+    const std::string endpoint = "twitch-native-ipc.test.methods.sock";
+    auto server = ConnectionFactory::newMulticonnectServerConnection(endpoint);
+    server->setDispatchThreads(4);
+    std::atomic_int running{0};
+    std::atomic_int peak{0};
+    std::atomic_int slowDone{0};
+    MethodOptions slowOptions;
+    slowOptions.maxConcurrency = 2;
+    server->registerMethod(
+        SlowMethod::MethodId,
+        [&](Handle, Payload message, IServerConnection::ResultCallback callback) {
+            const auto now = ++running;
+            for(auto seen = peak.load(); now > seen && !peak.compare_exchange_weak(seen, now);) {
+            }
+            std::this_thread::sleep_for(50ms);
+            --running;
+            ++slowDone;
+            callback(std::move(message));
+        },
+        slowOptions);
+    MethodOptions fastOptions;
+    fastOptions.executor = MethodExecutor::Inline;
+    server->registerMethod(
+        FastMethod::MethodId,
+        [](Handle, Payload message, IServerConnection::ResultCallback callback) { callback(std::move(message)); },
+        fastOptions);
+    server->onInvoked([](Handle, Payload message) { return Payload("untyped " + message.asString()); });
+    server->connect();
+    auto client = ConnectionFactory::newClientConnection(endpoint);
+    client->connect();
+
+    std::atomic_int slowAnswered{0};
+    for(uint32_t i = 0; i < SlowCount; ++i) {
+        client->invoke(encode(SlowMethod{i}), [&](InvokeResultCode resultCode, Payload) {
+            if(resultCode == InvokeResultCode::Good) {
+                ++slowAnswered;
+            }
+        });
+    }
+    // Neither waits behind the slow method's backlog
+    const auto fast = client->invokeBlocking(encode(FastMethod{1}), 10s);
+    EXPECT_EQ(InvokeResultCode::Good, fast.resultCode);
+    EXPECT_TRUE(MessageView<FastMethod>(fast.payload));
+    EXPECT_EQ("untyped hello", client->invokeBlocking("hello", 10s).payload.asString());
+    EXPECT_LT(slowDone, SlowCount);
+
+    const auto deadline = std::chrono::steady_clock::now() + 10s;
+    while(slowAnswered < SlowCount && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(1ms);
+    }
+    EXPECT_EQ(SlowCount, slowAnswered);
+    EXPECT_EQ(2, peak);
+}
+
+// In-process messages never queue, so there is nothing to overtake
+#if !USE_IN_PROCESS
+TEST(PriorityTest, ControlOvertakesBulkTest)
+{
+    constexpr int BulkCount = 128;
+    const std::string endpoint = "twitch-native-ipc.test.priority.sock";
+    auto server = ConnectionFactory::newServerConnection(endpoint);
+    auto client = ConnectionFactory::newClientConnection(endpoint);
+    std::atomic_int connected{0};
+    std::atomic_bool release{false};
+    std::mutex receivedMutex;
+    std::vector<std::string> received;
+    server->onConnect([&] { ++connected; });
+    // Stalls the client on the first message, so the rest back up behind it in the server's lanes
+    client->setInlineDispatch(true);
+    client->onReceived([&](Payload message) {
+        const auto start = std::chrono::steady_clock::now();
+        while(!release && std::chrono::steady_clock::now() - start < 10s) {
+            std::this_thread::sleep_for(1ms);
+        }
+        std::lock_guard lock(receivedMutex);
+        received.push_back(message.size() > 64 ? "bulk" : message.asString());
+    });
+    server->connect();
+    client->connect();
+    const auto connectDeadline = std::chrono::steady_clock::now() + 10s;
+    while(!connected && std::chrono::steady_clock::now() < connectDeadline) {
+        std::this_thread::sleep_for(1ms);
+    }
+    ASSERT_EQ(1, connected);
+
+    for(int i = 0; i < BulkCount; ++i) {
+        server->send(std::vector<uint8_t>(64 * 1024), Priority::Bulk);
+    }
+    std::this_thread::sleep_for(100ms);
+    server->send("control", Priority::Control);
+    release = true;
+
+    const auto deadline = std::chrono::steady_clock::now() + 20s;
+    for(;;) {
+        {
+            std::lock_guard lock(receivedMutex);
+            if(received.size() == BulkCount + 1 || std::chrono::steady_clock::now() > deadline) {
+                break;
+            }
+        }
+        std::this_thread::sleep_for(1ms);
+    }
+    std::lock_guard lock(receivedMutex);
+    ASSERT_EQ(BulkCount + 1u, received.size());
+    const auto position = std::find(received.begin(), received.end(), "control") - received.begin();
+    // Only what was already handed to the socket gets there first
+    EXPECT_LT(position, BulkCount / 2);
+}
+#endif
+
+// In-process transports hand payloads over without a limit
+#if !USE_IN_PROCESS
+TEST(FrameLimitTest, RefusesMessagesOverPeerLimitTest)
+{
+    const std::string endpoint = "twitch-native-ipc.test.framelimit.sock";
+    auto server = ConnectionFactory::newServerConnection(endpoint);
+    auto client = ConnectionFactory::newClientConnection(endpoint);
+    std::atomic_int disconnected{0};
+    std::atomic_int received{0};
+    server->setMaxFrameSize(1024);
+    server->onDisconnect([&] { ++disconnected; });
+    server->onReceived([&](Payload) { ++received; });
+    server->onInvoked([](Payload) { return Payload("ok"); });
+    server->connect();
+    client->connect();
+
+    // The server's hello comes ahead of the result, so its limit is known once this is answered
+    EXPECT_EQ(InvokeResultCode::Good, client->invokeBlocking(std::vector<uint8_t>(1024, 1), 10s).resultCode);
+    EXPECT_EQ(InvokeResultCode::FrameTooLarge, client->invokeBlocking(std::vector<uint8_t>(1025, 2), 10s).resultCode);
+    EXPECT_EQ(InvokeResultCode::FrameTooLarge, client->invokeAsync(std::vector<uint8_t>(1025, 2)).get().resultCode);
+    EXPECT_FALSE(client->trySend(std::vector<uint8_t>(1025, 2)));
+    EXPECT_FALSE(client->sendLatest(1, std::vector<uint8_t>(1024, 2)));
+    EXPECT_FALSE(client->sendChunk(client->openStream(), std::vector<uint8_t>(1024, 2), true));
+    client->send(std::vector<uint8_t>(1025, 2));
+    client->send(std::vector<uint8_t>(1024, 3));
+
+    const auto deadline = std::chrono::steady_clock::now() + 10s;
+    while(received < 1 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(1ms);
+    }
+    std::this_thread::sleep_for(50ms);
+    EXPECT_EQ(1, received);
+    EXPECT_EQ(0, disconnected);
+}
+#endif
+
+namespace {
+std::atomic<Twitch_IPC_Buffer> s_serverReceived{nullptr};
+std::atomic<uint32_t> s_serverReceivedFrom{0};
+std::atomic<Twitch_IPC_Buffer> s_clientReceived{nullptr};
+} // namespace
+
+TEST(ExportsTest, BufferRoundTripTest)
+{
+    const char *endpoint = "twitch-native-ipc.test.exports.sock";
+    auto server = Twitch_IPC_ServerConnectionCreate(endpoint);
+    Twitch_IPC_ServerConnectionOnReceivedBuffer(server, [](uint32_t connectionId, Twitch_IPC_Buffer buffer, const void *, int) {
+        s_serverReceivedFrom = connectionId;
+        s_serverReceived = buffer;
+    });
+    Twitch_IPC_ServerConnectionConnect(server);
+    auto client = Twitch_IPC_ConnectionCreateClient(endpoint);
+    Twitch_IPC_ConnectionOnReceivedBuffer(client, [](Twitch_IPC_Buffer buffer, const void *, int) { s_clientReceived = buffer; });
+    Twitch_IPC_ConnectionConnect(client);
+
+    const std::string message = "lent, not copied";
+    auto outgoing = Twitch_IPC_BufferAllocate(64);
+    EXPECT_EQ(64, Twitch_IPC_BufferLength(outgoing));
+    memcpy(Twitch_IPC_BufferData(outgoing), message.data(), message.size());
+    Twitch_IPC_ConnectionSendBuffer(client, outgoing, static_cast<int>(message.size()));
+
+    auto deadline = std::chrono::steady_clock::now() + 10s;
+    while(!s_serverReceived && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(1ms);
+    }
+    ASSERT_TRUE(s_serverReceived);
+    // Still the server's to use after the callback returned, until it sends it back
+    const auto received = s_serverReceived.exchange(nullptr);
+    EXPECT_EQ(message,
+        std::string(reinterpret_cast<const char *>(Twitch_IPC_BufferData(received)), Twitch_IPC_BufferLength(received)));
+    Twitch_IPC_ServerConnectionSendBuffer(server, s_serverReceivedFrom, received, Twitch_IPC_BufferLength(received));
+
+    deadline = std::chrono::steady_clock::now() + 10s;
+    while(!s_clientReceived && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(1ms);
+    }
+    ASSERT_TRUE(s_clientReceived);
+    const auto echoed = s_clientReceived.exchange(nullptr);
+    EXPECT_EQ(static_cast<int>(message.size()), Twitch_IPC_BufferLength(echoed));
+    Twitch_IPC_BufferRelease(echoed);
+
+    Twitch_IPC_ConnectionDestroy(client);
+    Twitch_IPC_ServerConnectionDestroy(server);
+}
+
+TEST(ExportsTest, PollingTest)
+{
+    constexpr int MessageCount = 20;
+    const char *endpoint = "twitch-native-ipc.test.exports.poll.sock";
+    auto server = Twitch_IPC_ServerConnectionCreate(endpoint);
+    std::atomic_int serverReady{0};
+    Twitch_IPC_ServerConnectionEnablePolling(
+        server, 0, [](void *context) { ++*static_cast<std::atomic_int *>(context); }, &serverReady);
+    Twitch_IPC_ServerConnectionConnect(server);
+    auto client = Twitch_IPC_ConnectionCreateClient(endpoint);
+    Twitch_IPC_ConnectionConnect(client);
+    for(int i = 0; i < MessageCount; ++i) {
+        const auto message = std::to_string(i);
+        Twitch_IPC_ConnectionSend(client, message.data(), static_cast<int>(message.size()));
+    }
+
+    std::vector<Twitch_IPC_Message> messages;
+    const auto deadline = std::chrono::steady_clock::now() + 10s;
+    while(messages.size() < MessageCount && std::chrono::steady_clock::now() < deadline) {
+        Twitch_IPC_Message batch[MessageCount];
+        const auto count = Twitch_IPC_ServerConnectionPoll(server, batch, MessageCount);
+        messages.insert(messages.end(), batch, batch + count);
+        if(!count) {
+            std::this_thread::sleep_for(1ms);
+        }
+    }
+    ASSERT_EQ(static_cast<size_t>(MessageCount), messages.size());
+    // Signalled when the inbox stops being empty, not for every message
+    EXPECT_GE(serverReady, 1);
+    EXPECT_LE(serverReady, MessageCount);
+    for(int i = 0; i < MessageCount; ++i) {
+        EXPECT_EQ(Twitch_IPC_MessageReceived, messages[i].kind);
+        EXPECT_NE(0u, messages[i].connectionId);
+        EXPECT_EQ(std::to_string(i), std::string(reinterpret_cast<const char *>(messages[i].data), messages[i].length));
+        Twitch_IPC_BufferRelease(messages[i].buffer);
+    }
+    EXPECT_EQ(0, Twitch_IPC_ServerConnectionPoll(server, messages.data(), MessageCount));
+    EXPECT_EQ(0u, Twitch_IPC_ServerConnectionPollDropped(server));
+
+    Twitch_IPC_ConnectionDestroy(client);
+    Twitch_IPC_ServerConnectionDestroy(server);
+}
+
+TEST(ExportsTest, PollingDropsOverCapacityTest)
+{
+    constexpr int Capacity = 4;
+    constexpr int MessageCount = 10;
+    const char *endpoint = "twitch-native-ipc.test.exports.pollfull.sock";
+    auto server = Twitch_IPC_ServerConnectionCreate(endpoint);
+    Twitch_IPC_ServerConnectionEnablePolling(server, Capacity, nullptr, nullptr);
+    Twitch_IPC_ServerConnectionConnect(server);
+    auto client = Twitch_IPC_ConnectionCreateClient(endpoint);
+    Twitch_IPC_ConnectionConnect(client);
+    for(int i = 0; i < MessageCount; ++i) {
+        const auto message = std::to_string(i);
+        Twitch_IPC_ConnectionSend(client, message.data(), static_cast<int>(message.size()));
+    }
+
+    // Nothing is polled until every message has either been queued or dropped
+    const auto deadline = std::chrono::steady_clock::now() + 10s;
+    while(Twitch_IPC_ServerConnectionPollDropped(server) < MessageCount - Capacity &&
+          std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(1ms);
+    }
+    EXPECT_EQ(static_cast<uint64_t>(MessageCount - Capacity), Twitch_IPC_ServerConnectionPollDropped(server));
+    Twitch_IPC_Message messages[MessageCount];
+    ASSERT_EQ(Capacity - 1, Twitch_IPC_ServerConnectionPoll(server, messages, Capacity - 1));
+    // The oldest are kept
+    std::vector<std::string> received;
+    for(int i = 0; i < Capacity - 1; ++i) {
+        received.emplace_back(reinterpret_cast<const char *>(messages[i].data), messages[i].length);
+        Twitch_IPC_BufferRelease(messages[i].buffer);
+    }
+    EXPECT_EQ((std::vector<std::string>{"0", "1", "2"}), received);
+
+    // Room for three more, which wrap around the end of the queue behind the one left in it
+    for(const std::string message : {"a", "b", "c"}) {
+        Twitch_IPC_ConnectionSend(client, message.data(), static_cast<int>(message.size()));
+    }
+    received.clear();
+    while(received.size() < Capacity && std::chrono::steady_clock::now() < deadline) {
+        const auto count = Twitch_IPC_ServerConnectionPoll(server, messages, MessageCount);
+        for(int i = 0; i < count; ++i) {
+            received.emplace_back(reinterpret_cast<const char *>(messages[i].data), messages[i].length);
+            Twitch_IPC_BufferRelease(messages[i].buffer);
+        }
+        if(!count) {
+            std::this_thread::sleep_for(1ms);
+        }
+    }
+    EXPECT_EQ((std::vector<std::string>{"3", "a", "b", "c"}), received);
+    EXPECT_EQ(static_cast<uint64_t>(MessageCount - Capacity), Twitch_IPC_ServerConnectionPollDropped(server));
+
+    Twitch_IPC_ConnectionDestroy(client);
+    Twitch_IPC_ServerConnectionDestroy(server);
+}
+
+TEST(ExportsTest, PollingAnswersInvokesOverCapacityTest)
+{
+    constexpr int InvokeCount = 3;
+    const char *endpoint = "twitch-native-ipc.test.exports.pollinvoke.sock";
+    auto server = Twitch_IPC_ServerConnectionCreate(endpoint);
+    Twitch_IPC_ServerConnectionEnablePolling(server, 1, nullptr, nullptr);
+    Twitch_IPC_ServerConnectionConnect(server);
+    auto client = Twitch_IPC_ConnectionCreateClient(endpoint);
+    Twitch_IPC_ConnectionEnablePolling(client, 1, nullptr, nullptr);
+    Twitch_IPC_ConnectionConnect(client);
+    // Fills the server's queue, so every invoke after it is answered without waiting to be polled
+    Twitch_IPC_ConnectionSend(client, "full", 4);
+    std::vector<uint32_t> promiseIds;
+    for(int i = 0; i < InvokeCount; ++i) {
+        promiseIds.push_back(Twitch_IPC_ConnectionInvoke(client, "invoke", 6));
+    }
+
+    const auto deadline = std::chrono::steady_clock::now() + 10s;
+    while(Twitch_IPC_ServerConnectionPollDropped(server) < InvokeCount && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(1ms);
+    }
+    // The client's own queue has room for one, but takes every result
+    std::this_thread::sleep_for(20ms);
+    std::vector<Twitch_IPC_Message> results;
+    while(results.size() < InvokeCount && std::chrono::steady_clock::now() < deadline) {
+        Twitch_IPC_Message batch[InvokeCount];
+        const auto count = Twitch_IPC_ConnectionPoll(client, batch, InvokeCount);
+        results.insert(results.end(), batch, batch + count);
+        if(!count) {
+            std::this_thread::sleep_for(1ms);
+        }
+    }
+    ASSERT_EQ(static_cast<size_t>(InvokeCount), results.size());
+    for(int i = 0; i < InvokeCount; ++i) {
+        EXPECT_EQ(Twitch_IPC_MessageResult, results[i].kind);
+        EXPECT_EQ(promiseIds[i], results[i].promiseId);
+        EXPECT_EQ(0, results[i].length);
+        Twitch_IPC_BufferRelease(results[i].buffer);
+    }
+    EXPECT_EQ(0u, Twitch_IPC_ConnectionPollDropped(client));
+    EXPECT_EQ(static_cast<uint64_t>(InvokeCount), Twitch_IPC_ServerConnectionPollDropped(server));
+
+    Twitch_IPC_Message message;
+    ASSERT_EQ(1, Twitch_IPC_ServerConnectionPoll(server, &message, 1));
+    EXPECT_EQ(Twitch_IPC_MessageReceived, message.kind);
+    Twitch_IPC_BufferRelease(message.buffer);
+
+    Twitch_IPC_ConnectionDestroy(client);
+    Twitch_IPC_ServerConnectionDestroy(server);
+}
+
+TEST(LatencyHistogramTest, BucketsKeepTheirPrecision)
+{
+    LatencyHistogram histogram;
+    for(uint64_t value : {0ull, 1ull, 7ull, 8ull, 9ull, 100ull, 1000ull, 123456ull, 1ull << 39}) {
+        const auto bucket = LatencyHistogram::bucketFor(value);
+        EXPECT_LE(value, LatencyHistogram::bucketLimit(bucket));
+        EXPECT_LE(LatencyHistogram::bucketLimit(bucket) - value, value / LatencyHistogram::SubBuckets);
+        if(bucket) {
+            EXPECT_GT(value, LatencyHistogram::bucketLimit(bucket - 1));
+        }
+    }
+    EXPECT_EQ(LatencyHistogram::BucketCount - 1, LatencyHistogram::bucketFor(~0ull));
+
+    for(uint64_t value = 1; value <= 1000; ++value) {
+        ++histogram.counts[LatencyHistogram::bucketFor(value)];
+    }
+    histogram.count = 1000;
+    histogram.maxMicroseconds = 1000;
+    EXPECT_NEAR(500.0, static_cast<double>(histogram.percentile(0.5)), 500.0 / LatencyHistogram::SubBuckets);
+    EXPECT_NEAR(990.0, static_cast<double>(histogram.percentile(0.99)), 990.0 / LatencyHistogram::SubBuckets);
+    EXPECT_EQ(1000u, histogram.percentile(1.0));
+}
+
+TEST_P(MultiTransmitTest, MixedSizeMessageOrderTest)
+{
+    // sizes chosen so that small frames and empty frames straddle read boundaries
+    const std::vector<size_t> sizes{0, 1, 5, 70000, 3, 0, 7, 200000, 1};
+    constexpr int rounds = 50;
+    std::atomic_int received{0};
+    std::atomic_int mismatched{0};
+    std::atomic_int serverConnected{0};
+
+    serverConnection->onReceived([&](Handle, Payload data) {
+        const int index = received;
+        const auto expectedSize = sizes[index % sizes.size()];
+        if(data.size() != expectedSize ||
+            (!data.empty() && (data.front() != static_cast<uint8_t>(index) ||
+                                  data.back() != static_cast<uint8_t>(index)))) {
+            ++mismatched;
+        }
+        ++received;
+    });
+    serverConnection->onConnect([&](Handle) {
+        Sleep(_sleepOnConnect);
+        ++serverConnected;
+    });
+
+    serverConnection->connect();
+    clientConnection->connect();
+    WAIT_UNTIL_REACHES(1, serverConnected, 10);
+
+    const int total = rounds * static_cast<int>(sizes.size());
+    for(int i = 0; i < total; ++i) {
+        clientConnection->send(std::vector<uint8_t>(sizes[i % sizes.size()], static_cast<uint8_t>(i)));
+    }
+
+    WAIT_UNTIL_REACHES(total, received, 20);
+    EXPECT_EQ(0, mismatched);
+}
+
 #if TEST_MANY_MESSAGES_SINGLE_DIRECTION
 TEST_P(MultiTransmitTest, ManyServerMessagesTest)
 {
@@ -1574,6 +2859,37 @@ TEST_P(TransmitTest, InvokeLatencyTest)
     EXPECT_LT(totalNanos / receivesExpected, 1000000);
 }
 
+TEST_P(TransmitTest, InlineInvokeLatencyTest)
+{
+    int receivesExpected = GetParam()._modified ? 10 : 500;
+    std::atomic_int clientsConnected{0};
+    std::atomic_int serverResultsReceived{0};
+    int64_t totalNanos = 0;
+
+    serverConnection->setInlineDispatch(true);
+    clientConnection->setInlineDispatch(true);
+    serverConnection->onInvoked([](Payload data) { return data; });
+    clientConnection->onConnect([&] { ++clientsConnected; });
+
+    serverConnection->connect();
+    clientConnection->connect();
+
+    WAIT_UNTIL_REACHES(1, clientsConnected);
+    for (auto i=0; i<receivesExpected; ++i) {
+        clientConnection->invoke("Here is just some dumb message",
+            [sentTime = std::chrono::high_resolution_clock::now(), &totalNanos, &serverResultsReceived] (InvokeResultCode, Payload)
+        {
+            totalNanos += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - sentTime).count();
+            ++serverResultsReceived;
+        });
+        std::this_thread::sleep_for(1ms);
+    }
+
+    WAIT_UNTIL_REACHES(receivesExpected, serverResultsReceived, 20);
+    printf("Inline latency - avg: %f\n", float(totalNanos)/1000000.f/receivesExpected);
+    EXPECT_LT(totalNanos / receivesExpected, 1000000);
+}
+
 TEST_P(MultiTransmitTest, InvokeLatencyTest)
 {
     int receivesExpected = GetParam()._modified ? 10 : 500;
@@ -2892,6 +4208,192 @@ TEST_P(MultiTransmitTest, BroadcastTest)
     EXPECT_EQ(serverCommands, "test");
 }
 
+TEST_P(MultiTransmitTest, BroadcastKeepsOrderWithSendsTest)
+{
+    constexpr int clientCount = 3;
+    constexpr int rounds = 20;
+    constexpr size_t broadcastSize = 256 * 1024;
+    std::mutex handlesMutex;
+    std::vector<Handle> handles;
+    std::atomic_int serverConnected{0};
+    std::atomic_int received{0};
+    std::atomic_int outOfOrder{0};
+
+    serverConnection->onConnect([&](Handle handle) {
+        std::lock_guard guard(handlesMutex);
+        handles.push_back(handle);
+        ++serverConnected;
+    });
+    // Each client should see its own message for a round followed by that round's broadcast
+    std::vector<std::unique_ptr<IConnection>> extraClients;
+    std::vector<IConnection *> clients{clientConnection.get()};
+    for(int c = 1; c < clientCount; ++c) {
+        extraClients.emplace_back(MakeClient());
+        clients.push_back(extraClients.back().get());
+    }
+    for(auto *client : clients) {
+        client->onReceived([&, count = 0](Payload data) mutable {
+            const auto round = count / 2;
+            const auto expectBroadcast = count % 2 == 1;
+            if(expectBroadcast ? data.size() != broadcastSize || data.front() != static_cast<uint8_t>(round)
+                               : data.asString() != std::to_string(round)) {
+                ++outOfOrder;
+            }
+            ++count;
+            ++received;
+        });
+    }
+
+    serverConnection->connect();
+    for(auto *client : clients) {
+        client->connect();
+    }
+    WAIT_UNTIL_REACHES(clientCount, serverConnected, 10);
+
+    for(int round = 0; round < rounds; ++round) {
+        for(const auto handle : handles) {
+            serverConnection->send(handle, std::to_string(round));
+        }
+        serverConnection->broadcast(std::vector<uint8_t>(broadcastSize, static_cast<uint8_t>(round)));
+    }
+
+    WAIT_UNTIL_REACHES(2 * rounds * clientCount, received, 20);
+    EXPECT_EQ(0, outOfOrder);
+}
+
+TEST_P(MultiTransmitTest, PublishToSubscribersTest)
+{
+    std::atomic_int serverConnected{0};
+    std::atomic_int roundTrips{0};
+    std::mutex receivedMutex;
+    std::vector<std::string> receivedA;
+    std::vector<std::string> receivedB;
+
+    serverConnection->onConnect([&](Handle) { ++serverConnected; });
+    serverConnection->onInvoked([](Handle, Payload data) -> Payload { return data; });
+    auto clientB = MakeClient();
+    clientConnection->onReceived([&](Payload data) {
+        std::lock_guard guard(receivedMutex);
+        receivedA.push_back(data.asString());
+    });
+    clientB->onReceived([&](Payload data) {
+        std::lock_guard guard(receivedMutex);
+        receivedB.push_back(data.asString());
+    });
+    // Subscriptions made before connect go out first; a round trip after them means the server has them too
+    const auto roundTrip = [&](IConnection &client) {
+        client.invoke("ping", [&](InvokeResultCode, Payload) { ++roundTrips; });
+    };
+    clientConnection->subscribe("a");
+    clientConnection->subscribe("shared");
+    clientB->subscribe("b");
+    clientB->subscribe("shared");
+
+    serverConnection->connect();
+    clientConnection->connect();
+    clientB->connect();
+    WAIT_UNTIL_REACHES(2, serverConnected, 10);
+    roundTrip(*clientConnection);
+    roundTrip(*clientB);
+    WAIT_UNTIL_REACHES(2, roundTrips, 10);
+
+    serverConnection->publish("a", "a1");
+    serverConnection->publish("b", "b1");
+    serverConnection->publish("nobody", "n1");
+    serverConnection->publish("shared", "s1");
+
+    clientB->unsubscribe("shared");
+    roundTrip(*clientB);
+    WAIT_UNTIL_REACHES(3, roundTrips, 10);
+    serverConnection->publish("shared", "s2");
+    // Marks the end of what each client can receive
+    serverConnection->broadcast("end");
+
+    const auto received = [&] {
+        std::lock_guard guard(receivedMutex);
+        return static_cast<int>(receivedA.size() + receivedB.size());
+    };
+    WAIT_UNTIL_REACHES(7, received, 10);
+    std::lock_guard guard(receivedMutex);
+    EXPECT_EQ((std::vector<std::string>{"a1", "s1", "s2", "end"}), receivedA);
+    EXPECT_EQ((std::vector<std::string>{"b1", "s1", "end"}), receivedB);
+}
+
+TEST_P(MultiTransmitTest, BackpressureTest)
+{
+    constexpr size_t messageSize = 64 * 1024;
+    std::atomic_int serverConnected{0};
+    std::atomic_int blocked{0};
+    std::atomic_int writable{0};
+    std::atomic_int received{0};
+    std::atomic_bool release{false};
+    Handle clientHandle{};
+
+    serverConnection->setWriteQueueLimits(1024 * 1024, 0);
+    serverConnection->onConnect([&](Handle handle) {
+        clientHandle = handle;
+        ++serverConnected;
+    });
+    serverConnection->onBackpressure([&](Handle) { ++blocked; });
+    serverConnection->onWritable([&](Handle) { ++writable; });
+    // An inline handler that doesn't return stops the client reading altogether, like a stalled consumer
+    clientConnection->setInlineDispatch(true);
+    clientConnection->onReceived([&](Payload) {
+        const auto start = std::chrono::steady_clock::now();
+        while(!release && std::chrono::steady_clock::now() - start < 10s) {
+            std::this_thread::sleep_for(1ms);
+        }
+        ++received;
+    });
+
+    serverConnection->connect();
+    clientConnection->connect();
+    WAIT_UNTIL_REACHES(1, serverConnected, 10);
+
+    int accepted = 0;
+    while(accepted < 1000 && serverConnection->trySend(clientHandle, std::vector<uint8_t>(messageSize))) {
+        ++accepted;
+    }
+    EXPECT_LT(accepted, 1000);
+    WAIT_UNTIL_REACHES(1, blocked, 10);
+    EXPECT_EQ(0, writable);
+
+    release = true;
+    WAIT_UNTIL_REACHES(1, writable, 10);
+    EXPECT_TRUE(serverConnection->trySend(clientHandle, std::vector<uint8_t>(messageSize)));
+    WAIT_UNTIL_REACHES(accepted + 1, received, 20);
+    EXPECT_EQ(1, blocked);
+}
+
+TEST_P(MultiTransmitTest, BackpressureReportedOffSendThreadTest)
+{
+    std::atomic_int serverConnected{0};
+    std::atomic_int received{0};
+    std::atomic_int blocked{0};
+    std::thread::id handlerThread;
+
+    serverConnection->onConnect([&](Handle) { ++serverConnected; });
+    serverConnection->onReceived([&](Handle, Payload) { ++received; });
+    // Inline, the handler would run inside the send that went over the limits if it weren't posted, holding
+    // on to the transport while it sends again
+    clientConnection->setInlineDispatch(true);
+    clientConnection->setWriteQueueLimits(1024, 0);
+    clientConnection->onBackpressure([&] {
+        handlerThread = std::this_thread::get_id();
+        clientConnection->send("from handler");
+        ++blocked;
+    });
+
+    serverConnection->connect();
+    clientConnection->connect();
+    WAIT_UNTIL_REACHES(1, serverConnected, 10);
+
+    clientConnection->send(std::vector<uint8_t>(64 * 1024));
+    WAIT_UNTIL_REACHES(1, blocked, 10);
+    EXPECT_NE(std::this_thread::get_id(), handlerThread);
+    WAIT_UNTIL_REACHES(2, received, 10);
+}
+
 TEST_P(MultiConnectIPCTest, ClientServerTest)
 {
     std::atomic_int gotShort{0};
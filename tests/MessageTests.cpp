@@ -0,0 +1,66 @@
+// Copyright Twitch Interactive, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: MIT
+
+#include "Message.h"
+#include <gtest/gtest.h>
+
+using namespace Twitch::IPC;
+
+namespace {
+size_t roundTrip(const MessageHeader &header)
+{
+    uint8_t encoded[MaxCompactHeaderSize]{};
+    const auto size = encodeCompactHeader(header, encoded);
+    EXPECT_LE(size, MaxCompactHeaderSize);
+    MessageHeader decoded{};
+    EXPECT_EQ(static_cast<int>(size), decodeCompactHeader(encoded, size, decoded));
+    EXPECT_EQ(header.handle, decoded.handle);
+    EXPECT_EQ(header.bodySize, decoded.bodySize);
+    return size;
+}
+} // namespace
+
+TEST(CompactHeaderTest, SmallMessagesTakeOneByte)
+{
+    EXPECT_EQ(1u, roundTrip({0, 0}));
+    EXPECT_EQ(1u, roundTrip({0, 14}));
+    EXPECT_EQ(1u, roundTrip({CompressedFlag, 9}));
+    EXPECT_EQ(2u, roundTrip({0, 15}));
+}
+
+TEST(CompactHeaderTest, RoundTripsEveryKindOfHandle)
+{
+    roundTrip({1, 4});
+    roundTrip({0x80000000 | 123456, 16});
+    roundTrip({0x80000000 | CompressedFlag | 0x3FFFFFFF, 1 << 20});
+    roundTrip({ControlHandle::Hello, sizeof(Hello)});
+    roundTrip({ControlHandleBase + 0xFF, 0});
+    EXPECT_EQ(MaxCompactHeaderSize, roundTrip({0x3FFFFFFF, UINT32_MAX}));
+}
+
+TEST(CompactHeaderTest, AsksForMoreUntilTheHeaderIsComplete)
+{
+    uint8_t encoded[MaxCompactHeaderSize]{};
+    const auto size = encodeCompactHeader({0x12345, 100000}, encoded);
+    MessageHeader decoded{};
+    for(size_t available = 0; available < size; ++available) {
+        EXPECT_EQ(0, decodeCompactHeader(encoded, available, decoded));
+    }
+    EXPECT_EQ(static_cast<int>(size), decodeCompactHeader(encoded, size, decoded));
+}
+
+TEST(CompactHeaderTest, RejectsMalformedHeaders)
+{
+    MessageHeader decoded{};
+    // A control handle can't carry flags
+    const uint8_t flaggedControl[] = {CompactHeader::ControlFollows | CompactHeader::HighFlag, 0};
+    EXPECT_EQ(-1, decodeCompactHeader(flaggedControl, sizeof(flaggedControl), decoded));
+    // Flags go in the lead byte, not the varint
+    const uint8_t flaggedId[] = {CompactHeader::HandleFollows, 0x80, 0x80, 0x80, 0x80, 0x04};
+    EXPECT_EQ(-1, decodeCompactHeader(flaggedId, sizeof(flaggedId), decoded));
+    // Varints past 32 bits
+    const uint8_t longVarint[] = {CompactHeader::HandleFollows, 0xFF, 0xFF, 0xFF, 0xFF, 0x7F};
+    EXPECT_EQ(-1, decodeCompactHeader(longVarint, sizeof(longVarint), decoded));
+    const uint8_t oversized[] = {CompactHeader::SizeFollows, 0xFF, 0xFF, 0xFF, 0xFF, 0x0F};
+    EXPECT_EQ(-1, decodeCompactHeader(oversized, sizeof(oversized), decoded));
+}
@@ -0,0 +1,135 @@
+// Copyright Twitch Interactive, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: MIT
+
+#include "OperationQueue.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+
+using namespace Twitch::IPC;
+using namespace std::chrono_literals;
+
+namespace {
+// Counts how often it gets copied or moved
+struct Tracker {
+    int *copies;
+    int *moves;
+    Tracker(int *c, int *m)
+        : copies(c)
+        , moves(m)
+    {
+    }
+    Tracker(const Tracker &other)
+        : copies(other.copies)
+        , moves(other.moves)
+    {
+        ++*copies;
+    }
+    Tracker(Tracker &&other) noexcept
+        : copies(other.copies)
+        , moves(other.moves)
+    {
+        ++*moves;
+    }
+};
+} // namespace
+
+TEST(OperationTest, MovesTargetsWithoutCopying)
+{
+    int copies = 0;
+    int moves = 0;
+    int calls = 0;
+    Operation small([tracker = Tracker(&copies, &moves), &calls] { ++calls; });
+    std::array<char, 2 * Operation::InlineSize> padding{};
+    Operation large([tracker = Tracker(&copies, &moves), padding, &calls] { calls += 1 + padding[0]; });
+
+    OperationRing ring(2);
+    ring.push(std::move(small));
+    ring.push(std::move(large));
+    ring.push([] {}); // grows the ring, relocating both
+    auto first = ring.pop();
+    auto second = ring.pop();
+    first();
+    second();
+
+    EXPECT_EQ(2, calls);
+    EXPECT_EQ(0, copies);
+    EXPECT_FALSE(small);
+    EXPECT_FALSE(large);
+}
+
+TEST(OperationTest, RingKeepsOrderAcrossWrapAndGrowth)
+{
+    OperationRing ring(4);
+    std::vector<int> ran;
+    int next = 0;
+    for(int round = 0; round < 50; ++round) {
+        // Push more than is popped so that the ring wraps and grows along the way
+        for(int i = 0; i < 3; ++i) {
+            ring.push([&ran, value = next++] { ran.push_back(value); });
+        }
+        ring.pop()();
+        ring.pop()();
+    }
+    std::vector<Operation> batch;
+    ring.popInto(batch, 1000);
+    for(auto &operation : batch) {
+        operation();
+    }
+    ASSERT_EQ(static_cast<size_t>(next), ran.size());
+    for(int i = 0; i < next; ++i) {
+        EXPECT_EQ(i, ran[i]);
+    }
+    EXPECT_TRUE(ring.empty());
+}
+
+TEST(OperationQueueTest, RunsInOrderAcrossBatches)
+{
+    constexpr int operationCount = 10000;
+    std::atomic_int ran{0};
+    std::atomic_int outOfOrder{0};
+    {
+        OperationQueue queue;
+        for(int i = 0; i < operationCount; ++i) {
+            queue.enqueue([&, i] {
+                if(ran++ != i) {
+                    ++outOfOrder;
+                }
+            });
+        }
+        const auto start = std::chrono::steady_clock::now();
+        while(ran < operationCount && std::chrono::steady_clock::now() - start < 10s) {
+            std::this_thread::sleep_for(1ms);
+        }
+    }
+    EXPECT_EQ(operationCount, ran);
+    EXPECT_EQ(0, outOfOrder);
+}
+
+TEST(OperationQueueTest, BusyStrandsLeaveRoomForUnordered)
+{
+    OperationQueue queue;
+    queue.setThreadCount(2);
+    std::atomic<bool> unorderedRan{false};
+    // Each keeps its strand on the ready list by queueing the next one before it returns
+    std::function<void(Handle)> keepBusy = [&](Handle key) {
+        if(!unorderedRan) {
+            queue.enqueue(key, [&, key] { keepBusy(key); });
+        }
+    };
+    for(Handle key = 1; key <= 4; ++key) {
+        queue.enqueue(key, [&, key] { keepBusy(key); });
+    }
+    std::this_thread::sleep_for(10ms);
+    queue.enqueueUnordered([&] { unorderedRan = true; });
+    const auto start = std::chrono::steady_clock::now();
+    while(!unorderedRan && std::chrono::steady_clock::now() - start < 10s) {
+        std::this_thread::sleep_for(1ms);
+    }
+    EXPECT_TRUE(unorderedRan);
+    queue.stop();
+}
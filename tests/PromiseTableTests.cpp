@@ -0,0 +1,130 @@
+// Copyright Twitch Interactive, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: MIT
+
+#include "PromiseTable.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+
+using namespace Twitch::IPC;
+
+namespace {
+PendingInvoke countingInvoke(std::atomic_int &calls)
+{
+    return {[&calls](InvokeResultCode, Payload) { ++calls; }, std::chrono::steady_clock::now()};
+}
+} // namespace
+
+TEST(PromiseTableTest, TakesOnlyMatchingInvokes)
+{
+    PromiseTable table(8);
+    std::atomic_int calls{0};
+    table.openConnection(10);
+    table.openConnection(20);
+    table.insert(1, 10, table.windowFor(10), countingInvoke(calls));
+    // Shares a slot with promise 1, so it lands in the overflow map
+    table.insert(9, 20, table.windowFor(20), countingInvoke(calls));
+    table.insert(2, 20, table.windowFor(20), countingInvoke(calls));
+    EXPECT_EQ(3u, table.size());
+
+    PendingInvoke invoke;
+    EXPECT_FALSE(table.take(1, 20, invoke));
+    EXPECT_FALSE(table.take(3, 10, invoke));
+    EXPECT_TRUE(table.take(1, 10, invoke));
+    invoke.callback(InvokeResultCode::Good, {});
+    EXPECT_FALSE(table.take(1, 10, invoke));
+    EXPECT_EQ(1, calls);
+
+    auto taken = table.takeConnection(20);
+    EXPECT_EQ(2u, taken.size());
+    EXPECT_EQ(0u, table.size());
+    EXPECT_TRUE(table.takeAll().empty());
+}
+
+TEST(PromiseTableTest, WindowsAndReordering)
+{
+    PromiseTable table(8);
+    std::atomic_int calls{0};
+    table.setWindow(2);
+    table.openConnection(10);
+    table.openConnection(20);
+    EXPECT_EQ(InvokeResultCode::Good, table.insert(1, 10, table.windowFor(10), countingInvoke(calls)));
+    EXPECT_EQ(InvokeResultCode::Good, table.insert(2, 10, table.windowFor(10), countingInvoke(calls)));
+    auto rejected = countingInvoke(calls);
+    EXPECT_EQ(InvokeResultCode::WindowFull, table.insert(3, 10, table.windowFor(10), std::move(rejected)));
+    // Left for the caller to fail
+    EXPECT_TRUE(rejected.callback);
+    // Each connection has a window of its own
+    EXPECT_EQ(InvokeResultCode::Good, table.insert(4, 20, table.windowFor(20), countingInvoke(calls)));
+    EXPECT_EQ(1u, table.rejected());
+    EXPECT_EQ(2u, table.peakInFlight());
+
+    PendingInvoke invoke;
+    EXPECT_TRUE(table.takeAnswered(2, 10, invoke));
+    EXPECT_EQ(InvokeResultCode::Good, table.insert(5, 10, table.windowFor(10), countingInvoke(calls)));
+    // Promise 1 went out before 2 but is answered after it
+    EXPECT_TRUE(table.takeAnswered(1, 10, invoke));
+    EXPECT_TRUE(table.takeAnswered(4, 20, invoke));
+    EXPECT_TRUE(table.takeAnswered(5, 10, invoke));
+    EXPECT_EQ(1u, table.reordered());
+    EXPECT_EQ(0u, table.size());
+}
+
+TEST(PromiseTableTest, RefusesClosedConnections)
+{
+    PromiseTable table(8);
+    std::atomic_int calls{0};
+    auto unknown = countingInvoke(calls);
+    EXPECT_EQ(InvokeResultCode::RemoteDisconnect, table.insert(1, 10, table.windowFor(10), std::move(unknown)));
+    EXPECT_TRUE(unknown.callback);
+
+    table.openConnection(10);
+    EXPECT_EQ(InvokeResultCode::Good, table.insert(2, 10, table.windowFor(10), countingInvoke(calls)));
+    EXPECT_EQ(1u, table.takeConnection(10).size());
+    // Gone for good, rather than opened again by the next invoke
+    EXPECT_EQ(InvokeResultCode::RemoteDisconnect, table.insert(3, 10, table.windowFor(10), countingInvoke(calls)));
+
+    const auto kept = table.openConnection(20);
+    table.closeAll();
+    EXPECT_EQ(InvokeResultCode::RemoteDisconnect, table.insert(4, 20, table.windowFor(20), countingInvoke(calls)));
+    // As is a window kept from before
+    EXPECT_EQ(InvokeResultCode::RemoteDisconnect, table.insert(5, 20, kept, countingInvoke(calls)));
+    EXPECT_EQ(0u, table.size());
+}
+
+TEST(PromiseTableTest, ConcurrentInsertAndTake)
+{
+    constexpr Handle perThread = 20000;
+    constexpr Handle threadCount = 4;
+    PromiseTable table(64);
+    std::atomic_int calls{0};
+    std::atomic_int taken{0};
+    std::vector<std::thread> threads;
+    for(Handle t = 0; t < threadCount; ++t) {
+        table.openConnection(t);
+    }
+    for(Handle t = 0; t < threadCount; ++t) {
+        threads.emplace_back([&, t] {
+            // Each thread keeps a window of invokes outstanding, wider than the table for some of them
+            const Handle window = 16 + t * 32;
+            for(Handle i = 1; i <= perThread; ++i) {
+                table.insert(i * threadCount + t, t, table.windowFor(t), countingInvoke(calls));
+                if(i > window) {
+                    PendingInvoke invoke;
+                    if(table.take((i - window) * threadCount + t, t, invoke)) {
+                        invoke.callback(InvokeResultCode::Good, {});
+                        ++taken;
+                    }
+                }
+            }
+        });
+    }
+    for(auto &thread : threads) {
+        thread.join();
+    }
+    auto rest = table.takeAll();
+    EXPECT_EQ(static_cast<int>(perThread * threadCount), taken + static_cast<int>(rest.size()));
+    EXPECT_EQ(taken.load(), calls.load());
+    EXPECT_EQ(0u, table.size());
+}
@@ -0,0 +1,228 @@
+// Copyright Twitch Interactive, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: MIT
+
+#include "ConnectionFactory.h"
+#include "SharedMemoryRing.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+using namespace Twitch::IPC;
+using namespace std::chrono_literals;
+
+namespace {
+constexpr const char *ShmEndPoint = "twitch-native-ipc.shm-test.endpoint.sock";
+
+bool waitFor(const std::atomic_int &counter, int expected, std::chrono::seconds timeout = 20s)
+{
+    const auto start = std::chrono::steady_clock::now();
+    while(counter < expected && std::chrono::steady_clock::now() - start < timeout) {
+        std::this_thread::sleep_for(1ms);
+    }
+    return counter >= expected;
+}
+
+// Makes an anonymous shared memory blob filled with `value`
+NativeHandle makeSharedBlob(size_t size, uint8_t value)
+{
+#ifdef _WIN32
+    const auto handle = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0, static_cast<DWORD>(size), nullptr);
+    auto view = MapViewOfFile(handle, FILE_MAP_ALL_ACCESS, 0, 0, size);
+    memset(view, value, size);
+    UnmapViewOfFile(view);
+    return handle;
+#else
+    const auto name = "/tnipc-blob-" + std::to_string(getpid());
+    const auto fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    shm_unlink(name.c_str());
+    EXPECT_EQ(0, ftruncate(fd, static_cast<off_t>(size)));
+    auto view = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    memset(view, value, size);
+    munmap(view, size);
+    return fd;
+#endif
+}
+
+void closeSharedBlob(NativeHandle handle)
+{
+#ifdef _WIN32
+    CloseHandle(handle);
+#else
+    close(handle);
+#endif
+}
+} // namespace
+
+TEST(SharedMemoryRingTest, FramesWrapAroundTheEnd)
+{
+    auto writer = SharedMemoryRing::create(100, false);
+    ASSERT_TRUE(writer);
+    auto reader = SharedMemoryRing::open(writer->name(), writer->capacity());
+    ASSERT_TRUE(reader);
+
+    std::vector<uint8_t> body(30);
+    for(uint32_t i = 0; i < 20; ++i) {
+        for(auto &b : body) {
+            b = static_cast<uint8_t>(i);
+        }
+        ASSERT_TRUE(writer->tryWrite({i, static_cast<uint32_t>(body.size())}, body.data()));
+        ASSERT_TRUE(writer->tryWrite({i, 0}, nullptr));
+
+        MessageHeader header{};
+        ASSERT_TRUE(reader->readHeader(header));
+        EXPECT_EQ(i, header.handle);
+        std::vector<uint8_t> received(header.bodySize);
+        reader->readBody(received.data());
+        EXPECT_EQ(body, received);
+
+        ASSERT_TRUE(reader->readHeader(header));
+        EXPECT_EQ(0u, header.bodySize);
+        reader->readBody(nullptr);
+        EXPECT_FALSE(reader->readHeader(header));
+    }
+}
+
+TEST(SharedMemoryRingTest, RefusesFramesThatDoNotFit)
+{
+    auto writer = SharedMemoryRing::create(64, false);
+    ASSERT_TRUE(writer);
+    std::vector<uint8_t> body(40);
+    EXPECT_TRUE(writer->tryWrite({1, static_cast<uint32_t>(body.size())}, body.data()));
+    EXPECT_FALSE(writer->tryWrite({2, static_cast<uint32_t>(body.size())}, body.data()));
+    EXPECT_FALSE(writer->tryWrite({3, 100}, body.data()));
+    EXPECT_FALSE(SharedMemoryRing::open(writer->name(), 128));
+}
+
+TEST(SharedMemoryTransportTest, LargeAndSmallMessagesKeepOrder)
+{
+    // 4MB frames outrun the ring, so some of them fall back to the pipe between ring runs
+    const std::vector<size_t> sizes{4 * 1024 * 1024, 0, 17, 70000, 4 * 1024 * 1024 + 3, 1};
+    constexpr int rounds = 10;
+    const int total = rounds * static_cast<int>(sizes.size());
+
+    auto server = ConnectionFactory::newServerConnectionShm(ShmEndPoint);
+    auto client = ConnectionFactory::newClientConnectionShm(ShmEndPoint);
+    std::atomic_int connected{0};
+    std::atomic_int received{0};
+    std::atomic_int mismatched{0};
+    std::atomic_int results{0};
+    server->onConnect([&] { ++connected; });
+    server->onReceived([&](Payload data) {
+        const int index = received;
+        const auto expectedSize = sizes[index % sizes.size()];
+        if(data.size() != expectedSize ||
+            (!data.empty() && (data.front() != static_cast<uint8_t>(index) ||
+                                  data.back() != static_cast<uint8_t>(index)))) {
+            ++mismatched;
+        }
+        ++received;
+    });
+    server->onInvoked([](Payload data) { return data; });
+
+    server->connect();
+    client->connect();
+    ASSERT_TRUE(waitFor(connected, 1));
+
+    for(int i = 0; i < total; ++i) {
+        client->send(Payload(std::vector<uint8_t>(sizes[i % sizes.size()], static_cast<uint8_t>(i))));
+    }
+    for(int i = 0; i < 100; ++i) {
+        client->invoke(std::to_string(i), [&, i](InvokeResultCode code, Payload result) {
+            if(code == InvokeResultCode::Good && result.asString() == std::to_string(i)) {
+                ++results;
+            }
+        });
+    }
+
+    EXPECT_TRUE(waitFor(received, total));
+    EXPECT_TRUE(waitFor(results, 100));
+    EXPECT_EQ(0, mismatched);
+}
+
+TEST(SharedMemoryTransportTest, WorksWithPipeServer)
+{
+    // The pipe server never offers a ring of its own but still reads the client's
+    auto server = ConnectionFactory::newServerConnection(ShmEndPoint);
+    auto client = ConnectionFactory::newClientConnectionShm(ShmEndPoint);
+    std::atomic_int connected{0};
+    std::atomic_int received{0};
+    server->onConnect([&] { ++connected; });
+    server->onInvoked([](Payload data) { return data; });
+
+    server->connect();
+    client->connect();
+    ASSERT_TRUE(waitFor(connected, 1));
+    for(int i = 0; i < 100; ++i) {
+        client->invoke(std::to_string(i), [&, i](InvokeResultCode code, Payload result) {
+            if(code == InvokeResultCode::Good && result.asString() == std::to_string(i)) {
+                ++received;
+            }
+        });
+    }
+    EXPECT_TRUE(waitFor(received, 100));
+}
+
+TEST(SharedPayloadTest, HandlesKeepOrderWithMessages)
+{
+    constexpr size_t blobSize = 8 * 1024 * 1024;
+    constexpr int rounds = 20;
+    auto server = ConnectionFactory::newMulticonnectServerConnection(ShmEndPoint);
+    auto client = ConnectionFactory::newClientConnection(ShmEndPoint);
+    std::atomic_int connected{0};
+    std::atomic_int received{0};
+    std::atomic_int mismatched{0};
+    std::atomic_int clientReceived{0};
+    Handle clientHandle{};
+    server->onConnect([&](Handle connectionHandle) {
+        clientHandle = connectionHandle;
+        ++connected;
+    });
+    // Even entries arrive as handles and odd ones as ordinary messages
+    server->onReceivedShared([&](Handle, SharedPayload data) {
+        const int index = received++;
+        if(index % 2 || data.size() != blobSize || data.data()[0] != static_cast<uint8_t>(index) ||
+            data.data()[blobSize - 1] != static_cast<uint8_t>(index)) {
+            ++mismatched;
+        }
+    });
+    server->onReceived([&](Handle, Payload data) {
+        const int index = received++;
+        if(index % 2 == 0 || data.asString() != std::to_string(index)) {
+            ++mismatched;
+        }
+    });
+    client->onReceivedShared([&](SharedPayload data) {
+        if(data.size() == 4096 && data.data()[100] == 7) {
+            ++clientReceived;
+        }
+    });
+
+    server->connect();
+    client->connect();
+    ASSERT_TRUE(waitFor(connected, 1));
+
+    for(int i = 0; i < rounds; ++i) {
+        const auto blob = makeSharedBlob(blobSize, static_cast<uint8_t>(2 * i));
+        EXPECT_TRUE(client->sendShared(blob, blobSize));
+        closeSharedBlob(blob);
+        client->send(std::to_string(2 * i + 1));
+    }
+    const auto blob = makeSharedBlob(4096, 7);
+    EXPECT_TRUE(server->sendShared(clientHandle, blob, 4096));
+    closeSharedBlob(blob);
+
+    EXPECT_TRUE(waitFor(received, 2 * rounds));
+    EXPECT_TRUE(waitFor(clientReceived, 1));
+    EXPECT_EQ(0, mismatched);
+}
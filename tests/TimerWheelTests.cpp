@@ -0,0 +1,55 @@
+// Copyright Twitch Interactive, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: MIT
+
+#include "TimerWheel.h"
+#include <vector>
+#include <gtest/gtest.h>
+
+using namespace Twitch::IPC;
+using namespace std::chrono_literals;
+
+using Wheel = TimerWheel<int>;
+
+TEST(TimerWheelTest, FiresOnlyOnceTheDeadlinePasses)
+{
+    Wheel wheel;
+    const auto start = Wheel::Clock::now();
+    std::vector<int> expired;
+    const auto collect = [&](int key) { expired.push_back(key); };
+
+    wheel.add(1, start + 30ms);
+    wheel.add(2, start + 10ms);
+    // Several turns of the wheel away, so it shares a slot with earlier ticks
+    wheel.add(3, start + Wheel::Resolution * Wheel::SlotCount * 3 + 30ms);
+    EXPECT_EQ(3u, wheel.size());
+
+    wheel.advance(start, collect);
+    EXPECT_TRUE(expired.empty());
+    wheel.advance(start + 25ms, collect);
+    EXPECT_EQ(std::vector<int>{2}, expired);
+    wheel.advance(start + 40ms, collect);
+    EXPECT_EQ((std::vector<int>{2, 1}), expired);
+
+    // Skipping straight past a long gap still finds what is due, and nothing that isn't
+    wheel.advance(start + Wheel::Resolution * Wheel::SlotCount * 3, collect);
+    EXPECT_EQ(2u, expired.size());
+    wheel.advance(start + Wheel::Resolution * Wheel::SlotCount * 3 + 50ms, collect);
+    EXPECT_EQ((std::vector<int>{2, 1, 3}), expired);
+    EXPECT_TRUE(wheel.empty());
+}
+
+TEST(TimerWheelTest, LateAddsFireOnTheNextTick)
+{
+    Wheel wheel;
+    const auto start = Wheel::Clock::now();
+    wheel.advance(start, [](int) {});
+    // Already due by the time it is added
+    wheel.add(7, start - 1s);
+    int fired = 0;
+    wheel.advance(start + Wheel::Resolution, [&](int key) {
+        EXPECT_EQ(7, key);
+        ++fired;
+    });
+    EXPECT_EQ(1, fired);
+    EXPECT_TRUE(wheel.empty());
+}
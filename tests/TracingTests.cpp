@@ -0,0 +1,46 @@
+// Copyright Twitch Interactive, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: MIT
+
+#include "ConnectionFactory.h"
+#include "Tracing.h"
+#include <chrono>
+#include <thread>
+#include <gtest/gtest.h>
+
+using namespace Twitch::IPC;
+using namespace std::chrono_literals;
+
+TEST(TracingTest, RecordsEveryStageOfAnInvoke)
+{
+    if(!Tracing::available()) {
+        GTEST_SKIP() << "built without NATIVEIPC_TRACING";
+    }
+    const std::string endpoint = "twitch-native-ipc.test.tracing.sock";
+    auto server = ConnectionFactory::newServerConnection(endpoint);
+    server->onInvoked([](Payload message) { return message; });
+    server->connect();
+    auto client = ConnectionFactory::newClientConnection(endpoint);
+    client->connect();
+    ASSERT_EQ(InvokeResultCode::Good, client->invokeBlocking("warm up", 10s).resultCode);
+
+    Tracing::dump();
+    Tracing::start();
+    for(int i = 0; i < 10; ++i) {
+        ASSERT_EQ(InvokeResultCode::Good, client->invokeBlocking("hello", 10s).resultCode);
+    }
+    Tracing::stop();
+    const auto trace = Tracing::dump();
+
+    EXPECT_EQ(0u, trace.find(R"({"displayTimeUnit":"ns","traceEvents":[{)"));
+    EXPECT_EQ(trace.size() - 2, trace.rfind("]}"));
+    for(const auto stage : {"write queue", "uv_write", "read", "dispatch queue", "handler"}) {
+        EXPECT_NE(std::string::npos, trace.find(std::string(R"("name":")") + stage + '"')) << stage;
+    }
+
+    // Stages already under way when tracing stopped still finish, but nothing new is recorded while
+    // stopped, and each dump only has what is new since the last
+    std::this_thread::sleep_for(100ms);
+    Tracing::dump();
+    EXPECT_EQ(InvokeResultCode::Good, client->invokeBlocking("hello", 10s).resultCode);
+    EXPECT_EQ(R"({"displayTimeUnit":"ns","traceEvents":[]})", Tracing::dump());
+}
@@ -0,0 +1,122 @@
+// Copyright Twitch Interactive, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: MIT
+
+#include "ConnectionFactory.h"
+#include "TypedMessage.h"
+#include <chrono>
+#include <gtest/gtest.h>
+
+using namespace Twitch::IPC;
+using namespace std::chrono_literals;
+
+namespace {
+struct SetVolume {
+    static constexpr auto MethodId = methodId("setVolume");
+    uint32_t source;
+    float level;
+};
+
+struct VolumeSet {
+    static constexpr auto MethodId = methodId("volumeSet");
+    double level;
+};
+
+// What a newer peer might send: SetVolume with a field appended
+struct SetVolumeV2 {
+    static constexpr auto MethodId = methodId("setVolume");
+    uint32_t source;
+    float level;
+    uint32_t fadeMilliseconds;
+};
+
+static_assert(IsTypedMessage<SetVolume>::value);
+static_assert(!IsTypedMessage<std::string>::value);
+} // namespace
+
+TEST(TypedMessageTest, ViewsReadInPlace)
+{
+    const std::string name = "microphone";
+    auto payload = encode(SetVolume{3, 0.5f}, name.data(), name.size());
+    EXPECT_EQ(SetVolume::MethodId, methodOf(payload));
+    const auto body = payload.data() + sizeof(TypedHeader);
+
+    MessageView<SetVolume> view(std::move(payload));
+    ASSERT_TRUE(view);
+    EXPECT_EQ(reinterpret_cast<const SetVolume *>(body), view.get());
+    EXPECT_EQ(3u, view->source);
+    EXPECT_EQ(0.5f, view->level);
+    EXPECT_EQ(name, view.tailString());
+}
+
+TEST(TypedMessageTest, RejectsOtherPayloads)
+{
+    EXPECT_EQ(0u, methodOf("hi"));
+    EXPECT_FALSE(MessageView<SetVolume>("not a typed message at all"));
+    EXPECT_FALSE(MessageView<VolumeSet>(encode(SetVolume{1, 1.0f})));
+
+    auto truncated = encode(SetVolume{1, 1.0f});
+    truncated.pop_back();
+    EXPECT_FALSE(MessageView<SetVolume>(std::move(truncated)));
+}
+
+TEST(TypedMessageTest, ReadsNewerLayouts)
+{
+    const std::string tail = "tail";
+    MessageView<SetVolume> view(encode(SetVolumeV2{7, 0.25f, 100}, tail.data(), tail.size()));
+    ASSERT_TRUE(view);
+    EXPECT_EQ(7u, view->source);
+    EXPECT_EQ(0.25f, view->level);
+    // The appended field isn't mistaken for the tail
+    EXPECT_EQ(tail, view.tailString());
+
+}
+
+TEST(TypedMessageTest, ReadsOlderLayouts)
+{
+    const std::string tail = "tail";
+    MessageView<SetVolumeV2> view(encode(SetVolume{7, 0.25f}, tail.data(), tail.size()));
+    ASSERT_TRUE(view);
+    EXPECT_EQ(7u, view->source);
+    EXPECT_EQ(0.25f, view->level);
+    // The field the sender didn't have yet reads as zero, and the tail still starts where it put it
+    EXPECT_EQ(0u, view->fadeMilliseconds);
+    EXPECT_EQ(tail, view.tailString());
+
+    // Moving the view keeps what was filled in
+    const auto moved = std::move(view);
+    EXPECT_EQ(7u, moved->source);
+}
+
+TEST(TypedMessageTest, MethodTableRoutesByMethodId)
+{
+    MethodTable methods;
+    int volumeSets = 0;
+    methods.on<SetVolume>([](MessageView<SetVolume> message) { return encode(VolumeSet{message->level * 2.0}); });
+    methods.on<VolumeSet>([&](MessageView<VolumeSet>) { ++volumeSets; });
+    methods.otherwise([](Payload message) { return Payload("untyped " + message.asString()); });
+
+    MessageView<VolumeSet> result(methods.dispatch(encode(SetVolume{1, 0.25f})));
+    ASSERT_TRUE(result);
+    EXPECT_EQ(0.5, result->level);
+    EXPECT_TRUE(methods.dispatch(encode(VolumeSet{1.0})).empty());
+    EXPECT_EQ(1, volumeSets);
+    EXPECT_EQ("untyped hello", methods.dispatch("hello").asString());
+}
+
+TEST(TypedMessageTest, InvokesOverConnection)
+{
+    const std::string endpoint = "twitch-native-ipc.test.typed.sock";
+    MethodTable methods;
+    methods.on<SetVolume>([](MessageView<SetVolume> message) { return encode(VolumeSet{message->level * 2.0}); });
+    auto server = ConnectionFactory::newServerConnection(endpoint);
+    server->onInvoked(methods.invokedHandler());
+    server->connect();
+    auto client = ConnectionFactory::newClientConnection(endpoint);
+    client->connect();
+
+    auto result = client->invokeBlocking(encode(SetVolume{2, 0.75f}), 10s);
+    ASSERT_EQ(InvokeResultCode::Good, result.resultCode);
+    MessageView<VolumeSet> view(std::move(result.payload));
+    ASSERT_TRUE(view);
+    EXPECT_EQ(1.5, view->level);
+}
@@ -0,0 +1,184 @@
+// Copyright Twitch Interactive, Inc. or its affiliates. All Rights Reserved.
+// SPDX-License-Identifier: MIT
+
+#include "IntrusiveMPSCQueue.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+
+using namespace Twitch::IPC;
+
+// Compares the lock-free write queue against the mutex-guarded queue it replaced
+#define INCLUDE_WRITE_QUEUE_BENCHMARK 0
+
+namespace {
+struct Node {
+    int producer;
+    int sequence;
+    Node *next{};
+    Node(int p, int s)
+        : producer(p)
+        , sequence(s)
+    {
+    }
+};
+
+constexpr int ProducerCount = 8;
+} // namespace
+
+TEST(IntrusiveMPSCQueueTest, PopAllReturnsOldestFirst)
+{
+    IntrusiveMPSCQueue<Node> queue;
+    EXPECT_TRUE(queue.empty());
+    EXPECT_TRUE(queue.push(std::make_unique<Node>(0, 0)));
+    EXPECT_FALSE(queue.push(std::make_unique<Node>(0, 1)));
+    EXPECT_FALSE(queue.push(std::make_unique<Node>(0, 2)));
+
+    int expected = 0;
+    auto *node = queue.popAll();
+    EXPECT_TRUE(queue.empty());
+    while(node) {
+        EXPECT_EQ(expected++, node->sequence);
+        std::unique_ptr<Node> owned(node);
+        node = node->next;
+    }
+    EXPECT_EQ(3, expected);
+}
+
+TEST(IntrusiveMPSCQueueTest, PushListKeepsOrder)
+{
+    IntrusiveMPSCQueue<Node> queue;
+    queue.push(std::make_unique<Node>(0, 0));
+
+    auto *oldest = new Node(0, 1);
+    auto *newest = new Node(0, 2);
+    newest->next = oldest;
+    EXPECT_FALSE(queue.pushList(newest, oldest));
+
+    int expected = 0;
+    auto *node = queue.popAll();
+    while(node) {
+        EXPECT_EQ(expected++, node->sequence);
+        std::unique_ptr<Node> owned(node);
+        node = node->next;
+    }
+    EXPECT_EQ(3, expected);
+}
+
+TEST(IntrusiveMPSCQueueTest, ManyProducersKeepPerProducerOrder)
+{
+    constexpr int perProducer = 20000;
+    IntrusiveMPSCQueue<Node> queue;
+    std::atomic_int finished{0};
+    std::vector<std::thread> producers;
+    for(int p = 0; p < ProducerCount; ++p) {
+        producers.emplace_back([&queue, &finished, p] {
+            for(int i = 0; i < perProducer; ++i) {
+                queue.push(std::make_unique<Node>(p, i));
+            }
+            ++finished;
+        });
+    }
+
+    std::vector<int> nextSequence(ProducerCount);
+    int received = 0;
+    int outOfOrder = 0;
+    while(received < ProducerCount * perProducer) {
+        auto *node = queue.popAll();
+        if(!node && finished == ProducerCount && queue.empty()) {
+            break;
+        }
+        while(node) {
+            if(node->sequence != nextSequence[node->producer]++) {
+                ++outOfOrder;
+            }
+            ++received;
+            std::unique_ptr<Node> owned(node);
+            node = node->next;
+        }
+    }
+    for(auto &i : producers) {
+        i.join();
+    }
+    EXPECT_EQ(ProducerCount * perProducer, received);
+    EXPECT_EQ(0, outOfOrder);
+}
+
+#if INCLUDE_WRITE_QUEUE_BENCHMARK
+namespace {
+template<typename Push, typename Drain>
+double runQueueBenchmark(int perProducer, Push push, Drain drain)
+{
+    std::atomic_int finished{0};
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> producers;
+    for(int p = 0; p < ProducerCount; ++p) {
+        producers.emplace_back([&, p] {
+            for(int i = 0; i < perProducer; ++i) {
+                push(std::make_unique<Node>(p, i));
+            }
+            ++finished;
+        });
+    }
+    int received = 0;
+    while(received < ProducerCount * perProducer) {
+        received += drain();
+    }
+    const std::chrono::duration<double, std::nano> elapsed =
+        std::chrono::steady_clock::now() - start;
+    for(auto &i : producers) {
+        i.join();
+    }
+    return elapsed.count() / (ProducerCount * perProducer);
+}
+} // namespace
+
+TEST(IntrusiveMPSCQueueTest, BenchmarkAgainstMutexQueue)
+{
+    constexpr int perProducer = 500000;
+
+    std::mutex mutex;
+    std::vector<std::unique_ptr<Node>> locked;
+    std::vector<std::unique_ptr<Node>> lockedDrained;
+    const auto mutexNs = runQueueBenchmark(
+        perProducer,
+        [&](std::unique_ptr<Node> node) {
+            std::lock_guard guard(mutex);
+            locked.emplace_back(std::move(node));
+        },
+        [&] {
+            {
+                std::lock_guard guard(mutex);
+                lockedDrained.swap(locked);
+            }
+            const auto count = static_cast<int>(lockedDrained.size());
+            lockedDrained.clear();
+            return count;
+        });
+
+    IntrusiveMPSCQueue<Node> queue;
+    const auto lockFreeNs = runQueueBenchmark(
+        perProducer,
+        [&](std::unique_ptr<Node> node) { queue.push(std::move(node)); },
+        [&] {
+            int count = 0;
+            auto *node = queue.popAll();
+            while(node) {
+                std::unique_ptr<Node> owned(node);
+                node = node->next;
+                ++count;
+            }
+            return count;
+        });
+
+    printf("%d producers: mutex queue %.1f ns/message, lock-free queue %.1f ns/message\n",
+        ProducerCount,
+        mutexNs,
+        lockFreeNs);
+}
+#endif